@@ -0,0 +1,113 @@
+/**
+ * @~Chinese
+ * @file mecanum_drive.ino
+ * @brief 示例：按车体速度驱动四轮麦克纳姆轮底盘并输出里程计。
+ * @example mecanum_drive.ino
+ * 按车体速度驱动四轮麦克纳姆轮底盘依次前进、左移和原地旋转，并输出积分得到的位姿。
+ */
+/**
+ * @~English
+ * @file mecanum_drive.ino
+ * @brief Example: Drive a four-wheel mecanum base by body velocity and print the odometry.
+ * @example mecanum_drive.ino
+ * Drive a four-wheel mecanum base forward, sideways to the left and rotate in place in turn, and print the integrated
+ * pose.
+ */
+
+#include "drive_base.h"
+#include "drive_kinematics.h"
+#include "esp_encoder_motor.h"
+#include "esp_encoder_motor_lib.h"
+
+namespace {
+constexpr uint32_t kPPR = 12;              // Pulses per revolution.
+constexpr uint32_t kReductionRation = 90;  // Reduction ratio.
+constexpr float kWheelRadius = 0.03;       // Meters.
+constexpr float kWheelBase = 0.16;         // Meters between the front and rear wheels.
+constexpr float kTrackWidth = 0.18;        // Meters between the left and right wheels.
+constexpr float kMaxWheelRpm = 100;
+
+em::EspEncoderMotor g_encoder_motor_0(  // E0
+    GPIO_NUM_27,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_13,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_18,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_19,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_1(  // E1
+    GPIO_NUM_4,                         // The pin number of the motor's positive pole.
+    GPIO_NUM_2,                         // The pin number of the motor's negative pole.
+    GPIO_NUM_5,                         // The pin number of the encoder's A phase.
+    GPIO_NUM_23,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_2(  // E2
+    GPIO_NUM_17,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_12,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_35,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_36,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_3(  // E3
+    GPIO_NUM_15,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_14,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_34,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_39,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+const em::MecanumKinematics g_kinematics(kWheelRadius, kWheelBase, kTrackWidth);
+
+// Wheels in the order front left (E0), front right (E1), rear left (E2), rear right (E3). A positive speed must roll every
+// wheel forward, swap the motor pins and the phase relationship of the motors mounted mirrored on the right side.
+em::DriveBase g_drive_base(g_kinematics,
+                           {&g_encoder_motor_0, &g_encoder_motor_1, &g_encoder_motor_2, &g_encoder_motor_3},
+                           kMaxWheelRpm);
+
+// Forward, left and counterclockwise, 3 seconds each.
+const em::Twist kMoves[] = {{0.15, 0, 0}, {0, 0.15, 0}, {0, 0, 1.0}};
+size_t g_move = 0;
+unsigned long g_move_start_ms = 0;
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  printf("setting up\n");
+  printf("Emakefun ESP Encoder Motor Library Version: %s\n", em::esp_encoder_motor_lib::Version().c_str());
+  g_drive_base.Init();
+  printf("setup completed\n");
+}
+
+void loop() {
+  if (millis() - g_move_start_ms >= 3000) {
+    g_move_start_ms = millis();
+    g_drive_base.Drive(kMoves[g_move]);
+    g_move = (g_move + 1) % (sizeof(kMoves) / sizeof(kMoves[0]));
+  }
+
+  const em::DriveBase::State state = g_drive_base.GetState();
+  printf("pose: [x: %.3f m, y: %.3f m, theta: %.3f rad], twist: [%.3f m/s, %.3f m/s, %.3f rad/s]\n",
+         state.pose.x,
+         state.pose.y,
+         state.pose.theta,
+         state.twist.linear_x,
+         state.twist.linear_y,
+         state.twist.angular_z);
+
+  delay(100);
+}
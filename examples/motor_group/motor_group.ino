@@ -0,0 +1,138 @@
+/**
+ * @~Chinese
+ * @file motor_group.ino
+ * @brief 示例：用电机组同步驱动四个电机，并读取同一采样时刻的状态。
+ * @example motor_group.ino
+ * 四个电机组成一个 @ref em::MotorGroup，每两秒切换一次指令：前进、原地转向、后退、停止。每条指令在同一个控制周期内
+ * 作用到所有电机，各电机不会先后改变转速。@ref em::MotorGroup::GetSnapshots 返回的状态来自同一个采样时刻。
+ */
+/**
+ * @~English
+ * @file motor_group.ino
+ * @brief Example: Drive four motors in sync through a motor group, and read their state from the same sampling instant.
+ * @example motor_group.ino
+ * The four motors form one @ref em::MotorGroup, which switches between forward, turning in place, backward and stop every
+ * two seconds. Every command takes effect on all motors in the same control tick, so the motors don't change speed one
+ * after another. The states returned by @ref em::MotorGroup::GetSnapshots come from the same sampling instant.
+ */
+
+#include "esp_encoder_motor.h"
+#include "esp_encoder_motor_lib.h"
+#include "motor_group.h"
+
+namespace {
+constexpr uint32_t kPPR = 12;              // Pulses per revolution.
+constexpr uint32_t kReductionRation = 90;  // Reduction ratio.
+constexpr int16_t kRpm = 100;
+
+em::EspEncoderMotor g_encoder_motor_0(  // E0
+    GPIO_NUM_27,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_13,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_18,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_19,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_1(  // E1
+    GPIO_NUM_4,                         // The pin number of the motor's positive pole.
+    GPIO_NUM_2,                         // The pin number of the motor's negative pole.
+    GPIO_NUM_5,                         // The pin number of the encoder's A phase.
+    GPIO_NUM_23,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_2(  // E2
+    GPIO_NUM_17,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_12,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_35,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_36,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_3(  // E3
+    GPIO_NUM_15,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_14,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_34,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_39,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+// Motors E0 and E2 are on the left, E1 and E3 on the right.
+em::MotorGroup g_motor_group({&g_encoder_motor_0, &g_encoder_motor_1, &g_encoder_motor_2, &g_encoder_motor_3});
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  printf("setting up\n");
+  printf("Emakefun ESP Encoder Motor Library Version: %s\n", em::esp_encoder_motor_lib::Version().c_str());
+  if (!g_motor_group.Init()) {
+    printf("failed to register the motor group with the control scheduler\n");
+  }
+  printf("setup completed\n");
+}
+
+void loop() {
+  static auto s_state_changed_time = millis();
+  static enum State : uint8_t {
+    kForward,
+    kTurn,
+    kBackward,
+    kStop,
+    kStateNum,
+  } s_state = kForward;
+
+  if (millis() - s_state_changed_time > 2000) {
+    switch (s_state) {
+      case kForward:
+        g_motor_group.RunSpeed({kRpm, kRpm, kRpm, kRpm});
+        break;
+      case kTurn:
+        g_motor_group.RunSpeed({-kRpm, kRpm, -kRpm, kRpm});
+        break;
+      case kBackward:
+        g_motor_group.RunSpeed({-kRpm, -kRpm, -kRpm, -kRpm});
+        break;
+      case kStop:
+        g_motor_group.Stop();
+        break;
+      default:
+        break;
+    }
+    s_state = static_cast<State>((static_cast<uint8_t>(s_state) + 1) % kStateNum);
+    s_state_changed_time = millis();
+  }
+
+  // All four snapshots come from the same sampling instant.
+  em::EspEncoderMotor::Snapshot snapshots[4];
+  g_motor_group.GetSnapshots(snapshots, 4);
+
+  printf("time us: %" PRId64 ", current speed rpm: [%4.0f, %4.0f, %4.0f, %4.0f], pwm duties: [%5" PRIi16 ", %5" PRIi16
+         ", %5" PRIi16 ", %5" PRIi16 "], pulse counts: [%" PRId64 ", %" PRId64 ", %" PRId64 ", %" PRId64 "]\n",
+         snapshots[0].time_us,
+         snapshots[0].speed_rpm,
+         snapshots[1].speed_rpm,
+         snapshots[2].speed_rpm,
+         snapshots[3].speed_rpm,
+         snapshots[0].pwm_duty,
+         snapshots[1].pwm_duty,
+         snapshots[2].pwm_duty,
+         snapshots[3].pwm_duty,
+         snapshots[0].pulse_count,
+         snapshots[1].pulse_count,
+         snapshots[2].pulse_count,
+         snapshots[3].pulse_count);
+
+  delay(100);
+}
@@ -0,0 +1,52 @@
+/**
+ * @~Chinese
+ * @file record_telemetry.ino
+ * @brief 示例：记录电机每个控制周期的遥测数据，并以二进制帧从串口输出。
+ * @example record_telemetry.ino
+ * 以固定速度驱动电机，每个控制周期记录目标转速、测得转速、PWM占空比和脉冲计数，在 @c loop() 中以二进制帧写入串口。
+ * 串口只输出二进制数据，把串口数据保存为文件后用主机工具 extras/tools/telemetry_to_csv 转换为CSV。
+ */
+/**
+ * @~English
+ * @file record_telemetry.ino
+ * @brief Example: Record the telemetry of every control tick of a motor and output it over the serial port as binary
+ * frames.
+ * @example record_telemetry.ino
+ * Drive the motor at a fixed speed, record the target speed, measured speed, PWM duty and pulse count of every control
+ * tick, and write them to the serial port as binary frames in @c loop(). The serial port carries binary data only, save
+ * it to a file and convert it to CSV with the host tool extras/tools/telemetry_to_csv.
+ */
+
+#include "esp_encoder_motor.h"
+#include "telemetry_recorder.h"
+
+namespace {
+constexpr uint32_t kPPR = 12;              // Pulses per revolution.
+constexpr uint32_t kReductionRation = 90;  // Reduction ratio.
+
+em::EspEncoderMotor g_encoder_motor_0(  // E0
+    GPIO_NUM_27,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_13,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_18,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_19,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+// 64 records cover 3.2 seconds at the default 50 ms control period, leaving room for a slow serial port.
+em::StaticTelemetryRecorder<64> g_recorder_0(0);
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  g_encoder_motor_0.SetTelemetryRecorder(&g_recorder_0);
+  g_encoder_motor_0.Init();
+  g_encoder_motor_0.RunSpeed(100);
+}
+
+void loop() {
+  g_recorder_0.Stream([](const uint8_t* data, size_t size) { return Serial.write(data, size); });
+  delay(10);
+}
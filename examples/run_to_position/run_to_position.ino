@@ -0,0 +1,68 @@
+/**
+ * @~Chinese
+ * @file run_to_position.ino
+ * @brief 示例：按S形速度曲线驱动电机往返运动到指定的位置。
+ * @example run_to_position.ino
+ * 按S形速度曲线驱动电机往返运动到指定的位置，到达后通过回调函数通知。
+ */
+/**
+ * @~English
+ * @file run_to_position.ino
+ * @brief Example: Move the motor back and forth to given positions along an S-curve velocity profile.
+ * @example run_to_position.ino
+ * Move the motor back and forth to given positions along an S-curve velocity profile, notified by a callback on arrival.
+ */
+
+#include <atomic>
+
+#include "esp_encoder_motor.h"
+#include "esp_encoder_motor_lib.h"
+
+namespace {
+constexpr uint32_t kPPR = 12;              // Pulses per revolution.
+constexpr uint32_t kReductionRation = 90;  // Reduction ratio.
+
+em::EspEncoderMotor g_encoder_motor_0(  // E0
+    GPIO_NUM_27,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_13,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_18,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_19,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+std::atomic<bool> g_move_ended = true;
+int64_t g_distance = kPPR * kReductionRation;  // One revolution with the default x1 decoding.
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  printf("setting up\n");
+  printf("Emakefun ESP Encoder Motor Library Version: %s\n", em::esp_encoder_motor_lib::Version().c_str());
+  g_encoder_motor_0.Init();
+  g_encoder_motor_0.SetMotionLimits(100, 300, 3000);  // 100 RPM, 300 RPM/s, 3000 RPM/s².
+  printf("setup completed\n");
+}
+
+void loop() {
+  if (g_move_ended) {
+    g_move_ended = false;
+    g_encoder_motor_0.RunRelative(g_distance, [](bool /* reached */) {
+      // Called from the control thread, only set a flag here.
+      g_move_ended = true;
+    });
+    g_distance = -g_distance;
+  }
+
+  printf("target position: %" PRId64 ", position: %" PRId64 ", target speed rpm: %4" PRId32 ", speed rpm: %4" PRId32
+         ", reached: %d\n",
+         g_encoder_motor_0.TargetPosition(),
+         g_encoder_motor_0.EncoderPulseCount(),
+         g_encoder_motor_0.TargetRpm(),
+         g_encoder_motor_0.SpeedRpm(),
+         g_encoder_motor_0.PositionReached());
+
+  delay(100);
+}
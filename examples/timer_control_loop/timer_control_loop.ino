@@ -0,0 +1,108 @@
+/**
+ * @~Chinese
+ * @file timer_control_loop.ino
+ * @brief 示例：由硬件定时器以1kHz驱动四个电机的控制循环，并输出调度抖动。
+ * @example timer_control_loop.ino
+ * 四个电机注册到同一个触发方式为 @ref em::ControlScheduler::kTimer 的调度器，采样和PID计算由esp_timer按固定频率触发，
+ * 不受其他任务调度的影响。每秒输出一次调度统计信息和抖动（最大与最小延迟之差），
+ * 以及抖动是否在10微秒的目标之内。
+ */
+/**
+ * @~English
+ * @file timer_control_loop.ino
+ * @brief Example: Run the control loop of four motors at 1 kHz from a hardware timer, and print the scheduling jitter.
+ * @example timer_control_loop.ino
+ * The four motors are registered with one scheduler using the @ref em::ControlScheduler::kTimer tick source, so the
+ * sampling and the PID updates are triggered by esp_timer at a fixed rate, regardless of how other tasks are scheduled.
+ * The scheduling statistics are printed once per second with the jitter, the spread between the largest and the smallest
+ * lateness, and whether it is within the 10 µs target.
+ */
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+
+namespace {
+constexpr uint32_t kPPR = 12;              // Pulses per revolution.
+constexpr uint32_t kReductionRation = 90;  // Reduction ratio.
+constexpr uint32_t kPeriodUs = 1000;       // 1 kHz.
+constexpr int64_t kJitterTargetUs = 10;    // The jitter target.
+
+em::ControlScheduler g_scheduler(kPeriodUs, em::DefaultHal(), em::ControlScheduler::kTimer);
+
+em::EspEncoderMotor g_encoder_motor_0(  // E0
+    GPIO_NUM_27,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_13,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_18,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_19,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_1(  // E1
+    GPIO_NUM_4,                         // The pin number of the motor's positive pole.
+    GPIO_NUM_2,                         // The pin number of the motor's negative pole.
+    GPIO_NUM_5,                         // The pin number of the encoder's A phase.
+    GPIO_NUM_23,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_2(  // E2
+    GPIO_NUM_17,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_12,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_35,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_36,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+
+em::EspEncoderMotor g_encoder_motor_3(  // E3
+    GPIO_NUM_15,                        // The pin number of the motor's positive pole.
+    GPIO_NUM_14,                        // The pin number of the motor's negative pole.
+    GPIO_NUM_34,                        // The pin number of the encoder's A phase.
+    GPIO_NUM_39,                        // The pin number of the encoder's B phase.
+    kPPR,                               // Pulses per revolution.
+    kReductionRation,                   // Reduction ratio.
+    em::EspEncoderMotor::kAPhaseLeads   // Phase relationship (A phase leads or B phase leads, referring to the situation when
+                                        // the motor is rotating forward)
+);
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+  printf("setting up\n");
+  g_encoder_motor_0.Init(g_scheduler);
+  g_encoder_motor_1.Init(g_scheduler);
+  g_encoder_motor_2.Init(g_scheduler);
+  g_encoder_motor_3.Init(g_scheduler);
+  g_encoder_motor_0.RunSpeed(60);
+  g_encoder_motor_1.RunSpeed(60);
+  g_encoder_motor_2.RunSpeed(60);
+  g_encoder_motor_3.RunSpeed(60);
+  printf("setup completed\n");
+}
+
+void loop() {
+  const em::ControlScheduler::Statistics statistics = g_scheduler.GetStatistics();
+  g_scheduler.ResetStatistics();
+  const int64_t jitter_us = statistics.max_lateness_us - statistics.min_lateness_us;
+  printf(
+      "ticks: %llu, overruns: %llu, lateness: [min: %lld us, max: %lld us, mean: %lld us], max execution: %lld us, "
+      "jitter: %lld us (%s the %lld us target)\n",
+      statistics.ticks,
+      statistics.overruns,
+      statistics.min_lateness_us,
+      statistics.max_lateness_us,
+      statistics.mean_lateness_us,
+      statistics.max_execution_us,
+      jitter_us,
+      jitter_us <= kJitterTargetUs ? "within" : "outside",
+      kJitterTargetUs);
+  delay(1000);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#ifndef _EM_BENCHMARK_RIG_H_
+#define _EM_BENCHMARK_RIG_H_
+
+/**
+ * @file benchmark_rig.h
+ * @brief Simulated motor fixtures and step-response metrics shared by the closed-loop benchmarks.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "edge_timestamp_buffer.h"
+#include "esp_encoder_motor.h"
+#include "esp_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+#include "quadrature_decoder.h"
+
+namespace em::benchmark {
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+constexpr uint32_t kPpr = 12;
+constexpr uint32_t kReduction = 90;
+
+// Owns one simulated motor under the control of an EspEncoderMotor on a manually ticked scheduler. The motor is
+// configured through motor() and then started with Init().
+class MotorRig {
+ public:
+  MotorRig(const uint32_t period_us, const MotorSimulator::Parameters& parameters)
+      : period_us_(period_us),
+        scheduler_(period_us, hal_, ControlScheduler::kManual),
+        simulator_(hal_, kPositivePin, kNegativePin, kAPin, kBPin, parameters),
+        motor_(kPositivePin, kNegativePin, kAPin, kBPin, kPpr, kReduction, EspEncoderMotor::kAPhaseLeads, hal_) {
+  }
+
+  void Init() {
+    motor_.Init(scheduler_);
+  }
+
+  // Advances one control period and runs one control tick, timing the tick.
+  void Tick() {
+    simulator_.Advance(period_us_);
+    const auto start = std::chrono::steady_clock::now();
+    scheduler_.Tick();
+    tick_ns_ += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    ++ticks_;
+  }
+
+  // The mean host time of the ticks run through Tick().
+  double TickNs() const {
+    return ticks_ > 0 ? tick_ns_ / ticks_ : 0;
+  }
+
+  HostHal& hal() {
+    return hal_;
+  }
+
+  ControlScheduler& scheduler() {
+    return scheduler_;
+  }
+
+  MotorSimulator& simulator() {
+    return simulator_;
+  }
+
+  EspEncoderMotor& motor() {
+    return motor_;
+  }
+
+ private:
+  const uint32_t period_us_;
+  HostHal hal_;
+  ControlScheduler scheduler_;
+  MotorSimulator simulator_;
+  EspEncoderMotor motor_;
+  double tick_ns_ = 0;
+  uint64_t ticks_ = 0;
+};
+
+// Owns one simulated motor driven directly through EspMotor, its encoder decoded and timestamped by an interrupt
+// handler like EspEncoderMotor does, for benchmarks that run the speed path themselves.
+class EncoderRig {
+ public:
+  EncoderRig(const MotorSimulator::Parameters& parameters, const QuadratureDecoder::Mode mode)
+      : simulator_(hal_, kPositivePin, kNegativePin, kAPin, kBPin, parameters),
+        driver_(kPositivePin, kNegativePin, hal_),
+        decoder_(mode) {
+    driver_.Init();
+    decoder_.Reset(hal_.DigitalRead(kAPin), hal_.DigitalRead(kBPin));
+    hal_.AttachInterrupt(kAPin, EncoderRig::OnEncoderEdge, this, Hal::kFalling);
+  }
+
+  // The decoded count, updated by the interrupt handler as the simulator advances.
+  int64_t Count() const {
+    return count_;
+  }
+
+  const EdgeTimestampBuffer& edges() const {
+    return edges_;
+  }
+
+  HostHal& hal() {
+    return hal_;
+  }
+
+  MotorSimulator& simulator() {
+    return simulator_;
+  }
+
+  EspMotor& driver() {
+    return driver_;
+  }
+
+ private:
+  static void OnEncoderEdge(void* self) {
+    auto* const rig = reinterpret_cast<EncoderRig*>(self);
+    const int8_t step = rig->decoder_.Update(rig->hal_.DigitalRead(kAPin), rig->hal_.DigitalRead(kBPin));
+    if (step != 0) {
+      rig->edges_.Push(rig->hal_.Micros(), rig->count_.fetch_add(step) + step);
+    }
+  }
+
+  HostHal hal_;
+  MotorSimulator simulator_;
+  EspMotor driver_;
+  QuadratureDecoder decoder_;
+  EdgeTimestampBuffer edges_;
+  std::atomic<int64_t> count_ = 0;
+};
+
+struct StepMetrics {
+  // From 10% to 90% of the step, -1 if not reached.
+  double rise_ms = -1;
+  // Until the speed stays within the band around the target, -1 if it never does.
+  double settling_ms = -1;
+  double overshoot_percent = 0;
+};
+
+// Measures a step from start_rpm to target_rpm on the speeds sampled once per period after the step, at the resolution
+// of the period.
+inline StepMetrics MeasureStep(const std::vector<float>& speeds,
+                               const float start_rpm,
+                               const float target_rpm,
+                               const uint32_t period_us,
+                               const double settle_band = 0.02) {
+  const int ticks = static_cast<int>(speeds.size());
+  int rise_start = -1;
+  int rise_end = -1;
+  int settled = 0;
+  float peak = 0;
+  for (int i = 0; i < ticks; ++i) {
+    const float fraction = (speeds[i] - start_rpm) / (target_rpm - start_rpm);
+    if (rise_start < 0 && fraction >= 0.1f) {
+      rise_start = i;
+    }
+    if (rise_end < 0 && fraction >= 0.9f) {
+      rise_end = i;
+    }
+    if (std::fabs(fraction - 1) > settle_band) {
+      settled = i + 1;
+    }
+    peak = std::max(peak, fraction);
+  }
+
+  StepMetrics metrics;
+  metrics.rise_ms = rise_start < 0 || rise_end < 0 ? -1.0 : (rise_end - rise_start) * period_us / 1000.0;
+  metrics.settling_ms = settled >= ticks ? -1.0 : settled * period_us / 1000.0;
+  metrics.overshoot_percent = std::max(peak - 1, 0.0f) * 100;
+  return metrics;
+}
+}  // namespace em::benchmark
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file closed_loop_sim.cpp
+ * @brief Runs the speed and position loops of EspEncoderMotor against MotorSimulator in virtual time.
+ *
+ * The scheduler is ticked manually between simulator advances, so the results only depend on the control code and
+ * the simulation parameters, not on the host. Reports step-response metrics of the true output shaft speed, the
+ * position tracking error, and the host CPU time spent in the control tick. Prints one JSON object per scenario.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "benchmark_rig.h"
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "motor_simulator.h"
+
+namespace {
+using em::benchmark::MotorRig;
+
+constexpr uint32_t kPeriodUs = em::ControlScheduler::kDefaultPeriodUs;
+constexpr auto kDecodingMode = em::QuadratureDecoder::kX1;
+// Positions are in decoded pulses, one output shaft revolution at the default x1 decoding.
+constexpr int64_t kPulsesPerRevolution = em::benchmark::kPpr * em::benchmark::kReduction * kDecodingMode;
+
+// Starts the motor of the rig with the given encoder backend.
+void InitRig(MotorRig& rig, const em::EspEncoderMotor::EncoderBackend backend) {
+  rig.motor().SetEncoderBackend(backend);
+  rig.motor().SetDecodingMode(kDecodingMode);
+  rig.Init();
+}
+
+void RunStep(const char* const name,
+             const em::MotorSimulator::Parameters& parameters,
+             const em::EspEncoderMotor::EncoderBackend backend,
+             const int16_t target_rpm,
+             const float load_torque) {
+  constexpr int kTicks = 60;
+  constexpr int kSteadyTicks = 20;
+
+  MotorRig rig(kPeriodUs, parameters);
+  InitRig(rig, backend);
+  rig.simulator().SetLoadTorque(load_torque);
+  rig.motor().RunSpeed(target_rpm);
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  std::vector<float> speeds;
+  double squared_error = 0;
+  for (int i = 0; i < kTicks; ++i) {
+    rig.Tick();
+    speeds.push_back(rig.simulator().SpeedRpm());
+    if (i >= kTicks - kSteadyTicks) {
+      const double error = rig.motor().SpeedRpmFloat() - target_rpm;
+      squared_error += error * error;
+    }
+  }
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  const em::benchmark::StepMetrics metrics = em::benchmark::MeasureStep(speeds, 0, target_rpm, kPeriodUs);
+
+  printf(
+      "{\"benchmark\": \"closed_loop_sim\", \"scenario\": \"%s\", \"target_rpm\": %d, \"rise_ms\": %.1f, "
+      "\"settling_ms\": %.1f, \"overshoot_percent\": %.2f, \"steady_rms_error_rpm\": %.3f, \"missed_edges\": %llu, "
+      "\"tick_ns\": %.0f, \"realtime_factor\": %.1f}\n",
+      name,
+      target_rpm,
+      metrics.rise_ms,
+      metrics.settling_ms,
+      metrics.overshoot_percent,
+      std::sqrt(squared_error / kSteadyTicks),
+      static_cast<unsigned long long>(rig.simulator().MissedEdges()),
+      rig.TickNs(),
+      kTicks * kPeriodUs / 1000000.0 / wall_s);
+}
+
+void RunPosition(const char* const name, const em::MotorSimulator::Parameters& parameters, const int64_t target) {
+  constexpr int kMaxTicks = 200;
+  constexpr int kHoldTicks = 20;
+
+  MotorRig rig(kPeriodUs, parameters);
+  InitRig(rig, em::EspEncoderMotor::kGpioInterrupt);
+  int reached_tick = -1;
+  int tick = 0;
+  rig.motor().RunToPosition(target, [&](const bool reached) {
+    if (reached) {
+      reached_tick = tick;
+    }
+  });
+
+  // The commanded trajectory isn't observable from outside, so track against the target after reaching it.
+  int64_t max_overshoot = 0;
+  for (tick = 0; tick < kMaxTicks && (reached_tick < 0 || tick < reached_tick + kHoldTicks); ++tick) {
+    rig.Tick();
+    max_overshoot = std::max(max_overshoot, (rig.motor().EncoderPulseCount() - target) * (target < 0 ? -1 : 1));
+  }
+
+  const double true_pulses = rig.simulator().Revolutions() * kPulsesPerRevolution;
+  printf(
+      "{\"benchmark\": \"closed_loop_sim\", \"scenario\": \"%s\", \"target_pulses\": %lld, \"reached_ms\": %.1f, "
+      "\"overshoot_pulses\": %lld, \"final_error_pulses\": %lld, \"true_final_error_pulses\": %.1f, \"tick_ns\": %.0f}\n",
+      name,
+      static_cast<long long>(target),
+      reached_tick < 0 ? -1.0 : (reached_tick + 1) * kPeriodUs / 1000.0,
+      static_cast<long long>(max_overshoot),
+      static_cast<long long>(rig.motor().EncoderPulseCount() - target),
+      true_pulses - target,
+      rig.TickNs());
+}
+}  // namespace
+
+int main() {
+  const em::MotorSimulator::Parameters nominal;
+
+  em::MotorSimulator::Parameters noisy;
+  noisy.edge_jitter_us = 20;
+  noisy.missed_edge_probability = 0.01;
+  noisy.backlash = 0.2;
+
+  RunStep("step_gpio", nominal, em::EspEncoderMotor::kGpioInterrupt, 100, 0);
+  RunStep("step_pulse_counter", nominal, em::EspEncoderMotor::kPulseCounter, 100, 0);
+  RunStep("step_loaded", nominal, em::EspEncoderMotor::kGpioInterrupt, 100, 0.3);
+  RunStep("step_noisy", noisy, em::EspEncoderMotor::kGpioInterrupt, 100, 0);
+  RunPosition("position", nominal, 2 * kPulsesPerRevolution);
+  RunPosition("position_noisy", noisy, 2 * kPulsesPerRevolution);
+  return 0;
+}
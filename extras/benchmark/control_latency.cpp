@@ -0,0 +1,87 @@
+/**
+ * @file control_latency.cpp
+ * @brief Reports the execution time of the encoder ISR, UpdateRpm and Driving of four simulated motors, recorded by the
+ * built-in latency probes.
+ *
+ * Needs the library built with -DEM_ESP_ENCODER_MOTOR_PROFILING=ON. The motors use x4 GPIO decoding so every edge runs
+ * the ISR, and are driven through MotorSimulator in virtual time. Prints one JSON object per motor and stage, and the
+ * estimated share of a control period spent per motor.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+namespace {
+constexpr size_t kMotors = 4;
+constexpr uint32_t kPeriodUs = 1000;
+constexpr int64_t kDurationUs = 5000000;
+
+void Print(const size_t motor, const char* const stage, const em::LatencyStatistics& statistics) {
+  printf("{\"benchmark\": \"control_latency\", \"motor\": %zu, \"stage\": \"%s\", \"count\": %u, \"min_us\": %.3f, "
+         "\"mean_us\": %.3f, \"max_us\": %.3f, \"histogram\": [",
+         motor,
+         stage,
+         statistics.count,
+         statistics.min_us,
+         statistics.mean_us,
+         statistics.max_us);
+  for (size_t i = 0; i < statistics.histogram.size(); ++i) {
+    printf("%s%u", i == 0 ? "" : ", ", statistics.histogram[i]);
+  }
+  printf("]}\n");
+}
+}  // namespace
+#endif
+
+int main() {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  std::vector<std::unique_ptr<em::MotorSimulator>> simulators;
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    em::MotorSimulator::Parameters parameters;
+    parameters.seed = i + 1;
+    simulators.emplace_back(new em::MotorSimulator(hal, 2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, parameters));
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, 12, 90,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->SetDecodingMode(em::QuadratureDecoder::kX4);
+    motors.back()->Init(scheduler);
+    motors.back()->RunSpeed(50 + 25 * i);
+  }
+
+  scheduler.RunUntil(kDurationUs, [&](const int64_t time_us) {
+    for (const auto& simulator : simulators) {
+      simulator->AdvanceTo(time_us);
+    }
+  });
+
+  const uint64_t ticks = scheduler.GetStatistics().ticks;
+  for (size_t i = 0; i < kMotors; ++i) {
+    const em::EspEncoderMotor::LatencyProfile profile = motors[i]->GetLatencyProfile();
+    Print(i, "encoder_isr", profile.encoder_isr);
+    Print(i, "update_rpm", profile.update_rpm);
+    Print(i, "driving", profile.driving);
+    const double busy_us = (static_cast<double>(profile.encoder_isr.mean_us) * profile.encoder_isr.count +
+                            static_cast<double>(profile.update_rpm.mean_us) * profile.update_rpm.count +
+                            static_cast<double>(profile.driving.mean_us) * profile.driving.count) /
+                           ticks;
+    printf("{\"benchmark\": \"control_latency\", \"motor\": %zu, \"stage\": \"total\", \"us_per_tick\": %.3f, "
+           "\"period_share\": %.6f}\n",
+           i,
+           busy_us,
+           busy_us / kPeriodUs);
+  }
+#else
+  fprintf(stderr, "control_latency: build with -DEM_ESP_ENCODER_MOTOR_PROFILING=ON to record the latency probes\n");
+#endif
+  return 0;
+}
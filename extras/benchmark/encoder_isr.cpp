@@ -0,0 +1,101 @@
+/**
+ * @file encoder_isr.cpp
+ * @brief Measures the encoder edge decoding throughput on the host in edges per second.
+ *
+ * "decoder" runs the body of the encoder ISR alone: QuadratureDecoder::Update, the atomic pulse count and the
+ * EdgeTimestampBuffer push. "host_hal" injects the edges through HostHal::SetLevel into an initialized EspEncoderMotor,
+ * which adds the dispatch of the host backend. Prints one JSON object per path and decoding mode.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#include "edge_timestamp_buffer.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "quadrature_decoder.h"
+
+namespace {
+constexpr uint64_t kCycles = 5000000;
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+
+// The AB levels of one forward quadrature cycle, starting from both high.
+constexpr uint8_t kLevels[][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+
+const char* ModeName(const em::QuadratureDecoder::Mode mode) {
+  return mode == em::QuadratureDecoder::kX4 ? "x4" : (mode == em::QuadratureDecoder::kX2 ? "x2" : "x1");
+}
+
+void Print(const char* const path, const em::QuadratureDecoder::Mode mode, const uint64_t edges, const int64_t count,
+           const double elapsed_s) {
+  printf("{\"benchmark\": \"encoder_isr\", \"path\": \"%s\", \"mode\": \"%s\", \"edges\": %llu, \"count\": %lld, "
+         "\"edges_per_second\": %.0f, \"ns_per_edge\": %.2f}\n",
+         path,
+         ModeName(mode),
+         static_cast<unsigned long long>(edges),
+         static_cast<long long>(count),
+         edges / elapsed_s,
+         elapsed_s * 1e9 / edges);
+}
+
+void RunDecoder(const em::QuadratureDecoder::Mode mode) {
+  em::QuadratureDecoder decoder(mode);
+  em::EdgeTimestampBuffer edge_timestamps;
+  std::atomic<int64_t> pulse_count = 0;
+  decoder.Reset(1, 1);
+
+  // The levels seen by the ISR: x4 interrupts on every edge, x2 on both edges of phase A (indices 0 and 2) and x1 on
+  // the falling edge of phase A only (index 0).
+  const size_t step = 4 / mode;
+  uint64_t edges = 0;
+  int64_t time_us = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t cycle = 0; cycle < kCycles; ++cycle) {
+    for (size_t i = 0; i < 4; i += step) {
+      const int8_t delta = decoder.Update(kLevels[i][0], kLevels[i][1]);
+      if (delta != 0) {
+        edge_timestamps.Push(++time_us, pulse_count.fetch_add(delta) + delta);
+      }
+      ++edges;
+    }
+  }
+  const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Print("decoder", mode, edges, pulse_count, elapsed_s);
+}
+
+void RunHostHal(const em::QuadratureDecoder::Mode mode) {
+  em::HostHal hal;
+  hal.SetLevel(kAPin, 1, false);
+  hal.SetLevel(kBPin, 1, false);
+  em::ControlScheduler scheduler(em::ControlScheduler::kDefaultPeriodUs, hal, em::ControlScheduler::kManual);
+  em::EspEncoderMotor motor(kPositivePin, kNegativePin, kAPin, kBPin, 12, 90, em::EspEncoderMotor::kAPhaseLeads, hal);
+  motor.SetDecodingMode(mode);
+  motor.Init(scheduler);
+
+  // Every level change is injected, the trigger mode decides which of them run the ISR.
+  const uint64_t interrupts = kCycles * (mode == em::QuadratureDecoder::kX1 ? 1 : (mode == em::QuadratureDecoder::kX2 ? 2 : 4));
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t cycle = 0; cycle < kCycles; ++cycle) {
+    for (const auto& levels : kLevels) {
+      hal.SetLevel(kAPin, levels[0]);
+      hal.SetLevel(kBPin, levels[1]);
+    }
+  }
+  const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Print("host_hal", mode, interrupts, motor.EncoderPulseCount(), elapsed_s);
+}
+}  // namespace
+
+int main() {
+  for (const auto mode : {em::QuadratureDecoder::kX1, em::QuadratureDecoder::kX2, em::QuadratureDecoder::kX4}) {
+    RunDecoder(mode);
+  }
+  for (const auto mode : {em::QuadratureDecoder::kX1, em::QuadratureDecoder::kX2, em::QuadratureDecoder::kX4}) {
+    RunHostHal(mode);
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file fixed_point_equivalence.cpp
+ * @brief Checks that the Q16 speed estimation and speed PID follow the float ones closely, and measures their cost.
+ *
+ * A simulated motor is driven in virtual time, its encoder edges are decoded and timestamped like EspEncoderMotor does.
+ * Every tick both SpeedEstimator<float> / SpeedController<float> and their Q16 counterparts see identical inputs, one
+ * of them drives the motor. Besides steps from standstill at a 50 ms period, a reversal with feed-forward runs at a 1 ms
+ * period, where the acceleration feed-forward leaves the Q16 range and has to saturate instead of flipping its sign.
+ * Reports the largest speed and duty differences, the step-response metrics of each closed loop, and the host time of
+ * one estimate plus PID update. Prints one JSON object per scenario, the process fails if a difference exceeds its
+ * tolerance.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "benchmark_rig.h"
+#include "edge_timestamp_buffer.h"
+#include "esp_motor.h"
+#include "motor_simulator.h"
+#include "quadrature_decoder.h"
+#include "speed_control.h"
+
+namespace {
+using em::benchmark::kPpr;
+using em::benchmark::kReduction;
+
+constexpr auto kDecodingMode = em::QuadratureDecoder::kX1;
+// How long a scenario runs at its start speed before the step, and after the step.
+constexpr int64_t kStartUs = 3000000;
+constexpr int64_t kStepUs = 6000000;
+// Q16 has a resolution of 1/65536 and the duty is rounded to an integer, one step of duty difference is expected
+// whenever the float output is close to .5.
+constexpr float kSpeedToleranceRpm = 0.01f;
+constexpr int kDutyTolerance = 1;
+
+// The speed estimation and the speed PID in one numeric type.
+template <typename T>
+struct SpeedPath {
+  void Init(const int64_t time_us, const em::Feedforward& feedforward) {
+    em::PidController<float>::Parameters parameters;
+    parameters.kp = 3;
+    parameters.ki = 1;
+    parameters.kd = 1;
+    parameters.derivative_filter_time = 0.5f;
+    parameters.tracking_gain = parameters.ki / parameters.kp;
+    parameters.output_min = -em::EspMotor::kMaxPwmDuty;
+    parameters.output_max = em::EspMotor::kMaxPwmDuty;
+    controller.SetParameters(parameters);
+    controller.SetFeedforward(feedforward);
+    estimator.Reset(kPpr * kReduction * kDecodingMode, time_us, 0);
+  }
+
+  int16_t Update(const int64_t now_us,
+                 const int64_t counts,
+                 const int64_t duration_us,
+                 const em::EdgeTimestampBuffer& edges,
+                 const int32_t target_rpm) {
+    speed_rpm = estimator.EdgeTimed(now_us, edges, kDecodingMode, estimator.CountRate(counts, duration_us));
+    return controller.Update(target_rpm, speed_rpm, duration_us);
+  }
+
+  em::SpeedEstimator<T> estimator;
+  em::SpeedController<T> controller;
+  T speed_rpm = T();
+};
+
+struct Result {
+  float max_speed_difference_rpm = 0;
+  int max_duty_difference = 0;
+  double rise_ms = -1;
+  double overshoot_percent = 0;
+  double steady_rms_error_rpm = 0;
+  double float_update_ns = 0;
+  double fixed_update_ns = 0;
+};
+
+// Runs one scenario on a fresh rig, driven by the Q16 path if kFixedDrives and by the float path otherwise.
+template <bool kFixedDrives>
+Result Run(const em::MotorSimulator::Parameters& parameters,
+           const int32_t start_rpm,
+           const int32_t target_rpm,
+           const em::Feedforward& feedforward,
+           const uint32_t period_us) {
+  em::benchmark::EncoderRig rig(parameters, kDecodingMode);
+  SpeedPath<float> float_path;
+  SpeedPath<em::Q16> fixed_path;
+  float_path.Init(rig.hal().Micros(), feedforward);
+  fixed_path.Init(rig.hal().Micros(), feedforward);
+
+  Result result;
+  std::vector<float> speeds;
+  int64_t previous_count = 0;
+  int64_t previous_time_us = rig.hal().Micros();
+  double squared_error = 0;
+  const int start_ticks = start_rpm == 0 ? 0 : kStartUs / period_us;
+  const int step_ticks = kStepUs / period_us;
+  for (int i = -start_ticks; i < step_ticks; ++i) {
+    const int32_t setpoint_rpm = i < 0 ? start_rpm : target_rpm;
+    rig.simulator().Advance(period_us);
+    const int64_t now_us = rig.hal().Micros();
+    const int64_t count = rig.Count();
+    const int64_t duration_us = now_us - previous_time_us;
+
+    auto start = std::chrono::steady_clock::now();
+    const int16_t float_duty = float_path.Update(now_us, count - previous_count, duration_us, rig.edges(), setpoint_rpm);
+    result.float_update_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    const int16_t fixed_duty = fixed_path.Update(now_us, count - previous_count, duration_us, rig.edges(), setpoint_rpm);
+    result.fixed_update_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    const float fixed_speed_rpm = static_cast<float>(fixed_path.speed_rpm);
+    result.max_speed_difference_rpm =
+        std::max(result.max_speed_difference_rpm, std::fabs(float_path.speed_rpm - fixed_speed_rpm));
+    result.max_duty_difference = std::max(result.max_duty_difference, std::abs(float_duty - fixed_duty));
+    rig.driver().PwmDuty(kFixedDrives ? fixed_duty : float_duty);
+
+    if (i >= 0) {
+      speeds.push_back(rig.simulator().SpeedRpm());
+    }
+    if (i >= step_ticks / 2) {
+      const double error = (kFixedDrives ? fixed_speed_rpm : float_path.speed_rpm) - target_rpm;
+      squared_error += error * error;
+    }
+    previous_count = count;
+    previous_time_us = now_us;
+  }
+
+  const em::benchmark::StepMetrics metrics = em::benchmark::MeasureStep(speeds, start_rpm, target_rpm, period_us);
+  result.rise_ms = metrics.rise_ms;
+  result.overshoot_percent = metrics.overshoot_percent;
+  result.steady_rms_error_rpm = std::sqrt(squared_error / (step_ticks - step_ticks / 2));
+  result.float_update_ns /= start_ticks + step_ticks;
+  result.fixed_update_ns /= start_ticks + step_ticks;
+  return result;
+}
+
+// Runs the scenario twice, once driven by each path, and reports whether the paths stayed within tolerance.
+bool RunScenario(const char* const name,
+                 const em::MotorSimulator::Parameters& parameters,
+                 const int32_t start_rpm,
+                 const int32_t target_rpm,
+                 const em::Feedforward& feedforward,
+                 const uint32_t period_us) {
+  const Result float_driven = Run<false>(parameters, start_rpm, target_rpm, feedforward, period_us);
+  const Result fixed_driven = Run<true>(parameters, start_rpm, target_rpm, feedforward, period_us);
+  const float max_speed_difference_rpm =
+      std::max(float_driven.max_speed_difference_rpm, fixed_driven.max_speed_difference_rpm);
+  const int max_duty_difference = std::max(float_driven.max_duty_difference, fixed_driven.max_duty_difference);
+  const bool equivalent = max_speed_difference_rpm <= kSpeedToleranceRpm && max_duty_difference <= kDutyTolerance;
+
+  printf(
+      "{\"benchmark\": \"fixed_point_equivalence\", \"scenario\": \"%s\", \"period_us\": %u, \"start_rpm\": %d, "
+      "\"target_rpm\": %d, "
+      "\"max_speed_difference_rpm\": %.6f, \"max_duty_difference\": %d, \"float_rise_ms\": %.1f, "
+      "\"q16_rise_ms\": %.1f, \"float_overshoot_percent\": %.2f, \"q16_overshoot_percent\": %.2f, "
+      "\"float_steady_rms_error_rpm\": %.3f, \"q16_steady_rms_error_rpm\": %.3f, \"float_update_ns\": %.0f, "
+      "\"q16_update_ns\": %.0f, \"equivalent\": %s}\n",
+      name,
+      period_us,
+      start_rpm,
+      target_rpm,
+      max_speed_difference_rpm,
+      max_duty_difference,
+      float_driven.rise_ms,
+      fixed_driven.rise_ms,
+      float_driven.overshoot_percent,
+      fixed_driven.overshoot_percent,
+      float_driven.steady_rms_error_rpm,
+      fixed_driven.steady_rms_error_rpm,
+      float_driven.float_update_ns,
+      float_driven.fixed_update_ns,
+      equivalent ? "true" : "false");
+  return equivalent;
+}
+}  // namespace
+
+int main() {
+  const em::MotorSimulator::Parameters nominal;
+
+  em::MotorSimulator::Parameters noisy;
+  noisy.edge_jitter_us = 20;
+  noisy.missed_edge_probability = 0.01;
+  noisy.backlash = 0.2;
+
+  em::Feedforward feedforward;
+  feedforward.ks = 40;
+  feedforward.kv = 2.5f;
+  feedforward.ka = 0.2f;
+
+  bool equivalent = true;
+  equivalent &= RunScenario("step", nominal, 0, 100, {}, 50000);
+  equivalent &= RunScenario("step_reverse", nominal, 0, -150, {}, 50000);
+  equivalent &= RunScenario("step_feedforward", nominal, 0, 100, feedforward, 50000);
+  equivalent &= RunScenario("step_noisy", noisy, 0, 100, {}, 50000);
+  equivalent &= RunScenario("reversal_feedforward_1ms", nominal, 100, -100, feedforward, 1000);
+  return equivalent ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file motion_observer.cpp
+ * @brief Validates the motion observers against MotorSimulator and compares them with the built-in speed estimates.
+ *
+ * Open loop, the motor follows a sinusoidal then constant PWM duty and every estimator sees the same simulated encoder:
+ * the built-in M/T estimate (GPIO interrupt backend), the built-in count difference (pulse counter backend), an
+ * alpha-beta tracker, an alpha-beta-gamma tracker and the constant acceleration Kalman filter. Reports the RMS speed
+ * error against the true shaft speed while the speed changes and while it is constant, the mean error while
+ * accelerating as a measure of lag, and the RMS acceleration error. Closed loop, a speed step runs at a 10 ms control
+ * period with high gains and reports the true speed error and the duty noise in steady state. Prints one JSON object
+ * per scenario and estimator.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "benchmark_rig.h"
+#include "esp_encoder_motor.h"
+#include "motion_observer.h"
+#include "motor_simulator.h"
+
+namespace {
+using em::benchmark::MotorRig;
+
+constexpr double kPi = 3.14159265358979323846;
+// The true acceleration is the speed difference over this interval just before each tick.
+constexpr int64_t kAccelerationIntervalUs = 200;
+
+enum EstimatorType {
+  kMt,
+  kCountDifference,
+  kAlphaBeta,
+  kAlphaBetaGamma,
+  kKalman,
+};
+
+struct Estimator {
+  const char* name;
+  EstimatorType type;
+};
+
+constexpr Estimator kEstimators[] = {
+    {"mt", kMt},
+    {"count_difference", kCountDifference},
+    {"alpha_beta", kAlphaBeta},
+    {"alpha_beta_gamma", kAlphaBetaGamma},
+    {"kalman", kKalman},
+};
+
+// The observers under test, declared before the rig so that they outlive its motor.
+struct Observers {
+  Observers() {
+    em::AlphaBetaObserver::Parameters parameters;
+    parameters.alpha = 0.8f;
+    parameters.beta = 0.611f;
+    parameters.gamma = 0.117f;
+    alpha_beta_gamma = em::AlphaBetaObserver(parameters);
+  }
+
+  em::AlphaBetaObserver alpha_beta;
+  em::AlphaBetaObserver alpha_beta_gamma;
+  em::KalmanObserver kalman;
+};
+
+// Starts the motor of the rig with the backend and observer of the estimator under test.
+void InitRig(MotorRig& rig, const EstimatorType type, Observers& observers) {
+  rig.motor().SetEncoderBackend(type == kCountDifference ? em::EspEncoderMotor::kPulseCounter
+                                                         : em::EspEncoderMotor::kGpioInterrupt);
+  if (type == kAlphaBeta) {
+    rig.motor().SetMotionObserver(&observers.alpha_beta);
+  } else if (type == kAlphaBetaGamma) {
+    rig.motor().SetMotionObserver(&observers.alpha_beta_gamma);
+  } else if (type == kKalman) {
+    rig.motor().SetMotionObserver(&observers.kalman);
+  }
+  rig.Init();
+}
+
+void RunOpenLoop(const char* const scenario,
+                 const Estimator& estimator,
+                 const uint32_t period_us,
+                 const em::MotorSimulator::Parameters& parameters) {
+  constexpr int64_t kVaryingUs = 3000000;
+  constexpr int64_t kDurationUs = 5000000;
+  // Let the estimators converge before scoring them.
+  constexpr int64_t kSettleUs = 500000;
+
+  Observers observers;
+  MotorRig rig(period_us, parameters);
+  InitRig(rig, estimator.type, observers);
+  rig.hal().SetMicros(0);
+  double varying_squared = 0;
+  int varying_samples = 0;
+  double constant_squared = 0;
+  int constant_samples = 0;
+  double accelerating_error = 0;
+  int accelerating_samples = 0;
+  double acceleration_squared = 0;
+  float true_speed = 0;
+  float true_acceleration = 0;
+  int64_t tick_us = -1;
+
+  auto score = [&]() {
+    if (tick_us < kSettleUs) {
+      return;
+    }
+    const em::EspEncoderMotor::Snapshot snapshot = rig.motor().GetSnapshot();
+    const double error = snapshot.speed_rpm - true_speed;
+    if (tick_us < kVaryingUs) {
+      varying_squared += error * error;
+      ++varying_samples;
+      const double acceleration_error = snapshot.acceleration_rpm_per_s - true_acceleration;
+      acceleration_squared += acceleration_error * acceleration_error;
+      if (true_acceleration > 50) {
+        accelerating_error += error;
+        ++accelerating_samples;
+      }
+    } else {
+      constant_squared += error * error;
+      ++constant_samples;
+    }
+  };
+
+  rig.scheduler().RunUntil(kDurationUs, [&](const int64_t time_us) {
+    // The tick before this advance has completed, score it against the truth at its sampling instant.
+    score();
+    rig.simulator().AdvanceTo(time_us - kAccelerationIntervalUs);
+    const float before = rig.simulator().SpeedRpm();
+    rig.simulator().AdvanceTo(time_us);
+    true_speed = rig.simulator().SpeedRpm();
+    true_acceleration = (true_speed - before) * 1000000.0f / kAccelerationIntervalUs;
+    tick_us = time_us;
+
+    const double t = time_us / 1000000.0;
+    const int16_t duty = time_us < kVaryingUs ? std::lround(500 + 300 * std::sin(2 * kPi * t)) : 600;
+    rig.motor().RunPwmDuty(duty);
+  });
+  score();
+
+  const bool has_acceleration = estimator.type == kAlphaBetaGamma || estimator.type == kKalman;
+  printf(
+      "{\"benchmark\": \"motion_observer\", \"scenario\": \"%s\", \"estimator\": \"%s\", \"period_us\": %u, "
+      "\"varying_rms_error_rpm\": %.3f, \"constant_rms_error_rpm\": %.3f, \"accelerating_mean_error_rpm\": %.3f, "
+      "\"acceleration_rms_error_rpm_per_s\": %s}\n",
+      scenario,
+      estimator.name,
+      period_us,
+      std::sqrt(varying_squared / varying_samples),
+      std::sqrt(constant_squared / constant_samples),
+      accelerating_error / accelerating_samples,
+      has_acceleration ? std::to_string(std::sqrt(acceleration_squared / varying_samples)).c_str() : "null");
+}
+
+void RunClosedLoop(const Estimator& estimator, const em::MotorSimulator::Parameters& parameters) {
+  constexpr uint32_t kPeriodUs = 10000;
+  constexpr int kTicks = 300;
+  constexpr int kSteadyTicks = 150;
+  constexpr int16_t kTargetRpm = 60;
+
+  Observers observers;
+  MotorRig rig(kPeriodUs, parameters);
+  InitRig(rig, estimator.type, observers);
+  rig.motor().SetSpeedPid(6, 0.5f, 0);
+  rig.motor().RunSpeed(kTargetRpm);
+
+  double squared_error = 0;
+  double duty_sum = 0;
+  double duty_squared = 0;
+  for (int i = 0; i < kTicks; ++i) {
+    rig.Tick();
+    if (i >= kTicks - kSteadyTicks) {
+      const double error = rig.simulator().SpeedRpm() - kTargetRpm;
+      const double duty = rig.motor().PwmDuty();
+      squared_error += error * error;
+      duty_sum += duty;
+      duty_squared += duty * duty;
+    }
+  }
+
+  const double duty_mean = duty_sum / kSteadyTicks;
+  printf(
+      "{\"benchmark\": \"motion_observer\", \"scenario\": \"closed_loop_10ms\", \"estimator\": \"%s\", "
+      "\"target_rpm\": %d, \"steady_rms_error_rpm\": %.3f, \"steady_duty_stddev\": %.2f}\n",
+      estimator.name,
+      kTargetRpm,
+      std::sqrt(squared_error / kSteadyTicks),
+      std::sqrt(std::max(duty_squared / kSteadyTicks - duty_mean * duty_mean, 0.0)));
+}
+}  // namespace
+
+int main() {
+  const em::MotorSimulator::Parameters nominal;
+
+  em::MotorSimulator::Parameters noisy;
+  noisy.edge_jitter_us = 20;
+  noisy.missed_edge_probability = 0.01;
+
+  for (const Estimator& estimator : kEstimators) {
+    RunOpenLoop("open_loop_50ms", estimator, 50000, nominal);
+    RunOpenLoop("open_loop_10ms", estimator, 10000, nominal);
+    RunOpenLoop("open_loop_10ms_noisy", estimator, 10000, noisy);
+    RunClosedLoop(estimator, nominal);
+  }
+  return 0;
+}
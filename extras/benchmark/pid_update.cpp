@@ -0,0 +1,58 @@
+/**
+ * @file pid_update.cpp
+ * @brief Measures the cost of one PidController::Update() with float and Q16 arithmetic on the host.
+ *
+ * The controller drives a first-order plant so that the integral, the derivative filter and the anti-windup paths are
+ * all exercised. Prints one JSON object per numeric type.
+ */
+
+#include <chrono>
+#include <cstdio>
+
+#include "fixed_point.h"
+#include "pid_controller.h"
+
+namespace {
+constexpr int kUpdates = 10000000;
+
+template <typename T>
+void Run(const char* const type) {
+  em::PidController<T> pid;
+  typename em::PidController<T>::Parameters parameters;
+  parameters.kp = T(3.0);
+  parameters.ki = T(1.0);
+  parameters.kd = T(1.0);
+  parameters.derivative_filter_time = T(0.5);
+  parameters.tracking_gain = T(1.0 / 3.0);
+  parameters.output_min = T(-1023.0);
+  parameters.output_max = T(1023.0);
+  pid.SetParameters(parameters);
+
+  // A plant reaching 300 RPM at full duty with a time constant of 5 control periods, setpoint toggling every 1000
+  // updates so that the output saturates now and then.
+  const T dt = T(0.02);
+  const T plant_gain = T(300.0 / 1023.0);
+  const T plant_rate = T(0.004);
+  const T setpoints[] = {T(250.0), T(-100.0)};
+  T speed = T(0);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kUpdates; ++i) {
+    const T duty = pid.Update(setpoints[(i / 1000) & 1], speed, dt);
+    speed += (plant_gain * duty - speed) * plant_rate;
+  }
+  const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  printf("{\"benchmark\": \"pid_update\", \"type\": \"%s\", \"updates\": %d, \"ns_per_update\": %.2f, \"final_speed\": %.3f}\n",
+         type,
+         kUpdates,
+         elapsed_ns / kUpdates,
+         static_cast<double>(speed));
+}
+}  // namespace
+
+int main() {
+  Run<float>("float");
+  Run<em::Q16>("q16");
+  return 0;
+}
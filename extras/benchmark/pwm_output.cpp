@@ -0,0 +1,171 @@
+/**
+ * @file pwm_output.cpp
+ * @brief Verifies the PWM output of EspMotor from the waveforms recorded by HostHal.
+ *
+ * Checks the default frequency and resolution, that unchanged duties are not written again, that the MCPWM backend
+ * updates both legs of all motors at the same PWM period boundary while LEDC writes land one by one, the brake and
+ * coast levels, and the duty scaling to other resolutions. Also counts the writes per control tick of a simulated
+ * closed loop. Prints one JSON object per scenario, the process fails if a check fails.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "esp_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+
+bool Report(const char* const scenario, const bool ok, const char* const details) {
+  printf("{\"benchmark\": \"pwm_output\", \"scenario\": \"%s\", %s, \"ok\": %s}\n", scenario, details, ok ? "true" : "false");
+  return ok;
+}
+
+bool CheckDefaults() {
+  em::HostHal hal;
+  em::EspMotor motor(kPositivePin, kNegativePin, hal);
+  motor.Init();
+  const uint32_t frequency = hal.PwmFrequency(kPositivePin);
+  const uint8_t resolution = hal.PwmResolution(kPositivePin);
+  char details[128];
+  snprintf(details, sizeof(details), "\"frequency_hz\": %u, \"resolution_bits\": %u", frequency, resolution);
+  return Report("defaults",
+                frequency == em::EspMotor::kPwmFrequency && resolution == em::EspMotor::kPwmResolution &&
+                    hal.PwmFrequency(kNegativePin) == frequency,
+                details);
+}
+
+bool CheckRedundantWrites(const em::EspMotor::PwmBackend backend, const char* const scenario) {
+  constexpr int kCalls = 1000;
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::EspMotor motor(kPositivePin, kNegativePin, hal);
+  motor.SetPwmBackend(backend);
+  motor.Init();
+  hal.SetWaveformRecording(true);
+  for (int i = 0; i < kCalls; ++i) {
+    motor.PwmDuty(500);
+  }
+  motor.Stop();
+  motor.Stop();
+  const size_t events = hal.WaveformEvents().size();
+  // One write of both legs for the duty and one for the stop.
+  char details[128];
+  snprintf(details, sizeof(details), "\"calls\": %d, \"leg_writes\": %zu", kCalls + 2, events);
+  return Report(scenario, events == 4, details);
+}
+
+bool CheckSynchronizedUpdate(const em::EspMotor::PwmBackend backend, const char* const scenario) {
+  constexpr size_t kMotors = 4;
+  // All writes fall within one 13.3 us PWM period, before its end boundary.
+  constexpr int64_t kWriteSpacingUs = 3;
+  constexpr int64_t kStartUs = 1000;
+  em::HostHal hal;
+  hal.SetMicros(kStartUs);
+  std::vector<std::unique_ptr<em::EspMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    motors.emplace_back(new em::EspMotor(2 * i, 2 * i + 1, hal));
+    motors.back()->SetPwmBackend(backend);
+    motors.back()->Init();
+  }
+
+  hal.SetWaveformRecording(true);
+  for (size_t i = 0; i < kMotors; ++i) {
+    hal.SetMicros(kStartUs + 1 + i * kWriteSpacingUs);
+    motors[i]->PwmDuty(i % 2 == 0 ? 300 : -300);
+  }
+
+  std::set<int64_t> times;
+  for (const auto& event : hal.WaveformEvents()) {
+    times.insert(event.time_us);
+  }
+  const size_t events = hal.WaveformEvents().size();
+  char details[128];
+  snprintf(details,
+           sizeof(details),
+           "\"motors\": %zu, \"leg_writes\": %zu, \"distinct_update_times\": %zu",
+           kMotors,
+           events,
+           times.size());
+  // MCPWM: every leg of every motor at one boundary. LEDC: each leg at its own write.
+  const bool ok = events == 2 * kMotors &&
+                  (backend == em::EspMotor::kMcpwm ? times.size() == 1 && *times.begin() > kStartUs
+                                                   : times.size() == kMotors);
+  return Report(scenario, ok, details);
+}
+
+bool CheckStopModes() {
+  // A higher frequency with less resolution, the duties are scaled to 8 bits.
+  constexpr uint32_t kFrequency = 100000;
+  constexpr uint8_t kResolution = 8;
+  constexpr uint32_t kMaxDuty = (1 << kResolution) - 1;
+  em::HostHal hal;
+  em::EspMotor motor(kPositivePin, kNegativePin, hal);
+  motor.SetPwmBackend(em::EspMotor::kMcpwm, kFrequency, kResolution);
+  motor.Init();
+
+  const bool braking = hal.PwmDuty(kPositivePin) == kMaxDuty && hal.PwmDuty(kNegativePin) == kMaxDuty;
+  motor.PwmDuty(-em::EspMotor::kMaxPwmDuty / 2);
+  const uint32_t half_duty = hal.PwmDuty(kNegativePin);
+  const bool half = hal.PwmDuty(kPositivePin) == 0 && half_duty == kMaxDuty / 2;
+  motor.SetStopMode(em::EspMotor::kCoast);
+  motor.Stop();
+  const bool coasting = hal.PwmDuty(kPositivePin) == 0 && hal.PwmDuty(kNegativePin) == 0;
+
+  char details[160];
+  snprintf(details,
+           sizeof(details),
+           "\"frequency_hz\": %u, \"resolution_bits\": %u, \"brake\": %s, \"half_duty\": %u, \"coast\": %s",
+           hal.PwmFrequency(kPositivePin),
+           hal.PwmResolution(kPositivePin),
+           braking ? "true" : "false",
+           half_duty,
+           coasting ? "true" : "false");
+  return Report("stop_modes", braking && half && coasting && hal.PwmFrequency(kPositivePin) == kFrequency, details);
+}
+
+bool CountClosedLoopWrites() {
+  constexpr uint32_t kPeriodUs = em::ControlScheduler::kDefaultPeriodUs;
+  constexpr int64_t kDurationUs = 3000000;
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  em::MotorSimulator simulator(hal, kPositivePin, kNegativePin, 2, 3, em::MotorSimulator::Parameters());
+  em::EspEncoderMotor motor(kPositivePin, kNegativePin, 2, 3, 12, 90, em::EspEncoderMotor::kAPhaseLeads, hal);
+  motor.Init(scheduler);
+  hal.SetWaveformRecording(true);
+  motor.RunSpeed(80);
+  scheduler.RunUntil(kDurationUs, [&](const int64_t time_us) { simulator.AdvanceTo(time_us); });
+
+  const uint64_t ticks = scheduler.GetStatistics().ticks;
+  const size_t events = hal.WaveformEvents().size();
+  char details[128];
+  snprintf(details,
+           sizeof(details),
+           "\"ticks\": %llu, \"leg_writes\": %zu, \"leg_writes_per_tick\": %.2f",
+           static_cast<unsigned long long>(ticks),
+           events,
+           ticks > 0 ? static_cast<double>(events) / ticks : 0.0);
+  // Without skipping, every tick writes both legs.
+  return Report("closed_loop_writes", events < 2 * ticks, details);
+}
+}  // namespace
+
+int main() {
+  bool ok = true;
+  ok &= CheckDefaults();
+  ok &= CheckRedundantWrites(em::EspMotor::kLedc, "redundant_writes_ledc");
+  ok &= CheckRedundantWrites(em::EspMotor::kMcpwm, "redundant_writes_mcpwm");
+  ok &= CheckSynchronizedUpdate(em::EspMotor::kLedc, "update_timing_ledc");
+  ok &= CheckSynchronizedUpdate(em::EspMotor::kMcpwm, "update_timing_mcpwm");
+  ok &= CheckStopModes();
+  ok &= CountClosedLoopWrites();
+  return ok ? 0 : 1;
+}
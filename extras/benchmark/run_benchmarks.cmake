@@ -0,0 +1,32 @@
+# Runs the host benchmarks and collects their JSON lines into benchmarks-<version>.jsonl, each line tagged with the
+# library version from src/esp_encoder_motor_lib.h, so that results can be compared across versions.
+#
+# Invoked by the run_benchmarks target:
+#   cmake -DSOURCE_DIR=<repo> -DOUTPUT_DIR=<dir> -DBENCHMARKS=<executables> -P run_benchmarks.cmake
+
+file(READ ${SOURCE_DIR}/src/esp_encoder_motor_lib.h lib_header)
+set(version_parts)
+foreach(part Major Minor Patch)
+  if(NOT lib_header MATCHES "kVersion${part} = ([0-9]+);")
+    message(FATAL_ERROR "kVersion${part} not found in esp_encoder_motor_lib.h")
+  endif()
+  list(APPEND version_parts ${CMAKE_MATCH_1})
+endforeach()
+list(JOIN version_parts "." version)
+
+set(results ${OUTPUT_DIR}/benchmarks-${version}.jsonl)
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+file(WRITE ${results} "")
+
+foreach(benchmark ${BENCHMARKS})
+  get_filename_component(name ${benchmark} NAME)
+  message(STATUS "Running ${name}")
+  execute_process(COMMAND ${benchmark} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${name} failed: ${result}")
+  endif()
+  string(REPLACE "{\"benchmark\"" "{\"version\": \"${version}\", \"benchmark\"" output "${output}")
+  file(APPEND ${results} "${output}")
+endforeach()
+
+message(STATUS "Results of version ${version} written to ${results}")
@@ -0,0 +1,72 @@
+/**
+ * @file scheduler_scaling.cpp
+ * @brief Measures how the cost of a control tick scales with the number of motors on one ControlScheduler.
+ *
+ * 1 to ControlScheduler::kMaxTasks motors in speed control, each driving a MotorSimulator, run for a fixed virtual
+ * duration through ControlScheduler::RunUntil. Only the ticks are timed, the simulator advances are excluded. Prints
+ * one JSON object per motor count.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr uint32_t kPeriodUs = 1000;
+constexpr int64_t kDurationUs = 20000000;
+
+void Run(const size_t motor_count) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  std::vector<std::unique_ptr<em::MotorSimulator>> simulators;
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < motor_count; ++i) {
+    em::MotorSimulator::Parameters parameters;
+    parameters.seed = i + 1;
+    parameters.step_us = 50;
+    simulators.emplace_back(new em::MotorSimulator(hal, 2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, parameters));
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, 12, 90,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->Init(scheduler);
+    motors.back()->RunSpeed(50 + 10 * i);
+  }
+
+  // RunUntil calls the handler right before each tick and once at the end, so the time from one call to the next is
+  // one tick, the simulator advance is excluded by restarting the stopwatch after it.
+  double tick_ns = 0;
+  bool ticking = false;
+  auto start = std::chrono::steady_clock::now();
+  scheduler.RunUntil(kDurationUs, [&](const int64_t time_us) {
+    if (ticking) {
+      tick_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    for (const auto& simulator : simulators) {
+      simulator->AdvanceTo(time_us);
+    }
+    ticking = true;
+    start = std::chrono::steady_clock::now();
+  });
+
+  const uint64_t ticks = scheduler.GetStatistics().ticks;
+  printf("{\"benchmark\": \"scheduler_scaling\", \"motors\": %zu, \"ticks\": %llu, \"tick_mean_ns\": %.1f, "
+         "\"ns_per_motor\": %.1f}\n",
+         motor_count,
+         static_cast<unsigned long long>(ticks),
+         tick_ns / ticks,
+         tick_ns / ticks / motor_count);
+}
+}  // namespace
+
+int main() {
+  for (size_t motors = 1; motors <= em::ControlScheduler::kMaxTasks; ++motors) {
+    Run(motors);
+  }
+  return 0;
+}
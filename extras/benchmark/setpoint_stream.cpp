@@ -0,0 +1,163 @@
+/**
+ * @file setpoint_stream.cpp
+ * @brief Measures setpoint streaming through the command queue of EspEncoderMotor.
+ *
+ * In virtual time a planner produces a speed and a position trajectory at 10 Hz for a motor controlled at 100 Hz. It
+ * streams them as timestamped setpoints, which the controller interpolates, and for comparison sends each point with
+ * PostSpeed or as a one-point stream when its time comes, which holds it until the next. Reports the RMS and largest
+ * tracking error of the true shaft against the continuous trajectory. On the real clock a producer thread issues
+ * commands while four motors run at 1 kHz and reports how long RunSpeed (locking) and PostSpeed (lock-free) calls take.
+ * Prints one JSON object per scenario.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+constexpr uint32_t kPpr = 12;
+constexpr uint32_t kReduction = 90;
+constexpr uint32_t kControlPeriodUs = 10000;
+constexpr int64_t kPlannerPeriodUs = 100000;
+// How far ahead of the current time the planner keeps the queue filled.
+constexpr int64_t kLookaheadUs = 300000;
+constexpr int64_t kStartUs = 1000000;
+constexpr int64_t kDurationUs = 6000000;
+constexpr double kPi = 3.14159265358979323846;
+
+double SpeedTrajectory(const int64_t time_us) {
+  return 60 + 40 * std::sin(2 * kPi * 0.5 * (time_us - kStartUs) / 1000000.0);
+}
+
+double PositionTrajectory(const int64_t time_us) {
+  return 400 * (1 - std::cos(2 * kPi * 0.5 * (time_us - kStartUs) / 1000000.0));
+}
+
+void RunVirtual(const em::EspEncoderMotor::SetpointType type, const bool interpolate) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kControlPeriodUs, hal, em::ControlScheduler::kManual);
+  em::MotorSimulator simulator(hal, kPositivePin, kNegativePin, kAPin, kBPin, em::MotorSimulator::Parameters());
+  em::EspEncoderMotor motor(kPositivePin, kNegativePin, kAPin, kBPin, kPpr, kReduction, em::EspEncoderMotor::kAPhaseLeads,
+                            hal);
+  motor.Init(scheduler);
+  const bool speed = type == em::EspEncoderMotor::kSpeedSetpoint;
+  const auto trajectory = speed ? SpeedTrajectory : PositionTrajectory;
+  if (speed) {
+    motor.RunSpeed(std::lround(trajectory(kStartUs)));
+  } else {
+    motor.RunToPosition(0);
+  }
+
+  int64_t next_point_us = kStartUs;
+  double squared_error = 0;
+  double max_error = 0;
+  int samples = 0;
+  scheduler.RunUntil(kStartUs + kDurationUs, [&](const int64_t time_us) {
+    simulator.AdvanceTo(time_us);
+    // The planner: either streams ahead for interpolation, or sends each point when its time has come.
+    while (next_point_us <= time_us + (interpolate ? kLookaheadUs : 0)) {
+      const em::EspEncoderMotor::Setpoint point = {next_point_us, trajectory(next_point_us)};
+      if (interpolate || !speed) {
+        if (motor.StreamSetpoints(type, &point, 1) == 0) {
+          break;
+        }
+      } else if (!motor.PostSpeed(std::lround(point.value))) {
+        break;
+      }
+      next_point_us += kPlannerPeriodUs;
+    }
+    if (time_us > kStartUs + kPlannerPeriodUs) {
+      const double actual = speed ? simulator.SpeedRpm() : simulator.Revolutions() * kPpr * kReduction;
+      const double error = actual - trajectory(time_us);
+      squared_error += error * error;
+      max_error = std::max(max_error, std::fabs(error));
+      ++samples;
+    }
+  });
+
+  printf(
+      "{\"benchmark\": \"setpoint_stream\", \"scenario\": \"%s_%s\", \"control_period_us\": %u, "
+      "\"planner_period_us\": %lld, \"rms_error_%s\": %.3f, \"max_error_%s\": %.3f}\n",
+      speed ? "speed" : "position",
+      interpolate ? "interpolated" : "held",
+      kControlPeriodUs,
+      static_cast<long long>(kPlannerPeriodUs),
+      speed ? "rpm" : "pulses",
+      std::sqrt(squared_error / std::max(samples, 1)),
+      speed ? "rpm" : "pulses",
+      max_error);
+}
+
+void RunRealClock(const bool post) {
+  constexpr size_t kMotors = 4;
+  constexpr uint32_t kPeriodUs = 1000;
+  constexpr int kCommands = 20000;
+  em::HostHal hal;
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kThread);
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, kPpr, kReduction,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->Init(scheduler);
+  }
+
+  std::vector<double> durations_ns;
+  durations_ns.reserve(kCommands);
+  int rejected = 0;
+  for (int i = 0; i < kCommands; ++i) {
+    em::EspEncoderMotor& motor = *motors[i % kMotors];
+    const int16_t speed_rpm = 50 + i % 20;
+    const auto start = std::chrono::steady_clock::now();
+    if (post) {
+      rejected += motor.PostSpeed(speed_rpm) ? 0 : 1;
+    } else {
+      motor.RunSpeed(speed_rpm);
+    }
+    durations_ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    // A planner producing commands at about 20 kHz, faster than the control loop consumes them.
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  std::sort(durations_ns.begin(), durations_ns.end());
+  double sum = 0;
+  for (const double duration : durations_ns) {
+    sum += duration;
+  }
+  printf(
+      "{\"benchmark\": \"setpoint_stream\", \"scenario\": \"%s_real_clock\", \"motors\": %zu, \"period_us\": %u, "
+      "\"calls\": %d, \"rejected_full_queue\": %d, \"mean_call_ns\": %.0f, \"p99_call_ns\": %.0f, \"max_call_ns\": %.0f}\n",
+      post ? "post_speed" : "run_speed",
+      kMotors,
+      kPeriodUs,
+      kCommands,
+      rejected,
+      sum / durations_ns.size(),
+      durations_ns[durations_ns.size() * 99 / 100],
+      durations_ns.back());
+}
+}  // namespace
+
+int main() {
+  RunVirtual(em::EspEncoderMotor::kSpeedSetpoint, false);
+  RunVirtual(em::EspEncoderMotor::kSpeedSetpoint, true);
+  RunVirtual(em::EspEncoderMotor::kPositionSetpoint, false);
+  RunVirtual(em::EspEncoderMotor::kPositionSetpoint, true);
+  RunRealClock(false);
+  RunRealClock(true);
+  return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file snapshot_contention.cpp
+ * @brief Measures how concurrent telemetry readers affect the control tick of four motors on the host backend.
+ *
+ * Readers either poll EspEncoderMotor::GetSnapshot(), which is lock-free, or EspEncoderMotor::GetSpeedPid(), which
+ * takes the same mutex as the control loop. Prints one JSON object per configuration.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+
+namespace {
+constexpr size_t kMotors = 4;
+constexpr size_t kTicks = 20000;
+
+enum class ReaderKind { kSnapshot, kMutex };
+
+void Run(const ReaderKind kind, const size_t readers) {
+  em::HostHal hal;
+  em::ControlScheduler scheduler(em::ControlScheduler::kDefaultPeriodUs, hal);
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, 12, 90,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->Init(scheduler);
+    motors.back()->RunSpeed(100);
+  }
+
+  std::atomic<bool> running = true;
+  std::atomic<uint64_t> reads = 0;
+  std::vector<std::thread> threads;
+  for (size_t r = 0; r < readers; ++r) {
+    threads.emplace_back([&]() {
+      uint64_t count = 0;
+      float sink = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        for (const auto& motor : motors) {
+          if (kind == ReaderKind::kSnapshot) {
+            sink += motor->GetSnapshot().speed_rpm;
+          } else {
+            float p = 0;
+            motor->GetSpeedPid(&p, nullptr, nullptr);
+            sink += p;
+          }
+          ++count;
+        }
+      }
+      reads += count + (sink < 0 ? 1 : 0);
+    });
+  }
+
+  std::vector<int64_t> durations_ns(kTicks);
+  const auto start = std::chrono::steady_clock::now();
+  for (auto& duration_ns : durations_ns) {
+    const auto tick_start = std::chrono::steady_clock::now();
+    scheduler.Tick();
+    duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tick_start).count();
+  }
+  const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  running = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::sort(durations_ns.begin(), durations_ns.end());
+  int64_t total_ns = 0;
+  for (const auto duration_ns : durations_ns) {
+    total_ns += duration_ns;
+  }
+
+  printf("{\"benchmark\": \"snapshot_contention\", \"reader\": \"%s\", \"readers\": %zu, \"motors\": %zu, \"ticks\": %zu, "
+         "\"tick_mean_ns\": %" PRId64 ", \"tick_p99_ns\": %" PRId64 ", \"tick_max_ns\": %" PRId64
+         ", \"reads_per_second\": %.0f}\n",
+         kind == ReaderKind::kSnapshot ? "snapshot" : "mutex",
+         readers,
+         kMotors,
+         kTicks,
+         total_ns / static_cast<int64_t>(kTicks),
+         durations_ns[kTicks * 99 / 100],
+         durations_ns.back(),
+         reads / elapsed_s);
+}
+}  // namespace
+
+int main() {
+  for (const auto kind : {ReaderKind::kSnapshot, ReaderKind::kMutex}) {
+    for (const size_t readers : {0, 1, 4}) {
+      Run(kind, readers);
+    }
+  }
+  return 0;
+}
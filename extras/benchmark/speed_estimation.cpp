@@ -0,0 +1,77 @@
+/**
+ * @file speed_estimation.cpp
+ * @brief Measures the cost of the speed estimation in the sampling phase of a control tick on the host.
+ *
+ * One motor in PWM mode, so that the control phase only publishes the snapshot, is ticked manually on a virtual clock
+ * with a few encoder edges injected between ticks (outside the timed region). The tick of an empty scheduler is
+ * reported as the baseline. Prints one JSON object per encoder backend.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+
+namespace {
+constexpr size_t kTicks = 1000000;
+constexpr uint32_t kPeriodUs = 1000;
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+constexpr uint8_t kLevels[][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+
+void Run(const char* const name, const bool with_motor, const em::EspEncoderMotor::EncoderBackend backend) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  hal.SetLevel(kAPin, 1, false);
+  hal.SetLevel(kBPin, 1, false);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  em::EspEncoderMotor motor(kPositivePin, kNegativePin, kAPin, kBPin, 12, 90, em::EspEncoderMotor::kAPhaseLeads, hal);
+  if (with_motor) {
+    motor.SetEncoderBackend(backend);
+    motor.Init(scheduler);
+  }
+
+  std::vector<int64_t> durations_ns(kTicks);
+  size_t level = 0;
+  for (size_t tick = 0; tick < kTicks; ++tick) {
+    // Two encoder cycles per tick, with the edges spread over the period.
+    for (size_t i = 0; i < 8; ++i) {
+      hal.SetMicros(tick * kPeriodUs + i * kPeriodUs / 8);
+      hal.SetLevel(kAPin, kLevels[level][0]);
+      hal.SetLevel(kBPin, kLevels[level][1]);
+      level = (level + 1) % 4;
+    }
+    hal.SetMicros((tick + 1) * kPeriodUs);
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.Tick();
+    durations_ns[tick] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::sort(durations_ns.begin(), durations_ns.end());
+  int64_t total_ns = 0;
+  for (const auto duration_ns : durations_ns) {
+    total_ns += duration_ns;
+  }
+  printf("{\"benchmark\": \"speed_estimation\", \"backend\": \"%s\", \"ticks\": %zu, \"tick_mean_ns\": %.1f, "
+         "\"tick_p50_ns\": %lld, \"tick_p99_ns\": %lld, \"speed_rpm\": %.3f}\n",
+         name,
+         kTicks,
+         static_cast<double>(total_ns) / kTicks,
+         static_cast<long long>(durations_ns[kTicks / 2]),
+         static_cast<long long>(durations_ns[kTicks * 99 / 100]),
+         with_motor ? motor.GetSnapshot().speed_rpm : 0.0f);
+}
+}  // namespace
+
+int main() {
+  Run("none", false, em::EspEncoderMotor::kGpioInterrupt);
+  Run("gpio_interrupt", true, em::EspEncoderMotor::kGpioInterrupt);
+  Run("pulse_counter", true, em::EspEncoderMotor::kPulseCounter);
+  return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file speed_ramp.cpp
+ * @brief Compares speed steps of EspEncoderMotor with and without the setpoint ramp against MotorSimulator.
+ *
+ * Each scenario runs a start from rest, a reversal or a target change in the middle of the ramp, once as plain steps,
+ * once with a trapezoidal ramp and once with a jerk-limited ramp, with the default speed PID gains and with aggressive
+ * ones that saturate the duty on plain steps. Reports the peak armature current, the ticks the duty
+ * saturates, the largest PID integral, the settling time and overshoot of the true output shaft speed after the last
+ * target change, and the largest acceleration of the setpoint. Prints one JSON object per scenario and ramp.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+constexpr uint32_t kPeriodUs = em::ControlScheduler::kDefaultPeriodUs;
+// The current is sampled between the control ticks, its peaks are much shorter than a control period.
+constexpr uint32_t kCurrentSampleUs = 200;
+constexpr float kMaxAcceleration = 400;
+constexpr float kMaxJerk = 4000;
+constexpr double kSettleBand = 0.02;
+constexpr float kAggressiveP = 12;
+constexpr float kAggressiveI = 6;
+constexpr float kAggressiveD = 1;
+
+struct Ramp {
+  const char* name;
+  float max_acceleration;
+  float max_jerk;
+};
+
+// Target speeds in RPM, each held for the given number of control ticks.
+using Commands = std::vector<std::pair<int16_t, int>>;
+
+void Run(const char* const scenario, const Commands& commands, const Ramp& ramp, const bool aggressive = false) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  em::MotorSimulator simulator(hal, kPositivePin, kNegativePin, kAPin, kBPin, em::MotorSimulator::Parameters());
+  em::EspEncoderMotor motor(kPositivePin, kNegativePin, kAPin, kBPin, 12, 90, em::EspEncoderMotor::kAPhaseLeads, hal);
+  motor.SetSpeedRamp(ramp.max_acceleration, ramp.max_jerk);
+  if (aggressive) {
+    motor.SetSpeedPid(kAggressiveP, kAggressiveI, kAggressiveD);
+  }
+  motor.Init(scheduler);
+
+  float peak_current = 0;
+  int saturated_ticks = 0;
+  float max_integral = 0;
+  float max_setpoint_acceleration = 0;
+  int32_t previous_setpoint = 0;
+  std::vector<float> final_speeds;
+  int16_t final_target = 0;
+  float start_speed = 0;
+  for (size_t c = 0; c < commands.size(); ++c) {
+    motor.RunSpeed(commands[c].first);
+    const bool last = c + 1 == commands.size();
+    if (last) {
+      final_target = commands[c].first;
+      start_speed = simulator.SpeedRpm();
+    }
+    for (int i = 0; i < commands[c].second; ++i) {
+      for (uint32_t t = 0; t < kPeriodUs; t += kCurrentSampleUs) {
+        simulator.Advance(kCurrentSampleUs);
+        peak_current = std::max(peak_current, std::fabs(simulator.Current()));
+      }
+      scheduler.Tick();
+
+      const em::EspEncoderMotor::Snapshot snapshot = motor.GetSnapshot();
+      if (std::abs(snapshot.pwm_duty) >= em::EspMotor::kMaxPwmDuty) {
+        ++saturated_ticks;
+      }
+      max_integral = std::max(max_integral, std::fabs(snapshot.pid_integral));
+      max_setpoint_acceleration =
+          std::max(max_setpoint_acceleration,
+                   std::abs(snapshot.setpoint_rpm - previous_setpoint) * 1000000.0f / kPeriodUs);
+      previous_setpoint = snapshot.setpoint_rpm;
+      if (last) {
+        final_speeds.push_back(simulator.SpeedRpm());
+      }
+    }
+  }
+
+  // Settling into the band around the last target and overshoot beyond it, relative to the size of the last change.
+  int settled = 0;
+  float overshoot = 0;
+  const float change = std::fabs(final_target - start_speed);
+  const float direction = final_target < start_speed ? -1 : 1;
+  for (size_t i = 0; i < final_speeds.size(); ++i) {
+    if (std::fabs(final_speeds[i] - final_target) > kSettleBand * std::abs(final_target)) {
+      settled = i + 1;
+    }
+    overshoot = std::max(overshoot, (final_speeds[i] - final_target) * direction);
+  }
+
+  printf(
+      "{\"benchmark\": \"speed_ramp\", \"scenario\": \"%s\", \"ramp\": \"%s\", \"max_acceleration_rpm_per_s\": %.0f, "
+      "\"max_jerk_rpm_per_s2\": %.0f, \"peak_current_a\": %.3f, \"saturated_ticks\": %d, \"max_pid_integral\": %.1f, "
+      "\"settling_ms\": %.1f, \"overshoot_percent\": %.2f, \"max_setpoint_acceleration_rpm_per_s\": %.0f}\n",
+      scenario,
+      ramp.name,
+      ramp.max_acceleration,
+      ramp.max_jerk,
+      peak_current,
+      saturated_ticks,
+      max_integral,
+      settled >= static_cast<int>(final_speeds.size()) ? -1.0 : settled * kPeriodUs / 1000.0,
+      change > 0 ? std::max(overshoot, 0.0f) / change * 100 : 0.0f,
+      max_setpoint_acceleration);
+}
+}  // namespace
+
+int main() {
+  const Ramp ramps[] = {
+      {"step", 0, 0},
+      {"trapezoid", kMaxAcceleration, 0},
+      {"s_curve", kMaxAcceleration, kMaxJerk},
+  };
+  for (const Ramp& ramp : ramps) {
+    Run("start", {{100, 60}}, ramp);
+    Run("start_fast", {{180, 60}}, ramp);
+    Run("reverse", {{100, 40}, {-100, 60}}, ramp);
+    Run("change_mid_ramp", {{150, 4}, {60, 60}}, ramp);
+    Run("start_aggressive", {{100, 60}}, ramp, true);
+    Run("reverse_aggressive", {{100, 40}, {-100, 60}}, ramp, true);
+  }
+  return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file static_allocation.cpp
+ * @brief Checks that compile-time configured motors allocate no heap memory after boot, and compares their encoder ISR
+ * with the runtime configured one.
+ *
+ * The global operator new is replaced by a counting one. "virtual_time" boots a StaticControlScheduler and a
+ * StaticEncoderMotor (or their runtime configured counterparts) on a simulated motor, then drives it through speed,
+ * ramped speed, queued, streamed and position commands for 20 s of virtual time and counts the allocations made after
+ * Init. "thread" does the same for 0.5 s on the real clock with the scheduler's own thread. "isr" injects encoder edges
+ * through HostHal into both motor types for either phase relation and reports the time per edge and the final counts,
+ * which must match. Prints one JSON object per scenario.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+#include "static_encoder_motor.h"
+
+namespace {
+std::atomic<uint64_t> g_allocations = 0;
+}  // namespace
+
+void* operator new(const size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* const pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* const pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* const pointer, const size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+constexpr uint8_t kPositivePin = 0;
+constexpr uint8_t kNegativePin = 1;
+constexpr uint8_t kAPin = 2;
+constexpr uint8_t kBPin = 3;
+constexpr uint32_t kPpr = 12;
+constexpr uint32_t kReduction = 90;
+constexpr uint32_t kPeriodUs = 10000;
+constexpr uint64_t kIsrCycles = 2000000;
+
+using StaticMotor = em::StaticEncoderMotor<kPositivePin, kNegativePin, kAPin, kBPin, kPpr, kReduction>;
+using StaticReversedMotor =
+    em::StaticEncoderMotor<kPositivePin, kNegativePin, kAPin, kBPin, kPpr, kReduction, em::EspEncoderMotor::kBPhaseLeads>;
+
+// The AB levels of one forward quadrature cycle, starting from both high.
+constexpr uint8_t kLevels[][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+
+// Issues one command of every kind over the run, the motor is ticked in between.
+void Command(em::EspEncoderMotor& motor, const int tick, const int64_t now_us) {
+  switch (tick) {
+    case 10:
+      motor.RunSpeed(80);
+      break;
+    case 300:
+      motor.SetSpeedRamp(200, 2000);
+      motor.RunSpeed(-60);
+      break;
+    case 600:
+      motor.PostSpeed(40);
+      break;
+    case 900: {
+      const em::EspEncoderMotor::Setpoint setpoints[] = {{now_us + 500000, 90}, {now_us + 1000000, 20}};
+      motor.StreamSetpoints(em::EspEncoderMotor::kSpeedSetpoint, setpoints, 2);
+      break;
+    }
+    case 1200:
+      motor.RunRelative(2000);
+      break;
+    case 1600:
+      motor.PostStop();
+      break;
+    default:
+      break;
+  }
+}
+
+template <typename Motor, typename Scheduler>
+void RunVirtual(const char* const variant, Motor& motor, Scheduler& scheduler, em::HostHal& hal) {
+  constexpr int kTicks = 2000;
+  em::MotorSimulator simulator(hal, kPositivePin, kNegativePin, kAPin, kBPin, em::MotorSimulator::Parameters());
+  const uint64_t before_boot = g_allocations;
+  motor.Init(scheduler);
+  const uint64_t after_boot = g_allocations;
+
+  double checksum = 0;
+  for (int i = 0; i < kTicks; ++i) {
+    simulator.Advance(kPeriodUs);
+    scheduler.Tick();
+    Command(motor, i, hal.Micros());
+    checksum += motor.GetSnapshot().speed_rpm;
+  }
+
+  printf(
+      "{\"benchmark\": \"static_allocation\", \"scenario\": \"virtual_time\", \"variant\": \"%s\", "
+      "\"motor_bytes\": %zu, \"scheduler_bytes\": %zu, \"boot_allocations\": %llu, \"ticks\": %d, "
+      "\"allocations_after_boot\": %llu, \"final_count\": %lld, \"speed_checksum\": %.1f}\n",
+      variant,
+      sizeof(motor),
+      sizeof(scheduler),
+      static_cast<unsigned long long>(after_boot - before_boot),
+      kTicks,
+      static_cast<unsigned long long>(g_allocations - after_boot),
+      static_cast<long long>(motor.EncoderPulseCount()),
+      checksum);
+}
+
+void RunThread() {
+  em::HostHal hal;
+  em::StaticControlScheduler<1000> scheduler(hal);
+  StaticMotor motor(hal);
+  const uint64_t before_boot = g_allocations;
+  motor.Init(scheduler);
+  const uint64_t after_boot = g_allocations;
+  for (int i = 0; i < 50; ++i) {
+    motor.RunSpeed(i % 2 == 0 ? 60 : -60);
+    motor.PostSpeed(30);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const uint64_t after_run = g_allocations;
+  const uint64_t ticks = scheduler.GetStatistics().ticks;
+
+  printf(
+      "{\"benchmark\": \"static_allocation\", \"scenario\": \"thread\", \"variant\": \"static\", \"period_us\": 1000, "
+      "\"boot_allocations\": %llu, \"ticks\": %llu, \"allocations_after_boot\": %llu}\n",
+      static_cast<unsigned long long>(after_boot - before_boot),
+      static_cast<unsigned long long>(ticks),
+      static_cast<unsigned long long>(after_run - after_boot));
+}
+
+template <typename Motor>
+void RunIsr(const char* const variant, const char* const phase_relation, Motor& motor, em::HostHal& hal) {
+  em::ControlScheduler scheduler(em::ControlScheduler::kDefaultPeriodUs, hal, em::ControlScheduler::kManual);
+  motor.SetDecodingMode(em::QuadratureDecoder::kX4);
+  motor.Init(scheduler);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t cycle = 0; cycle < kIsrCycles; ++cycle) {
+    for (const auto& levels : kLevels) {
+      hal.SetLevel(kAPin, levels[0]);
+      hal.SetLevel(kBPin, levels[1]);
+    }
+  }
+  const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf(
+      "{\"benchmark\": \"static_allocation\", \"scenario\": \"isr\", \"variant\": \"%s\", \"phase_relation\": \"%s\", "
+      "\"edges\": %llu, \"count\": %lld, \"ns_per_edge\": %.2f}\n",
+      variant,
+      phase_relation,
+      static_cast<unsigned long long>(kIsrCycles * 4),
+      static_cast<long long>(motor.EncoderPulseCount()),
+      elapsed_s * 1e9 / (kIsrCycles * 4));
+}
+
+void PrepareIsrHal(em::HostHal& hal) {
+  hal.SetLevel(kAPin, 1, false);
+  hal.SetLevel(kBPin, 1, false);
+}
+}  // namespace
+
+int main() {
+  {
+    em::HostHal hal;
+    hal.SetMicros(0);
+    em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+    em::EspEncoderMotor motor(
+        kPositivePin, kNegativePin, kAPin, kBPin, kPpr, kReduction, em::EspEncoderMotor::kAPhaseLeads, hal);
+    RunVirtual("runtime", motor, scheduler, hal);
+  }
+  {
+    em::HostHal hal;
+    hal.SetMicros(0);
+    em::StaticControlScheduler<kPeriodUs, em::ControlScheduler::kManual> scheduler(hal);
+    StaticMotor motor(hal);
+    RunVirtual("static", motor, scheduler, hal);
+  }
+  RunThread();
+
+  for (const bool reversed : {false, true}) {
+    const char* const phase_relation = reversed ? "b_leads" : "a_leads";
+    {
+      em::HostHal hal;
+      PrepareIsrHal(hal);
+      em::EspEncoderMotor motor(kPositivePin,
+                                kNegativePin,
+                                kAPin,
+                                kBPin,
+                                kPpr,
+                                kReduction,
+                                reversed ? em::EspEncoderMotor::kBPhaseLeads : em::EspEncoderMotor::kAPhaseLeads,
+                                hal);
+      RunIsr("runtime", phase_relation, motor, hal);
+    }
+    em::HostHal hal;
+    PrepareIsrHal(hal);
+    if (reversed) {
+      StaticReversedMotor motor(hal);
+      RunIsr("static", phase_relation, motor, hal);
+    } else {
+      StaticMotor motor(hal);
+      RunIsr("static", phase_relation, motor, hal);
+    }
+  }
+  return 0;
+}
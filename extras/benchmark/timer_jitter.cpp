@@ -0,0 +1,115 @@
+/**
+ * @file timer_jitter.cpp
+ * @brief Compares the scheduling jitter of the kThread and kTimer tick sources, and checks that kTimer ticks on the
+ * same grid as kManual in virtual time.
+ *
+ * Four motors in speed control run at 1 kHz on the real clock for each tick source, the HostHal timer thread stands in
+ * for the hardware timer. The scheduler's own statistics are reported together with the jitter, the spread between the
+ * smallest and the largest lateness, and whether it is within the 10 µs target. On the host both sources are bounded by
+ * the OS scheduler and usually miss the target, so the real clock runs are reported only; the target applies to the
+ * ESP32, where examples/timer_control_loop measures it. In virtual time a simulated motor is run once through RunUntil
+ * and once by a kTimer scheduler dispatched from HostHal::SetMicros: the timer ticks must never be late and the two runs
+ * must end in the same state, otherwise the process fails. Prints one JSON object per scenario.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr uint32_t kPeriodUs = 1000;
+constexpr size_t kMotors = 4;
+constexpr auto kRealDuration = std::chrono::seconds(2);
+constexpr int64_t kVirtualDurationUs = 5000000;
+// The jitter target of the kTimer tick source at 1 kHz with four motors.
+constexpr int64_t kJitterTargetUs = 10;
+
+void RunRealClock(const char* const name, const em::ControlScheduler::TickSource tick_source) {
+  em::HostHal hal;
+  em::ControlScheduler scheduler(kPeriodUs, hal, tick_source);
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, 12, 90,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->Init(scheduler);
+    motors.back()->RunSpeed(60);
+  }
+
+  std::this_thread::sleep_for(kRealDuration);
+  const em::ControlScheduler::Statistics statistics = scheduler.GetStatistics();
+  const int64_t jitter_us = statistics.max_lateness_us - statistics.min_lateness_us;
+
+  printf(
+      "{\"benchmark\": \"timer_jitter\", \"scenario\": \"%s\", \"motors\": %zu, \"period_us\": %u, \"ticks\": %llu, "
+      "\"overruns\": %llu, \"min_lateness_us\": %lld, \"max_lateness_us\": %lld, \"mean_lateness_us\": %lld, "
+      "\"max_execution_us\": %lld, \"jitter_us\": %lld, \"target_jitter_us\": %lld, \"within_target\": %s}\n",
+      name,
+      kMotors,
+      kPeriodUs,
+      static_cast<unsigned long long>(statistics.ticks),
+      static_cast<unsigned long long>(statistics.overruns),
+      static_cast<long long>(statistics.min_lateness_us),
+      static_cast<long long>(statistics.max_lateness_us),
+      static_cast<long long>(statistics.mean_lateness_us),
+      static_cast<long long>(statistics.max_execution_us),
+      static_cast<long long>(jitter_us),
+      static_cast<long long>(kJitterTargetUs),
+      jitter_us <= kJitterTargetUs ? "true" : "false");
+}
+
+struct VirtualResult {
+  uint64_t ticks = 0;
+  int64_t max_lateness_us = 0;
+  int64_t pulse_count = 0;
+  float speed_rpm = 0;
+};
+
+VirtualResult RunVirtual(const em::ControlScheduler::TickSource tick_source) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, tick_source);
+  em::MotorSimulator simulator(hal, 0, 1, 20, 21, em::MotorSimulator::Parameters());
+  em::EspEncoderMotor motor(0, 1, 20, 21, 12, 90, em::EspEncoderMotor::kAPhaseLeads, hal);
+  motor.Init(scheduler);
+  motor.RunSpeed(80);
+
+  if (tick_source == em::ControlScheduler::kManual) {
+    scheduler.RunUntil(kVirtualDurationUs, [&](const int64_t time_us) { simulator.AdvanceTo(time_us); });
+  } else {
+    // The timer fires from SetMicros at each deadline while the simulator advances.
+    simulator.AdvanceTo(kVirtualDurationUs);
+  }
+
+  const em::ControlScheduler::Statistics statistics = scheduler.GetStatistics();
+  return {statistics.ticks, statistics.max_lateness_us, motor.EncoderPulseCount(), motor.SpeedRpmFloat()};
+}
+}  // namespace
+
+int main() {
+  RunRealClock("real_clock_thread", em::ControlScheduler::kThread);
+  RunRealClock("real_clock_timer", em::ControlScheduler::kTimer);
+
+  const VirtualResult manual = RunVirtual(em::ControlScheduler::kManual);
+  const VirtualResult timer = RunVirtual(em::ControlScheduler::kTimer);
+  const bool identical =
+      manual.ticks == timer.ticks && manual.pulse_count == timer.pulse_count && manual.speed_rpm == timer.speed_rpm;
+  // The timer fires at the exact deadline on the virtual clock, any lateness is a dispatch error.
+  const bool on_time = timer.ticks == kVirtualDurationUs / kPeriodUs && timer.max_lateness_us == 0;
+  printf(
+      "{\"benchmark\": \"timer_jitter\", \"scenario\": \"virtual_timer_vs_manual\", \"ticks\": %llu, "
+      "\"max_lateness_us\": %lld, \"pulse_count\": %lld, \"speed_rpm\": %.3f, \"on_time\": %s, \"identical\": %s}\n",
+      static_cast<unsigned long long>(timer.ticks),
+      static_cast<long long>(timer.max_lateness_us),
+      static_cast<long long>(timer.pulse_count),
+      timer.speed_rpm,
+      on_time ? "true" : "false",
+      identical ? "true" : "false");
+  return on_time && identical ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file virtual_time.cpp
+ * @brief Measures how fast four motors run in virtual time through ControlScheduler::RunUntil, and checks that two runs
+ * with the same inputs are bit-identical.
+ *
+ * With "clock" only the virtual clock advances and the control code runs against a motor standing still, with
+ * "simulator" each motor drives a MotorSimulator. Prints one JSON object per configuration.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "host_hal.h"
+#include "motor_simulator.h"
+
+namespace {
+constexpr size_t kMotors = 4;
+constexpr uint32_t kPeriodUs = 1000;
+constexpr int64_t kDurationUs = 10000000;
+
+// FNV-1a over the published state of all motors after every tick.
+uint64_t Hash(uint64_t hash, const void* const data, const size_t size) {
+  const auto bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+struct Result {
+  uint64_t hash = 14695981039346656037ull;
+  uint64_t ticks = 0;
+  double wall_ms = 0;
+};
+
+Result Run(const bool simulate) {
+  em::HostHal hal;
+  hal.SetMicros(0);
+  em::ControlScheduler scheduler(kPeriodUs, hal, em::ControlScheduler::kManual);
+  std::vector<std::unique_ptr<em::MotorSimulator>> simulators;
+  std::vector<std::unique_ptr<em::EspEncoderMotor>> motors;
+  for (size_t i = 0; i < kMotors; ++i) {
+    em::MotorSimulator::Parameters parameters;
+    parameters.seed = i + 1;
+    parameters.edge_jitter_us = 5;
+    parameters.step_us = 50;
+    simulators.emplace_back(new em::MotorSimulator(hal, 2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, parameters));
+    motors.emplace_back(new em::EspEncoderMotor(2 * i, 2 * i + 1, 20 + 2 * i, 21 + 2 * i, 12, 90,
+                                                em::EspEncoderMotor::kAPhaseLeads, hal));
+    motors.back()->Init(scheduler);
+    motors.back()->RunSpeed(50 + 25 * i);
+  }
+
+  Result result;
+  const auto advance = [&](const int64_t time_us) {
+    if (simulate) {
+      for (const auto& simulator : simulators) {
+        simulator->AdvanceTo(time_us);
+      }
+    } else {
+      hal.SetMicros(time_us);
+    }
+    for (const auto& motor : motors) {
+      const em::EspEncoderMotor::Snapshot snapshot = motor->GetSnapshot();
+      result.hash = Hash(result.hash, &snapshot.pulse_count, sizeof(snapshot.pulse_count));
+      result.hash = Hash(result.hash, &snapshot.speed_rpm, sizeof(snapshot.speed_rpm));
+      result.hash = Hash(result.hash, &snapshot.pwm_duty, sizeof(snapshot.pwm_duty));
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  scheduler.RunUntil(kDurationUs, advance);
+  result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  result.ticks = scheduler.GetStatistics().ticks;
+  return result;
+}
+
+void Report(const char* const plant, const bool simulate) {
+  const Result first = Run(simulate);
+  const Result second = Run(simulate);
+  printf(
+      "{\"benchmark\": \"virtual_time\", \"plant\": \"%s\", \"motors\": %zu, \"ticks\": %llu, \"ticks_per_wall_ms\": "
+      "%.1f, \"realtime_factor\": %.1f, \"identical\": %s}\n",
+      plant,
+      kMotors,
+      static_cast<unsigned long long>(first.ticks),
+      first.ticks / first.wall_ms,
+      kDurationUs / 1000.0 / first.wall_ms,
+      first.hash == second.hash && first.ticks == second.ticks ? "true" : "false");
+}
+}  // namespace
+
+int main() {
+  Report("clock", false);
+  Report("simulator", true);
+  return 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file telemetry_to_csv.cpp
+ * @brief Decodes the binary frames written by TelemetryRecorder::Stream into CSV.
+ *
+ * Usage: telemetry_to_csv [input] [output], reading stdin and writing stdout when omitted. The input is a raw capture of
+ * the byte sink, e.g. a serial port dumped to a file; bytes outside valid frames are skipped. The numbers of frames and
+ * CRC errors are reported on stderr.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "telemetry_recorder.h"
+
+int main(int argc, char* argv[]) {
+  FILE* const input = argc > 1 ? std::fopen(argv[1], "rb") : stdin;
+  if (input == nullptr) {
+    std::fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+  FILE* const output = argc > 2 ? std::fopen(argv[2], "w") : stdout;
+  if (output == nullptr) {
+    std::fprintf(stderr, "cannot open %s\n", argv[2]);
+    return 1;
+  }
+
+  std::fprintf(output, "id,time_us,pulse_count,target_rpm,speed_rpm,pwm_duty\n");
+  em::TelemetryDecoder decoder;
+  uint64_t frames = 0;
+  uint8_t buffer[4096];
+  size_t size = 0;
+  while ((size = std::fread(buffer, 1, sizeof(buffer), input)) > 0) {
+    for (size_t i = 0; i < size; ++i) {
+      uint8_t id = 0;
+      em::TelemetryRecord record;
+      if (decoder.Push(buffer[i], &id, &record)) {
+        std::fprintf(output,
+                     "%u,%" PRId64 ",%" PRId64 ",%g,%g,%d\n",
+                     id,
+                     record.time_us,
+                     record.pulse_count,
+                     record.target_rpm,
+                     record.speed_rpm,
+                     record.pwm_duty);
+        ++frames;
+      }
+    }
+  }
+
+  std::fprintf(stderr, "frames: %" PRIu64 ", crc errors: %" PRIu32 "\n", frames, decoder.CrcErrors());
+  if (input != stdin) {
+    std::fclose(input);
+  }
+  if (output != stdout) {
+    std::fclose(output);
+  }
+  return 0;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file control_scheduler.cpp
+ */
+
+#include "control_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_pthread.h"
+#include "esp_task.h"
+#endif
+
+namespace em {
+
+namespace {
+#if defined(ARDUINO_ARCH_ESP32)
+constexpr size_t kThreadPriority = 10;
+// The thread of a timer scheduler runs the ticks at the priority of the esp_timer task, which used to dispatch them.
+constexpr size_t kTimerThreadPriority = ESP_TASK_TIMER_PRIO;
+// Bounds how long the woken thread may miss that its scheduler is being destroyed.
+constexpr TickType_t kTimerWaitTicks = pdMS_TO_TICKS(10);
+constexpr char kThreadName[] = "em_control";
+// On the ESP32 the timer handler runs in interrupt context and hands the tick over to the scheduling thread.
+constexpr bool kTimerNeedsThread = true;
+#else
+constexpr bool kTimerNeedsThread = false;
+#endif
+}  // namespace
+
+ControlScheduler::ControlScheduler(const uint32_t period_us, Hal& hal, const TickSource tick_source)
+    : hal_(hal), tick_source_(tick_source), period_us_(std::clamp(period_us, kMinPeriodUs, kMaxPeriodUs)) {
+}
+
+ControlScheduler::ControlScheduler(const uint32_t period_us,
+                                   Hal& hal,
+                                   const TickSource tick_source,
+                                   uint8_t* const stack,
+                                   const size_t stack_size,
+                                   TaskControlBlock* const control_block)
+    : hal_(hal),
+      tick_source_(tick_source),
+      stack_(stack),
+      stack_size_(stack_size),
+      control_block_(control_block),
+      period_us_(std::clamp(period_us, kMinPeriodUs, kMaxPeriodUs)) {
+}
+
+ControlScheduler::~ControlScheduler() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  running_ = false;
+  const auto thread = std::exchange(thread_, nullptr);
+#if defined(ARDUINO_ARCH_ESP32)
+  const auto task = std::exchange(task_, nullptr);
+#endif
+  const bool timer_attached = std::exchange(timer_attached_, false);
+  lock.unlock();
+  // Unlocked, the detach waits for a running timer tick, which locks the mutex.
+  if (timer_attached) {
+    hal_.TimerDetach(this);
+  }
+  condition_.notify_all();
+#if defined(ARDUINO_ARCH_ESP32)
+  const TaskHandle_t timer_task = timer_task_.load(std::memory_order_acquire);
+  if (timer_task != nullptr) {
+    xTaskNotifyGive(timer_task);
+  }
+#endif
+  if (thread != nullptr) {
+    thread->join();
+    delete thread;
+  }
+#if defined(ARDUINO_ARCH_ESP32)
+  if (task != nullptr) {
+    // The task suspends itself once Run returns, only then is it safe to delete it and release its stack.
+    while (eTaskGetState(task) != eSuspended) {
+      vTaskDelay(1);
+    }
+    vTaskDelete(task);
+  }
+#endif
+}
+
+ControlScheduler& ControlScheduler::Default() {
+  // Never destroyed, so that motors with static storage duration can still unregister themselves at exit.
+  static ControlScheduler* const scheduler = new ControlScheduler();
+  return *scheduler;
+}
+
+bool ControlScheduler::Register(ControlTask* const task) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (task == nullptr || task_count_ >= kMaxTasks) {
+    return false;
+  }
+
+  if (std::find(tasks_.begin(), tasks_.begin() + task_count_, task) != tasks_.begin() + task_count_) {
+    return true;
+  }
+
+  tasks_[task_count_++] = task;
+
+  if (tick_source_ == kTimer && !timer_attached_ && !running_) {
+    // The grid starts before the timer does, so that the lateness includes the whole dispatch delay.
+    next_deadline_us_ = hal_.Micros() + period_us_;
+    timer_attached_ = hal_.TimerAttach(period_us_, ControlScheduler::OnTimer, this);
+  }
+
+  if ((tick_source_ == kThread || (tick_source_ == kTimer && (!timer_attached_ || kTimerNeedsThread))) && !running_) {
+    StartThread();
+  }
+  return true;
+}
+
+void ControlScheduler::Unregister(ControlTask* const task) {
+  std::lock_guard<std::mutex> l(mutex_);
+  const auto end = tasks_.begin() + task_count_;
+  const auto it = std::find(tasks_.begin(), end, task);
+  if (it != end) {
+    std::copy(it + 1, end, it);
+    tasks_[--task_count_] = nullptr;
+  }
+}
+
+void ControlScheduler::SetPeriodUs(const uint32_t period_us) {
+  std::lock_guard<std::mutex> l(mutex_);
+  period_us_ = std::clamp(period_us, kMinPeriodUs, kMaxPeriodUs);
+  if (timer_attached_) {
+    next_deadline_us_ = hal_.Micros() + period_us_;
+    hal_.TimerAttach(period_us_, ControlScheduler::OnTimer, this);
+  }
+}
+
+uint32_t ControlScheduler::PeriodUs() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return period_us_;
+}
+
+ControlScheduler::Statistics ControlScheduler::GetStatistics() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  Statistics statistics = statistics_;
+  if (statistics.ticks > 0) {
+    statistics.mean_lateness_us = total_lateness_us_ / static_cast<int64_t>(statistics.ticks);
+  }
+  return statistics;
+}
+
+void ControlScheduler::ResetStatistics() {
+  std::lock_guard<std::mutex> l(mutex_);
+  statistics_ = Statistics();
+  total_lateness_us_ = 0;
+}
+
+void ControlScheduler::Tick() {
+  std::lock_guard<std::mutex> l(mutex_);
+  RunTasks();
+}
+
+void ControlScheduler::RunUntil(const int64_t time_us, const AdvanceHandler& advance) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (tick_source_ != kManual) {
+    return;
+  }
+
+  if (!virtual_time_started_) {
+    virtual_time_started_ = true;
+    next_deadline_us_ = hal_.Micros() + period_us_;
+  }
+
+  while (next_deadline_us_ <= time_us) {
+    const int64_t deadline_us = next_deadline_us_;
+    // Unlocked, so that the plant may call back into the scheduler or the motors.
+    lock.unlock();
+    if (advance != nullptr) {
+      advance(deadline_us);
+    }
+    lock.lock();
+    RunTasks();
+    ++statistics_.ticks;
+    next_deadline_us_ = deadline_us + period_us_;
+  }
+
+  lock.unlock();
+  if (advance != nullptr) {
+    advance(time_us);
+  }
+}
+
+void ControlScheduler::Run() {
+  using Clock = std::chrono::steady_clock;
+  std::unique_lock lock(mutex_);
+#if defined(ARDUINO_ARCH_ESP32)
+  if (timer_attached_) {
+    lock.unlock();
+    RunTimerTicks();
+    return;
+  }
+#endif
+  auto deadline = Clock::now();
+  while (true) {
+    deadline += std::chrono::microseconds(period_us_);
+    if (condition_.wait_until(lock, deadline, [this]() { return !running_; })) {
+      return;
+    }
+
+    const auto wake_time = Clock::now();
+    int64_t lateness_us = std::chrono::duration_cast<std::chrono::microseconds>(wake_time - deadline).count();
+    if (lateness_us >= period_us_) {
+      // Skip the deadlines that already passed but stay on the original time grid.
+      const int64_t missed = lateness_us / period_us_;
+      statistics_.overruns += missed;
+      deadline += std::chrono::microseconds(missed * period_us_);
+      lateness_us -= missed * period_us_;
+    }
+
+    RunTasks();
+
+    RecordTick(lateness_us, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - wake_time).count());
+  }
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+void ControlScheduler::RunTimerTicks() {
+  timer_task_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+  while (true) {
+    if (ulTaskNotifyTake(pdTRUE, kTimerWaitTicks) > 0) {
+      TimerTick();
+    }
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!running_) {
+      return;
+    }
+  }
+}
+#endif
+
+void ControlScheduler::StartThread() {
+  running_ = true;
+#if defined(ARDUINO_ARCH_ESP32)
+  const size_t priority = timer_attached_ ? kTimerThreadPriority : kThreadPriority;
+  if (stack_ != nullptr) {
+    task_ = xTaskCreateStaticPinnedToCore(&ControlScheduler::RunTask,
+                                          kThreadName,
+                                          stack_size_,
+                                          this,
+                                          priority,
+                                          reinterpret_cast<StackType_t*>(stack_),
+                                          control_block_,
+                                          tskNO_AFFINITY);
+    return;
+  }
+
+  auto config = esp_pthread_get_default_config();
+  config.stack_size = stack_size_;
+  config.prio = priority;
+  config.thread_name = kThreadName;
+  esp_pthread_set_cfg(&config);
+#endif
+  thread_ = new std::thread(&ControlScheduler::Run, this);
+#if defined(ARDUINO_ARCH_ESP32)
+  config = esp_pthread_get_default_config();
+  esp_pthread_set_cfg(&config);
+#endif
+}
+
+void ControlScheduler::RunTask(void* self) {
+  reinterpret_cast<ControlScheduler*>(self)->Run();
+#if defined(ARDUINO_ARCH_ESP32)
+  // A FreeRTOS task must not return, it waits here to be deleted by the destructor.
+  vTaskSuspend(nullptr);
+#endif
+}
+
+void ControlScheduler::OnTimer(void* self) {
+  ControlScheduler* const scheduler = reinterpret_cast<ControlScheduler*>(self);
+#if defined(ARDUINO_ARCH_ESP32)
+  // Only wakes the scheduling thread, which runs the tick, as the handler may run in interrupt context.
+  const TaskHandle_t task = scheduler->timer_task_.load(std::memory_order_acquire);
+  if (task == nullptr) {
+    return;
+  }
+  if (xPortInIsrContext()) {
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+  } else {
+    xTaskNotifyGive(task);
+  }
+#else
+  scheduler->TimerTick();
+#endif
+}
+
+void ControlScheduler::TimerTick() {
+  // Taken before locking, so that a getter holding the lock shows up as lateness, and on the ESP32 after the thread woke
+  // up, so that the lateness includes the hand-over from the timer interrupt.
+  const int64_t wake_us = hal_.Micros();
+  std::lock_guard<std::mutex> l(mutex_);
+  if (!timer_attached_) {
+    return;
+  }
+
+  int64_t lateness_us = wake_us - next_deadline_us_;
+  if (lateness_us >= period_us_) {
+    // The timer skips the expiries missed meanwhile, the grid follows it.
+    const int64_t missed = lateness_us / period_us_;
+    statistics_.overruns += missed;
+    next_deadline_us_ += missed * period_us_;
+    lateness_us -= missed * period_us_;
+  }
+  next_deadline_us_ += period_us_;
+
+  RunTasks();
+
+  RecordTick(lateness_us, hal_.Micros() - wake_us);
+}
+
+void ControlScheduler::RecordTick(const int64_t lateness_us, const int64_t execution_us) {
+  statistics_.min_lateness_us =
+      statistics_.ticks == 0 ? lateness_us : std::min(statistics_.min_lateness_us, lateness_us);
+  statistics_.max_lateness_us = std::max(statistics_.max_lateness_us, lateness_us);
+  statistics_.max_execution_us = std::max(statistics_.max_execution_us, execution_us);
+  total_lateness_us_ += lateness_us;
+  ++statistics_.ticks;
+}
+
+void ControlScheduler::RunTasks() {
+  const int64_t now_us = hal_.Micros();
+  for (size_t i = 0; i < task_count_; ++i) {
+    tasks_[i]->Sample(now_us);
+  }
+  for (size_t i = 0; i < task_count_; ++i) {
+    tasks_[i]->Control(now_us);
+  }
+}
+
+}  // namespace em
@@ -0,0 +1,541 @@
+#pragma once
+
+#ifndef _EM_CONTROL_SCHEDULER_H_
+#define _EM_CONTROL_SCHEDULER_H_
+
+/**
+ * @file control_scheduler.h
+ */
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "hal.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+namespace em {
+/**
+ * @~Chinese
+ * @class ControlTask
+ * @brief 由 @ref ControlScheduler 周期性执行的控制任务接口。
+ */
+/**
+ * @~English
+ * @class ControlTask
+ * @brief Interface of a control task executed periodically by @ref ControlScheduler.
+ */
+class ControlTask {
+ public:
+  virtual ~ControlTask() = default;
+
+  /**
+   * @~Chinese
+   * @brief 采样阶段，在同一个周期内，所有任务的采样阶段都在控制阶段之前执行。
+   * @param[in] now_us 本周期的时间，单位为微秒，同一周期内所有任务的值相同。
+   */
+  /**
+   * @~English
+   * @brief Sampling phase, within one tick the sampling phase of every task runs before any control phase.
+   * @param[in] now_us The time of this tick in microseconds, the same for all tasks within one tick.
+   */
+  virtual void Sample(const int64_t now_us) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 控制阶段。
+   * @param[in] now_us 本周期的时间，单位为微秒，同一周期内所有任务的值相同。
+   */
+  /**
+   * @~English
+   * @brief Control phase.
+   * @param[in] now_us The time of this tick in microseconds, the same for all tasks within one tick.
+   */
+  virtual void Control(const int64_t now_us) = 0;
+};
+
+/**
+ * @~Chinese
+ * @class ControlScheduler
+ * @brief 控制调度器，使用一个高优先级线程按固定周期对所有已注册的任务先统一采样、再统一执行控制。
+ * @details 多个电机共享同一个调度器时只需要一个线程，并且所有电机在同一时刻采样。每个周期的截止时间由上一个截止时间加上
+ * 控制周期得到，基于单调时钟，唤醒延迟不会累积成漂移。触发方式为 @ref kTimer 时由硬件定时器代替线程的定时等待触发，唤醒时间
+ * 不受其他任务调度的影响。
+ */
+/**
+ * @~English
+ * @class ControlScheduler
+ * @brief Control scheduler, a single high-priority thread that samples all registered tasks and then runs all their
+ * control phases once per fixed period.
+ * @details Motors sharing one scheduler need only one thread between them, and are all sampled at the same instant. Each
+ * deadline is the previous deadline plus the period on the monotonic clock, so wake-up latency never accumulates into
+ * drift. With the @ref kTimer tick source a hardware timer triggers the ticks instead of the thread's timed wait, so the wake-up time
+ * doesn't depend on how other tasks are scheduled.
+ */
+class ControlScheduler {
+ public:
+  /**
+   * @~Chinese
+   * @brief 每个调度器最多可注册的任务数量。
+   */
+  /**
+   * @~English
+   * @brief The maximum number of tasks that can be registered with one scheduler.
+   */
+  static constexpr size_t kMaxTasks = 8;
+
+  /**
+   * @~Chinese
+   * @brief 默认控制周期，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The default control period in microseconds.
+   */
+  static constexpr uint32_t kDefaultPeriodUs = 50000;
+
+  /**
+   * @~Chinese
+   * @brief 最小控制周期，单位为微秒，对应1kHz。
+   */
+  /**
+   * @~English
+   * @brief The minimum control period in microseconds, i.e. 1 kHz.
+   */
+  static constexpr uint32_t kMinPeriodUs = 1000;
+
+  /**
+   * @~Chinese
+   * @brief 最大控制周期，单位为微秒，对应10Hz。
+   */
+  /**
+   * @~English
+   * @brief The maximum control period in microseconds, i.e. 10 Hz.
+   */
+  static constexpr uint32_t kMaxPeriodUs = 100000;
+
+  /**
+   * @~Chinese
+   * @brief 调度线程的默认栈大小，单位为字节，仅在ESP32上有效。
+   */
+  /**
+   * @~English
+   * @brief The default stack size of the scheduling thread in bytes, only effective on the ESP32.
+   */
+  static constexpr size_t kDefaultStackSize = 4096;
+
+#if defined(ARDUINO_ARCH_ESP32)
+  using TaskControlBlock = StaticTask_t;
+#else
+  struct TaskControlBlock {};
+#endif
+
+  /**
+   * @~Chinese
+   * @brief 调度统计信息。延迟指调度线程或定时器实际触发的时间晚于计划时间的部分，即调度抖动。
+   */
+  /**
+   * @~English
+   * @brief Scheduling statistics. Lateness is how much later than its deadline the scheduling thread or timer actually
+   * triggered, i.e. the scheduling jitter.
+   */
+  struct Statistics {
+    /**
+     * @~Chinese
+     * @brief 已执行的调度周期数。
+     */
+    /**
+     * @~English
+     * @brief The number of executed ticks.
+     */
+    uint64_t ticks = 0;
+
+    /**
+     * @~Chinese
+     * @brief 因为上一周期超时而被跳过的周期数。
+     */
+    /**
+     * @~English
+     * @brief The number of ticks skipped because the previous tick overran.
+     */
+    uint64_t overruns = 0;
+
+    /**
+     * @~Chinese
+     * @brief 最小延迟，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The minimum lateness in microseconds.
+     */
+    int64_t min_lateness_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 最大延迟，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The maximum lateness in microseconds.
+     */
+    int64_t max_lateness_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 平均延迟，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The mean lateness in microseconds.
+     */
+    int64_t mean_lateness_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 单个周期内执行所有任务的最长时间，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The longest time spent running all tasks in one tick, in microseconds.
+     */
+    int64_t max_execution_us = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 虚拟时间下推进外部环境的回调函数类型，参见 @ref RunUntil。
+   * @param[in] time_us 需要推进到的时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Callback type that advances the environment in virtual time, see @ref RunUntil.
+   * @param[in] time_us The time to advance to in microseconds.
+   */
+  using AdvanceHandler = std::function<void(const int64_t time_us)>;
+
+  /**
+   * @~Chinese
+   * @brief 调度周期的触发方式。
+   */
+  /**
+   * @~English
+   * @brief How the scheduling ticks are triggered.
+   */
+  enum TickSource : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 由调度器自己的线程按控制周期触发。
+     */
+    /**
+     * @~English
+     * @brief Triggered by the scheduler's own thread at the control period.
+     */
+    kThread,
+
+    /**
+     * @~Chinese
+     * @brief 不创建线程，只由调用者通过 @ref Tick 或 @ref RunUntil 触发，用于仿真、基准测试和回归测试。
+     */
+    /**
+     * @~English
+     * @brief No thread is created, ticks are only triggered by the caller through @ref Tick or @ref RunUntil, for
+     * simulations, benchmarks and regression tests.
+     */
+    kManual,
+
+    /**
+     * @~Chinese
+     * @brief 由硬件定时器（@ref Hal::TimerAttach，ESP32上为esp_timer）按控制周期触发。ESP32上定时器中断只唤醒
+     * 调度线程，任务和电机的回调函数在调度线程中以esp_timer任务的优先级执行，应尽快返回；主机上任务直接在定时器的
+     * 处理函数中执行。平台不支持定时器时退回到 @ref kThread。
+     */
+    /**
+     * @~English
+     * @brief Triggered by a hardware timer (@ref Hal::TimerAttach, esp_timer on the ESP32) at the control period. On
+     * the ESP32 the timer interrupt only wakes the scheduling thread, which runs the tasks, and with them the motor
+     * callbacks, at the priority of the esp_timer task, so they should return quickly; on a host the tasks run in the
+     * timer handler directly. Falls back to @ref kThread if the platform has no timer.
+     */
+    kTimer,
+  };
+
+  /**
+   * @~Chinese
+   * @brief 构造函数，用于创建一个 ControlScheduler 对象。
+   * @param[in] period_us 控制周期，单位为微秒，取值范围 @ref kMinPeriodUs 到 @ref kMaxPeriodUs。
+   * @param[in] hal 用于获取时间的硬件抽象层，默认为当前平台的 @ref DefaultHal。
+   * @param[in] tick_source 调度周期的触发方式，@ref TickSource，默认为 @ref kThread。
+   * @details 需要不同控制频率的电机可以分别注册到不同的调度器。
+   */
+  /**
+   * @~English
+   * @brief Constructor for creating a ControlScheduler object.
+   * @param[in] period_us The control period in microseconds, from @ref kMinPeriodUs to @ref kMaxPeriodUs.
+   * @param[in] hal The hardware abstraction layer used for timing, defaults to @ref DefaultHal of the current platform.
+   * @param[in] tick_source How the ticks are triggered, @ref TickSource, defaults to @ref kThread.
+   * @details Motors that need different control rates can be registered with different schedulers.
+   */
+  explicit ControlScheduler(const uint32_t period_us = kDefaultPeriodUs,
+                            Hal& hal = DefaultHal(),
+                            const TickSource tick_source = kThread);
+
+  ~ControlScheduler();
+
+  /**
+   * @~Chinese
+   * @brief 获取默认的控制调度器，未指定调度器的电机都注册到该调度器。
+   * @return 默认的控制调度器。
+   */
+  /**
+   * @~English
+   * @brief Get the default control scheduler, motors without an explicit scheduler are registered with it.
+   * @return The default control scheduler.
+   */
+  static ControlScheduler& Default();
+
+  /**
+   * @~Chinese
+   * @brief 注册任务，触发方式为 @ref kThread 或 @ref kTimer 时在首次注册任务时启动调度线程或定时器。
+   * @param[in] task 要注册的任务。
+   * @return 注册成功返回true，任务数量已达到 @ref kMaxTasks 时返回false。
+   */
+  /**
+   * @~English
+   * @brief Register a task, with @ref kThread or @ref kTimer the scheduling thread or the timer is started when the first
+   * task is registered.
+   * @param[in] task The task to register.
+   * @return true on success, false if @ref kMaxTasks tasks are already registered.
+   */
+  bool Register(ControlTask* const task);
+
+  /**
+   * @~Chinese
+   * @brief 注销任务，函数返回后该任务不会再被执行。
+   * @param[in] task 要注销的任务。
+   */
+  /**
+   * @~English
+   * @brief Unregister a task, the task is no longer executed once this function returns.
+   * @param[in] task The task to unregister.
+   */
+  void Unregister(ControlTask* const task);
+
+  /**
+   * @~Chinese
+   * @brief 设置控制周期，从下一个周期开始生效。
+   * @param[in] period_us 控制周期，单位为微秒，超出 @ref kMinPeriodUs 到 @ref kMaxPeriodUs 范围时取边界值。
+   */
+  /**
+   * @~English
+   * @brief Set the control period, effective from the next tick.
+   * @param[in] period_us The control period in microseconds, clamped to @ref kMinPeriodUs to @ref kMaxPeriodUs.
+   */
+  void SetPeriodUs(const uint32_t period_us);
+
+  /**
+   * @~Chinese
+   * @brief 获取控制周期。
+   * @return 控制周期，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Get the control period.
+   * @return The control period in microseconds.
+   */
+  uint32_t PeriodUs() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取调度线程或定时器的统计信息。
+   * @return 统计信息，@ref Statistics。
+   */
+  /**
+   * @~English
+   * @brief Get the statistics of the scheduling thread or timer.
+   * @return The statistics, @ref Statistics.
+   */
+  Statistics GetStatistics() const;
+
+  /**
+   * @~Chinese
+   * @brief 清零统计信息。
+   */
+  /**
+   * @~English
+   * @brief Clear the statistics.
+   */
+  void ResetStatistics();
+
+  /**
+   * @~Chinese
+   * @brief 在调用线程中立即执行一个调度周期。
+   */
+  /**
+   * @~English
+   * @brief Run one scheduling tick immediately on the calling thread.
+   */
+  void Tick();
+
+  /**
+   * @~Chinese
+   * @brief 在虚拟时间中运行到指定时间，仅在触发方式为 @ref kManual 时有效。
+   * @param[in] time_us 运行到的时间，单位为微秒。
+   * @param[in] advance 推进外部环境的回调函数，在每个截止时间执行调度周期之前以该截止时间调用一次，返回前再以 @p time_us
+   * 调用一次，不持有调度器的锁。回调函数负责推进时钟（如 @ref HostHal::SetMicros）以及被控对象（如 @ref MotorSimulator）。
+   * @details 截止时间位于首次调用时的时间加上整数个控制周期的时间网格上，每个调度周期恰好在截止时间执行，不依赖真实时钟，
+   * 因此运行速度只受计算量限制，且相同输入的多次运行结果完全相同。
+   */
+  /**
+   * @~English
+   * @brief Run in virtual time up to the given time, only effective with the @ref kManual tick source.
+   * @param[in] time_us The time to run to in microseconds.
+   * @param[in] advance The callback that advances the environment, called with each deadline before the tick at that
+   * deadline runs and once more with @p time_us before returning, without holding the scheduler lock. It is responsible
+   * for advancing the clock (e.g. @ref HostHal::SetMicros) and the controlled plant (e.g. @ref MotorSimulator).
+   * @details Deadlines lie on the grid of whole periods after the time of the first call, and each tick runs exactly at
+   * its deadline without consulting a real clock, so the run is only bounded by computation and repeated runs with the
+   * same inputs produce identical results.
+   */
+  void RunUntil(const int64_t time_us, const AdvanceHandler& advance);
+
+ protected:
+  /**
+   * @~Chinese
+   * @brief 使用调用者提供的栈和任务控制块创建调度线程的构造函数，参见 @ref StaticControlScheduler。
+   * @param[in] period_us 控制周期，单位为微秒，取值范围 @ref kMinPeriodUs 到 @ref kMaxPeriodUs。
+   * @param[in] hal 用于获取时间的硬件抽象层。
+   * @param[in] tick_source 调度周期的触发方式，@ref TickSource。
+   * @param[in] stack 调度线程的栈，生存期不短于调度器。
+   * @param[in] stack_size 栈的大小，单位为字节。
+   * @param[in] control_block 调度线程的任务控制块，生存期不短于调度器。
+   * @details 在ESP32上以静态分配的FreeRTOS任务代替std::thread，创建线程不分配堆内存；在主机上忽略栈和任务控制块。
+   */
+  /**
+   * @~English
+   * @brief Constructor whose scheduling thread uses a stack and a task control block provided by the caller, see
+   * @ref StaticControlScheduler.
+   * @param[in] period_us The control period in microseconds, from @ref kMinPeriodUs to @ref kMaxPeriodUs.
+   * @param[in] hal The hardware abstraction layer used for timing.
+   * @param[in] tick_source How the ticks are triggered, @ref TickSource.
+   * @param[in] stack The stack of the scheduling thread, which must outlive the scheduler.
+   * @param[in] stack_size The size of the stack in bytes.
+   * @param[in] control_block The task control block of the scheduling thread, which must outlive the scheduler.
+   * @details On the ESP32 a statically allocated FreeRTOS task replaces std::thread, so starting the thread allocates no
+   * heap memory; on a host the stack and the task control block are ignored.
+   */
+  ControlScheduler(const uint32_t period_us,
+                   Hal& hal,
+                   const TickSource tick_source,
+                   uint8_t* const stack,
+                   const size_t stack_size,
+                   TaskControlBlock* const control_block);
+
+ private:
+  static void OnTimer(void* self);
+
+  static void RunTask(void* self);
+
+  void StartThread();
+
+  void Run();
+
+#if defined(ARDUINO_ARCH_ESP32)
+  void RunTimerTicks();
+#endif
+
+  void TimerTick();
+
+  void RunTasks();
+
+  void RecordTick(const int64_t lateness_us, const int64_t execution_us);
+
+  Hal& hal_;
+  const TickSource tick_source_ = kThread;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread* thread_ = nullptr;
+  uint8_t* const stack_ = nullptr;
+  const size_t stack_size_ = kDefaultStackSize;
+  TaskControlBlock* const control_block_ = nullptr;
+#if defined(ARDUINO_ARCH_ESP32)
+  TaskHandle_t task_ = nullptr;
+  // Woken by the timer interrupt, read there without locking.
+  std::atomic<TaskHandle_t> timer_task_ = nullptr;
+#endif
+  bool timer_attached_ = false;
+  std::array<ControlTask*, kMaxTasks> tasks_ = {};
+  size_t task_count_ = 0;
+  uint32_t period_us_ = kDefaultPeriodUs;
+  bool running_ = false;
+  Statistics statistics_;
+  int64_t total_lateness_us_ = 0;
+  bool virtual_time_started_ = false;
+  int64_t next_deadline_us_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @class StaticControlScheduler
+ * @brief 控制周期和触发方式在编译期确定、调度线程的栈和任务控制块静态分配的控制调度器。
+ * @details 定义为全局对象时栈位于.bss段，内存占用在链接时即已确定，启动调度线程不分配堆内存（ESP32上以
+ * xTaskCreateStaticPinnedToCore创建任务，主机上仍使用std::thread）。其余行为与 @ref ControlScheduler 相同，
+ * 可与 @ref StaticEncoderMotor 配合使用。
+ * @tparam kPeriodUs 控制周期，单位为微秒，取值范围 @ref ControlScheduler::kMinPeriodUs 到
+ * @ref ControlScheduler::kMaxPeriodUs，超出时编译失败。
+ * @tparam kTickSource 调度周期的触发方式，@ref ControlScheduler::TickSource。
+ * @tparam kStackSize 调度线程的栈大小，单位为字节，仅在ESP32上使用。
+ */
+/**
+ * @~English
+ * @class StaticControlScheduler
+ * @brief Control scheduler whose control period and tick source are fixed at compile time, and whose scheduling thread
+ * runs on a statically allocated stack and task control block.
+ * @details Defined as a global, the stack lives in .bss, so the memory footprint is fixed at link time, and starting
+ * the scheduling thread allocates no heap memory (the task is created with xTaskCreateStaticPinnedToCore on the ESP32,
+ * a host still uses std::thread). Otherwise it behaves like @ref ControlScheduler, and pairs with
+ * @ref StaticEncoderMotor.
+ * @tparam kPeriodUs The control period in microseconds, from @ref ControlScheduler::kMinPeriodUs to
+ * @ref ControlScheduler::kMaxPeriodUs, other values fail to compile.
+ * @tparam kTickSource How the ticks are triggered, @ref ControlScheduler::TickSource.
+ * @tparam kStackSize The stack size of the scheduling thread in bytes, only used on the ESP32.
+ */
+template <uint32_t kPeriodUs,
+          ControlScheduler::TickSource kTickSource = ControlScheduler::kThread,
+          size_t kStackSize = ControlScheduler::kDefaultStackSize>
+class StaticControlScheduler : public ControlScheduler {
+ public:
+  static_assert(kPeriodUs >= kMinPeriodUs && kPeriodUs <= kMaxPeriodUs, "control period out of range");
+  static_assert(kStackSize >= 1024, "stack too small for the control tasks");
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] hal 用于获取时间的硬件抽象层，默认为当前平台的 @ref DefaultHal。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] hal The hardware abstraction layer used for timing, defaults to @ref DefaultHal of the current platform.
+   */
+  explicit StaticControlScheduler(Hal& hal = DefaultHal())
+      : ControlScheduler(kPeriodUs, hal, kTickSource, stack_, kStackSize, &control_block_) {
+  }
+
+ private:
+  // Only referenced by the base class until the scheduler is destroyed, so handing them out before they are
+  // initialized is fine.
+  alignas(16) uint8_t stack_[kStackSize];
+  TaskControlBlock control_block_;
+};
+}  // namespace em
+
+#endif
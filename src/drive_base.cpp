@@ -0,0 +1,100 @@
+/**
+ * @file drive_base.cpp
+ */
+
+#include "drive_base.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+namespace {
+constexpr float kTwoPi = 6.2831853f;
+}  // namespace
+
+DriveBase::DriveBase(const DriveKinematics& kinematics,
+                     std::initializer_list<EspEncoderMotor*> motors,
+                     const float max_wheel_rpm)
+    : MotorGroup(motors),
+      kinematics_(kinematics),
+      wheel_count_(std::min({kinematics.WheelCount(), Size(), DriveKinematics::kMaxWheels})),
+      max_wheel_rpm_(max_wheel_rpm) {
+}
+
+bool DriveBase::Init(ControlScheduler& scheduler) {
+  // Recorded before the group registers, the decoding mode of a motor is fixed once it is initialized.
+  for (size_t i = 0; i < wheel_count_; ++i) {
+    radians_per_pulse_[i] = static_cast<float>(kTwoPi / Motor(i)->PulsesPerRevolution());
+  }
+  return MotorGroup::Init(scheduler);
+}
+
+float DriveBase::Drive(const Twist& twist) {
+  float wheel_rpm[DriveKinematics::kMaxWheels] = {};
+  kinematics_.ToWheelSpeeds(twist, wheel_rpm);
+  for (size_t i = 0; i < wheel_count_; ++i) {
+    wheel_rpm[i] *= 60 / kTwoPi;
+  }
+  const float scale = DriveKinematics::Desaturate(wheel_rpm, wheel_count_, max_wheel_rpm_);
+
+  int16_t speeds_rpm[DriveKinematics::kMaxWheels] = {};
+  for (size_t i = 0; i < wheel_count_; ++i) {
+    speeds_rpm[i] = std::lround(wheel_rpm[i]);
+  }
+  RunSpeed(speeds_rpm, wheel_count_);
+  return scale;
+}
+
+void DriveBase::ResetPose(const Pose& pose) {
+  std::lock_guard<std::mutex> l(reset_mutex_);
+  reset_pending_ = true;
+  reset_pose_ = pose;
+}
+
+DriveBase::State DriveBase::GetState() const {
+  return state_.Read();
+}
+
+void DriveBase::Control(const int64_t now_us) {
+  MotorGroup::Control(now_us);
+
+  {
+    std::lock_guard<std::mutex> l(reset_mutex_);
+    if (reset_pending_) {
+      reset_pending_ = false;
+      odometry_.Reset(reset_pose_);
+    }
+  }
+
+  // The group snapshots of this tick, all sampled at the same instant.
+  EspEncoderMotor::Snapshot snapshots[DriveKinematics::kMaxWheels];
+  GetSnapshots(snapshots, wheel_count_);
+
+  State state;
+  state.time_us = snapshots[0].time_us;
+  if (has_previous_sample_ && state.time_us > previous_time_us_) {
+    float wheel_angles[DriveKinematics::kMaxWheels] = {};
+    for (size_t i = 0; i < wheel_count_; ++i) {
+      wheel_angles[i] = (snapshots[i].pulse_count - previous_pulse_counts_[i]) * radians_per_pulse_[i];
+    }
+    const Twist displacement = kinematics_.ToTwist(wheel_angles);
+    odometry_.Update(displacement);
+
+    const float elapsed_s = (state.time_us - previous_time_us_) / 1000000.0f;
+    state.twist.linear_x = displacement.linear_x / elapsed_s;
+    state.twist.linear_y = displacement.linear_y / elapsed_s;
+    state.twist.angular_z = displacement.angular_z / elapsed_s;
+  }
+
+  for (size_t i = 0; i < wheel_count_; ++i) {
+    previous_pulse_counts_[i] = snapshots[i].pulse_count;
+  }
+  previous_time_us_ = state.time_us;
+  has_previous_sample_ = true;
+
+  state.pose = odometry_.GetPose();
+  state_.Write(state);
+}
+
+}  // namespace em
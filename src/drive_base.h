@@ -0,0 +1,170 @@
+#pragma once
+
+#ifndef _EM_DRIVE_BASE_H_
+#define _EM_DRIVE_BASE_H_
+
+/**
+ * @file drive_base.h
+ */
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+
+#include "drive_kinematics.h"
+#include "esp_encoder_motor.h"
+#include "motor_group.h"
+#include "seqlock.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class DriveBase
+ * @brief 轮式底盘，在 @ref MotorGroup 之上加入运动学：按车体速度驱动所有车轮，并在每个控制周期积分里程计。
+ * @details @ref Drive 通过逆运动学得到各车轮转速，限幅时保持车轮之间的比例，然后作为一组同步指令在下一个控制周期同时
+ * 生效。每个控制周期结束时，由同一采样时刻各车轮的编码器计数增量经正运动学得到车体位移并积分为位姿，结果通过顺序锁发布，
+ * @ref GetState 读取时不加锁。所有状态都是定长的，控制周期中不分配内存。
+ */
+/**
+ * @~English
+ * @class DriveBase
+ * @brief A wheeled drive base, adding kinematics on top of @ref MotorGroup: drives all wheels from a body velocity and
+ * integrates the odometry in every control tick.
+ * @details @ref Drive computes the wheel speeds through the inverse kinematics, keeping the ratio between wheels when
+ * saturating, and issues them as one synchronized group command that takes effect in the next control tick. At the end
+ * of every control tick the encoder count deltas of all wheels, sampled at the same instant, go through the forward
+ * kinematics into a body displacement that is integrated into the pose, and the result is published through a seqlock
+ * so @ref GetState reads it without locking. All state has a fixed size and nothing is allocated in the control tick.
+ */
+class DriveBase : public MotorGroup {
+ public:
+  /**
+   * @~Chinese
+   * @brief 里程计状态。
+   */
+  /**
+   * @~English
+   * @brief Odometry state.
+   */
+  struct State {
+    /**
+     * @~Chinese
+     * @brief 采样时间，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The sampling time in microseconds.
+     */
+    int64_t time_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 积分得到的位姿，@ref Pose。
+     */
+    /**
+     * @~English
+     * @brief The integrated pose, @ref Pose.
+     */
+    Pose pose;
+
+    /**
+     * @~Chinese
+     * @brief 最近一个控制周期内测得的车体速度，@ref Twist。
+     */
+    /**
+     * @~English
+     * @brief The body velocity measured over the last control tick, @ref Twist.
+     */
+    Twist twist;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 构造函数，用于创建一个 DriveBase 对象。
+   * @param[in] kinematics 底盘运动学，生命周期必须长于底盘。
+   * @param[in] motors 各车轮的电机，顺序与 @p kinematics 的车轮顺序一致，数量应等于其车轮数量。
+   * @param[in] max_wheel_rpm 单个车轮的最高转速（RPM），@ref Drive 超过时按比例限幅。
+   */
+  /**
+   * @~English
+   * @brief Constructor for creating a DriveBase object.
+   * @param[in] kinematics The drive kinematics, which must outlive the drive base.
+   * @param[in] motors The motor of each wheel, in the wheel order of @p kinematics and as many as its wheels.
+   * @param[in] max_wheel_rpm The maximum speed of a single wheel in RPM, @ref Drive scales proportionally beyond it.
+   */
+  DriveBase(const DriveKinematics& kinematics, std::initializer_list<EspEncoderMotor*> motors, const float max_wheel_rpm);
+
+  /**
+   * @~Chinese
+   * @brief 初始化所有车轮的电机并把底盘注册到调度器，同时记录各车轮每个脉冲对应的转角，控制周期中不再查询电机。
+   * @param[in] scheduler 控制调度器，默认为 @ref ControlScheduler::Default。
+   * @return 同 @ref MotorGroup::Init。
+   */
+  /**
+   * @~English
+   * @brief Initialize the motors of all wheels and register the drive base with the scheduler, recording the angle of
+   * one pulse of each wheel so that the control tick doesn't query the motors.
+   * @param[in] scheduler The control scheduler, defaults to @ref ControlScheduler::Default.
+   * @return The same as @ref MotorGroup::Init.
+   */
+  bool Init(ControlScheduler& scheduler = ControlScheduler::Default()) override;
+
+  /**
+   * @~Chinese
+   * @brief 以指定的车体速度行驶，从下一个控制周期开始所有车轮同时生效。
+   * @param[in] twist 车体速度，@ref Twist。
+   * @return 限幅的缩放系数，未限幅时为1。
+   */
+  /**
+   * @~English
+   * @brief Drive at the given body velocity, all wheels take it in the next control tick.
+   * @param[in] twist The body velocity, @ref Twist.
+   * @return The saturation scale factor, 1 if not saturated.
+   */
+  float Drive(const Twist& twist);
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期重置里程计位姿。
+   * @param[in] pose 新的位姿，@ref Pose。
+   */
+  /**
+   * @~English
+   * @brief Reset the odometry pose in the next control tick.
+   * @param[in] pose The new pose, @ref Pose.
+   */
+  void ResetPose(const Pose& pose = Pose());
+
+  /**
+   * @~Chinese
+   * @brief 获取最近一个控制周期结束时的里程计状态，不加锁。
+   * @return 里程计状态，@ref State。
+   */
+  /**
+   * @~English
+   * @brief Get the odometry state at the end of the last control tick, without locking.
+   * @return The odometry state, @ref State.
+   */
+  State GetState() const;
+
+ protected:
+  void Control(const int64_t now_us) override;
+
+ private:
+  const DriveKinematics& kinematics_;
+  const size_t wheel_count_ = 0;
+  const float max_wheel_rpm_ = 0;
+  Odometry odometry_;
+  std::array<float, DriveKinematics::kMaxWheels> radians_per_pulse_ = {};
+  std::array<int64_t, DriveKinematics::kMaxWheels> previous_pulse_counts_ = {};
+  int64_t previous_time_us_ = 0;
+  bool has_previous_sample_ = false;
+  std::mutex reset_mutex_;
+  bool reset_pending_ = false;
+  Pose reset_pose_;
+  Seqlock<State> state_;
+};
+}  // namespace em
+
+#endif
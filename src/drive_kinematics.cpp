@@ -0,0 +1,105 @@
+/**
+ * @file drive_kinematics.cpp
+ */
+
+#include "drive_kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+namespace {
+constexpr float kPi = 3.14159265f;
+constexpr float kTwoPi = 2 * kPi;
+}  // namespace
+
+float DriveKinematics::Desaturate(float* const wheel_speeds, const size_t count, const float max_speed) {
+  float peak = 0;
+  for (size_t i = 0; i < count; ++i) {
+    peak = std::max(peak, std::fabs(wheel_speeds[i]));
+  }
+  if (peak <= max_speed || peak == 0) {
+    return 1;
+  }
+
+  const float scale = std::max(max_speed, 0.0f) / peak;
+  for (size_t i = 0; i < count; ++i) {
+    wheel_speeds[i] *= scale;
+  }
+  return scale;
+}
+
+DifferentialKinematics::DifferentialKinematics(const float wheel_radius, const float track_width)
+    : wheel_radius_(wheel_radius), track_width_(track_width) {
+}
+
+size_t DifferentialKinematics::WheelCount() const {
+  return 2;
+}
+
+void DifferentialKinematics::ToWheelSpeeds(const Twist& twist, float* const wheel_speeds) const {
+  const float turn = twist.angular_z * track_width_ / 2;
+  wheel_speeds[0] = (twist.linear_x - turn) / wheel_radius_;
+  wheel_speeds[1] = (twist.linear_x + turn) / wheel_radius_;
+}
+
+Twist DifferentialKinematics::ToTwist(const float* const wheel_speeds) const {
+  Twist twist;
+  twist.linear_x = wheel_radius_ * (wheel_speeds[0] + wheel_speeds[1]) / 2;
+  twist.angular_z = wheel_radius_ * (wheel_speeds[1] - wheel_speeds[0]) / track_width_;
+  return twist;
+}
+
+MecanumKinematics::MecanumKinematics(const float wheel_radius, const float wheel_base, const float track_width)
+    : wheel_radius_(wheel_radius), rotation_arm_((wheel_base + track_width) / 2) {
+}
+
+size_t MecanumKinematics::WheelCount() const {
+  return 4;
+}
+
+void MecanumKinematics::ToWheelSpeeds(const Twist& twist, float* const wheel_speeds) const {
+  const float turn = twist.angular_z * rotation_arm_;
+  wheel_speeds[0] = (twist.linear_x - twist.linear_y - turn) / wheel_radius_;
+  wheel_speeds[1] = (twist.linear_x + twist.linear_y + turn) / wheel_radius_;
+  wheel_speeds[2] = (twist.linear_x + twist.linear_y - turn) / wheel_radius_;
+  wheel_speeds[3] = (twist.linear_x - twist.linear_y + turn) / wheel_radius_;
+}
+
+Twist MecanumKinematics::ToTwist(const float* const wheel_speeds) const {
+  // The pseudo-inverse of ToWheelSpeeds(), the four wheels over-determine the three degrees of freedom.
+  const float scale = wheel_radius_ / 4;
+  Twist twist;
+  twist.linear_x = scale * (wheel_speeds[0] + wheel_speeds[1] + wheel_speeds[2] + wheel_speeds[3]);
+  twist.linear_y = scale * (-wheel_speeds[0] + wheel_speeds[1] + wheel_speeds[2] - wheel_speeds[3]);
+  twist.angular_z = scale * (-wheel_speeds[0] + wheel_speeds[1] - wheel_speeds[2] + wheel_speeds[3]) / rotation_arm_;
+  return twist;
+}
+
+void Odometry::Reset(const Pose& pose) {
+  pose_ = pose;
+  pose_.theta = std::remainder(pose.theta, kTwoPi);
+}
+
+void Odometry::Update(const Twist& displacement) {
+  // Single precision throughout, the ESP32 has a float unit but computes double in software.
+  const float heading = pose_.theta + displacement.angular_z / 2;
+  const float cos_heading = std::cos(heading);
+  const float sin_heading = std::sin(heading);
+  pose_.x += displacement.linear_x * cos_heading - displacement.linear_y * sin_heading;
+  pose_.y += displacement.linear_x * sin_heading + displacement.linear_y * cos_heading;
+  pose_.theta += displacement.angular_z;
+  // One tick turns by far less than a revolution, a single correction keeps the heading wrapped.
+  if (pose_.theta >= kPi) {
+    pose_.theta -= kTwoPi;
+  } else if (pose_.theta < -kPi) {
+    pose_.theta += kTwoPi;
+  }
+}
+
+const Pose& Odometry::GetPose() const {
+  return pose_;
+}
+
+}  // namespace em
@@ -0,0 +1,327 @@
+#pragma once
+
+#ifndef _EM_DRIVE_KINEMATICS_H_
+#define _EM_DRIVE_KINEMATICS_H_
+
+/**
+ * @file drive_kinematics.h
+ */
+
+#include <cstddef>
+
+namespace em {
+/**
+ * @~Chinese
+ * @brief 车体坐标系下的速度（或一段时间内的位移）：x轴朝前，y轴朝左，逆时针旋转为正。
+ */
+/**
+ * @~English
+ * @brief A velocity (or a displacement over some time) in the body frame: x forward, y to the left, counterclockwise
+ * rotation positive.
+ */
+struct Twist {
+  /**
+   * @~Chinese
+   * @brief 前向速度，单位为m/s（位移时为m）。
+   */
+  /**
+   * @~English
+   * @brief The forward velocity in m/s (m for a displacement).
+   */
+  float linear_x = 0;
+
+  /**
+   * @~Chinese
+   * @brief 左向速度，单位为m/s（位移时为m），差速底盘恒为0。
+   */
+  /**
+   * @~English
+   * @brief The leftward velocity in m/s (m for a displacement), always 0 for a differential drive.
+   */
+  float linear_y = 0;
+
+  /**
+   * @~Chinese
+   * @brief 角速度，单位为rad/s（位移时为rad）。
+   */
+  /**
+   * @~English
+   * @brief The angular velocity in rad/s (rad for a displacement).
+   */
+  float angular_z = 0;
+};
+
+/**
+ * @~Chinese
+ * @brief 车体在里程计坐标系中的位姿。
+ */
+/**
+ * @~English
+ * @brief The pose of the body in the odometry frame.
+ */
+struct Pose {
+  /**
+   * @~Chinese
+   * @brief x坐标，单位为m。
+   */
+  /**
+   * @~English
+   * @brief The x coordinate in m.
+   */
+  float x = 0;
+
+  /**
+   * @~Chinese
+   * @brief y坐标，单位为m。
+   */
+  /**
+   * @~English
+   * @brief The y coordinate in m.
+   */
+  float y = 0;
+
+  /**
+   * @~Chinese
+   * @brief 航向角，单位为rad，由 @ref Odometry 回绕到 [-π, π) 之内，以保持单精度浮点数的精度。
+   */
+  /**
+   * @~English
+   * @brief The heading in rad, wrapped into [-π, π) by @ref Odometry to keep the precision of single-precision floats.
+   */
+  float theta = 0;
+};
+
+/**
+ * @~Chinese
+ * @class DriveKinematics
+ * @brief 轮式底盘运动学接口，在车体速度与各车轮角速度之间转换。
+ * @details 运动学是线性的，因此 @ref ToTwist 输入一段时间内各车轮转过的角度（rad）时，输出的是这段时间内车体的位移。
+ * 所有转换只使用调用者提供的定长数组，不分配内存，可以在控制周期中执行。
+ */
+/**
+ * @~English
+ * @class DriveKinematics
+ * @brief Interface of wheeled drive kinematics, converting between the body velocity and the angular velocity of each
+ * wheel.
+ * @details The kinematics is linear, so when @ref ToTwist is given the angle each wheel turned over some time (rad), it
+ * returns the displacement of the body over that time. All conversions only use fixed-size arrays provided by the
+ * caller and never allocate, so they can run in the control tick.
+ */
+class DriveKinematics {
+ public:
+  /**
+   * @~Chinese
+   * @brief 支持的最大车轮数量。
+   */
+  /**
+   * @~English
+   * @brief The maximum number of supported wheels.
+   */
+  static constexpr size_t kMaxWheels = 4;
+
+  virtual ~DriveKinematics() = default;
+
+  /**
+   * @~Chinese
+   * @brief 获取车轮数量。
+   * @return 车轮数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of wheels.
+   * @return The number of wheels.
+   */
+  virtual size_t WheelCount() const = 0;
+
+  /**
+   * @~Chinese
+   * @brief 逆运动学：由车体速度计算各车轮角速度。
+   * @param[in] twist 车体速度，@ref Twist。
+   * @param[out] wheel_speeds 各车轮角速度，单位为rad/s，长度为 @ref WheelCount，车轮顺序见具体实现。
+   */
+  /**
+   * @~English
+   * @brief Inverse kinematics: compute the angular velocity of each wheel from the body velocity.
+   * @param[in] twist The body velocity, @ref Twist.
+   * @param[out] wheel_speeds The angular velocity of each wheel in rad/s, @ref WheelCount long, see the implementations
+   * for the wheel order.
+   */
+  virtual void ToWheelSpeeds(const Twist& twist, float* const wheel_speeds) const = 0;
+
+  /**
+   * @~Chinese
+   * @brief 正运动学：由各车轮角速度计算车体速度，车轮多于自由度时为最小二乘解。
+   * @param[in] wheel_speeds 各车轮角速度，单位为rad/s，长度为 @ref WheelCount。
+   * @return 车体速度，@ref Twist。
+   */
+  /**
+   * @~English
+   * @brief Forward kinematics: compute the body velocity from the angular velocity of each wheel, the least squares
+   * solution when there are more wheels than degrees of freedom.
+   * @param[in] wheel_speeds The angular velocity of each wheel in rad/s, @ref WheelCount long.
+   * @return The body velocity, @ref Twist.
+   */
+  virtual Twist ToTwist(const float* const wheel_speeds) const = 0;
+
+  /**
+   * @~Chinese
+   * @brief 车轮速度限幅：任一车轮超过限值时按同一比例缩小所有车轮速度，保持车轮之间的比例，因此车体的运动方向和转弯半径
+   * 不变，只是变慢。
+   * @param[in,out] wheel_speeds 各车轮速度，任意单位。
+   * @param[in] count 车轮数量。
+   * @param[in] max_speed 单个车轮速度绝对值的上限，与 @p wheel_speeds 单位相同。
+   * @return 应用的缩放系数，未限幅时为1。
+   */
+  /**
+   * @~English
+   * @brief Wheel speed saturation: if any wheel exceeds the limit, all wheel speeds are scaled down by the same factor,
+   * keeping the ratio between wheels, so the body keeps its direction of motion and turning radius and only slows down.
+   * @param[in,out] wheel_speeds The speed of each wheel, in any unit.
+   * @param[in] count The number of wheels.
+   * @param[in] max_speed The limit of the absolute speed of a single wheel, in the unit of @p wheel_speeds.
+   * @return The applied scale factor, 1 if not saturated.
+   */
+  static float Desaturate(float* const wheel_speeds, const size_t count, const float max_speed);
+};
+
+/**
+ * @~Chinese
+ * @class DifferentialKinematics
+ * @brief 两轮差速底盘运动学，车轮顺序为左、右，车轮向前滚动时角速度为正。
+ */
+/**
+ * @~English
+ * @class DifferentialKinematics
+ * @brief Two-wheel differential drive kinematics, the wheel order is left, right, and a wheel rolling forward has a
+ * positive angular velocity.
+ */
+class DifferentialKinematics : public DriveKinematics {
+ public:
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] wheel_radius 车轮半径，单位为m。
+   * @param[in] track_width 左右轮距，单位为m。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] wheel_radius The wheel radius in m.
+   * @param[in] track_width The distance between the left and right wheels in m.
+   */
+  DifferentialKinematics(const float wheel_radius, const float track_width);
+
+  size_t WheelCount() const override;
+
+  void ToWheelSpeeds(const Twist& twist, float* const wheel_speeds) const override;
+
+  Twist ToTwist(const float* const wheel_speeds) const override;
+
+ private:
+  const float wheel_radius_ = 0;
+  const float track_width_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @class MecanumKinematics
+ * @brief 四轮麦克纳姆轮底盘运动学，车轮顺序为左前、右前、左后、右后，车轮向前滚动时角速度为正。辊子的布置使得左前、
+ * 右后轮向后而右前、左后轮向前滚动时车体向左平移。
+ */
+/**
+ * @~English
+ * @class MecanumKinematics
+ * @brief Four-wheel mecanum drive kinematics, the wheel order is front left, front right, rear left, rear right, and a
+ * wheel rolling forward has a positive angular velocity. The rollers are laid out so that the body strafes left when
+ * the front left and rear right wheels roll backward and the front right and rear left wheels roll forward.
+ */
+class MecanumKinematics : public DriveKinematics {
+ public:
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] wheel_radius 车轮半径，单位为m。
+   * @param[in] wheel_base 前后轮距，单位为m。
+   * @param[in] track_width 左右轮距，单位为m。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] wheel_radius The wheel radius in m.
+   * @param[in] wheel_base The distance between the front and rear wheels in m.
+   * @param[in] track_width The distance between the left and right wheels in m.
+   */
+  MecanumKinematics(const float wheel_radius, const float wheel_base, const float track_width);
+
+  size_t WheelCount() const override;
+
+  void ToWheelSpeeds(const Twist& twist, float* const wheel_speeds) const override;
+
+  Twist ToTwist(const float* const wheel_speeds) const override;
+
+ private:
+  const float wheel_radius_ = 0;
+  // Half the wheel base plus half the track width, the lever arm of the rotation.
+  const float rotation_arm_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @class Odometry
+ * @brief 由车体位移积分得到位姿的里程计，每个控制周期调用一次 @ref Update。
+ * @details 使用中点航向积分，每个周期的位移按该周期起止航向的平均值旋转到里程计坐标系，对匀速圆弧运动的误差为三阶小量。
+ * 全部以单精度浮点数计算，航向角回绕到 [-π, π) 之内。
+ */
+/**
+ * @~English
+ * @class Odometry
+ * @brief Odometry integrating body displacements into a pose, @ref Update is called once per control tick.
+ * @details Integrates at the midpoint heading, each displacement is rotated into the odometry frame by the mean of the
+ * headings at the start and end of its tick, which is exact up to third order for motion along a circular arc. Everything
+ * is computed in single precision, and the heading is wrapped into [-π, π).
+ */
+class Odometry {
+ public:
+  /**
+   * @~Chinese
+   * @brief 重置位姿。
+   * @param[in] pose 新的位姿，@ref Pose。
+   */
+  /**
+   * @~English
+   * @brief Reset the pose.
+   * @param[in] pose The new pose, @ref Pose.
+   */
+  void Reset(const Pose& pose = Pose());
+
+  /**
+   * @~Chinese
+   * @brief 累加一个控制周期内的车体位移。
+   * @param[in] displacement 车体坐标系下的位移，@ref Twist，由 @ref DriveKinematics::ToTwist 从车轮转角得到。
+   */
+  /**
+   * @~English
+   * @brief Accumulate the body displacement over one control tick.
+   * @param[in] displacement The displacement in the body frame, @ref Twist, from @ref DriveKinematics::ToTwist on the
+   * wheel angles.
+   */
+  void Update(const Twist& displacement);
+
+  /**
+   * @~Chinese
+   * @brief 获取当前位姿。
+   * @return 当前位姿，@ref Pose。
+   */
+  /**
+   * @~English
+   * @brief Get the current pose.
+   * @return The current pose, @ref Pose.
+   */
+  const Pose& GetPose() const;
+
+ private:
+  Pose pose_;
+};
+}  // namespace em
+
+#endif
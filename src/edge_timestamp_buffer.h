@@ -0,0 +1,129 @@
+#pragma once
+
+#ifndef _EM_EDGE_TIMESTAMP_BUFFER_H_
+#define _EM_EDGE_TIMESTAMP_BUFFER_H_
+
+/**
+ * @file edge_timestamp_buffer.h
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class EdgeTimestampBuffer
+ * @brief 无锁的编码器边沿时间戳环形缓冲区，单个写入者（中断处理函数），单个读取者。
+ * @details 写入者从不阻塞，缓冲区满时覆盖最旧的记录；读取者只读取最新的若干条记录，如果读取期间这些记录被覆盖则读取失败。
+ */
+/**
+ * @~English
+ * @class EdgeTimestampBuffer
+ * @brief Lock-free ring buffer of encoder edge timestamps with a single writer (the interrupt handler) and a single
+ * reader.
+ * @details The writer never blocks and overwrites the oldest entries when the buffer is full; the reader only reads the
+ * latest few entries and fails if they are overwritten while being read.
+ */
+class EdgeTimestampBuffer {
+ public:
+  /**
+   * @~Chinese
+   * @brief 缓冲区容量，必须为2的幂。
+   */
+  /**
+   * @~English
+   * @brief The buffer capacity, must be a power of two.
+   */
+  static constexpr uint32_t kCapacity = 16;
+
+  static_assert((kCapacity & (kCapacity - 1)) == 0);
+
+  /**
+   * @~Chinese
+   * @brief 边沿记录。
+   */
+  /**
+   * @~English
+   * @brief Edge record.
+   */
+  struct Edge {
+    /**
+     * @~Chinese
+     * @brief 边沿发生的时间，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The time of the edge in microseconds.
+     */
+    int64_t time_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 该边沿计数之后的编码器计数值。
+     */
+    /**
+     * @~English
+     * @brief The encoder count after counting this edge.
+     */
+    int64_t count = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 写入一条边沿记录，可以在中断处理函数中调用。
+   * @param[in] time_us 边沿发生的时间，单位为微秒。
+   * @param[in] count 该边沿计数之后的编码器计数值。
+   */
+  /**
+   * @~English
+   * @brief Write an edge record, may be called from an interrupt handler.
+   * @param[in] time_us The time of the edge in microseconds.
+   * @param[in] count The encoder count after counting this edge.
+   */
+  void Push(const int64_t time_us, const int64_t count) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    edges_[head & (kCapacity - 1)].time_us = time_us;
+    edges_[head & (kCapacity - 1)].count = count;
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 读取最新的n条边沿记录，按时间从早到晚排列。
+   * @param[out] edges 用于存放记录的数组，长度至少为n。
+   * @param[in] n 要读取的记录数量，必须小于 @ref kCapacity。
+   * @return 成功返回true；记录数量不足n条，或者读取期间记录被覆盖时返回false。
+   */
+  /**
+   * @~English
+   * @brief Read the latest n edge records, oldest first.
+   * @param[out] edges The array receiving the records, at least n long.
+   * @param[in] n The number of records to read, must be less than @ref kCapacity.
+   * @return true on success; false if fewer than n records were written or they were overwritten while being read.
+   */
+  bool Latest(Edge* const edges, const uint32_t n) const {
+    const uint32_t head = head_.load(std::memory_order_acquire);
+    if (n == 0 || n >= kCapacity || head < n) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+      const Edge& edge = edges_[(head - n + i) & (kCapacity - 1)];
+      edges[i].time_us = edge.time_us;
+      edges[i].count = edge.count;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return head_.load(std::memory_order_relaxed) - head < kCapacity - n;
+  }
+
+ private:
+  std::array<Edge, kCapacity> edges_;
+  std::atomic<uint32_t> head_ = 0;
+};
+}  // namespace em
+
+#endif
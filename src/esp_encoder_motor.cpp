@@ -4,14 +4,10 @@
 
 #include "esp_encoder_motor.h"
 
-#include <Arduino.h>
-
-#include <thread>
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
-#include "driver/gpio.h"
-#include "driver/ledc.h"
-
 namespace em {
 
 namespace {
@@ -20,8 +16,31 @@ constexpr float kDefaultPositionI = 0.1;
 constexpr float kDefaultPositionD = 5.0;
 constexpr float kDefaultSpeedP = 3.0;
 constexpr float kDefaultSpeedI = 1.0;
-constexpr float kDefaultSpeedD = 1.0;
-constexpr int32_t kDeadRpmZone = 10;
+// The original speed loop never applied its derivative gain, keep the default behavior a PI controller.
+constexpr float kDefaultSpeedD = 0.0;
+// The speed and position PID gains are specified per 50 ms control period, the integral and the derivative are scaled
+// for other periods.
+constexpr float kSpeedPidReferencePeriodUs = SpeedController<ControlNumber>::kReferencePeriodUs;
+// The derivative filter time constant in reference periods.
+constexpr float kDerivativeFilterTime = 0.5;
+
+PidController<float>::Parameters PidParameters(const float p,
+                                               const float i,
+                                               const float d,
+                                               const float output_limit,
+                                               const float derivative_setpoint_weight) {
+  PidController<float>::Parameters parameters;
+  parameters.kp = p;
+  parameters.ki = i;
+  parameters.kd = d;
+  parameters.derivative_setpoint_weight = derivative_setpoint_weight;
+  parameters.derivative_filter_time = kDerivativeFilterTime;
+  // Back-calculation with the integral time constant p / i as tracking time.
+  parameters.tracking_gain = p > 0 ? i / p : 1;
+  parameters.output_min = -output_limit;
+  parameters.output_max = output_limit;
+  return parameters;
+}
 }  // namespace
 
 EspEncoderMotor::EspEncoderMotor(const uint8_t pin_positive,
@@ -30,181 +49,781 @@ EspEncoderMotor::EspEncoderMotor(const uint8_t pin_positive,
                            const uint8_t pin_b,
                            const uint32_t ppr,
                            const uint32_t reduction_ration,
-                           const PhaseRelation phase_relation)
-    : pin_a_(pin_a),
+                           const PhaseRelation phase_relation,
+                           Hal& hal)
+    : EspEncoderMotor(pin_positive,
+                      pin_negative,
+                      pin_a,
+                      pin_b,
+                      ppr,
+                      reduction_ration,
+                      phase_relation,
+                      hal,
+                      EspEncoderMotor::OnEncoderEdge) {
+}
+
+EspEncoderMotor::EspEncoderMotor(const uint8_t pin_positive,
+                                 const uint8_t pin_negative,
+                                 const uint8_t pin_a,
+                                 const uint8_t pin_b,
+                                 const uint32_t ppr,
+                                 const uint32_t reduction_ration,
+                                 const PhaseRelation phase_relation,
+                                 Hal& hal,
+                                 const Hal::InterruptHandler encoder_isr)
+    : hal_(hal),
+      motor_driver_(pin_positive, pin_negative, hal),
+      pin_a_(pin_a),
       pin_b_(pin_b),
-      motor_driver_(pin_positive, pin_negative),
       total_ppr_(ppr * reduction_ration),
-      b_level_at_a_falling_edge_(phase_relation == PhaseRelation::kAPhaseLeads ? HIGH : LOW) {
-  rpm_pid_.p = kDefaultSpeedP;
-  rpm_pid_.i = kDefaultSpeedI;
-  rpm_pid_.d = kDefaultSpeedD;
-  rpm_pid_.max_integral = ceil(EspMotor::kMaxPwmDuty / rpm_pid_.i);
+      direction_(phase_relation == PhaseRelation::kAPhaseLeads ? 1 : -1),
+      encoder_isr_(encoder_isr),
+      rpm_per_count_per_s_(static_cast<float>(60.0 / (static_cast<double>(total_ppr_) * decoder_.DecodingMode()))) {
+  speed_controller_.SetParameters(
+      PidParameters(kDefaultSpeedP, kDefaultSpeedI, kDefaultSpeedD, EspMotor::kMaxPwmDuty, 0));
+  motion_limits_.max_velocity = kDefaultMaxPositionRpm;
+  motion_limits_.max_acceleration = kDefaultMaxPositionAcceleration;
+  // The position loop differentiates the tracking error, a derivative on the measurement would fight the feed-forward.
+  position_pid_.SetParameters(
+      PidParameters(kDefaultPositionP, kDefaultPositionI, kDefaultPositionD, kDefaultMaxPositionRpm, 1));
 }
 
-void EspEncoderMotor::Init() {
+bool EspEncoderMotor::Init(ControlScheduler& scheduler) {
+  EncoderBackend requested_backend;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (scheduler_ != nullptr) {
+      return true;
+    }
+
+    motor_driver_.Init();
+    requested_backend = encoder_backend_;
+
+    hal_.InputPullUp(pin_a_);
+    hal_.InputPullUp(pin_b_);
+
+    const auto mode = decoder_.DecodingMode();
+    if (encoder_backend_ != kPulseCounter || !hal_.PulseCounterAttach(pin_a_, pin_b_, mode, glitch_filter_ns_)) {
+      encoder_backend_ = kGpioInterrupt;
+      decoder_.Reset(hal_.DigitalRead(pin_a_), hal_.DigitalRead(pin_b_));
+      hal_.AttachInterrupt(pin_a_, encoder_isr_, this, mode == QuadratureDecoder::kX1 ? Hal::kFalling : Hal::kChange);
+      if (mode == QuadratureDecoder::kX4) {
+        hal_.AttachInterrupt(pin_b_, encoder_isr_, this, Hal::kChange);
+      }
+    }
+    last_update_speed_time_us_ = hal_.Micros();
+    speed_estimator_.Reset(total_ppr_ * mode, last_update_speed_time_us_, pulse_count_);
+    if (motion_observer_ != nullptr) {
+      motion_observer_->Reset(pulse_count_, last_update_speed_time_us_);
+    }
+    scheduler_ = &scheduler;
+  }
+
+  // Registered without holding mutex_, the scheduler locks its own mutex before calling into the motor.
+  if (scheduler.Register(this)) {
+    return true;
+  }
+
+  // The scheduler is full, release the encoder so that Init can be called again with another scheduler.
   std::lock_guard<std::mutex> l(mutex_);
-  if (update_rpm_thread_ != nullptr) {
+  DetachEncoder();
+  encoder_backend_ = requested_backend;
+  scheduler_ = nullptr;
+  return false;
+}
+
+void EspEncoderMotor::SetEncoderBackend(const EncoderBackend backend, const uint32_t glitch_filter_ns) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (scheduler_ != nullptr) {
     return;
   }
 
-  motor_driver_.Init();
+  encoder_backend_ = backend;
+  glitch_filter_ns_ = glitch_filter_ns;
+}
 
-  pinMode(pin_a_, INPUT_PULLUP);
-  pinMode(pin_b_, INPUT_PULLUP);
+void EspEncoderMotor::SetDecodingMode(const QuadratureDecoder::Mode mode) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (scheduler_ != nullptr) {
+    return;
+  }
 
-  attachInterruptArg(pin_a_, EspEncoderMotor::OnPinAFalling, this, FALLING);
-  update_rpm_thread_ = new std::thread(&EspEncoderMotor::UpdateRpm, this);
+  decoder_ = QuadratureDecoder(mode);
+  rpm_per_count_per_s_ = static_cast<float>(60.0 / (static_cast<double>(total_ppr_) * mode));
 }
 
-void EspEncoderMotor::SetSpeedPid(const float p, const float i, const float d) {
+void EspEncoderMotor::SetPwmBackend(const EspMotor::PwmBackend backend,
+                                    const uint32_t frequency,
+                                    const uint8_t resolution) {
   std::lock_guard<std::mutex> l(mutex_);
-  rpm_pid_.p = p;
-  rpm_pid_.i = i;
-  rpm_pid_.d = d;
-
-  if (i > 0) {
-    rpm_pid_.max_integral = ceil(EspMotor::kMaxPwmDuty / rpm_pid_.i);
-  } else {
-    rpm_pid_.max_integral = 0;
+  if (scheduler_ != nullptr) {
+    return;
   }
+
+  motor_driver_.SetPwmBackend(backend, frequency, resolution);
+}
+
+void EspEncoderMotor::SetStopMode(const EspMotor::StopMode mode) {
+  std::lock_guard<std::mutex> l(mutex_);
+  motor_driver_.SetStopMode(mode);
+}
+
+void EspEncoderMotor::SetSpeedPid(const float p, const float i, const float d) {
+  std::lock_guard<std::mutex> l(mutex_);
+  speed_controller_.SetParameters(PidParameters(p, i, d, EspMotor::kMaxPwmDuty, 0));
 }
 
 void EspEncoderMotor::GetSpeedPid(float* const p, float* const i, float* const d) {
   std::lock_guard<std::mutex> l(mutex_);
+  const auto& parameters = speed_controller_.GetParameters();
   if (p != nullptr) {
-    *p = rpm_pid_.p;
+    *p = parameters.kp;
   }
   if (i != nullptr) {
-    *i = rpm_pid_.i;
+    *i = parameters.ki;
   }
   if (d != nullptr) {
-    *d = rpm_pid_.d;
+    *d = parameters.kd;
   }
 }
 
-EspEncoderMotor::~EspEncoderMotor() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  DeleteThread(driving_thread_);
-  DeleteThread(update_rpm_thread_);
+void EspEncoderMotor::SetFeedforward(const Feedforward& feedforward) {
+  std::lock_guard<std::mutex> l(mutex_);
+  feedforward_ = feedforward;
+  speed_controller_.SetFeedforward(feedforward);
 }
 
-void EspEncoderMotor::RunPwmDuty(const int16_t duty) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  DeleteThread(driving_thread_);
-  target_speed_rpm_ = 0;
+Feedforward EspEncoderMotor::GetFeedforward() {
+  std::lock_guard<std::mutex> l(mutex_);
+  return feedforward_;
+}
 
-  if (motor_driver_.PwmDuty() == duty) {
-    return;
+void EspEncoderMotor::StartFeedforwardLearning() {
+  std::lock_guard<std::mutex> l(mutex_);
+  feedforward_estimator_.Reset();
+  learning_feedforward_ = true;
+}
+
+bool EspEncoderMotor::FinishFeedforwardLearning(Feedforward* const feedforward) {
+  std::lock_guard<std::mutex> l(mutex_);
+  learning_feedforward_ = false;
+  Feedforward learned;
+  if (!feedforward_estimator_.Solve(&learned)) {
+    return false;
   }
 
-  motor_driver_.PwmDuty(duty);
+  feedforward_ = learned;
+  speed_controller_.SetFeedforward(learned);
+  if (feedforward != nullptr) {
+    *feedforward = learned;
+  }
+  return true;
 }
 
-void EspEncoderMotor::RunSpeed(const int16_t speed_rpm) {
+void EspEncoderMotor::SetPositionPid(const float p, const float i, const float d) {
+  std::lock_guard<std::mutex> l(mutex_);
+  position_pid_.SetParameters(PidParameters(p, i, d, motion_limits_.max_velocity, 1));
+}
+
+void EspEncoderMotor::GetPositionPid(float* const p, float* const i, float* const d) {
   std::lock_guard<std::mutex> l(mutex_);
-  if (driving_thread_ == nullptr) {
-    rpm_pid_.integral = 0;
-    driving_thread_ = new std::thread(&EspEncoderMotor::Driving, this);
+  const auto& parameters = position_pid_.GetParameters();
+  if (p != nullptr) {
+    *p = parameters.kp;
   }
+  if (i != nullptr) {
+    *i = parameters.ki;
+  }
+  if (d != nullptr) {
+    *d = parameters.kd;
+  }
+}
 
-  if (speed_rpm == target_speed_rpm_) {
+void EspEncoderMotor::SetMotionLimits(const float max_rpm, const float max_acceleration, const float max_jerk) {
+  if (max_rpm <= 0 || max_acceleration <= 0 || max_jerk < 0) {
     return;
   }
 
-  target_speed_rpm_ = speed_rpm;
-  drive_ = true;
-  condition_.notify_all();
+  std::lock_guard<std::mutex> l(mutex_);
+  motion_limits_.max_velocity = max_rpm;
+  motion_limits_.max_acceleration = max_acceleration;
+  motion_limits_.max_jerk = max_jerk;
+  auto parameters = position_pid_.GetParameters();
+  parameters.output_min = -max_rpm;
+  parameters.output_max = max_rpm;
+  position_pid_.SetParameters(parameters);
+}
+
+void EspEncoderMotor::SetSpeedRamp(const float max_acceleration, const float max_jerk) {
+  if (max_acceleration < 0 || max_jerk < 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  // The disabled ramp isn't updated, so an enabled one starts at the setpoint the speed loop tracks.
+  if (!speed_ramp_.Enabled()) {
+    speed_ramp_.Reset(setpoint_rpm_);
+  }
+  speed_ramp_.SetLimits(max_acceleration, max_jerk);
+}
+
+EspEncoderMotor::~EspEncoderMotor() {
+  if (scheduler_ != nullptr) {
+    scheduler_->Unregister(this);
+    DetachEncoder();
+  }
+}
+
+void EspEncoderMotor::DetachEncoder() {
+  if (encoder_backend_ == kPulseCounter) {
+    hal_.PulseCounterDetach(pin_a_);
+  } else {
+    hal_.DetachInterrupt(pin_a_);
+    if (decoder_.DecodingMode() == QuadratureDecoder::kX4) {
+      hal_.DetachInterrupt(pin_b_);
+    }
+  }
+}
+
+void EspEncoderMotor::RunPwmDuty(const int16_t duty) {
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    pending = StartPwmDuty(duty);
+    PublishSnapshot();
+  }
+  pending.Invoke();
+}
+
+void EspEncoderMotor::RunSpeed(const int16_t speed_rpm) {
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    pending = StartSpeed(speed_rpm);
+    PublishSnapshot();
+  }
+  pending.Invoke();
+}
+
+void EspEncoderMotor::RunToPosition(const int64_t position, PositionCallback callback) {
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    pending = StartPosition(position, std::move(callback));
+  }
+  pending.Invoke();
+}
+
+void EspEncoderMotor::RunRelative(const int64_t distance, PositionCallback callback) {
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    const int64_t origin = control_mode_ == kPositionControl ? target_position_ : EncoderPulseCount();
+    pending = StartPosition(origin + distance, std::move(callback));
+  }
+  pending.Invoke();
 }
 
 void EspEncoderMotor::Stop() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  DeleteThread(driving_thread_);
-  motor_driver_.Stop();
-  target_speed_rpm_ = 0;
-  rpm_pid_.integral = 0;
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    pending = StopOutput();
+    PublishSnapshot();
+  }
+  pending.Invoke();
+}
+
+void EspEncoderMotor::AutoTuneSpeed(const int16_t step_duty, AutoTuneCallback callback) {
+  PendingCallbacks pending;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    DiscardQueuedCommands();
+    pending = CancelCommand();
+    control_mode_ = kAutoTuneControl;
+    target_speed_rpm_ = 0;
+    auto_tuner_.Start(std::clamp<int16_t>(step_duty, -EspMotor::kMaxPwmDuty, EspMotor::kMaxPwmDuty),
+                      last_update_speed_time_us_);
+    auto_tune_callback_ = std::move(callback);
+    PublishSnapshot();
+  }
+  pending.Invoke();
+}
+
+size_t EspEncoderMotor::StreamSetpoints(const SetpointType type, const Setpoint* const setpoints, const size_t count) {
+  if (setpoints == nullptr) {
+    return 0;
+  }
+
+  const QueuedCommandType queued_type = type == kPositionSetpoint ? kQueuedPositionSetpoint : kQueuedSpeedSetpoint;
+  const uint32_t generation = command_generation_.load(std::memory_order_relaxed);
+  size_t written = 0;
+  while (written < count) {
+    const QueuedCommand command = {queued_type, setpoints[written].time_us, setpoints[written].value, generation};
+    if (command_queue_.Push(&command, 1) == 0) {
+      break;
+    }
+    ++written;
+  }
+  return written;
+}
+
+bool EspEncoderMotor::PostSpeed(const int16_t speed_rpm) {
+  const uint32_t generation = command_generation_.load(std::memory_order_relaxed);
+  const QueuedCommand command = {kQueuedSpeed, 0, static_cast<double>(speed_rpm), generation};
+  return command_queue_.Push(&command, 1) == 1;
+}
+
+bool EspEncoderMotor::PostPwmDuty(const int16_t pwm_duty) {
+  const uint32_t generation = command_generation_.load(std::memory_order_relaxed);
+  const QueuedCommand command = {kQueuedPwmDuty, 0, static_cast<double>(pwm_duty), generation};
+  return command_queue_.Push(&command, 1) == 1;
+}
+
+bool EspEncoderMotor::PostStop() {
+  const uint32_t generation = command_generation_.load(std::memory_order_relaxed);
+  const QueuedCommand command = {kQueuedStop, 0, 0, generation};
+  return command_queue_.Push(&command, 1) == 1;
+}
+
+size_t EspEncoderMotor::CommandQueueSpace() const {
+  return command_queue_.Space();
 }
 
 int64_t EspEncoderMotor::EncoderPulseCount() const {
+  if (encoder_backend_ == kPulseCounter) {
+    return direction_ * hal_.PulseCounterRead(pin_a_);
+  }
   return pulse_count_;
 }
 
+double EspEncoderMotor::PulsesPerRevolution() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return total_ppr_ * decoder_.DecodingMode();
+}
+
+uint32_t EspEncoderMotor::IllegalTransitionCount() const {
+  return encoder_backend_ == kGpioInterrupt ? decoder_.IllegalTransitions() : 0;
+}
+
 int32_t EspEncoderMotor::SpeedRpm() const {
-  std::unique_lock<std::mutex> lock(mutex_);
-  return speed_rpm_;
+  return RoundToInt(snapshot_.Read().speed_rpm);
+}
+
+float EspEncoderMotor::SpeedRpmFloat() const {
+  return static_cast<float>(snapshot_.Read().speed_rpm);
 }
 
 int16_t EspEncoderMotor::PwmDuty() const {
-  std::lock_guard<std::mutex> l(mutex_);
-  return motor_driver_.PwmDuty();
+  return snapshot_.Read().pwm_duty;
 }
 
 int32_t EspEncoderMotor::TargetRpm() const {
+  return snapshot_.Read().target_rpm;
+}
+
+int32_t EspEncoderMotor::SetpointRpm() const {
+  return snapshot_.Read().setpoint_rpm;
+}
+
+int64_t EspEncoderMotor::TargetPosition() const {
+  return snapshot_.Read().target_position;
+}
+
+bool EspEncoderMotor::PositionReached() const {
+  return snapshot_.Read().position_reached;
+}
+
+EspEncoderMotor::Snapshot EspEncoderMotor::GetSnapshot() const {
+  const PublishedState state = snapshot_.Read();
+  Snapshot snapshot;
+  snapshot.time_us = state.time_us;
+  snapshot.pulse_count = state.pulse_count;
+  snapshot.speed_rpm = static_cast<float>(state.speed_rpm);
+  snapshot.acceleration_rpm_per_s = state.acceleration_rpm_per_s;
+  snapshot.pid_integral = static_cast<float>(state.pid_integral);
+  snapshot.target_rpm = state.target_rpm;
+  snapshot.setpoint_rpm = state.setpoint_rpm;
+  snapshot.pwm_duty = state.pwm_duty;
+  snapshot.target_position = state.target_position;
+  snapshot.position_reached = state.position_reached;
+  return snapshot;
+}
+
+void EspEncoderMotor::SetTelemetryRecorder(TelemetryRecorder* const recorder) {
+  std::lock_guard<std::mutex> l(mutex_);
+  telemetry_recorder_ = recorder;
+}
+
+void EspEncoderMotor::SetMotionObserver(MotionObserver* const observer) {
   std::lock_guard<std::mutex> l(mutex_);
-  return target_speed_rpm_;
+  motion_observer_ = observer;
+  acceleration_rpm_per_s_ = 0;
+  if (observer != nullptr) {
+    observer->Reset(previous_pulse_count_, last_update_speed_time_us_);
+  }
 }
 
-void EspEncoderMotor::OnPinAFalling(void* self) {
-  reinterpret_cast<EspEncoderMotor*>(self)->OnPinAFalling();
+EspEncoderMotor::LatencyProfile EspEncoderMotor::GetLatencyProfile() const {
+  LatencyProfile profile;
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  const uint32_t cycles_per_us = hal_.CyclesPerMicrosecond();
+  profile.encoder_isr = encoder_isr_latency_.Get(cycles_per_us);
+  profile.update_rpm = update_rpm_latency_.Get(cycles_per_us);
+  profile.driving = driving_latency_.Get(cycles_per_us);
+#endif
+  return profile;
 }
 
-void EspEncoderMotor::OnPinAFalling() {
-  if (gpio_get_level(static_cast<gpio_num_t>(pin_b_)) == b_level_at_a_falling_edge_) {
-    ++pulse_count_;
+void EspEncoderMotor::ResetLatencyProfile() {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  encoder_isr_latency_.Reset();
+  update_rpm_latency_.Reset();
+  driving_latency_.Reset();
+#endif
+}
+
+void EspEncoderMotor::OnEncoderEdge(void* self) {
+  reinterpret_cast<EspEncoderMotor*>(self)->OnEncoderEdge();
+}
+
+void EspEncoderMotor::OnEncoderEdge() {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  const LatencyProbe::Scope latency_scope(encoder_isr_latency_, hal_);
+#endif
+  CountEncoderStep(direction_ * decoder_.Update(hal_.DigitalRead(pin_a_), hal_.DigitalRead(pin_b_)));
+}
+
+void EspEncoderMotor::Sample(const int64_t now_us) {
+  std::lock_guard<std::mutex> l(mutex_);
+  UpdateRpm(now_us);
+}
+
+void EspEncoderMotor::Control(const int64_t now_us) {
+  PendingCallbacks finished;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    ProcessCommandQueue(now_us, finished);
+    if (learning_feedforward_ && sample_period_us_ > 0) {
+      const float speed_rpm = static_cast<float>(speed_rpm_);
+      const float acceleration_rpm_per_s =
+          (speed_rpm - static_cast<float>(previous_speed_rpm_)) * 1000000.0f / sample_period_us_;
+      // The duty was applied over the last sampling period, pair it with the average speed over that period.
+      feedforward_estimator_.AddSample(motor_driver_.PwmDuty(),
+                                       speed_rpm - acceleration_rpm_per_s * sample_period_us_ / 2000000.0f,
+                                       acceleration_rpm_per_s);
+    }
+    if (control_mode_ == kPositionControl && PositionControl(now_us)) {
+      finished.position.swap(position_callback_);
+      finished.position_reached = true;
+    }
+    if (control_mode_ == kStreamControl) {
+      StreamControl(now_us);
+    }
+    if (control_mode_ == kSpeedControl || control_mode_ == kPositionControl || control_mode_ == kStreamControl) {
+      Driving();
+    } else if (control_mode_ == kAutoTuneControl) {
+      motor_driver_.PwmDuty(auto_tuner_.Update(now_us, static_cast<float>(speed_rpm_)));
+      if (auto_tuner_.Done()) {
+        FinishAutoTune();
+        finished.auto_tune.swap(auto_tune_callback_);
+        finished.auto_tune_result = auto_tuner_.GetResult();
+      }
+    }
+    PublishSnapshot();
+    if (telemetry_recorder_ != nullptr) {
+      telemetry_recorder_->Record({last_update_speed_time_us_,
+                                   previous_pulse_count_,
+                                   static_cast<float>(target_speed_rpm_),
+                                   static_cast<float>(speed_rpm_),
+                                   motor_driver_.PwmDuty()});
+    }
+  }
+  // Invoked without holding mutex_, so that the callbacks may issue the next command.
+  finished.Invoke();
+}
+
+void EspEncoderMotor::UpdateRpm(const int64_t now_us) {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  const LatencyProbe::Scope latency_scope(update_rpm_latency_, hal_);
+#endif
+  const int64_t duration_us = now_us - last_update_speed_time_us_;
+  if (duration_us <= 0) {
+    return;
+  }
+
+  if (encoder_backend_ == kPulseCounter) {
+    pulse_count_ = direction_ * hal_.PulseCounterRead(pin_a_);
+  }
+
+  const int64_t pulse_count = pulse_count_;
+  previous_speed_rpm_ = speed_rpm_;
+  if (motion_observer_ != nullptr) {
+    const MotionObserver::State state = motion_observer_->Update(pulse_count, now_us);
+    speed_rpm_ = ControlNumber(state.velocity * rpm_per_count_per_s_);
+    acceleration_rpm_per_s_ = state.acceleration * rpm_per_count_per_s_;
   } else {
-    --pulse_count_;
+    speed_rpm_ = speed_estimator_.CountRate(pulse_count - previous_pulse_count_, duration_us);
+    if (encoder_backend_ == kGpioInterrupt) {
+      speed_rpm_ = speed_estimator_.EdgeTimed(now_us, edge_timestamps_, decoder_.DecodingMode(), speed_rpm_);
+    }
   }
+  previous_pulse_count_ = pulse_count;
+  last_update_speed_time_us_ = now_us;
+  sample_period_us_ = duration_us;
 }
 
-void EspEncoderMotor::UpdateRpm() {
-  std::unique_lock lock(mutex_);
-  last_update_speed_time_ = std::chrono::system_clock::now();
-  while (!condition_.wait_until(
-      lock, last_update_speed_time_ + std::chrono::milliseconds(50), [this]() { return update_rpm_thread_ == nullptr; })) {
-    const auto now = std::chrono::system_clock::now();
-    const double duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_speed_time_).count();
-    const double pulse_count = pulse_count_;
-    speed_rpm_ = (pulse_count - previous_pulse_count_) * 60000.0 / duration / total_ppr_;
-    previous_pulse_count_ = pulse_count;
-    last_update_speed_time_ = now;
-    if (driving_thread_ != nullptr) {
-      drive_ = true;
-      condition_.notify_all();
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::StartPosition(const int64_t position, PositionCallback callback) {
+  PendingCallbacks cancelled = CancelCommand();
+  if (control_mode_ != kPositionControl) {
+    if (control_mode_ != kSpeedControl) {
+      speed_controller_.Reset();
     }
+    position_pid_.Reset();
+    control_mode_ = kPositionControl;
   }
+
+  // The profile is planned in encoder counts, the limits are given in RPM.
+  const double counts_per_rpm_per_s = total_ppr_ * decoder_.DecodingMode() / 60.0;
+  MotionProfile::Limits limits;
+  limits.max_velocity = motion_limits_.max_velocity * counts_per_rpm_per_s;
+  limits.max_acceleration = motion_limits_.max_acceleration * counts_per_rpm_per_s;
+  limits.max_jerk = motion_limits_.max_jerk * counts_per_rpm_per_s;
+  profile_.Plan(EncoderPulseCount(), position, limits);
+  profile_start_time_us_ = hal_.Micros();
+  target_position_ = position;
+  position_reached_ = false;
+  position_callback_ = std::move(callback);
+  PublishSnapshot();
+  return cancelled;
 }
 
-void EspEncoderMotor::Driving() {
-  std::unique_lock lock(mutex_);
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::StartPwmDuty(const int16_t duty) {
+  PendingCallbacks cancelled = CancelCommand();
+  control_mode_ = kPwmControl;
+  target_speed_rpm_ = 0;
 
-  while (driving_thread_ != nullptr) {
-    condition_.wait(lock, [this]() { return driving_thread_ == nullptr || drive_; });
+  if (motor_driver_.PwmDuty() != duty) {
+    motor_driver_.PwmDuty(duty);
+  }
+  return cancelled;
+}
 
-    if (driving_thread_ == nullptr) {
-      return;
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::StartSpeed(const int16_t speed_rpm) {
+  PendingCallbacks cancelled = CancelCommand();
+  if (control_mode_ != kSpeedControl) {
+    if (control_mode_ != kPositionControl && control_mode_ != kStreamControl) {
+      speed_controller_.Reset();
+    }
+    // The ramp continues from the speed the speed loop was tracking, or else the motor is running at.
+    speed_ramp_.Reset(control_mode_ == kPositionControl || control_mode_ == kStreamControl
+                          ? target_speed_rpm_
+                          : static_cast<float>(speed_rpm_));
+  }
+  control_mode_ = kSpeedControl;
+
+  target_speed_rpm_ = speed_rpm;
+  setpoint_rpm_ = speed_ramp_.Enabled() ? std::lround(speed_ramp_.Setpoint()) : speed_rpm;
+  return cancelled;
+}
+
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::StopOutput() {
+  PendingCallbacks cancelled = CancelCommand();
+  control_mode_ = kPwmControl;
+  motor_driver_.Stop();
+  target_speed_rpm_ = 0;
+  speed_controller_.ResetPid();
+  return cancelled;
+}
+
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::StartStream(const SetpointType type, const int64_t now_us) {
+  PendingCallbacks cancelled = CancelCommand();
+  const bool closed_loop =
+      control_mode_ == kSpeedControl || control_mode_ == kPositionControl || control_mode_ == kStreamControl;
+  if (!closed_loop) {
+    speed_controller_.Reset();
+  }
+  // Streaming starts where the motor is, the first setpoints are interpolated from there.
+  if (type == kSpeedSetpoint) {
+    stream_previous_ = {now_us, closed_loop ? static_cast<double>(setpoint_rpm_) : static_cast<float>(speed_rpm_)};
+  } else {
+    const bool position_loop =
+        control_mode_ == kPositionControl || (control_mode_ == kStreamControl && stream_type_ == kPositionSetpoint);
+    if (!position_loop) {
+      position_pid_.Reset();
     }
+    stream_previous_ = {now_us, static_cast<double>(previous_pulse_count_)};
+  }
+  control_mode_ = kStreamControl;
+  stream_type_ = type;
+  return cancelled;
+}
 
-    if (target_speed_rpm_ < kDeadRpmZone && target_speed_rpm_ > -kDeadRpmZone) {
-      motor_driver_.PwmDuty(0);
-    } else {
-      const float speed_error = target_speed_rpm_ - speed_rpm_;
-      rpm_pid_.integral = constrain(rpm_pid_.integral + speed_error, -rpm_pid_.max_integral, rpm_pid_.max_integral);
-      const int16_t duty = round(rpm_pid_.p * speed_error + rpm_pid_.i * rpm_pid_.integral);
-      motor_driver_.PwmDuty(duty);
+void EspEncoderMotor::DiscardQueuedCommands() {
+  // Only the consumer may pop, the control loop drops the commands queued so far at its next tick.
+  command_generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EspEncoderMotor::ProcessCommandQueue(const int64_t now_us, PendingCallbacks& cancelled) {
+  const uint32_t generation = command_generation_.load(std::memory_order_relaxed);
+  QueuedCommand command;
+  while (command_queue_.Front(command)) {
+    if (command.generation != generation) {
+      command_queue_.Pop();
+      continue;
+    }
+    PendingCallbacks pending;
+    bool hold = false;
+    switch (command.type) {
+      case kQueuedPwmDuty:
+        pending = StartPwmDuty(static_cast<int16_t>(command.value));
+        break;
+      case kQueuedSpeed:
+        pending = StartSpeed(static_cast<int16_t>(command.value));
+        break;
+      case kQueuedStop:
+        pending = StopOutput();
+        break;
+      case kQueuedSpeedSetpoint:
+      case kQueuedPositionSetpoint: {
+        const SetpointType type = command.type == kQueuedPositionSetpoint ? kPositionSetpoint : kSpeedSetpoint;
+        if (control_mode_ != kStreamControl || stream_type_ != type) {
+          pending = StartStream(type, now_us);
+        }
+        // A setpoint in the future stays at the front as the end of the segment being interpolated.
+        hold = command.time_us > now_us;
+        if (!hold) {
+          stream_previous_ = {command.time_us, command.value};
+        }
+        break;
+      }
     }
-    drive_ = false;
+    // Only the first command of a tick can cancel a position move or an auto-tuning, nothing is lost by keeping one.
+    if (pending.position || pending.auto_tune) {
+      cancelled = std::move(pending);
+    }
+    if (hold) {
+      return;
+    }
+    command_queue_.Pop();
+  }
+}
+
+void EspEncoderMotor::StreamControl(const int64_t now_us) {
+  QueuedCommand next;
+  const QueuedCommandType type = stream_type_ == kPositionSetpoint ? kQueuedPositionSetpoint : kQueuedSpeedSetpoint;
+  double value = stream_previous_.value;
+  double slope_per_s = 0;
+  if (command_queue_.Front(next) && next.generation == command_generation_.load(std::memory_order_relaxed) &&
+      next.type == type && next.time_us > stream_previous_.time_us) {
+    slope_per_s = (next.value - stream_previous_.value) * 1000000.0 / (next.time_us - stream_previous_.time_us);
+    value += slope_per_s * (now_us - stream_previous_.time_us) / 1000000.0;
+  }
+
+  if (stream_type_ == kSpeedSetpoint) {
+    target_speed_rpm_ = std::lround(value);
+  } else {
+    TrackPosition(value, slope_per_s);
+    target_position_ = std::llround(value);
+  }
+}
+
+EspEncoderMotor::PendingCallbacks EspEncoderMotor::CancelCommand() {
+  PendingCallbacks cancelled;
+  if (control_mode_ == kPositionControl) {
+    cancelled.position.swap(position_callback_);
+    target_position_ = 0;
+    position_reached_ = false;
+  } else if (control_mode_ == kAutoTuneControl) {
+    cancelled.auto_tune.swap(auto_tune_callback_);
+    motor_driver_.PwmDuty(0);
+  } else if (control_mode_ == kStreamControl) {
+    target_position_ = 0;
+  }
+  return cancelled;
+}
+
+void EspEncoderMotor::FinishAutoTune() {
+  const SpeedAutoTuner::Result& result = auto_tuner_.GetResult();
+  if (result.success) {
+    // The tuner computes gains per second, the speed PID uses the 50 ms reference period as time unit.
+    const float reference_period_s = kSpeedPidReferencePeriodUs / 1000000.0f;
+    speed_controller_.SetParameters(PidParameters(
+        result.kp, result.ki * reference_period_s, result.kd / reference_period_s, EspMotor::kMaxPwmDuty, 0));
+  }
+  speed_controller_.ResetPid();
+  control_mode_ = kPwmControl;
+  motor_driver_.Stop();
+}
+
+void EspEncoderMotor::PendingCallbacks::Invoke() const {
+  if (position) {
+    position(position_reached);
+  }
+  if (auto_tune) {
+    auto_tune(auto_tune_result);
   }
 }
 
-void EspEncoderMotor::DeleteThread(std::thread*& thread) {
-  if (thread != nullptr) {
-    const auto temp = std::exchange(thread, nullptr);
-    condition_.notify_all();
-    mutex_.unlock();
-    temp->join();
-    delete temp;
-    mutex_.lock();
+bool EspEncoderMotor::PositionControl(const int64_t now_us) {
+  const double elapsed_s = (now_us - profile_start_time_us_) / 1000000.0;
+  const MotionProfile::State reference = profile_.Sample(elapsed_s);
+  TrackPosition(reference.position, reference.velocity);
+
+  const double counts_per_pulse = decoder_.DecodingMode();
+  if (position_reached_ || elapsed_s < profile_.Duration() ||
+      std::abs(target_position_ - previous_pulse_count_) > counts_per_pulse) {
+    return false;
   }
+  position_reached_ = true;
+  return true;
+}
+
+void EspEncoderMotor::TrackPosition(const double position, const double velocity) {
+  const double counts_per_pulse = decoder_.DecodingMode();
+
+  // The error is fed as setpoint against a zero measurement, which keeps float precision at large positions.
+  const float error = (position - previous_pulse_count_) / counts_per_pulse;
+  const float rpm =
+      velocity * rpm_per_count_per_s_ + position_pid_.Update(error, 0, sample_period_us_ / kSpeedPidReferencePeriodUs);
+  target_speed_rpm_ = std::lround(std::clamp<float>(rpm, -motion_limits_.max_velocity, motion_limits_.max_velocity));
+}
+
+void EspEncoderMotor::Driving() {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  const LatencyProbe::Scope latency_scope(driving_latency_, hal_);
+#endif
+  // The position control shapes its target speed along the motion profile already. Without a ramp the target goes to
+  // the speed loop unchanged, which keeps the float ramp out of the fixed-point tick.
+  setpoint_rpm_ = control_mode_ == kSpeedControl && speed_ramp_.Enabled()
+                      ? std::lround(speed_ramp_.Update(target_speed_rpm_, sample_period_us_))
+                      : target_speed_rpm_;
+  motor_driver_.PwmDuty(speed_controller_.Update(setpoint_rpm_, speed_rpm_, sample_period_us_));
+}
+
+void EspEncoderMotor::PublishSnapshot() {
+  PublishedState snapshot;
+  snapshot.time_us = last_update_speed_time_us_;
+  snapshot.pulse_count = previous_pulse_count_;
+  snapshot.speed_rpm = speed_rpm_;
+  snapshot.acceleration_rpm_per_s = acceleration_rpm_per_s_;
+  snapshot.pid_integral = speed_controller_.Integral();
+  snapshot.target_rpm = target_speed_rpm_;
+  snapshot.setpoint_rpm = control_mode_ == kSpeedControl ? setpoint_rpm_ : target_speed_rpm_;
+  snapshot.pwm_duty = motor_driver_.PwmDuty();
+  snapshot.target_position = target_position_;
+  snapshot.position_reached = position_reached_;
+  snapshot_.Write(snapshot);
+}
+
+void EspEncoderMotor::DeferOutput(const bool defer) {
+  std::lock_guard<std::mutex> l(mutex_);
+  motor_driver_.DeferOutput(defer);
 }
 
-}  // namespace em
\ No newline at end of file
+}  // namespace em
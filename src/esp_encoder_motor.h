@@ -7,14 +7,27 @@
  * @file esp_encoder_motor.h
  */
 
-#include <WString.h>
-
-#include <chrono>
-#include <condition_variable>
+#include <atomic>
 #include <cstdint>
-#include <thread>
+#include <functional>
+#include <mutex>
 
+#include "control_scheduler.h"
+#include "edge_timestamp_buffer.h"
 #include "esp_motor.h"
+#include "feedforward.h"
+#include "hal.h"
+#include "latency_probe.h"
+#include "motion_observer.h"
+#include "motion_profile.h"
+#include "pid_controller.h"
+#include "quadrature_decoder.h"
+#include "seqlock.h"
+#include "speed_auto_tuner.h"
+#include "speed_control.h"
+#include "speed_ramp.h"
+#include "spsc_queue.h"
+#include "telemetry_recorder.h"
 
 namespace em {
 /**
@@ -27,6 +40,12 @@ namespace em {
  * -# 支持获取电机当前的转速信息，单位为RPM。
  * -# 支持获取编码脉冲计数值，此计数值在A相下降沿进行更新，电机正转时计数值加1，反转时减1。
  * -# 支持获取电机驱动器当前设置的PWM占空比。
+ * -# 支持速度环前馈（静摩擦、转速和加速度项），系数可以手动设置或从测量数据中学习。
+ * -# 支持以受限的加速度和加加速度将目标转速的变化平滑为斜坡。
+ * -# 支持按梯形或S形速度曲线运动到指定的编码器计数位置，位置环串联在速度环之外。
+ * -# 支持通过阶跃响应实验自动整定速度PID参数。
+ * -# 支持以可替换的运动观测器（α-β跟踪器、卡尔曼滤波器或自定义实现）估计转速和加速度。
+ * -# 支持通过无锁命令队列从其它任务流式下发带时间戳的转速或位置设定值，由控制循环插值。
  */
 /**
  * @~English
@@ -40,8 +59,18 @@ namespace em {
  * -# Supports obtaining the encoder pulse count value. This count value is updated at the falling edge of phase A, incremented
  * by 1 during forward rotation and decremented by 1 during reverse rotation.
  * -# Supports obtaining the PWM duty cycle currently set on the motor driver.
+ * -# Supports a speed loop feed-forward (static friction, speed and acceleration terms), with coefficients set manually
+ * or learned from measured data.
+ * -# Supports ramping changes of the target speed with limited acceleration and jerk.
+ * -# Supports moving to a given encoder count position along a trapezoidal or S-curve velocity profile, with a position
+ * loop cascaded around the speed loop.
+ * -# Supports automatic tuning of the speed PID gains with a step response experiment.
+ * -# Supports estimating speed and acceleration with a pluggable motion observer (alpha-beta tracker, Kalman filter or a
+ * custom implementation).
+ * -# Supports streaming timestamped speed or position setpoints from another task through a lock-free command queue,
+ * interpolated by the control loop.
  */
-class EspEncoderMotor {
+class EspEncoderMotor : private ControlTask {
  public:
   /**
    * @~Chinese
@@ -75,6 +104,326 @@ class EspEncoderMotor {
     kBPhaseLeads,
   };
 
+  /**
+   * @~Chinese
+   * @brief 编码器信号的计数方式。
+   */
+  /**
+   * @~English
+   * @brief The way the encoder signals are counted.
+   */
+  enum EncoderBackend : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 在编码器边沿触发GPIO中断并读取A、B相电平，由 @ref QuadratureDecoder 按解码方式计数。
+     */
+    /**
+     * @~English
+     * @brief A GPIO interrupt on the encoder edges reads phase A and B, and @ref QuadratureDecoder counts according to the
+     * decoding mode.
+     */
+    kGpioInterrupt,
+
+    /**
+     * @~Chinese
+     * @brief 由硬件脉冲计数器（ESP32的PCNT外设）按解码方式进行正交计数，不产生逐边沿中断。
+     */
+    /**
+     * @~English
+     * @brief Quadrature counting according to the decoding mode by a hardware pulse counter (the PCNT peripheral of the
+     * ESP32), no interrupt per edge.
+     */
+    kPulseCounter,
+  };
+
+  /**
+   * @~Chinese
+   * @brief 电机状态快照，各字段来自同一个控制周期。
+   */
+  /**
+   * @~English
+   * @brief Snapshot of the motor state, all fields come from the same control tick.
+   */
+  struct Snapshot {
+    /**
+     * @~Chinese
+     * @brief 转速采样的时间，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The time the speed was sampled, in microseconds.
+     */
+    int64_t time_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 采样时的编码器脉冲计数。
+     */
+    /**
+     * @~English
+     * @brief The encoder pulse count at the sampling time.
+     */
+    int64_t pulse_count = 0;
+
+    /**
+     * @~Chinese
+     * @brief 转速（RPM）。
+     */
+    /**
+     * @~English
+     * @brief The speed in RPM.
+     */
+    float speed_rpm = 0;
+
+    /**
+     * @~Chinese
+     * @brief 运动观测器（@ref SetMotionObserver）估计的加速度，单位为RPM/秒，没有观测器时为0。
+     */
+    /**
+     * @~English
+     * @brief The acceleration estimated by the motion observer (@ref SetMotionObserver) in RPM per second, 0 without
+     * an observer.
+     */
+    float acceleration_rpm_per_s = 0;
+
+    /**
+     * @~Chinese
+     * @brief 速度PID控制器的积分项，单位为PWM占空比。
+     */
+    /**
+     * @~English
+     * @brief The integral term of the speed PID controller, in PWM duty.
+     */
+    float pid_integral = 0;
+
+    /**
+     * @~Chinese
+     * @brief 目标转速（RPM）。
+     */
+    /**
+     * @~English
+     * @brief The target speed in RPM.
+     */
+    int32_t target_rpm = 0;
+
+    /**
+     * @~Chinese
+     * @brief 速度环实际跟踪的设定值（RPM），使用速度斜坡（@ref SetSpeedRamp）时是斜坡的当前值，否则等于目标转速。
+     */
+    /**
+     * @~English
+     * @brief The setpoint the speed loop actually tracks in RPM, the current value of the speed ramp (@ref SetSpeedRamp)
+     * when enabled, the target speed otherwise.
+     */
+    int32_t setpoint_rpm = 0;
+
+    /**
+     * @~Chinese
+     * @brief PWM占空比。
+     */
+    /**
+     * @~English
+     * @brief The PWM duty cycle.
+     */
+    int16_t pwm_duty = 0;
+
+    /**
+     * @~Chinese
+     * @brief 位置控制的目标位置（编码器计数），不在位置控制模式时为0。
+     */
+    /**
+     * @~English
+     * @brief The target position of the position control in encoder counts, 0 when not in position control mode.
+     */
+    int64_t target_position = 0;
+
+    /**
+     * @~Chinese
+     * @brief 位置控制是否已到达目标位置。
+     */
+    /**
+     * @~English
+     * @brief Whether the position control has reached the target position.
+     */
+    bool position_reached = false;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 控制循环各部分的耗时统计，参见 @ref GetLatencyProfile。
+   */
+  /**
+   * @~English
+   * @brief Timing statistics of the parts of the control loop, see @ref GetLatencyProfile.
+   */
+  struct LatencyProfile {
+    /**
+     * @~Chinese
+     * @brief 编码器边沿中断处理函数，使用脉冲计数器时没有记录。
+     */
+    /**
+     * @~English
+     * @brief The encoder edge interrupt handler, nothing is recorded with the pulse counter.
+     */
+    LatencyStatistics encoder_isr;
+
+    /**
+     * @~Chinese
+     * @brief 每个控制周期采样阶段的转速计算。
+     */
+    /**
+     * @~English
+     * @brief The speed computation in the sampling phase of every control tick.
+     */
+    LatencyStatistics update_rpm;
+
+    /**
+     * @~Chinese
+     * @brief 速度和位置控制模式下每个控制周期的速度PID计算与PWM输出。
+     */
+    /**
+     * @~English
+     * @brief The speed PID computation and PWM output of every control tick in the speed and position control modes.
+     */
+    LatencyStatistics driving;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 位置控制结束时的回调函数类型，在控制线程中调用，应尽快返回。到达目标位置时reached为true，
+   * 被新的指令（@ref RunToPosition、@ref RunRelative、@ref RunSpeed、@ref RunPwmDuty、@ref AutoTuneSpeed、@ref Stop，
+   * 或者从命令队列中取出的命令）取消时为false。
+   */
+  /**
+   * @~English
+   * @brief Type of the callback invoked when a position move ends, called from the control thread and should return
+   * quickly. reached is true when the target position is reached, false when the move is cancelled by a new command
+   * (@ref RunToPosition, @ref RunRelative, @ref RunSpeed, @ref RunPwmDuty, @ref AutoTuneSpeed, @ref Stop, or a command
+   * taken from the command queue).
+   */
+  using PositionCallback = std::function<void(bool reached)>;
+
+  /**
+   * @~Chinese
+   * @brief 速度PID自动整定结束时的回调函数类型，在控制线程中调用，应尽快返回。被新的指令取消时结果的success为false。
+   */
+  /**
+   * @~English
+   * @brief Type of the callback invoked when the speed PID auto-tuning ends, called from the control thread and should
+   * return quickly. The success of the result is false when the tuning is cancelled by a new command.
+   */
+  using AutoTuneCallback = std::function<void(const SpeedAutoTuner::Result& result)>;
+
+  /**
+   * @~Chinese
+   * @brief 流式设定值的类型，参见 @ref StreamSetpoints。
+   */
+  /**
+   * @~English
+   * @brief The type of streamed setpoints, see @ref StreamSetpoints.
+   */
+  enum SetpointType : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 转速设定值，单位为RPM。
+     */
+    /**
+     * @~English
+     * @brief Speed setpoints in RPM.
+     */
+    kSpeedSetpoint,
+
+    /**
+     * @~Chinese
+     * @brief 位置设定值，单位与 @ref EncoderPulseCount 相同。
+     */
+    /**
+     * @~English
+     * @brief Position setpoints, in the same unit as @ref EncoderPulseCount.
+     */
+    kPositionSetpoint,
+  };
+
+  /**
+   * @~Chinese
+   * @brief 带时间戳的设定值，参见 @ref StreamSetpoints。
+   */
+  /**
+   * @~English
+   * @brief A timestamped setpoint, see @ref StreamSetpoints.
+   */
+  struct Setpoint {
+    /**
+     * @~Chinese
+     * @brief 设定值生效的时间，单位为微秒，与 @ref Hal::Micros 使用同一个时钟。
+     */
+    /**
+     * @~English
+     * @brief The time the setpoint applies at in microseconds, on the same clock as @ref Hal::Micros.
+     */
+    int64_t time_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 设定值，单位由 @ref SetpointType 决定。
+     */
+    /**
+     * @~English
+     * @brief The setpoint, its unit depends on the @ref SetpointType.
+     */
+    double value = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 速度PID自动整定默认的阶跃PWM占空比。
+   */
+  /**
+   * @~English
+   * @brief The default step PWM duty of the speed PID auto-tuning.
+   */
+  static constexpr int16_t kDefaultAutoTuneDuty = 600;
+
+  /**
+   * @~Chinese
+   * @brief 位置控制默认的最大转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief The default maximum speed of the position control in RPM.
+   */
+  static constexpr float kDefaultMaxPositionRpm = 100;
+
+  /**
+   * @~Chinese
+   * @brief 位置控制默认的最大加速度，单位为RPM/秒。
+   */
+  /**
+   * @~English
+   * @brief The default maximum acceleration of the position control in RPM per second.
+   */
+  static constexpr float kDefaultMaxPositionAcceleration = 300;
+
+  /**
+   * @~Chinese
+   * @brief 默认的硬件脉冲计数器毛刺滤波时间，单位为纳秒。
+   */
+  /**
+   * @~English
+   * @brief The default glitch filter time of the hardware pulse counter in nanoseconds.
+   */
+  static constexpr uint32_t kDefaultGlitchFilterNs = 1000;
+
+  /**
+   * @~Chinese
+   * @brief 命令队列的容量，参见 @ref StreamSetpoints。
+   */
+  /**
+   * @~English
+   * @brief The capacity of the command queue, see @ref StreamSetpoints.
+   */
+  static constexpr uint32_t kCommandQueueCapacity = 64;
+
   /**
    * @~Chinese
    * @brief 构造函数，用于创建一个 EspEncoderMotor 对象。
@@ -85,6 +434,7 @@ class EspEncoderMotor {
    * @param[in] ppr 每转脉冲数。
    * @param[in] reduction_ration 减速比。
    * @param[in] phase_relation 相位关系（A相领先或B相领先，指电机正转时的情况），@ref PhaseRelation。
+   * @param[in] hal 用于PWM输出、编码器中断和计时的硬件抽象层，默认为当前平台的 @ref DefaultHal。
    * @details
    * 如果用户不清楚自己所使用的编码电机的phase_relation参数具体取值，可以使用示例程序 @ref detect_phase_relation.ino
    * 来帮助检测确定该参数的值。
@@ -100,6 +450,8 @@ class EspEncoderMotor {
    * @param[in] reduction_ration Reduction ratio.
    * @param[in] phase_relation Phase relationship (A phase leads or B phase leads, referring to the situation when the motor is
    * rotating forward), @ref PhaseRelation.
+   * @param[in] hal The hardware abstraction layer used for PWM output, encoder interrupts and timing, defaults to
+   * @ref DefaultHal of the current platform.
    * @details
    * If the user is unsure about the value of the phase_relation parameter for the encoded motor they are using, they
    * can use the example program @ref detect_phase_relation.ino to help detect and determine the value of this parameter.
@@ -110,23 +462,100 @@ class EspEncoderMotor {
                   const uint8_t b_pin,
                   const uint32_t ppr,
                   const uint32_t reduction_ration,
-                  const PhaseRelation phase_relation);
+                  const PhaseRelation phase_relation,
+                  Hal& hal = DefaultHal());
 
   ~EspEncoderMotor();
 
   /**
    * @~Chinese
-   * @brief 初始化电机设置。
+   * @brief 初始化电机设置，并将电机注册到控制调度器，由调度器周期性地更新转速和执行速度控制。
+   * @param[in] scheduler 控制调度器，默认为 @ref ControlScheduler::Default，共享同一调度器的电机由同一个线程驱动，
+   * 控制频率由调度器的控制周期决定。
+   * @return 注册成功或电机已经初始化时返回true。调度器的任务数量已达到 @ref ControlScheduler::kMaxTasks 时返回false，
+   * 此时编码器被释放，电机保持未初始化状态，可以使用其他调度器再次调用。
+   */
+  /**
+   * @~English
+   * @brief Initialize motor settings and register the motor with a control scheduler, which periodically updates the
+   * speed and runs the speed control.
+   * @param[in] scheduler The control scheduler, defaults to @ref ControlScheduler::Default, motors sharing a scheduler are
+   * driven by the same thread, the control rate is the period of the scheduler.
+   * @return true if the motor was registered or is already initialized. false if the scheduler already has
+   * @ref ControlScheduler::kMaxTasks tasks, the encoder is then released and the motor stays uninitialized, so Init may be
+   * called again with another scheduler.
+   */
+  bool Init(ControlScheduler& scheduler = ControlScheduler::Default());
+
+  /**
+   * @~Chinese
+   * @brief 设置编码器信号的计数方式，必须在 @ref Init 之前调用。
+   * @param[in] backend 计数方式，@ref EncoderBackend，默认为 @ref kGpioInterrupt。
+   * @param[in] glitch_filter_ns 硬件脉冲计数器的毛刺滤波时间，单位为纳秒，仅对 @ref kPulseCounter 有效。
+   * @details 如果当前平台不支持或没有空闲的硬件脉冲计数器，@ref Init 时将退回到 @ref kGpioInterrupt。
+   */
+  /**
+   * @~English
+   * @brief Set the way the encoder signals are counted, must be called before @ref Init.
+   * @param[in] backend The counting backend, @ref EncoderBackend, defaults to @ref kGpioInterrupt.
+   * @param[in] glitch_filter_ns The glitch filter time of the hardware pulse counter in nanoseconds, only used by
+   * @ref kPulseCounter.
+   * @details If the platform has no hardware pulse counter or none is free, @ref Init falls back to
+   * @ref kGpioInterrupt.
+   */
+  void SetEncoderBackend(const EncoderBackend backend, const uint32_t glitch_filter_ns = kDefaultGlitchFilterNs);
+
+  /**
+   * @~Chinese
+   * @brief 设置编码器的解码方式，必须在 @ref Init 之前调用。
+   * @param[in] mode 解码方式，@ref QuadratureDecoder::Mode，默认为一倍频 @ref QuadratureDecoder::kX1。
+   * 二倍频和四倍频提高了低转速时的速度分辨率，但中断次数也相应增加，四倍频推荐与 @ref kPulseCounter 配合使用。
    */
   /**
    * @~English
-   * @brief Initialize motor settings.
+   * @brief Set the decoding mode of the encoder, must be called before @ref Init.
+   * @param[in] mode The decoding mode, @ref QuadratureDecoder::Mode, defaults to x1 @ref QuadratureDecoder::kX1. x2
+   * and x4 improve the speed resolution at low speed at the cost of proportionally more interrupts, x4 is best used
+   * together with @ref kPulseCounter.
    */
-  void Init();
+  void SetDecodingMode(const QuadratureDecoder::Mode mode);
+
+  /**
+   * @~Chinese
+   * @brief 设置电机驱动的PWM输出方式、频率和分辨率，必须在 @ref Init 之前调用，参见 @ref EspMotor::SetPwmBackend。
+   * @param[in] backend 输出方式，@ref EspMotor::PwmBackend。
+   * @param[in] frequency PWM频率，单位为赫兹。
+   * @param[in] resolution PWM分辨率，单位为位。
+   */
+  /**
+   * @~English
+   * @brief Set the PWM output backend, frequency and resolution of the motor driver, must be called before @ref Init,
+   * see @ref EspMotor::SetPwmBackend.
+   * @param[in] backend The output backend, @ref EspMotor::PwmBackend.
+   * @param[in] frequency The PWM frequency in Hz.
+   * @param[in] resolution The PWM resolution in bits.
+   */
+  void SetPwmBackend(const EspMotor::PwmBackend backend,
+                     const uint32_t frequency = EspMotor::kPwmFrequency,
+                     const uint8_t resolution = EspMotor::kPwmResolution);
+
+  /**
+   * @~Chinese
+   * @brief 设置 @ref Stop 的停止方式，刹车或滑行。
+   * @param[in] mode 停止方式，@ref EspMotor::StopMode，默认为 @ref EspMotor::kBrake。
+   */
+  /**
+   * @~English
+   * @brief Set how @ref Stop stops the motor, braking or coasting.
+   * @param[in] mode The stop mode, @ref EspMotor::StopMode, defaults to @ref EspMotor::kBrake.
+   */
+  void SetStopMode(const EspMotor::StopMode mode);
 
   /**
    * @~Chinese
    * @brief 使用给定的比例（P）、积分（I）、微分（D）参数值来设置速度PID控制器的参数。
+   * @details 积分和微分系数以50毫秒为时间单位，控制周期不同时按实际采样间隔换算。微分项作用于测量的转速并经过低通滤波，
+   * 积分项在PWM占空比饱和时通过反计算法退饱和，参考 @ref PidController。
    * @param[in] p 比例系数（P）的值。
    * @param[in] i 积分系数（I）的值。
    * @param[in] d 微分系数（D）的值。
@@ -135,6 +564,9 @@ class EspEncoderMotor {
    * @~English
    * @brief Set the parameters of the speed PID controller with the given Proportional (P), Integral (I), and Derivative (D)
    * parameter values.
+   * @details The integral and derivative gains use 50 ms as time unit and are scaled by the actual sampling interval at
+   * other control periods. The derivative acts on the measured speed through a low-pass filter, and the integral is
+   * unwound by back-calculation while the PWM duty saturates, see @ref PidController.
    * @param[in] p The value of the Proportional coefficient (P).
    * @param[in] i The value of the Integral coefficient (I).
    * @param[in] d The value of the Derivative coefficient (D).
@@ -161,6 +593,181 @@ class EspEncoderMotor {
    */
   void GetSpeedPid(float* const p, float* const i, float* const d);
 
+  /**
+   * @~Chinese
+   * @brief 设置速度环的前馈模型系数，前馈占空比按目标转速及其变化率计算，叠加在速度PID的输出上。
+   * @details 默认系数全为0，即不使用前馈。合适的前馈让速度阶跃时的占空比直接接近稳态值，PID只需修正剩余误差，
+   * 从而显著缩短调节时间而无需重新整定PID参数。
+   * @param[in] feedforward 前馈模型系数，@ref Feedforward。
+   */
+  /**
+   * @~English
+   * @brief Set the feed-forward model coefficients of the speed loop, the feed-forward duty is computed from the target
+   * speed and its rate of change and added to the output of the speed PID.
+   * @details All coefficients default to 0, i.e. no feed-forward. A good feed-forward puts the duty close to its steady
+   * state right at a speed step, leaving only the residual error to the PID, which shortens the settling time
+   * considerably without retuning the PID gains.
+   * @param[in] feedforward The feed-forward model coefficients, @ref Feedforward.
+   */
+  void SetFeedforward(const Feedforward& feedforward);
+
+  /**
+   * @~Chinese
+   * @brief 获取速度环的前馈模型系数。
+   * @return 前馈模型系数，@ref Feedforward。
+   */
+  /**
+   * @~English
+   * @brief Get the feed-forward model coefficients of the speed loop.
+   * @return The feed-forward model coefficients, @ref Feedforward.
+   */
+  Feedforward GetFeedforward();
+
+  /**
+   * @~Chinese
+   * @brief 开始学习前馈模型，清除之前的样本。
+   * @details 之后每个控制周期将上一周期施加的PWM占空比与测得的平均转速和加速度作为一个样本，@ref FeedforwardEstimator。
+   * 学习期间应使用 @ref RunPwmDuty 或 @ref RunSpeed 让电机以多个不同的占空比正反转并包含加减速过程，然后调用
+   * @ref FinishFeedforwardLearning。
+   */
+  /**
+   * @~English
+   * @brief Start learning the feed-forward model, discarding earlier samples.
+   * @details From then on every control tick takes the PWM duty applied over the previous period together with the
+   * average speed and acceleration measured over it as one sample, @ref FeedforwardEstimator. While learning, drive the
+   * motor in both directions at several duties including some acceleration and deceleration with @ref RunPwmDuty or
+   * @ref RunSpeed, then call @ref FinishFeedforwardLearning.
+   */
+  void StartFeedforwardLearning();
+
+  /**
+   * @~Chinese
+   * @brief 结束学习前馈模型，拟合成功时将结果设置为速度环的前馈模型。
+   * @param[out] feedforward 拟合得到的模型系数，可以为nullptr。
+   * @return 拟合成功返回true，样本不足时返回false，此时前馈模型保持不变。
+   */
+  /**
+   * @~English
+   * @brief Finish learning the feed-forward model and set the result as the feed-forward model of the speed loop on
+   * success.
+   * @param[out] feedforward The fitted model coefficients, may be nullptr.
+   * @return true on success, false if the samples are insufficient, in which case the feed-forward model is unchanged.
+   */
+  bool FinishFeedforwardLearning(Feedforward* const feedforward = nullptr);
+
+  /**
+   * @~Chinese
+   * @brief 使用给定的比例（P）、积分（I）、微分（D）参数值来设置位置PID控制器的参数。
+   * @details 位置PID控制器的输入为位置误差，单位为编码器脉冲（与解码方式无关），输出为叠加在运动曲线速度上的速度修正量（RPM）。
+   * @param[in] p 比例系数（P）的值。
+   * @param[in] i 积分系数（I）的值。
+   * @param[in] d 微分系数（D）的值。
+   */
+  /**
+   * @~English
+   * @brief Set the parameters of the position PID controller with the given Proportional (P), Integral (I), and Derivative
+   * (D) parameter values.
+   * @details The input of the position PID controller is the position error in encoder pulses (independent of the
+   * decoding mode), the output is a speed correction in RPM added to the velocity of the motion profile.
+   * @param[in] p The value of the Proportional coefficient (P).
+   * @param[in] i The value of the Integral coefficient (I).
+   * @param[in] d The value of the Derivative coefficient (D).
+   */
+  void SetPositionPid(const float p, const float i, const float d);
+
+  /**
+   * @~Chinese
+   * @brief 通过指针获取位置PID控制器的比例（P）、积分（I）、微分（D）参数值。
+   * @param[out] p 用于获取比例系数（P）值的指针。
+   * @param[out] i 用于获取积分系数（I）值的指针。
+   * @param[out] d 用于获取微分系数（D）值的指针。
+   */
+  /**
+   * @~English
+   * @brief Get the Proportional (P), Integral (I), and Derivative (D) parameter values of the position PID controller
+   * through pointers.
+   * @param[out] p Pointer used to get the value of the Proportional coefficient (P).
+   * @param[out] i Pointer used to get the value of the Integral coefficient (I).
+   * @param[out] d Pointer used to get the value of the Derivative coefficient (D).
+   */
+  void GetPositionPid(float* const p, float* const i, float* const d);
+
+  /**
+   * @~Chinese
+   * @brief 设置位置控制的运动限制，对之后开始的运动生效。
+   * @param[in] max_rpm 最大转速（RPM），必须大于0。
+   * @param[in] max_acceleration 最大加速度，单位为RPM/秒，必须大于0。
+   * @param[in] max_jerk 最大加加速度，单位为RPM/秒²，0表示使用梯形速度曲线，大于0时使用S形速度曲线。
+   */
+  /**
+   * @~English
+   * @brief Set the motion limits of the position control, applied to moves started afterwards.
+   * @param[in] max_rpm The maximum speed in RPM, must be greater than 0.
+   * @param[in] max_acceleration The maximum acceleration in RPM per second, must be greater than 0.
+   * @param[in] max_jerk The maximum jerk in RPM per second², 0 for a trapezoidal velocity profile, an S-curve velocity
+   * profile when greater than 0.
+   */
+  void SetMotionLimits(const float max_rpm, const float max_acceleration, const float max_jerk = 0);
+
+  /**
+   * @~Chinese
+   * @brief 设置速度控制的设定值斜坡，默认不使用。
+   * @details 使用时 @ref RunSpeed 的目标转速不再作为阶跃直接交给速度环，而是每个控制周期以受限的加速度和加加速度推进的
+   * 设定值（@ref SetpointRpm），避免占空比饱和、积分饱和以及多个电机同时启动时的电流尖峰。斜坡途中可以随时改变目标转速。
+   * 从其它控制模式切换到速度控制时，斜坡从电机当前的转速开始。斜坡以float计算，定点数构建（@ref ControlNumber）中
+   * 使用斜坡会在每个控制周期重新引入浮点运算，不使用时速度环不经过斜坡。位置控制已经按运动曲线给出目标转速，不经过斜坡。
+   * @param[in] max_acceleration 最大加速度，单位为RPM/秒，0表示不使用斜坡，不能小于0。
+   * @param[in] max_jerk 最大加加速度，单位为RPM/秒²，0表示不限制（梯形斜坡），不能小于0。
+   */
+  /**
+   * @~English
+   * @brief Set the setpoint ramp of the speed control, disabled by default.
+   * @details When enabled the target speed of @ref RunSpeed is no longer handed to the speed loop as a step, the loop
+   * tracks a setpoint (@ref SetpointRpm) advanced every control tick with limited acceleration and jerk instead, which
+   * avoids saturating the duty, integral windup, and the current spikes of several motors starting together. The target
+   * speed may change at any time during the ramp. When switching to speed control from another control mode the ramp
+   * starts at the current speed of the motor. The ramp is computed in float, so enabling it brings floating point back
+   * into every control tick of the fixed-point build (@ref ControlNumber); while disabled the speed loop bypasses it. The
+   * position control already derives its target speed from the motion profile and bypasses the ramp.
+   * @param[in] max_acceleration The maximum acceleration in RPM per second, 0 disables the ramp, must not be negative.
+   * @param[in] max_jerk The maximum jerk in RPM per second², 0 for unlimited (a trapezoidal ramp), must not be negative.
+   */
+  void SetSpeedRamp(const float max_acceleration, const float max_jerk = 0);
+
+  /**
+   * @~Chinese
+   * @brief 运动到指定的绝对位置，立即返回。
+   * @details 从当前位置规划一条静止到静止的运动曲线（@ref SetMotionLimits），位置环以曲线的速度作为前馈并修正位置误差，
+   * 输出作为速度环的目标转速。运动结束后保持在目标位置。
+   * @param[in] position 目标位置，单位与 @ref EncoderPulseCount 相同。
+   * @param[in] callback 运动结束时的回调函数，@ref PositionCallback，可以为空。
+   */
+  /**
+   * @~English
+   * @brief Move to an absolute position, returns immediately.
+   * @details A rest-to-rest motion profile (@ref SetMotionLimits) is planned from the current position, the position loop
+   * feeds the velocity of the profile forward, corrects the position error and sets its output as the target speed of
+   * the speed loop. The motor holds the target position after the move.
+   * @param[in] position The target position, in the same unit as @ref EncoderPulseCount.
+   * @param[in] callback The callback invoked when the move ends, @ref PositionCallback, may be empty.
+   */
+  void RunToPosition(const int64_t position, PositionCallback callback = nullptr);
+
+  /**
+   * @~Chinese
+   * @brief 相对移动指定的距离，立即返回。正在位置控制时相对于当前的目标位置，否则相对于当前位置。
+   * @param[in] distance 移动距离，单位与 @ref EncoderPulseCount 相同。
+   * @param[in] callback 运动结束时的回调函数，@ref PositionCallback，可以为空。
+   */
+  /**
+   * @~English
+   * @brief Move by a relative distance, returns immediately. Relative to the current target position while in position
+   * control, otherwise relative to the current position.
+   * @param[in] distance The distance, in the same unit as @ref EncoderPulseCount.
+   * @param[in] callback The callback invoked when the move ends, @ref PositionCallback, may be empty.
+   */
+  void RunRelative(const int64_t distance, PositionCallback callback = nullptr);
+
   /**
    * @~Chinese
    * @brief 直接设置电机的PWM占空比。
@@ -176,38 +783,190 @@ class EspEncoderMotor {
   /**
    * @~Chinese
    * @brief 以设定的速度值（RPM）运行电机。
+   * @details 使用速度斜坡（@ref SetSpeedRamp）时，速度环的设定值以受限的加速度趋向该速度。
    * @param[in] speed_rpm 速度设定值（RPM）。
    */
   /**
    * @~English
    * @brief Run motor at speed setpoint.
+   * @details With the speed ramp (@ref SetSpeedRamp) enabled the setpoint of the speed loop approaches this speed with
+   * limited acceleration.
    * @param[in] speed_rpm Speed setpoint(RPM).
    */
   void RunSpeed(const int16_t speed_rpm);
 
   /**
    * @~Chinese
-   * @brief 停止电机运行。
+   * @brief 自动整定速度PID参数，立即返回，整定过程在控制调度器中逐周期进行。
+   * @details 通过 @ref EspMotor::PwmDuty 直接驱动电机：先以一半的阶跃占空比运转至转速稳定，再阶跃到step_duty并记录转速响应，
+   * 辨识一阶加纯滞后模型并按SIMC规则计算PI参数，参考 @ref SpeedAutoTuner。成功时新参数立即生效，相当于调用
+   * @ref SetSpeedPid，比例、积分、微分系数同样以50毫秒为时间单位。结束后电机停止。
+   * 整定期间电机会以step_duty对应的转速运转数秒，请确保机构可以自由转动。
+   * @param[in] step_duty 阶跃的PWM占空比（取值范围 -1023到1023），符号决定转动方向，应使电机达到常用的转速范围。
+   * @param[in] callback 整定结束时的回调函数，@ref AutoTuneCallback，回调中包含辨识得到的模型和参数，可以为空。
    */
   /**
    * @~English
-   * @brief Stop motor.
+   * @brief Automatically tune the speed PID gains, returns immediately and the tuning runs tick by tick in the control
+   * scheduler.
+   * @details The motor is driven directly through @ref EspMotor::PwmDuty: it first runs at half the step duty until the
+   * speed settles, then the duty steps to step_duty and the speed response is recorded, a first-order-plus-dead-time
+   * model is identified and PI gains are computed with the SIMC rules, see @ref SpeedAutoTuner. On success the new
+   * gains take effect right away as if set with @ref SetSpeedPid, with the same 50 ms time unit. The motor stops
+   * afterwards. The motor runs at the speed of step_duty for a few seconds while tuning, make sure the mechanism can
+   * turn freely.
+   * @param[in] step_duty The PWM duty of the step (-1023 to 1023), its sign selects the direction, it should bring the
+   * motor into its usual speed range.
+   * @param[in] callback The callback invoked when the tuning ends, @ref AutoTuneCallback, receives the identified model
+   * and gains, may be empty.
+   */
+  void AutoTuneSpeed(const int16_t step_duty = kDefaultAutoTuneDuty, AutoTuneCallback callback = nullptr);
+
+  /**
+   * @~Chinese
+   * @brief 停止电机运行，按 @ref SetStopMode 设置的方式刹车或滑行。
+   */
+  /**
+   * @~English
+   * @brief Stop motor, braking or coasting as set by @ref SetStopMode.
    */
   void Stop();
 
   /**
    * @~Chinese
-   * @brief 获取编码器脉冲计数。该计数值是在A相下降沿的时候计数，如果是正转会加一，反转则减一。
+   * @brief 将一组带时间戳的设定值写入命令队列，不加锁，从不阻塞。
+   * @details 命令队列是一个无锁的单生产者单消费者队列（@ref SpscQueue），控制循环在每个控制周期开始时按顺序取出命令。
+   * 时间已到的设定值依次生效，控制器在最后一个已生效的设定值与下一个尚未到时间的设定值之间按自己的控制周期线性插值；
+   * 位置设定值的斜率同时作为速度前馈，位置环与 @ref RunToPosition 相同。队列中没有后续设定值时保持最后一个设定值。
+   * 设定值的时间应递增，开始流式控制时从电机当前的转速或位置出发。转速设定值不经过速度斜坡（@ref SetSpeedRamp）。
+   * 所有 Post 和 Stream 函数必须由同一个任务调用（单生产者），例如运行在另一个核心上的轨迹规划任务。
+   * 加锁的指令（@ref RunSpeed、@ref RunPwmDuty、@ref Stop 等）会作废之前写入队列的命令，由控制循环在下一个控制周期
+   * 丢弃，队列本身只由控制循环读取。
+   * @param[in] type 设定值的类型，@ref SetpointType。
+   * @param[in] setpoints 按时间排列的设定值。
+   * @param[in] count 设定值数量。
+   * @return 写入的设定值数量，队列剩余空间（@ref CommandQueueSpace）不足时只写入前面的部分。
+   */
+  /**
+   * @~English
+   * @brief Write a buffer of timestamped setpoints into the command queue, without locking, never blocks.
+   * @details The command queue is a lock-free single-producer single-consumer queue (@ref SpscQueue), the control loop
+   * takes the commands in order at the start of every control tick. Setpoints whose time has come take effect one after
+   * another, and the controller interpolates linearly at its own rate between the last one in effect and the next one
+   * still in the future; for position setpoints the slope is fed forward as speed too, the position loop is the same as
+   * with @ref RunToPosition. Without a following setpoint in the queue the last one is held. The times should increase,
+   * streaming starts from the current speed or position of the motor. Speed setpoints bypass the speed ramp
+   * (@ref SetSpeedRamp). All Post and Stream functions must be called from the same task (single producer), e.g. a
+   * trajectory planner running on the other core. The locking commands (@ref RunSpeed, @ref RunPwmDuty, @ref Stop etc.)
+   * invalidate the commands queued before them, which the control loop drops at its next tick, so only the control loop
+   * ever reads the queue.
+   * @param[in] type The type of the setpoints, @ref SetpointType.
+   * @param[in] setpoints The setpoints in time order.
+   * @param[in] count The number of setpoints.
+   * @return The number of setpoints written, only the leading ones when the remaining space of the queue
+   * (@ref CommandQueueSpace) is too small.
+   */
+  size_t StreamSetpoints(const SetpointType type, const Setpoint* const setpoints, const size_t count);
+
+  /**
+   * @~Chinese
+   * @brief 通过命令队列以设定的速度值（RPM）运行电机，不加锁，从不阻塞，在下一个控制周期按队列顺序生效，参见
+   * @ref StreamSetpoints。
+   * @param[in] speed_rpm 速度设定值（RPM）。
+   * @return 写入队列返回true，队列已满返回false。
+   */
+  /**
+   * @~English
+   * @brief Run the motor at a speed setpoint through the command queue, without locking, never blocks, takes effect in
+   * queue order at the next control tick, see @ref StreamSetpoints.
+   * @param[in] speed_rpm Speed setpoint (RPM).
+   * @return true if queued, false if the queue is full.
+   */
+  bool PostSpeed(const int16_t speed_rpm);
+
+  /**
+   * @~Chinese
+   * @brief 通过命令队列直接设置电机的PWM占空比，不加锁，从不阻塞，在下一个控制周期按队列顺序生效，参见
+   * @ref StreamSetpoints。
+   * @param[in] pwm_duty PWM占空比（取值范围 -1023到1023）。
+   * @return 写入队列返回true，队列已满返回false。
+   */
+  /**
+   * @~English
+   * @brief Set the motor PWM directly through the command queue, without locking, never blocks, takes effect in queue
+   * order at the next control tick, see @ref StreamSetpoints.
+   * @param[in] pwm_duty PWM duty cycle (-1023 to 1023).
+   * @return true if queued, false if the queue is full.
+   */
+  bool PostPwmDuty(const int16_t pwm_duty);
+
+  /**
+   * @~Chinese
+   * @brief 通过命令队列停止电机，不加锁，从不阻塞，在下一个控制周期按队列顺序生效，参见 @ref StreamSetpoints。
+   * @return 写入队列返回true，队列已满返回false。
+   */
+  /**
+   * @~English
+   * @brief Stop the motor through the command queue, without locking, never blocks, takes effect in queue order at the
+   * next control tick, see @ref StreamSetpoints.
+   * @return true if queued, false if the queue is full.
+   */
+  bool PostStop();
+
+  /**
+   * @~Chinese
+   * @brief 获取命令队列的剩余空间。被加锁的指令作废的命令在下一个控制周期丢弃之前仍然占用空间。
+   * @return 还能写入的命令或设定值数量。
+   */
+  /**
+   * @~English
+   * @brief Get the remaining space of the command queue. Commands invalidated by a locking command take up space until
+   * the next control tick drops them.
+   * @return The number of commands or setpoints that can still be queued.
+   */
+  size_t CommandQueueSpace() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取编码器脉冲计数。默认的一倍频解码在A相下降沿的时候计数，如果是正转会加一，反转则减一。二倍频和四倍频解码时
+   * 每个脉冲分别计数两次和四次，参考 @ref SetDecodingMode。
    * @return 编码器脉冲数。
    */
   /**
    * @~English
    * @brief Get encoder pulse count. The count value is incremented by one during forward rotation and decremented by one during
-   * reverse rotation, counted at the falling edge of phase A.
+   * reverse rotation, counted at the falling edge of phase A with the default x1 decoding. x2 and x4 decoding count two and
+   * four times per pulse, see @ref SetDecodingMode.
    * @return int32_t Encoder pulses.
    */
   int64_t EncoderPulseCount() const;
 
+  /**
+   * @~Chinese
+   * @brief 获取输出轴每转的编码器脉冲计数，即每转脉冲数、减速比与解码倍数之积，用于把 @ref EncoderPulseCount 换算为转数。
+   * @return 输出轴每转的脉冲计数。
+   */
+  /**
+   * @~English
+   * @brief Get the encoder pulse count per revolution of the output shaft, the product of the pulses per revolution,
+   * the reduction ratio and the decoding multiple, to convert @ref EncoderPulseCount into revolutions.
+   * @return The pulse count per output shaft revolution.
+   */
+  double PulsesPerRevolution() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取 @ref kGpioInterrupt 计数方式下检测到的编码器非法跳变次数，可用于诊断信号噪声或丢失的边沿。
+   * @return 非法跳变次数，使用 @ref kPulseCounter 计数方式时为0。
+   */
+  /**
+   * @~English
+   * @brief Get the number of illegal encoder transitions detected with the @ref kGpioInterrupt backend, useful to
+   * diagnose signal noise or lost edges.
+   * @return The number of illegal transitions, 0 with the @ref kPulseCounter backend.
+   */
+  uint32_t IllegalTransitionCount() const;
+
   /**
    * @~Chinese
    * @brief 获取电机当前的转速（RPM）。
@@ -220,6 +979,26 @@ class EspEncoderMotor {
    */
   int32_t SpeedRpm() const;
 
+  /**
+   * @~Chinese
+   * @brief 获取电机当前的转速（RPM），浮点精度。
+   * @details 使用 @ref kGpioInterrupt 计数方式时，每个计数边沿都记录微秒级时间戳，转速采用M/T法估算：
+   * 一个采样周期内的边沿足够多时，用首尾边沿之间的精确时间计算平均转速；转速很低时，用最近一个完整编码器周期的边沿间隔
+   * （1/T法）计算转速，长时间没有新边沿时转速逐渐衰减为0。使用 @ref kPulseCounter 计数方式时按采样周期内的计数差计算。
+   * @return 电机当前的转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief Get the current speed of the motor with float precision.
+   * @details With the @ref kGpioInterrupt backend every counted edge is timestamped with microsecond resolution and the
+   * speed is estimated with the M/T method: when enough edges fall into one sampling period the average speed is computed
+   * over the exact time between the edges, at low speed it is computed from the edge intervals of the latest full encoder
+   * cycle (1/T method) and decays towards 0 while no new edge arrives. With the @ref kPulseCounter backend it is computed
+   * from the count difference over the sampling period.
+   * @return The current speed of the motor in RPM.
+   */
+  float SpeedRpmFloat() const;
+
   /**
    * @~Chinese
    * @brief 获取电机驱动器的PWM占空比。
@@ -244,41 +1023,330 @@ class EspEncoderMotor {
    */
   int32_t TargetRpm() const;
 
+  /**
+   * @~Chinese
+   * @brief 获取速度环实际跟踪的设定值（RPM），使用速度斜坡（@ref SetSpeedRamp）时随斜坡逐步趋向 @ref TargetRpm。
+   * @return 设定值（RPM）。
+   */
+  /**
+   * @~English
+   * @brief Get the setpoint the speed loop actually tracks in RPM, which follows the speed ramp (@ref SetSpeedRamp)
+   * towards @ref TargetRpm when enabled.
+   * @return The setpoint in RPM.
+   */
+  int32_t SetpointRpm() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取位置控制的目标位置。
+   * @return 目标位置，不在位置控制模式时为0。
+   */
+  /**
+   * @~English
+   * @brief Get the target position of the position control.
+   * @return The target position, 0 when not in position control mode.
+   */
+  int64_t TargetPosition() const;
+
+  /**
+   * @~Chinese
+   * @brief 查询位置控制是否已到达目标位置，即运动曲线已结束且位置误差不超过一个编码器脉冲。
+   * @return 已到达返回true，否则返回false。
+   */
+  /**
+   * @~English
+   * @brief Query whether the position control has reached the target position, i.e. the motion profile has ended and the
+   * position error is within one encoder pulse.
+   * @return true if reached, false otherwise.
+   */
+  bool PositionReached() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取电机状态快照。
+   * @details 快照在每个控制周期结束时以及每次下达指令后通过顺序锁发布，读取时不加锁，不会阻塞或拖慢控制循环，
+   * 适合界面或日志任务高频轮询。@ref SpeedRpm、@ref SpeedRpmFloat、@ref PwmDuty、@ref TargetRpm 和 @ref SetpointRpm
+   * 同样读取该快照。
+   * @return 电机状态快照，@ref Snapshot。
+   */
+  /**
+   * @~English
+   * @brief Get a snapshot of the motor state.
+   * @details The snapshot is published through a seqlock at the end of every control tick and after every command, and
+   * is read without locking, so polling it never blocks or delays the control loop, which suits UI and logging tasks
+   * polling at a high rate. @ref SpeedRpm, @ref SpeedRpmFloat, @ref PwmDuty, @ref TargetRpm and @ref SetpointRpm read the
+   * same snapshot.
+   * @return The motor state snapshot, @ref Snapshot.
+   */
+  Snapshot GetSnapshot() const;
+
+  /**
+   * @~Chinese
+   * @brief 设置遥测记录器，之后每个控制周期结束时向其写入一条 @ref TelemetryRecord，写入不加锁、不分配内存。
+   * @details 记录器由调用者读出，例如在 @c loop() 中调用 @ref TelemetryRecorder::Stream 写到串口。
+   * @param[in] recorder 遥测记录器，生命周期必须长于电机，传入空指针则停止记录。
+   */
+  /**
+   * @~English
+   * @brief Set the telemetry recorder, a @ref TelemetryRecord is written to it at the end of every control tick from
+   * then on, without locking or allocation.
+   * @details The caller reads the recorder out, e.g. calling @ref TelemetryRecorder::Stream in @c loop() to write to the
+   * serial port.
+   * @param[in] recorder The telemetry recorder, which must outlive the motor, nullptr stops recording.
+   */
+  void SetTelemetryRecorder(TelemetryRecorder* const recorder);
+
+  /**
+   * @~Chinese
+   * @brief 设置运动观测器，之后速度环和 @ref SpeedRpm 使用观测器估计的转速，代替内置的M/T法或计数差估计。
+   * @details 每个控制周期以采样的编码器计数调用 @ref MotionObserver::Update，估计的加速度通过 @ref Snapshot 发布。
+   * 观测器以float计算，定点数构建（@ref ControlNumber）中设置观测器会在每个控制周期重新引入浮点运算，不设置时速度路径
+   * 仍然只用定点数。设置时以当前计数重置观测器。可使用 @ref AlphaBetaObserver、
+   * @ref KalmanObserver 或自定义的实现。
+   * @param[in] observer 运动观测器，生命周期必须长于电机，传入空指针则恢复内置的估计。
+   */
+  /**
+   * @~English
+   * @brief Set the motion observer, the speed loop and @ref SpeedRpm use the speed it estimates from then on, instead of
+   * the built-in M/T or count difference estimate.
+   * @details @ref MotionObserver::Update is called with the sampled encoder count every control tick, the estimated
+   * acceleration is published through the @ref Snapshot. Observers compute in float, so setting one brings floating
+   * point back into every control tick of the fixed-point build (@ref ControlNumber), without one the speed path stays
+   * fixed-point. The observer is reset to the current count when set. @ref AlphaBetaObserver, @ref KalmanObserver or a custom
+   * implementation can be used.
+   * @param[in] observer The motion observer, which must outlive the motor, nullptr returns to the built-in estimate.
+   */
+  void SetMotionObserver(MotionObserver* const observer);
+
+  /**
+   * @~Chinese
+   * @brief 获取控制循环各部分的耗时统计，不加锁，用于评估一个CPU核心能承载的电机数量。
+   * @details 仅当编译选项 @ref EM_ESP_ENCODER_MOTOR_PROFILING 为1时统计，否则相关代码不参与编译，返回的统计全部为0。
+   * 在ESP32上以CPU周期计时，在主机上以真实时钟的纳秒计时，参见 @ref Hal::CycleCount。
+   * 调度周期的唤醒延迟由 @ref ControlScheduler::GetStatistics 统计。
+   * @return 耗时统计，@ref LatencyProfile。
+   */
+  /**
+   * @~English
+   * @brief Get the timing statistics of the parts of the control loop, without locking, to size how many motors one CPU
+   * core can handle.
+   * @details Only recorded when the compiler flag @ref EM_ESP_ENCODER_MOTOR_PROFILING is 1, otherwise that code is not
+   * compiled and all returned statistics are zero. Timed in CPU cycles on the ESP32 and in nanoseconds of the real clock
+   * on a host, see @ref Hal::CycleCount. The wake-up lateness of the scheduling ticks is covered by
+   * @ref ControlScheduler::GetStatistics.
+   * @return The timing statistics, @ref LatencyProfile.
+   */
+  LatencyProfile GetLatencyProfile() const;
+
+  /**
+   * @~Chinese
+   * @brief 清零耗时统计，每项统计在下一次记录时清零。
+   */
+  /**
+   * @~English
+   * @brief Clear the timing statistics, each statistic is cleared at its next record.
+   */
+  void ResetLatencyProfile();
+
+ protected:
+  /**
+   * @~Chinese
+   * @brief 使用指定编码器中断处理函数的构造函数，供 @ref StaticEncoderMotor 使用，其余参数与公有构造函数相同。
+   * @param[in] encoder_isr 编码器引脚的中断处理函数，参数为电机对象，通常调用 @ref DecodeEncoderEdge。
+   */
+  /**
+   * @~English
+   * @brief Constructor with a given encoder interrupt handler, used by @ref StaticEncoderMotor, the other parameters
+   * are the same as for the public constructor.
+   * @param[in] encoder_isr The interrupt handler of the encoder pins, its argument is the motor, usually calls
+   * @ref DecodeEncoderEdge.
+   */
+  EspEncoderMotor(const uint8_t positive_pin,
+                  const uint8_t negative_pin,
+                  const uint8_t a_pin,
+                  const uint8_t b_pin,
+                  const uint32_t ppr,
+                  const uint32_t reduction_ration,
+                  const PhaseRelation phase_relation,
+                  Hal& hal,
+                  const Hal::InterruptHandler encoder_isr);
+
+  /**
+   * @~Chinese
+   * @brief 编码器中断处理函数的主体，引脚和方向为编译期常量，省去了从对象中读取它们和乘以方向的开销。
+   * @tparam kPinA 编码器A相引脚编号，必须与构造时的相同。
+   * @tparam kPinB 编码器B相引脚编号，必须与构造时的相同。
+   * @tparam kDirection 计数方向，A相领先为1，B相领先为-1。
+   */
+  /**
+   * @~English
+   * @brief The body of the encoder interrupt handler with the pins and the direction as compile-time constants, which
+   * saves loading them from the object and multiplying by the direction.
+   * @tparam kPinA The pin number of the encoder's A phase, must match the one given at construction.
+   * @tparam kPinB The pin number of the encoder's B phase, must match the one given at construction.
+   * @tparam kDirection The counting direction, 1 if phase A leads, -1 if phase B leads.
+   */
+  template <uint8_t kPinA, uint8_t kPinB, int8_t kDirection>
+  void DecodeEncoderEdge() {
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+    const LatencyProbe::Scope latency_scope(encoder_isr_latency_, hal_);
+#endif
+    const int8_t step = decoder_.Update(hal_.DigitalRead(kPinA), hal_.DigitalRead(kPinB));
+    CountEncoderStep(kDirection > 0 ? step : -step);
+  }
+
  private:
-  static void OnPinAFalling(void* self);
+  friend class MotorGroup;
+
+  static void OnEncoderEdge(void* self);
+
+  void OnEncoderEdge();
+
+  void CountEncoderStep(const int8_t step) {
+    if (step != 0) {
+      edge_timestamps_.Push(hal_.Micros(), pulse_count_.fetch_add(step) + step);
+    }
+  }
+
+  void Sample(const int64_t now_us) override;
+
+  void Control(const int64_t now_us) override;
+
+  void UpdateRpm(const int64_t now_us);
+
+  // Completion callbacks taken out under mutex_ and invoked after releasing it, so that they may issue new commands.
+  struct PendingCallbacks {
+    PositionCallback position;
+    bool position_reached = false;
+    AutoTuneCallback auto_tune;
+    SpeedAutoTuner::Result auto_tune_result;
+
+    void Invoke() const;
+  };
+
+  PendingCallbacks StartPosition(const int64_t position, PositionCallback callback);
+
+  PendingCallbacks StartPwmDuty(const int16_t duty);
+
+  PendingCallbacks StartSpeed(const int16_t speed_rpm);
 
-  void OnPinAFalling();
+  PendingCallbacks StopOutput();
 
-  void UpdateRpm();
+  PendingCallbacks StartStream(const SetpointType type, const int64_t now_us);
+
+  void DiscardQueuedCommands();
+
+  void ProcessCommandQueue(const int64_t now_us, PendingCallbacks& cancelled);
+
+  void StreamControl(const int64_t now_us);
+
+  PendingCallbacks CancelCommand();
+
+  void FinishAutoTune();
+
+  bool PositionControl(const int64_t now_us);
+
+  void TrackPosition(const double position, const double velocity);
 
   void Driving();
 
-  void DeleteThread(std::thread*& thread);
+  void PublishSnapshot();
+
+  void DeferOutput(const bool defer);
+
+  void DetachEncoder();
+
+  // The published state, converted into a Snapshot by the reader, keeps the speed and the integral as ControlNumber so
+  // that publishing needs no floating point with the fixed-point path.
+  struct PublishedState {
+    int64_t time_us = 0;
+    int64_t pulse_count = 0;
+    ControlNumber speed_rpm = ControlNumber();
+    float acceleration_rpm_per_s = 0;
+    ControlNumber pid_integral = ControlNumber();
+    int32_t target_rpm = 0;
+    int32_t setpoint_rpm = 0;
+    int16_t pwm_duty = 0;
+    int64_t target_position = 0;
+    bool position_reached = false;
+  };
+
+  enum ControlMode : uint8_t {
+    kPwmControl,
+    kSpeedControl,
+    kPositionControl,
+    kAutoTuneControl,
+    kStreamControl,
+  };
+
+  enum QueuedCommandType : uint8_t {
+    kQueuedPwmDuty,
+    kQueuedSpeed,
+    kQueuedStop,
+    kQueuedSpeedSetpoint,
+    kQueuedPositionSetpoint,
+  };
 
-  struct Pid {
-    float p = 0.0;
-    float i = 0.0;
-    float d = 0.0;
-    float integral = 0.0;
-    float max_integral = 0.0;
+  struct QueuedCommand {
+    QueuedCommandType type = kQueuedStop;
+    int64_t time_us = 0;
+    double value = 0;
+    uint32_t generation = 0;
   };
 
+  Hal& hal_;
   mutable std::mutex mutex_;
-  std::condition_variable condition_;
-  std::thread* update_rpm_thread_ = nullptr;
-  std::thread* driving_thread_ = nullptr;
+  ControlScheduler* scheduler_ = nullptr;
   EspMotor motor_driver_;
   const uint8_t pin_a_ = 0;
   const uint8_t pin_b_ = 0;
-  const double total_ppr_ = 0;
-  const uint8_t b_level_at_a_falling_edge_ = 0;
-  Pid rpm_pid_;
+  const uint32_t total_ppr_ = 0;
+  const int8_t direction_ = 1;
+  const Hal::InterruptHandler encoder_isr_ = nullptr;
+  EncoderBackend encoder_backend_ = kGpioInterrupt;
+  uint32_t glitch_filter_ns_ = kDefaultGlitchFilterNs;
+  QuadratureDecoder decoder_;
+  // Converts encoder counts per second into RPM for the decoding mode, computed once instead of every tick.
+  float rpm_per_count_per_s_ = 0;
+  SpeedController<ControlNumber> speed_controller_;
   int64_t previous_pulse_count_ = 0;
   std::atomic<int64_t> pulse_count_ = 0;
-  std::chrono::system_clock::time_point last_update_speed_time_ = std::chrono::time_point<std::chrono::system_clock>::min();
-  int32_t speed_rpm_ = 0;
+  int64_t last_update_speed_time_us_ = 0;
+  int64_t sample_period_us_ = 0;
+  EdgeTimestampBuffer edge_timestamps_;
+  SpeedEstimator<ControlNumber> speed_estimator_;
+  ControlNumber speed_rpm_ = ControlNumber();
+  ControlNumber previous_speed_rpm_ = ControlNumber();
+  MotionObserver* motion_observer_ = nullptr;
+  float acceleration_rpm_per_s_ = 0;
   int32_t target_speed_rpm_ = 0.0;
-  bool drive_ = false;
+  SpeedRamp speed_ramp_;
+  int32_t setpoint_rpm_ = 0;
+  Feedforward feedforward_;
+  FeedforwardEstimator feedforward_estimator_;
+  bool learning_feedforward_ = false;
+  ControlMode control_mode_ = kPwmControl;
+  PidController<float> position_pid_;
+  MotionProfile::Limits motion_limits_;
+  MotionProfile profile_;
+  int64_t profile_start_time_us_ = 0;
+  int64_t target_position_ = 0;
+  bool position_reached_ = false;
+  PositionCallback position_callback_;
+  SpscQueue<QueuedCommand, kCommandQueueCapacity> command_queue_;
+  // Bumped by the locking commands, queued commands of an older generation are dropped by the control loop.
+  std::atomic<uint32_t> command_generation_ = 0;
+  SetpointType stream_type_ = kSpeedSetpoint;
+  Setpoint stream_previous_;
+  SpeedAutoTuner auto_tuner_;
+  AutoTuneCallback auto_tune_callback_;
+  Seqlock<PublishedState> snapshot_;
+  TelemetryRecorder* telemetry_recorder_ = nullptr;
+#if EM_ESP_ENCODER_MOTOR_PROFILING
+  LatencyProbe encoder_isr_latency_;
+  LatencyProbe update_rpm_latency_;
+  LatencyProbe driving_latency_;
+#endif
 };
 }  // namespace em
 
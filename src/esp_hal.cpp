@@ -0,0 +1,489 @@
+/**
+ * @file esp_hal.cpp
+ */
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include "esp_hal.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include "driver/gpio.h"
+
+namespace em {
+
+namespace {
+#if SOC_PCNT_SUPPORTED
+// The hardware counter is cleared when it reaches a limit, the driver then accumulates the limit value (accum_count).
+constexpr int kPulseCounterLimit = 30000;
+#endif
+
+#if SOC_MCPWM_SUPPORTED
+// The MCPWM group clock with the default prescaler, the timers divide it further so that the period fits in 16 bits.
+constexpr uint32_t kMcpwmGroupResolutionHz = 80000000;
+constexpr uint32_t kMcpwmMaxPeriodTicks = 65535;
+#endif
+}  // namespace
+
+bool EspHal::PwmAttach(const uint8_t pin, const uint32_t frequency, const uint8_t resolution) {
+  return ledcAttach(pin, frequency, resolution);
+}
+
+void EspHal::PwmWrite(const uint8_t pin, const uint32_t duty) {
+  ledcWrite(pin, duty);
+}
+
+#if SOC_MCPWM_SUPPORTED
+bool EspHal::PwmBridgeAttach(const uint8_t pin_positive,
+                             const uint8_t pin_negative,
+                             const uint32_t frequency,
+                             const uint8_t resolution) {
+  if (frequency == 0 || resolution == 0 || FindPwmBridge(pin_positive) != nullptr) {
+    return false;
+  }
+
+  PwmBridge* bridge = FindPwmBridge(0xFF);
+  if (bridge == nullptr) {
+    return false;
+  }
+
+  // Prefer a group that already runs a timer at this frequency, so that the bridges share its period boundary.
+  int groups[SOC_MCPWM_GROUPS];
+  for (int group = 0; group < SOC_MCPWM_GROUPS; ++group) {
+    groups[group] = group;
+  }
+  std::stable_sort(groups, groups + SOC_MCPWM_GROUPS, [this, frequency](const int lhs, const int rhs) {
+    const auto shares = [this, frequency](const int group) {
+      return std::any_of(std::begin(pwm_timers_), std::end(pwm_timers_), [group, frequency](const PwmTimer& timer) {
+        return timer.handle != nullptr && timer.group == group && timer.frequency == frequency;
+      });
+    };
+    return shares(lhs) && !shares(rhs);
+  });
+
+  for (const int group : groups) {
+    PwmTimer* const timer = AcquirePwmTimer(group, frequency);
+    if (timer == nullptr) {
+      continue;
+    }
+
+    mcpwm_operator_config_t operator_config = {};
+    operator_config.group_id = group;
+    if (mcpwm_new_operator(&operator_config, &bridge->oper) != ESP_OK) {
+      // The group's operators are all in use.
+      bridge->oper = nullptr;
+      bridge->timer = timer;
+      ReleasePwmBridge(*bridge);
+      continue;
+    }
+
+    bridge->timer = timer;
+    bridge->pin_positive = pin_positive;
+    bridge->max_duty = (1u << resolution) - 1;
+    bool ok = mcpwm_operator_connect_timer(bridge->oper, timer->handle) == ESP_OK;
+    const uint8_t pins[2] = {pin_positive, pin_negative};
+    for (size_t i = 0; i < 2; ++i) {
+      // The compare values are shadowed and load when the timer wraps to zero, so both legs change at the same boundary.
+      mcpwm_comparator_config_t comparator_config = {};
+      comparator_config.flags.update_cmp_on_tez = true;
+      ok = ok && mcpwm_new_comparator(bridge->oper, &comparator_config, &bridge->comparators[i]) == ESP_OK;
+      ok = ok && mcpwm_comparator_set_compare_value(bridge->comparators[i], 0) == ESP_OK;
+
+      mcpwm_generator_config_t generator_config = {};
+      generator_config.gen_gpio_num = pins[i];
+      ok = ok && mcpwm_new_generator(bridge->oper, &generator_config, &bridge->generators[i]) == ESP_OK;
+      // High from the start of the period until the compare value. The compare event wins over the timer event, so a
+      // compare value of 0 keeps the output low, and a compare value of the period is never reached and keeps it high.
+      ok = ok && mcpwm_generator_set_action_on_timer_event(
+                     bridge->generators[i],
+                     MCPWM_GEN_TIMER_EVENT_ACTION(
+                         MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH)) == ESP_OK;
+      ok = ok && mcpwm_generator_set_action_on_compare_event(
+                     bridge->generators[i],
+                     MCPWM_GEN_COMPARE_EVENT_ACTION(
+                         MCPWM_TIMER_DIRECTION_UP, bridge->comparators[i], MCPWM_GEN_ACTION_LOW)) == ESP_OK;
+    }
+
+    if (!ok) {
+      ReleasePwmBridge(*bridge);
+    }
+    return ok;
+  }
+  return false;
+}
+
+void EspHal::PwmBridgeWrite(const uint8_t pin_positive, const uint32_t duty_positive, const uint32_t duty_negative) {
+  PwmBridge* const bridge = FindPwmBridge(pin_positive);
+  if (bridge == nullptr) {
+    return;
+  }
+
+  const uint32_t duties[2] = {duty_positive, duty_negative};
+  uint32_t ticks[2] = {};
+  for (size_t i = 0; i < 2; ++i) {
+    ticks[i] = static_cast<uint64_t>(std::min(duties[i], bridge->max_duty)) * bridge->timer->period_ticks /
+               bridge->max_duty;
+  }
+  // Both shadow registers are written back to back without being preempted, so the timer practically never wraps
+  // between them.
+  portENTER_CRITICAL(&pwm_bridge_lock_);
+  mcpwm_comparator_set_compare_value(bridge->comparators[0], ticks[0]);
+  mcpwm_comparator_set_compare_value(bridge->comparators[1], ticks[1]);
+  portEXIT_CRITICAL(&pwm_bridge_lock_);
+}
+
+void EspHal::PwmBridgeDetach(const uint8_t pin_positive) {
+  PwmBridge* const bridge = FindPwmBridge(pin_positive);
+  if (bridge != nullptr) {
+    ReleasePwmBridge(*bridge);
+  }
+}
+
+EspHal::PwmTimer* EspHal::AcquirePwmTimer(const int group, const uint32_t frequency) {
+  PwmTimer* free_timer = nullptr;
+  for (auto& timer : pwm_timers_) {
+    if (timer.handle != nullptr && timer.group == group && timer.frequency == frequency) {
+      ++timer.users;
+      return &timer;
+    }
+    if (timer.handle == nullptr && free_timer == nullptr) {
+      free_timer = &timer;
+    }
+  }
+  if (free_timer == nullptr) {
+    return nullptr;
+  }
+
+  const uint32_t prescale = std::max<uint32_t>((kMcpwmGroupResolutionHz / frequency + kMcpwmMaxPeriodTicks - 1) /
+                                                   kMcpwmMaxPeriodTicks,
+                                               1);
+  const uint32_t resolution_hz = kMcpwmGroupResolutionHz / prescale;
+  const uint32_t period_ticks = resolution_hz / frequency;
+  if (period_ticks < 2) {
+    return nullptr;
+  }
+
+  mcpwm_timer_config_t timer_config = {};
+  timer_config.group_id = group;
+  timer_config.clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT;
+  timer_config.resolution_hz = resolution_hz;
+  timer_config.count_mode = MCPWM_TIMER_COUNT_MODE_UP;
+  timer_config.period_ticks = period_ticks;
+  if (mcpwm_new_timer(&timer_config, &free_timer->handle) != ESP_OK) {
+    free_timer->handle = nullptr;
+    return nullptr;
+  }
+
+  if (mcpwm_timer_enable(free_timer->handle) != ESP_OK ||
+      mcpwm_timer_start_stop(free_timer->handle, MCPWM_TIMER_START_NO_STOP) != ESP_OK) {
+    mcpwm_del_timer(free_timer->handle);
+    free_timer->handle = nullptr;
+    return nullptr;
+  }
+
+  free_timer->group = group;
+  free_timer->frequency = frequency;
+  free_timer->period_ticks = period_ticks;
+  free_timer->users = 1;
+  return free_timer;
+}
+
+EspHal::PwmBridge* EspHal::FindPwmBridge(const uint8_t pin_positive) {
+  for (auto& bridge : pwm_bridges_) {
+    if (bridge.pin_positive == pin_positive && (pin_positive != 0xFF || bridge.timer == nullptr)) {
+      return &bridge;
+    }
+  }
+  return nullptr;
+}
+
+void EspHal::ReleasePwmBridge(PwmBridge& bridge) {
+  for (size_t i = 0; i < 2; ++i) {
+    if (bridge.generators[i] != nullptr) {
+      mcpwm_del_generator(bridge.generators[i]);
+      bridge.generators[i] = nullptr;
+    }
+    if (bridge.comparators[i] != nullptr) {
+      mcpwm_del_comparator(bridge.comparators[i]);
+      bridge.comparators[i] = nullptr;
+    }
+  }
+  if (bridge.oper != nullptr) {
+    mcpwm_del_operator(bridge.oper);
+    bridge.oper = nullptr;
+  }
+
+  PwmTimer* const timer = bridge.timer;
+  if (timer != nullptr && --timer->users == 0) {
+    mcpwm_timer_start_stop(timer->handle, MCPWM_TIMER_STOP_EMPTY);
+    mcpwm_timer_disable(timer->handle);
+    mcpwm_del_timer(timer->handle);
+    timer->handle = nullptr;
+  }
+  bridge.timer = nullptr;
+  bridge.pin_positive = 0xFF;
+}
+#else
+bool EspHal::PwmBridgeAttach(const uint8_t, const uint8_t, const uint32_t, const uint8_t) {
+  return false;
+}
+
+void EspHal::PwmBridgeWrite(const uint8_t, const uint32_t, const uint32_t) {
+}
+
+void EspHal::PwmBridgeDetach(const uint8_t) {
+}
+#endif
+
+void EspHal::InputPullUp(const uint8_t pin) {
+  pinMode(pin, INPUT_PULLUP);
+}
+
+uint8_t EspHal::DigitalRead(const uint8_t pin) {
+  return gpio_get_level(static_cast<gpio_num_t>(pin));
+}
+
+void EspHal::AttachInterrupt(const uint8_t pin, const InterruptHandler handler, void* arg, const InterruptMode mode) {
+  switch (mode) {
+    case kRising:
+      attachInterruptArg(pin, handler, arg, RISING);
+      break;
+    case kFalling:
+      attachInterruptArg(pin, handler, arg, FALLING);
+      break;
+    default:
+      attachInterruptArg(pin, handler, arg, CHANGE);
+      break;
+  }
+}
+
+void EspHal::DetachInterrupt(const uint8_t pin) {
+  detachInterrupt(pin);
+}
+
+#if SOC_PCNT_SUPPORTED
+bool EspHal::PulseCounterAttach(const uint8_t pin_a,
+                                const uint8_t pin_b,
+                                const QuadratureDecoder::Mode mode,
+                                const uint32_t glitch_filter_ns) {
+  if (FindPulseCounter(pin_a) != nullptr) {
+    return false;
+  }
+
+  PulseCounter* counter = nullptr;
+  for (auto& candidate : pulse_counters_) {
+    if (candidate.unit == nullptr) {
+      counter = &candidate;
+      break;
+    }
+  }
+
+  if (counter == nullptr) {
+    return false;
+  }
+
+  pcnt_unit_config_t unit_config = {};
+  unit_config.low_limit = -kPulseCounterLimit;
+  unit_config.high_limit = kPulseCounterLimit;
+  // The driver adds the limit and reads the count under one spinlock, also while a limit event is still pending, so a
+  // read never sees the cleared hardware counter without its accumulated part.
+  unit_config.flags.accum_count = true;
+  if (pcnt_new_unit(&unit_config, &counter->unit) != ESP_OK) {
+    counter->unit = nullptr;
+    return false;
+  }
+
+  counter->pin_a = pin_a;
+  counter->last_count = 0;
+  counter->count = 0;
+
+  bool ok = true;
+  if (glitch_filter_ns > 0) {
+    pcnt_glitch_filter_config_t filter_config = {};
+    filter_config.max_glitch_ns = glitch_filter_ns;
+    ok = ok && pcnt_unit_set_glitch_filter(counter->unit, &filter_config) == ESP_OK;
+  }
+
+  // Channel A counts the edges of A with B as direction level: x1 only counts falling edges, x2 and x4 count both.
+  pcnt_chan_config_t channel_a_config = {};
+  channel_a_config.edge_gpio_num = pin_a;
+  channel_a_config.level_gpio_num = pin_b;
+  ok = ok && pcnt_new_channel(counter->unit, &channel_a_config, &counter->channel_a) == ESP_OK;
+  ok = ok && pcnt_channel_set_edge_action(counter->channel_a,
+                                          mode == QuadratureDecoder::kX1 ? PCNT_CHANNEL_EDGE_ACTION_HOLD
+                                                                         : PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+                                          PCNT_CHANNEL_EDGE_ACTION_INCREASE) == ESP_OK;
+  ok = ok &&
+       pcnt_channel_set_level_action(counter->channel_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE) ==
+           ESP_OK;
+
+  // Channel B is only used for x4 and counts the edges of B with A as direction level.
+  if (mode == QuadratureDecoder::kX4) {
+    pcnt_chan_config_t channel_b_config = {};
+    channel_b_config.edge_gpio_num = pin_b;
+    channel_b_config.level_gpio_num = pin_a;
+    ok = ok && pcnt_new_channel(counter->unit, &channel_b_config, &counter->channel_b) == ESP_OK;
+    ok = ok &&
+         pcnt_channel_set_edge_action(
+             counter->channel_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE) == ESP_OK;
+    ok = ok && pcnt_channel_set_level_action(
+                   counter->channel_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE) == ESP_OK;
+  }
+
+  // accum_count needs the limits as watch points to catch the clears.
+  ok = ok && pcnt_unit_add_watch_point(counter->unit, kPulseCounterLimit) == ESP_OK;
+  ok = ok && pcnt_unit_add_watch_point(counter->unit, -kPulseCounterLimit) == ESP_OK;
+
+  ok = ok && pcnt_unit_enable(counter->unit) == ESP_OK;
+  ok = ok && pcnt_unit_clear_count(counter->unit) == ESP_OK;
+  ok = ok && pcnt_unit_start(counter->unit) == ESP_OK;
+
+  if (!ok) {
+    ReleasePulseCounter(*counter);
+  }
+  return ok;
+}
+
+void EspHal::PulseCounterDetach(const uint8_t pin_a) {
+  PulseCounter* const counter = FindPulseCounter(pin_a);
+  if (counter != nullptr) {
+    ReleasePulseCounter(*counter);
+  }
+}
+
+int64_t EspHal::PulseCounterRead(const uint8_t pin_a) {
+  PulseCounter* const counter = FindPulseCounter(pin_a);
+  if (counter == nullptr) {
+    return 0;
+  }
+
+  portENTER_CRITICAL(&counter->lock);
+  int count = 0;
+  if (pcnt_unit_get_count(counter->unit, &count) == ESP_OK) {
+    // Wrapping 32-bit difference, correct as long as reads are less than 2^31 counts apart.
+    counter->count += static_cast<int32_t>(static_cast<uint32_t>(count) - static_cast<uint32_t>(counter->last_count));
+    counter->last_count = count;
+  }
+  const int64_t result = counter->count;
+  portEXIT_CRITICAL(&counter->lock);
+  return result;
+}
+
+EspHal::PulseCounter* EspHal::FindPulseCounter(const uint8_t pin_a) {
+  for (auto& counter : pulse_counters_) {
+    if (counter.unit != nullptr && counter.pin_a == pin_a) {
+      return &counter;
+    }
+  }
+  return nullptr;
+}
+
+void EspHal::ReleasePulseCounter(PulseCounter& counter) {
+  pcnt_unit_stop(counter.unit);
+  pcnt_unit_disable(counter.unit);
+  if (counter.channel_a != nullptr) {
+    pcnt_del_channel(counter.channel_a);
+    counter.channel_a = nullptr;
+  }
+  if (counter.channel_b != nullptr) {
+    pcnt_del_channel(counter.channel_b);
+    counter.channel_b = nullptr;
+  }
+  pcnt_del_unit(counter.unit);
+  counter.unit = nullptr;
+  counter.pin_a = 0xFF;
+}
+#else
+bool EspHal::PulseCounterAttach(const uint8_t, const uint8_t, const QuadratureDecoder::Mode, const uint32_t) {
+  return false;
+}
+
+void EspHal::PulseCounterDetach(const uint8_t) {
+}
+
+int64_t EspHal::PulseCounterRead(const uint8_t) {
+  return 0;
+}
+#endif
+
+bool EspHal::TimerAttach(const uint32_t period_us, const InterruptHandler handler, void* arg) {
+  Timer* timer = FindTimer(arg);
+  if (timer != nullptr) {
+    esp_timer_stop(timer->handle);
+    return esp_timer_start_periodic(timer->handle, period_us) == ESP_OK;
+  }
+
+  timer = FindTimer(nullptr);
+  if (timer == nullptr) {
+    return false;
+  }
+
+  // ISR dispatch calls the handler straight from the timer interrupt, without the detour through the esp_timer task and
+  // the other callbacks queued there.
+  esp_timer_create_args_t args = {};
+  args.callback = handler;
+  args.arg = arg;
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+  args.dispatch_method = ESP_TIMER_ISR;
+#else
+  args.dispatch_method = ESP_TIMER_TASK;
+#endif
+  args.name = "em_control";
+  args.skip_unhandled_events = true;
+  if (esp_timer_create(&args, &timer->handle) != ESP_OK) {
+    timer->handle = nullptr;
+    return false;
+  }
+
+  if (esp_timer_start_periodic(timer->handle, period_us) != ESP_OK) {
+    esp_timer_delete(timer->handle);
+    timer->handle = nullptr;
+    return false;
+  }
+  timer->arg = arg;
+  return true;
+}
+
+void EspHal::TimerDetach(void* arg) {
+  Timer* const timer = FindTimer(arg);
+  if (timer == nullptr) {
+    return;
+  }
+
+  esp_timer_stop(timer->handle);
+  esp_timer_delete(timer->handle);
+  timer->handle = nullptr;
+  timer->arg = nullptr;
+}
+
+EspHal::Timer* EspHal::FindTimer(void* arg) {
+  for (auto& timer : timers_) {
+    if (timer.arg == arg && (arg != nullptr || timer.handle == nullptr)) {
+      return &timer;
+    }
+  }
+  return nullptr;
+}
+
+int64_t EspHal::Micros() {
+  return esp_timer_get_time();
+}
+
+uint32_t EspHal::CycleCount() {
+  return ESP.getCycleCount();
+}
+
+uint32_t EspHal::CyclesPerMicrosecond() {
+  return getCpuFrequencyMhz();
+}
+
+Hal& DefaultHal() {
+  static EspHal hal;
+  return hal;
+}
+
+}  // namespace em
+
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef _EM_ESP_HAL_H_
+#define _EM_ESP_HAL_H_
+
+/**
+ * @file esp_hal.h
+ */
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include <cstddef>
+
+#include "esp_timer.h"
+#include "hal.h"
+#include "soc/soc_caps.h"
+
+#if SOC_PCNT_SUPPORTED
+#include "driver/pulse_cnt.h"
+#include "freertos/FreeRTOS.h"
+#endif
+
+#if SOC_MCPWM_SUPPORTED
+#include "driver/mcpwm_prelude.h"
+#include "freertos/FreeRTOS.h"
+#endif
+
+namespace em {
+/**
+ * @~Chinese
+ * @class EspHal
+ * @brief 基于ESP32 Arduino API（LEDC、GPIO中断、esp_timer）的硬件抽象层实现。
+ */
+/**
+ * @~English
+ * @class EspHal
+ * @brief Hardware abstraction layer implementation based on the ESP32 Arduino API (LEDC, GPIO interrupts, esp_timer).
+ */
+class EspHal : public Hal {
+ public:
+  bool PwmAttach(const uint8_t pin, const uint32_t frequency, const uint8_t resolution) override;
+
+  void PwmWrite(const uint8_t pin, const uint32_t duty) override;
+
+  bool PwmBridgeAttach(const uint8_t pin_positive,
+                       const uint8_t pin_negative,
+                       const uint32_t frequency,
+                       const uint8_t resolution) override;
+
+  void PwmBridgeWrite(const uint8_t pin_positive, const uint32_t duty_positive, const uint32_t duty_negative) override;
+
+  void PwmBridgeDetach(const uint8_t pin_positive) override;
+
+  void InputPullUp(const uint8_t pin) override;
+
+  uint8_t DigitalRead(const uint8_t pin) override;
+
+  void AttachInterrupt(const uint8_t pin, const InterruptHandler handler, void* arg, const InterruptMode mode) override;
+
+  void DetachInterrupt(const uint8_t pin) override;
+
+  bool PulseCounterAttach(const uint8_t pin_a,
+                          const uint8_t pin_b,
+                          const QuadratureDecoder::Mode mode,
+                          const uint32_t glitch_filter_ns) override;
+
+  void PulseCounterDetach(const uint8_t pin_a) override;
+
+  int64_t PulseCounterRead(const uint8_t pin_a) override;
+
+  bool TimerAttach(const uint32_t period_us, const InterruptHandler handler, void* arg) override;
+
+  void TimerDetach(void* arg) override;
+
+  int64_t Micros() override;
+
+  uint32_t CycleCount() override;
+
+  uint32_t CyclesPerMicrosecond() override;
+
+ private:
+  static constexpr size_t kMaxTimers = 4;
+
+  struct Timer {
+    esp_timer_handle_t handle = nullptr;
+    void* arg = nullptr;
+  };
+
+  Timer* FindTimer(void* arg);
+
+  Timer timers_[kMaxTimers];
+
+#if SOC_MCPWM_SUPPORTED
+  struct PwmTimer {
+    mcpwm_timer_handle_t handle = nullptr;
+    int group = 0;
+    uint32_t frequency = 0;
+    uint32_t period_ticks = 0;
+    uint8_t users = 0;
+  };
+
+  struct PwmBridge {
+    mcpwm_oper_handle_t oper = nullptr;
+    mcpwm_cmpr_handle_t comparators[2] = {};
+    mcpwm_gen_handle_t generators[2] = {};
+    PwmTimer* timer = nullptr;
+    uint32_t max_duty = 0;
+    uint8_t pin_positive = 0xFF;
+  };
+
+  PwmTimer* AcquirePwmTimer(const int group, const uint32_t frequency);
+
+  PwmBridge* FindPwmBridge(const uint8_t pin_positive);
+
+  void ReleasePwmBridge(PwmBridge& bridge);
+
+  PwmTimer pwm_timers_[SOC_MCPWM_GROUPS * SOC_MCPWM_TIMERS_PER_GROUP];
+  PwmBridge pwm_bridges_[SOC_MCPWM_GROUPS * SOC_MCPWM_OPERATORS_PER_GROUP];
+  portMUX_TYPE pwm_bridge_lock_ = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+#if SOC_PCNT_SUPPORTED
+  struct PulseCounter {
+    pcnt_unit_handle_t unit = nullptr;
+    pcnt_channel_handle_t channel_a = nullptr;
+    pcnt_channel_handle_t channel_b = nullptr;
+    uint8_t pin_a = 0xFF;
+    // The driver accumulates the hardware count in an int, extended here to 64 bits from the change between reads.
+    int last_count = 0;
+    int64_t count = 0;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+  };
+
+  PulseCounter* FindPulseCounter(const uint8_t pin_a);
+
+  void ReleasePulseCounter(PulseCounter& counter);
+
+  PulseCounter pulse_counters_[SOC_PCNT_GROUPS * SOC_PCNT_UNITS_PER_GROUP];
+#endif
+};
+}  // namespace em
+
+#endif
+
+#endif
@@ -4,28 +4,64 @@
 
 #include "esp_motor.h"
 
-#include <Arduino.h>
+#include <algorithm>
 
 namespace em {
 
-EspMotor::EspMotor(const uint8_t pos_pin, const uint8_t neg_pin) : positive_pin_(pos_pin), negative_pin_(neg_pin) {
+namespace {
+constexpr uint8_t kMinPwmResolution = 2;
+constexpr uint8_t kMaxPwmResolution = 16;
+}  // namespace
+
+EspMotor::EspMotor(const uint8_t pos_pin, const uint8_t neg_pin, Hal& hal)
+    : hal_(hal), positive_pin_(pos_pin), negative_pin_(neg_pin) {
+}
+
+EspMotor::~EspMotor() {
+  if (initialized_ && pwm_backend_ == kMcpwm) {
+    hal_.PwmBridgeDetach(positive_pin_);
+  }
 }
 
 void EspMotor::Init() {
-  ledcAttach(positive_pin_, kPwmFrequency, kPwmResolution);
-  ledcAttach(negative_pin_, kPwmFrequency, kPwmResolution);
+  if (initialized_) {
+    return;
+  }
+
+  if (pwm_backend_ == kMcpwm &&
+      !hal_.PwmBridgeAttach(positive_pin_, negative_pin_, pwm_frequency_, pwm_resolution_)) {
+    pwm_backend_ = kLedc;
+  }
+  if (pwm_backend_ == kLedc) {
+    hal_.PwmAttach(positive_pin_, pwm_frequency_, pwm_resolution_);
+    hal_.PwmAttach(negative_pin_, pwm_frequency_, pwm_resolution_);
+  }
+  initialized_ = true;
   Stop();
 }
 
-void EspMotor::PwmDuty(const int16_t pwm_duty) {
-  pwm_duty_ = constrain(pwm_duty, -kMaxPwmDuty, kMaxPwmDuty);
-  if (pwm_duty_ >= 0) {
-    ledcWrite(positive_pin_, pwm_duty_);
-    ledcWrite(negative_pin_, 0);
-  } else {
-    ledcWrite(positive_pin_, 0);
-    ledcWrite(negative_pin_, -pwm_duty_);
+void EspMotor::SetPwmBackend(const PwmBackend backend, const uint32_t frequency, const uint8_t resolution) {
+  if (initialized_) {
+    return;
   }
+
+  pwm_backend_ = backend;
+  pwm_frequency_ = frequency;
+  pwm_resolution_ = std::clamp(resolution, kMinPwmResolution, kMaxPwmResolution);
+}
+
+EspMotor::PwmBackend EspMotor::ActivePwmBackend() const {
+  return pwm_backend_;
+}
+
+void EspMotor::SetStopMode(const StopMode mode) {
+  stop_mode_ = mode;
+}
+
+void EspMotor::PwmDuty(const int16_t pwm_duty) {
+  pwm_duty_ = std::clamp<int16_t>(pwm_duty, -kMaxPwmDuty, kMaxPwmDuty);
+  stopped_ = false;
+  Output();
 }
 
 int16_t EspMotor::PwmDuty() const {
@@ -34,8 +70,56 @@ int16_t EspMotor::PwmDuty() const {
 
 void EspMotor::Stop() {
   pwm_duty_ = 0;
-  ledcWrite(positive_pin_, kMaxPwmDuty);
-  ledcWrite(negative_pin_, kMaxPwmDuty);
+  stopped_ = true;
+  Output();
+}
+
+void EspMotor::DeferOutput(const bool defer) {
+  output_deferred_ = defer;
+  if (!defer && output_pending_) {
+    Output();
+  }
+}
+
+void EspMotor::Output() {
+  if (output_deferred_) {
+    output_pending_ = true;
+    return;
+  }
+  output_pending_ = false;
+
+  uint32_t positive_duty = 0;
+  uint32_t negative_duty = 0;
+  if (stopped_) {
+    if (stop_mode_ == kBrake) {
+      positive_duty = HardwareDuty(kMaxPwmDuty);
+      negative_duty = positive_duty;
+    }
+  } else if (pwm_duty_ >= 0) {
+    positive_duty = HardwareDuty(pwm_duty_);
+  } else {
+    negative_duty = HardwareDuty(-pwm_duty_);
+  }
+
+  if (pwm_backend_ == kMcpwm) {
+    if (positive_duty != written_positive_duty_ || negative_duty != written_negative_duty_) {
+      hal_.PwmBridgeWrite(positive_pin_, positive_duty, negative_duty);
+    }
+  } else {
+    if (positive_duty != written_positive_duty_) {
+      hal_.PwmWrite(positive_pin_, positive_duty);
+    }
+    if (negative_duty != written_negative_duty_) {
+      hal_.PwmWrite(negative_pin_, negative_duty);
+    }
+  }
+  written_positive_duty_ = positive_duty;
+  written_negative_duty_ = negative_duty;
+}
+
+uint32_t EspMotor::HardwareDuty(const int16_t pwm_duty) const {
+  const uint32_t max_duty = (1u << pwm_resolution_) - 1;
+  return (static_cast<uint32_t>(pwm_duty) * max_duty + kMaxPwmDuty / 2) / kMaxPwmDuty;
 }
 
-}  // namespace em
\ No newline at end of file
+}  // namespace em
@@ -7,11 +7,10 @@
  * @file esp_motor.h
  */
 
-#include <WString.h>
-
-#include <cmath>
 #include <cstdint>
 
+#include "hal.h"
+
 namespace em {
 /**
  * @~Chinese
@@ -27,53 +26,119 @@ class EspMotor {
  public:
   /**
    * @~Chinese
-   * @brief PWM的分辨率，决定了PWM占空比可调节的精细程度，单位为位，这里设置为10位。
-   * /
+   * @brief 默认的PWM分辨率，单位为位。
+   */
   /**
    * @~English
-   * @brief The resolution of PWM, which determines the fine-tuning level of the PWM duty cycle, in bits. Here it is set to 10
-   * bits.
+   * @brief The default PWM resolution in bits.
    */
   static constexpr uint8_t kPwmResolution = 10;
+
   /**
    * @~Chinese
-   * @brief PWM的频率，单位为赫兹，这里设置为75000赫兹，用于控制电机驱动的PWM信号频率。
+   * @brief 默认的PWM频率，单位为赫兹，高于人耳可听范围。
+   */
+  /**
    * @~English
-   * @brief The frequency of PWM, in Hertz. Here it is set to 75000 Hz, used to control the frequency of the PWM signal for
-   * motor driving.
+   * @brief The default PWM frequency in Hz, above the audible range.
    */
-  static constexpr uint8_t kPwmFrequency = 75000;
+  static constexpr uint32_t kPwmFrequency = 75000;
 
   static_assert(kPwmResolution > 1);
+
   /**
    * @~Chinese
-   * @brief 根据PWM分辨率计算出的最大PWM占空比数值，通过公式 \(2^{PWM分辨率} - 1\) 得出。
+   * @brief 最大PWM占空比，即 2^@ref kPwmResolution - 1。@ref PwmDuty 的取值范围与配置的分辨率无关，始终为
+   * -kMaxPwmDuty到kMaxPwmDuty，输出时换算到实际的分辨率。
+   */
+  /**
    * @~English
-   * @brief The maximum PWM duty cycle value calculated based on the PWM resolution, obtained by the formula \(2^{PWM分辨率} -
-   * 1\).
-   */  /**
+   * @brief The maximum PWM duty, 2^@ref kPwmResolution - 1. The range of @ref PwmDuty is always -kMaxPwmDuty to
+   * kMaxPwmDuty regardless of the configured resolution, it is scaled to the actual resolution on output.
+   */
+  static constexpr int16_t kMaxPwmDuty = (1 << kPwmResolution) - 1;
+
+  /**
    * @~Chinese
-   * @brief 根据PWM分辨率计算出的最大PWM占空比数值，通过公式 \(2^{PWM分辨率} - 1\) 得出。
+   * @brief PWM输出方式。
+   */
+  /**
    * @~English
-   * @brief The maximum PWM duty cycle value calculated based on the PWM resolution, obtained by the formula \(2^{PWM分辨率} - 1\).
+   * @brief PWM output backend.
    */
-  static constexpr int16_t kMaxPwmDuty = pow(2, kPwmResolution) - 1;
+  enum PwmBackend : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 每个桥臂使用一个独立的LEDC通道（@ref Hal::PwmAttach），两个桥臂依次更新。
+     */
+    /**
+     * @~English
+     * @brief One independent LEDC channel per leg (@ref Hal::PwmAttach), the two legs are updated one after the other.
+     */
+    kLedc,
+
+    /**
+     * @~Chinese
+     * @brief 两个桥臂使用同一个MCPWM操作器（@ref Hal::PwmBridgeAttach），通过影子寄存器在同一个PWM周期边界更新，
+     * 频率和分辨率相同的电机共用定时器，更新也在同一个周期边界生效。
+     */
+    /**
+     * @~English
+     * @brief Both legs on one MCPWM operator (@ref Hal::PwmBridgeAttach), updated through shadow registers at the same
+     * PWM period boundary, motors with the same frequency and resolution share the timer, so their updates also land at
+     * the same boundary.
+     */
+    kMcpwm,
+  };
+
+  /**
+   * @~Chinese
+   * @brief @ref Stop 的停止方式。
+   */
+  /**
+   * @~English
+   * @brief How @ref Stop stops the motor.
+   */
+  enum StopMode : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 刹车，两个桥臂都输出高电平，电机绕组短路，迅速停止。
+     */
+    /**
+     * @~English
+     * @brief Brake, both legs high, the motor winding is shorted and stops quickly.
+     */
+    kBrake,
+
+    /**
+     * @~Chinese
+     * @brief 滑行，两个桥臂都输出低电平，电机绕组开路，依靠惯性逐渐停止。
+     */
+    /**
+     * @~English
+     * @brief Coast, both legs low, the motor winding is open and the motor runs down on its own.
+     */
+    kCoast,
+  };
 
   /**
    * @~Chinese
    * @brief 构造函数，用于创建一个 EspMotor 对象。
    * @param[in] positive_pin 电机正极引脚编号。
    * @param[in] negative_pin 电机负极引脚编号。
+   * @param[in] hal 用于输出PWM的硬件抽象层，默认为当前平台的 @ref DefaultHal。
    */
   /**
    * @~English
    * @brief Constructor for creating an EspMotor object.
    * @param[in] positive_pin The pin number of the motor's positive pole.
    * @param[in] negative_pin The pin number of the motor's negative pole.
+   * @param[in] hal The hardware abstraction layer used for PWM output, defaults to @ref DefaultHal of the current
+   * platform.
    */
-  explicit EspMotor(const uint8_t positive_pin, const uint8_t negative_pin);
+  explicit EspMotor(const uint8_t positive_pin, const uint8_t negative_pin, Hal& hal = DefaultHal());
 
-  ~EspMotor() = default;
+  ~EspMotor();
 
   /**
    * @~Chinese
@@ -85,6 +150,52 @@ class EspMotor {
    */
   void Init();
 
+  /**
+   * @~Chinese
+   * @brief 设置PWM输出方式、频率和分辨率，必须在 @ref Init 之前调用。
+   * @param[in] backend 输出方式，@ref PwmBackend，默认为 @ref kLedc。
+   * @param[in] frequency PWM频率，单位为赫兹，默认为 @ref kPwmFrequency。
+   * @param[in] resolution PWM分辨率，单位为位，取值范围2到16，默认为 @ref kPwmResolution。频率越高可用的分辨率越低，
+   * 例如LEDC要求频率乘以2^resolution不超过80MHz。
+   * @details 如果当前平台不支持或没有空闲的MCPWM资源，@ref Init 时将退回到 @ref kLedc。
+   */
+  /**
+   * @~English
+   * @brief Set the PWM output backend, frequency and resolution, must be called before @ref Init.
+   * @param[in] backend The output backend, @ref PwmBackend, defaults to @ref kLedc.
+   * @param[in] frequency The PWM frequency in Hz, defaults to @ref kPwmFrequency.
+   * @param[in] resolution The PWM resolution in bits, 2 to 16, defaults to @ref kPwmResolution. Higher frequencies
+   * leave less resolution, e.g. LEDC requires the frequency times 2^resolution to stay within 80 MHz.
+   * @details If the platform has no MCPWM or none is free, @ref Init falls back to @ref kLedc.
+   */
+  void SetPwmBackend(const PwmBackend backend,
+                     const uint32_t frequency = kPwmFrequency,
+                     const uint8_t resolution = kPwmResolution);
+
+  /**
+   * @~Chinese
+   * @brief 获取实际使用的PWM输出方式，@ref Init 之后有效。
+   * @return PWM输出方式，@ref PwmBackend。
+   */
+  /**
+   * @~English
+   * @brief Get the PWM output backend actually in use, valid after @ref Init.
+   * @return The PWM output backend, @ref PwmBackend.
+   */
+  PwmBackend ActivePwmBackend() const;
+
+  /**
+   * @~Chinese
+   * @brief 设置 @ref Stop 的停止方式，下一次调用 @ref Stop 时生效。
+   * @param[in] mode 停止方式，@ref StopMode，默认为 @ref kBrake。
+   */
+  /**
+   * @~English
+   * @brief Set how @ref Stop stops the motor, takes effect at the next call to @ref Stop.
+   * @param[in] mode The stop mode, @ref StopMode, defaults to @ref kBrake.
+   */
+  void SetStopMode(const StopMode mode);
+
   /**
    * @~Chinese
    * @brief 直接设置电机的PWM占空比。
@@ -111,18 +222,51 @@ class EspMotor {
 
   /**
    * @~Chinese
-   * @brief 停止电机运行。
+   * @brief 停止电机运行，按 @ref SetStopMode 设置的方式刹车或滑行。
    */
   /**
    * @~English
-   * @brief Stop motor.
+   * @brief Stop motor, braking or coasting as set by @ref SetStopMode.
    */
   void Stop();
 
+  /**
+   * @~Chinese
+   * @brief 设置是否暂缓PWM输出。暂缓期间 @ref PwmDuty 和 @ref Stop 只记录状态，取消暂缓时立即输出最后记录的状态，
+   * 用于让多个电机的PWM占空比紧接着依次更新，使用 @ref kMcpwm 时它们在同一个PWM周期边界生效。
+   * @param[in] defer 为true时暂缓输出，为false时取消暂缓。
+   */
+  /**
+   * @~English
+   * @brief Set whether the PWM output is deferred. While deferred, @ref PwmDuty and @ref Stop only record the state,
+   * which is output immediately when the deferral is lifted, so that the PWM duties of several motors can be updated
+   * back to back, with @ref kMcpwm they take effect at the same PWM period boundary.
+   * @param[in] defer true to defer the output, false to lift the deferral.
+   */
+  void DeferOutput(const bool defer);
+
  private:
+  static constexpr uint32_t kNotWritten = UINT32_MAX;
+
+  void Output();
+
+  uint32_t HardwareDuty(const int16_t pwm_duty) const;
+
+  Hal& hal_;
   const uint8_t positive_pin_ = 0xFF;
   const uint8_t negative_pin_ = 0xFF;
+  PwmBackend pwm_backend_ = kLedc;
+  uint32_t pwm_frequency_ = kPwmFrequency;
+  uint8_t pwm_resolution_ = kPwmResolution;
+  StopMode stop_mode_ = kBrake;
+  bool initialized_ = false;
   int16_t pwm_duty_ = 0;
+  bool stopped_ = false;
+  bool output_deferred_ = false;
+  bool output_pending_ = false;
+  // The duties last written to the legs, in the hardware resolution, so that unchanged writes are skipped.
+  uint32_t written_positive_duty_ = kNotWritten;
+  uint32_t written_negative_duty_ = kNotWritten;
 };
 }  // namespace em
 
@@ -0,0 +1,94 @@
+/**
+ * @file feedforward.cpp
+ */
+
+#include "feedforward.h"
+
+#include <cmath>
+#include <utility>
+
+namespace em {
+
+void FeedforwardEstimator::Reset() {
+  *this = FeedforwardEstimator();
+}
+
+void FeedforwardEstimator::AddSample(const float duty, const float speed_rpm, const float acceleration) {
+  if (std::fabs(speed_rpm) < kMinSpeedRpm) {
+    return;
+  }
+
+  const double x[kTerms] = {speed_rpm > 0 ? 1.0 : -1.0, speed_rpm, acceleration};
+  for (size_t row = 0; row < kTerms; ++row) {
+    for (size_t column = 0; column < kTerms; ++column) {
+      xx_[row][column] += x[row] * x[column];
+    }
+    xy_[row] += x[row] * duty;
+  }
+  ++sample_count_;
+}
+
+size_t FeedforwardEstimator::SampleCount() const {
+  return sample_count_;
+}
+
+bool FeedforwardEstimator::Solve(Feedforward* const feedforward) const {
+  if (feedforward == nullptr || sample_count_ < kTerms) {
+    return false;
+  }
+
+  // Gaussian elimination with partial pivoting on the augmented normal equations. The columns are scaled to unit
+  // diagonal first, since speed and acceleration differ by orders of magnitude.
+  double scale[kTerms];
+  for (size_t i = 0; i < kTerms; ++i) {
+    if (xx_[i][i] <= 0) {
+      return false;
+    }
+    scale[i] = 1 / std::sqrt(xx_[i][i]);
+  }
+
+  double a[kTerms][kTerms + 1];
+  for (size_t row = 0; row < kTerms; ++row) {
+    for (size_t column = 0; column < kTerms; ++column) {
+      a[row][column] = xx_[row][column] * scale[row] * scale[column];
+    }
+    a[row][kTerms] = xy_[row] * scale[row];
+  }
+
+  // Relative to the unit diagonal, a smaller pivot means the terms are (nearly) collinear.
+  constexpr double kMinPivot = 1e-6;
+  for (size_t column = 0; column < kTerms; ++column) {
+    size_t pivot = column;
+    for (size_t row = column + 1; row < kTerms; ++row) {
+      if (std::fabs(a[row][column]) > std::fabs(a[pivot][column])) {
+        pivot = row;
+      }
+    }
+    if (std::fabs(a[pivot][column]) < kMinPivot) {
+      return false;
+    }
+    std::swap(a[pivot], a[column]);
+    for (size_t row = column + 1; row < kTerms; ++row) {
+      const double factor = a[row][column] / a[column][column];
+      for (size_t k = column; k <= kTerms; ++k) {
+        a[row][k] -= factor * a[column][k];
+      }
+    }
+  }
+
+  double solution[kTerms];
+  for (size_t row = kTerms; row-- > 0;) {
+    double sum = a[row][kTerms];
+    for (size_t k = row + 1; k < kTerms; ++k) {
+      sum -= a[row][k] * solution[k];
+    }
+    solution[row] = sum / a[row][row];
+  }
+
+  feedforward->ks = solution[0] * scale[0];
+  feedforward->kv = solution[1] * scale[1];
+  feedforward->ka = solution[2] * scale[2];
+  return true;
+}
+
+}  // namespace em
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef _EM_FEEDFORWARD_H_
+#define _EM_FEEDFORWARD_H_
+
+/**
+ * @file feedforward.h
+ */
+
+#include <cstddef>
+
+namespace em {
+/**
+ * @~Chinese
+ * @brief 电机前馈模型：duty = ks·sign(v) + kv·v + ka·a，其中v为转速（RPM），a为角加速度（RPM/秒）。
+ */
+/**
+ * @~English
+ * @brief Motor feed-forward model: duty = ks·sign(v) + kv·v + ka·a, where v is the speed in RPM and a the acceleration in
+ * RPM per second.
+ */
+struct Feedforward {
+  /**
+   * @~Chinese
+   * @brief 克服静摩擦所需的PWM占空比ks。
+   */
+  /**
+   * @~English
+   * @brief The PWM duty ks needed to overcome static friction.
+   */
+  float ks = 0;
+
+  /**
+   * @~Chinese
+   * @brief 每RPM转速所需的PWM占空比kv。
+   */
+  /**
+   * @~English
+   * @brief The PWM duty kv per RPM of speed.
+   */
+  float kv = 0;
+
+  /**
+   * @~Chinese
+   * @brief 每RPM/秒加速度所需的PWM占空比ka。
+   */
+  /**
+   * @~English
+   * @brief The PWM duty ka per RPM per second of acceleration.
+   */
+  float ka = 0;
+};
+
+/**
+ * @~Chinese
+ * @class FeedforwardEstimator
+ * @brief 用最小二乘法从测量数据中拟合 @ref Feedforward 模型的系数。
+ * @details 每个样本为一段时间内施加的PWM占空比以及该段时间内测得的平均转速和加速度。样本应覆盖两个转动方向、
+ * 多个不同的占空比以及加速过程，否则加速度项或静摩擦项无法辨识，@ref Solve 返回false。
+ * 只累加正规方程，内存占用与样本数量无关。
+ */
+/**
+ * @~English
+ * @class FeedforwardEstimator
+ * @brief Fits the coefficients of the @ref Feedforward model to measured data with least squares.
+ * @details Each sample is the PWM duty applied over an interval together with the average speed and acceleration
+ * measured over that interval. The samples should cover both directions, several duties and some acceleration, otherwise
+ * the acceleration or static friction term is not identifiable and @ref Solve returns false. Only the normal equations
+ * are accumulated, so the memory use does not depend on the number of samples.
+ */
+class FeedforwardEstimator {
+ public:
+  /**
+   * @~Chinese
+   * @brief 转速绝对值低于该值（RPM）的样本被忽略，因为静止时的摩擦方向不确定。
+   */
+  /**
+   * @~English
+   * @brief Samples slower than this speed in RPM are ignored, as the direction of friction is undefined at standstill.
+   */
+  static constexpr float kMinSpeedRpm = 1;
+
+  /**
+   * @~Chinese
+   * @brief 清除已累加的样本。
+   */
+  /**
+   * @~English
+   * @brief Clear the accumulated samples.
+   */
+  void Reset();
+
+  /**
+   * @~Chinese
+   * @brief 添加一个样本。
+   * @param[in] duty 施加的PWM占空比。
+   * @param[in] speed_rpm 测得的转速（RPM）。
+   * @param[in] acceleration 测得的加速度，单位为RPM/秒。
+   */
+  /**
+   * @~English
+   * @brief Add a sample.
+   * @param[in] duty The applied PWM duty.
+   * @param[in] speed_rpm The measured speed in RPM.
+   * @param[in] acceleration The measured acceleration in RPM per second.
+   */
+  void AddSample(const float duty, const float speed_rpm, const float acceleration);
+
+  /**
+   * @~Chinese
+   * @brief 获取已累加的有效样本数量。
+   * @return 样本数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of accumulated valid samples.
+   * @return The number of samples.
+   */
+  size_t SampleCount() const;
+
+  /**
+   * @~Chinese
+   * @brief 求解最小二乘拟合。
+   * @param[out] feedforward 拟合得到的模型系数，失败时不修改。
+   * @return 成功返回true，样本不足以辨识全部系数时返回false。
+   */
+  /**
+   * @~English
+   * @brief Solve the least-squares fit.
+   * @param[out] feedforward The fitted model coefficients, untouched on failure.
+   * @return true on success, false if the samples can't identify all coefficients.
+   */
+  bool Solve(Feedforward* const feedforward) const;
+
+ private:
+  static constexpr size_t kTerms = 3;
+
+  // Normal equations: sum of x·xᵀ and of x·duty, x = (sign(v), v, a).
+  double xx_[kTerms][kTerms] = {};
+  double xy_[kTerms] = {};
+  size_t sample_count_ = 0;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,193 @@
+#pragma once
+
+#ifndef _EM_FIXED_POINT_H_
+#define _EM_FIXED_POINT_H_
+
+/**
+ * @file fixed_point.h
+ */
+
+#include <cstdint>
+#include <limits>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class FixedPoint
+ * @brief 32位有符号定点数，用于没有硬件浮点单元或需要确定性整数运算的控制计算。
+ * @details 乘法和除法使用64位中间结果并四舍五入。超出表示范围的结果（包括从浮点数构造）饱和到最大值或最小值，
+ * 而不是回绕改变符号。
+ * @tparam kFractionalBits 小数位数，例如16表示Q15.16格式，表示范围约为±32768，分辨率为1/65536。
+ */
+/**
+ * @~English
+ * @class FixedPoint
+ * @brief 32-bit signed fixed-point number, for control computations without a hardware FPU or with deterministic integer
+ * arithmetic.
+ * @details Multiplication and division use 64-bit intermediates and round to nearest. Results out of range, including
+ * conversions from floating point, saturate at the maximum or minimum instead of wrapping around and flipping the sign.
+ * @tparam kFractionalBits The number of fractional bits, e.g. 16 for the Q15.16 format with a range of about ±32768 and a
+ * resolution of 1/65536.
+ */
+template <int kFractionalBits>
+class FixedPoint {
+  static_assert(kFractionalBits > 0 && kFractionalBits < 31);
+
+ public:
+  /**
+   * @~Chinese
+   * @brief 1对应的原始整数值。
+   */
+  /**
+   * @~English
+   * @brief The raw integer value of 1.
+   */
+  static constexpr int32_t kOne = int32_t{1} << kFractionalBits;
+
+  constexpr FixedPoint() = default;
+
+  /**
+   * @~Chinese
+   * @brief 从浮点数构造，四舍五入到最接近的定点数，超出范围时饱和。
+   * @param[in] value 浮点数值。
+   */
+  /**
+   * @~English
+   * @brief Construct from a floating-point number, rounded to the nearest fixed-point value and saturated.
+   * @param[in] value The floating-point value.
+   */
+  constexpr explicit FixedPoint(const double value) : raw_(RoundSaturated(value * kOne + (value < 0 ? -0.5 : 0.5))) {
+  }
+
+  /**
+   * @~Chinese
+   * @brief 从原始整数值构造。
+   * @param[in] raw 原始整数值，即数值乘以2^kFractionalBits。
+   * @return 定点数。
+   */
+  /**
+   * @~English
+   * @brief Construct from the raw integer value.
+   * @param[in] raw The raw integer value, i.e. the value times 2^kFractionalBits.
+   * @return The fixed-point number.
+   */
+  static constexpr FixedPoint FromRaw(const int32_t raw) {
+    FixedPoint value;
+    value.raw_ = raw;
+    return value;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取原始整数值。
+   * @return 原始整数值。
+   */
+  /**
+   * @~English
+   * @brief Get the raw integer value.
+   * @return The raw integer value.
+   */
+  constexpr int32_t Raw() const {
+    return raw_;
+  }
+
+  constexpr explicit operator float() const {
+    return static_cast<float>(raw_) / kOne;
+  }
+
+  constexpr explicit operator double() const {
+    return static_cast<double>(raw_) / kOne;
+  }
+
+  constexpr FixedPoint operator-() const {
+    return FromRaw(Saturate(-int64_t{raw_}));
+  }
+
+  constexpr FixedPoint operator+(const FixedPoint other) const {
+    return FromRaw(Saturate(int64_t{raw_} + other.raw_));
+  }
+
+  constexpr FixedPoint operator-(const FixedPoint other) const {
+    return FromRaw(Saturate(int64_t{raw_} - other.raw_));
+  }
+
+  constexpr FixedPoint operator*(const FixedPoint other) const {
+    return FromRaw(Saturate((int64_t{raw_} * other.raw_ + (int64_t{1} << (kFractionalBits - 1))) >> kFractionalBits));
+  }
+
+  constexpr FixedPoint operator/(const FixedPoint other) const {
+    const int64_t numerator = int64_t{raw_} * kOne;
+    const int64_t denominator = other.raw_;
+    const int64_t magnitude = ((numerator < 0 ? -numerator : numerator) + (denominator < 0 ? -denominator : denominator) / 2) /
+                              (denominator < 0 ? -denominator : denominator);
+    return FromRaw(Saturate((numerator < 0) == (denominator < 0) ? magnitude : -magnitude));
+  }
+
+  constexpr FixedPoint& operator+=(const FixedPoint other) {
+    return *this = *this + other;
+  }
+
+  constexpr FixedPoint& operator-=(const FixedPoint other) {
+    return *this = *this - other;
+  }
+
+  constexpr FixedPoint& operator*=(const FixedPoint other) {
+    return *this = *this * other;
+  }
+
+  constexpr FixedPoint& operator/=(const FixedPoint other) {
+    return *this = *this / other;
+  }
+
+  constexpr bool operator==(const FixedPoint other) const {
+    return raw_ == other.raw_;
+  }
+
+  constexpr bool operator!=(const FixedPoint other) const {
+    return raw_ != other.raw_;
+  }
+
+  constexpr bool operator<(const FixedPoint other) const {
+    return raw_ < other.raw_;
+  }
+
+  constexpr bool operator<=(const FixedPoint other) const {
+    return raw_ <= other.raw_;
+  }
+
+  constexpr bool operator>(const FixedPoint other) const {
+    return raw_ > other.raw_;
+  }
+
+  constexpr bool operator>=(const FixedPoint other) const {
+    return raw_ >= other.raw_;
+  }
+
+ private:
+  static constexpr int32_t kMaxRaw = std::numeric_limits<int32_t>::max();
+  static constexpr int32_t kMinRaw = std::numeric_limits<int32_t>::min();
+
+  static constexpr int32_t Saturate(const int64_t raw) {
+    return raw > kMaxRaw ? kMaxRaw : (raw < kMinRaw ? kMinRaw : static_cast<int32_t>(raw));
+  }
+
+  // Converting an out of range double to an integer is undefined, so the bounds are checked first; NaN yields kMinRaw.
+  static constexpr int32_t RoundSaturated(const double raw) {
+    return raw >= kMaxRaw ? kMaxRaw : (raw > kMinRaw ? static_cast<int32_t>(raw) : kMinRaw);
+  }
+
+  int32_t raw_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @brief Q15.16格式的定点数。
+ */
+/**
+ * @~English
+ * @brief Fixed-point number in the Q15.16 format.
+ */
+using Q16 = FixedPoint<16>;
+}  // namespace em
+
+#endif
@@ -0,0 +1,368 @@
+#pragma once
+
+#ifndef _EM_HAL_H_
+#define _EM_HAL_H_
+
+/**
+ * @file hal.h
+ */
+
+#include <cstdint>
+
+#include "quadrature_decoder.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class Hal
+ * @brief 硬件抽象层接口。
+ * @details 电机驱动类通过该接口访问PWM输出、编码器边沿中断以及单调时钟，而不直接调用ESP32/Arduino的API。
+ * 在ESP32上默认使用 @ref EspHal 实现，在主机（Linux）上默认使用 @ref HostHal 实现，以便在没有硬件的情况下编译、
+ * 运行和测量控制循环。
+ */
+/**
+ * @~English
+ * @class Hal
+ * @brief Hardware abstraction layer interface.
+ * @details The motor classes access PWM output, encoder edge interrupts and a monotonic clock through this interface
+ * instead of calling the ESP32/Arduino API directly. On the ESP32 the default implementation is @ref EspHal, on a host
+ * (Linux) it is @ref HostHal, so that the control loops can be built, run and measured without hardware.
+ */
+class Hal {
+ public:
+  /**
+   * @~Chinese
+   * @brief 中断触发方式。
+   */
+  /**
+   * @~English
+   * @brief Interrupt trigger mode.
+   */
+  enum InterruptMode : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 上升沿触发。
+     */
+    /**
+     * @~English
+     * @brief Trigger on the rising edge.
+     */
+    kRising,
+
+    /**
+     * @~Chinese
+     * @brief 下降沿触发。
+     */
+    /**
+     * @~English
+     * @brief Trigger on the falling edge.
+     */
+    kFalling,
+
+    /**
+     * @~Chinese
+     * @brief 上升沿和下降沿均触发。
+     */
+    /**
+     * @~English
+     * @brief Trigger on both edges.
+     */
+    kChange,
+  };
+
+  /**
+   * @~Chinese
+   * @brief 中断处理函数类型，arg为注册中断时传入的参数。
+   */
+  /**
+   * @~English
+   * @brief Interrupt handler type, arg is the argument passed when attaching the interrupt.
+   */
+  using InterruptHandler = void (*)(void* arg);
+
+  virtual ~Hal() = default;
+
+  /**
+   * @~Chinese
+   * @brief 将引脚配置为PWM输出。
+   * @param[in] pin 引脚编号。
+   * @param[in] frequency PWM频率，单位为赫兹。
+   * @param[in] resolution PWM分辨率，单位为位。
+   * @return 配置成功返回true，否则返回false。
+   */
+  /**
+   * @~English
+   * @brief Configure a pin as PWM output.
+   * @param[in] pin The pin number.
+   * @param[in] frequency PWM frequency in Hz.
+   * @param[in] resolution PWM resolution in bits.
+   * @return true on success, false otherwise.
+   */
+  virtual bool PwmAttach(const uint8_t pin, const uint32_t frequency, const uint8_t resolution) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 设置引脚的PWM占空比。
+   * @param[in] pin 引脚编号。
+   * @param[in] duty PWM占空比，取值范围为0到2^分辨率-1。
+   */
+  /**
+   * @~English
+   * @brief Set the PWM duty cycle of a pin.
+   * @param[in] pin The pin number.
+   * @param[in] duty PWM duty cycle, from 0 to 2^resolution - 1.
+   */
+  virtual void PwmWrite(const uint8_t pin, const uint32_t duty) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 将两个引脚配置为H桥的两个桥臂，由同一个PWM定时器驱动，两路占空比通过影子寄存器在下一个PWM周期边界同时更新。
+   * @details 频率和分辨率相同的桥臂对在硬件允许时共用一个定时器（ESP32上为同一MCPWM组内的定时器），因此它们的更新
+   * 也在同一个周期边界生效。
+   * @param[in] pin_positive 正极桥臂的引脚编号，同时作为该桥臂对的标识。
+   * @param[in] pin_negative 负极桥臂的引脚编号。
+   * @param[in] frequency PWM频率，单位为赫兹。
+   * @param[in] resolution PWM分辨率，单位为位，占空比取值范围为0到2^resolution - 1。
+   * @return 成功返回true，平台不支持或资源已用完时返回false。
+   */
+  /**
+   * @~English
+   * @brief Configure two pins as the two legs of an H-bridge driven by one PWM timer, both duties are updated together
+   * through shadow registers at the next PWM period boundary.
+   * @details Bridges with the same frequency and resolution share one timer where the hardware allows (a timer within
+   * the same MCPWM group on the ESP32), so their updates also take effect at the same period boundary.
+   * @param[in] pin_positive The pin number of the positive leg, also identifies the bridge.
+   * @param[in] pin_negative The pin number of the negative leg.
+   * @param[in] frequency PWM frequency in Hz.
+   * @param[in] resolution PWM resolution in bits, duties range from 0 to 2^resolution - 1.
+   * @return true on success, false if the platform doesn't support it or is out of resources.
+   */
+  virtual bool PwmBridgeAttach(const uint8_t pin_positive,
+                               const uint8_t pin_negative,
+                               const uint32_t frequency,
+                               const uint8_t resolution) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 设置H桥两个桥臂的占空比，两者在下一个PWM周期边界同时生效。
+   * @param[in] pin_positive 正极桥臂的引脚编号。
+   * @param[in] duty_positive 正极桥臂的占空比。
+   * @param[in] duty_negative 负极桥臂的占空比。
+   */
+  /**
+   * @~English
+   * @brief Set the duties of both legs of an H-bridge, which take effect together at the next PWM period boundary.
+   * @param[in] pin_positive The pin number of the positive leg.
+   * @param[in] duty_positive The duty of the positive leg.
+   * @param[in] duty_negative The duty of the negative leg.
+   */
+  virtual void PwmBridgeWrite(const uint8_t pin_positive, const uint32_t duty_positive, const uint32_t duty_negative) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 释放H桥的PWM资源。
+   * @param[in] pin_positive 正极桥臂的引脚编号。
+   */
+  /**
+   * @~English
+   * @brief Release the PWM resources of an H-bridge.
+   * @param[in] pin_positive The pin number of the positive leg.
+   */
+  virtual void PwmBridgeDetach(const uint8_t pin_positive) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 将引脚配置为带上拉的输入。
+   * @param[in] pin 引脚编号。
+   */
+  /**
+   * @~English
+   * @brief Configure a pin as input with pull-up.
+   * @param[in] pin The pin number.
+   */
+  virtual void InputPullUp(const uint8_t pin) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 读取引脚电平，可以在中断处理函数中调用。
+   * @param[in] pin 引脚编号。
+   * @return 高电平返回1，低电平返回0。
+   */
+  /**
+   * @~English
+   * @brief Read the level of a pin, may be called from an interrupt handler.
+   * @param[in] pin The pin number.
+   * @return 1 for high level, 0 for low level.
+   */
+  virtual uint8_t DigitalRead(const uint8_t pin) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 为引脚注册边沿中断。
+   * @param[in] pin 引脚编号。
+   * @param[in] handler 中断处理函数。
+   * @param[in] arg 传递给中断处理函数的参数。
+   * @param[in] mode 中断触发方式，@ref InterruptMode。
+   */
+  /**
+   * @~English
+   * @brief Attach an edge interrupt to a pin.
+   * @param[in] pin The pin number.
+   * @param[in] handler The interrupt handler.
+   * @param[in] arg The argument passed to the interrupt handler.
+   * @param[in] mode The interrupt trigger mode, @ref InterruptMode.
+   */
+  virtual void AttachInterrupt(const uint8_t pin, const InterruptHandler handler, void* arg, const InterruptMode mode) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 注销引脚的边沿中断。
+   * @param[in] pin 引脚编号。
+   */
+  /**
+   * @~English
+   * @brief Detach the edge interrupt of a pin.
+   * @param[in] pin The pin number.
+   */
+  virtual void DetachInterrupt(const uint8_t pin) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 在硬件脉冲计数器上对A、B两相信号进行正交计数，无需逐个边沿触发中断。
+   * @param[in] pin_a 编码器A相引脚编号，同时作为该计数器的标识。
+   * @param[in] pin_b 编码器B相引脚编号。
+   * @param[in] mode 解码方式，@ref QuadratureDecoder::Mode，计数规则与 @ref QuadratureDecoder 相同。
+   * @param[in] glitch_filter_ns 毛刺滤波时间，短于该时间的脉冲被忽略，单位为纳秒，0表示不滤波。
+   * @return 成功返回true，平台不支持或计数器已用完时返回false。
+   */
+  /**
+   * @~English
+   * @brief Count the A and B phase signals in quadrature on a hardware pulse counter, without an interrupt per edge.
+   * @param[in] pin_a The pin number of the encoder's A phase, also identifies the counter.
+   * @param[in] pin_b The pin number of the encoder's B phase.
+   * @param[in] mode The decoding mode, @ref QuadratureDecoder::Mode, counting follows the same rules as
+   * @ref QuadratureDecoder.
+   * @param[in] glitch_filter_ns Pulses shorter than this are ignored, in nanoseconds, 0 disables the filter.
+   * @return true on success, false if the platform has no pulse counter or all counters are in use.
+   */
+  virtual bool PulseCounterAttach(const uint8_t pin_a,
+                                  const uint8_t pin_b,
+                                  const QuadratureDecoder::Mode mode,
+                                  const uint32_t glitch_filter_ns) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 释放硬件脉冲计数器。
+   * @param[in] pin_a 编码器A相引脚编号。
+   */
+  /**
+   * @~English
+   * @brief Release a hardware pulse counter.
+   * @param[in] pin_a The pin number of the encoder's A phase.
+   */
+  virtual void PulseCounterDetach(const uint8_t pin_a) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 读取硬件脉冲计数器累计的计数值，硬件计数器溢出部分已累加在内。A相领先B相时计数增加。
+   * @param[in] pin_a 编码器A相引脚编号。
+   * @return 64位累计计数值。
+   */
+  /**
+   * @~English
+   * @brief Read the accumulated count of a hardware pulse counter, including the hardware counter overflows. The count
+   * increases while phase A leads phase B.
+   * @param[in] pin_a The pin number of the encoder's A phase.
+   * @return The accumulated 64-bit count.
+   */
+  virtual int64_t PulseCounterRead(const uint8_t pin_a) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 启动周期定时器，由硬件定时器以固定频率调用处理函数，与任何任务的调度无关。
+   * @details ESP32上处理函数在定时器中断中调用（ESP_TIMER_ISR分发，IDF未启用时为esp_timer任务），不能加锁或阻塞，
+   * 应只唤醒执行实际工作的任务；主机上在模拟定时器的线程中调用。
+   * 用相同的arg再次调用时以新的周期重新启动该定时器。
+   * @param[in] period_us 周期，单位为微秒。
+   * @param[in] handler 处理函数。
+   * @param[in] arg 传给处理函数的参数，同时作为该定时器的标识。
+   * @return 成功返回true，平台不支持或定时器已用完时返回false。
+   */
+  /**
+   * @~English
+   * @brief Start a periodic timer, which calls the handler at a fixed rate driven by a hardware timer, independent of
+   * how any task is scheduled.
+   * @details On the ESP32 the handler is called from the timer interrupt (ESP_TIMER_ISR dispatch, or the esp_timer task
+   * if the IDF doesn't enable it), so it must not lock or block and should only wake the task that does the work; on a
+   * host it is called from the thread emulating the timer. Calling again with the same arg restarts that timer with the new period.
+   * @param[in] period_us The period in microseconds.
+   * @param[in] handler The handler.
+   * @param[in] arg The argument passed to the handler, also identifies the timer.
+   * @return true on success, false if the platform has no timer or all timers are in use.
+   */
+  virtual bool TimerAttach(const uint32_t period_us, const InterruptHandler handler, void* arg) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 停止并释放周期定时器，返回后处理函数不再被调用。
+   * @param[in] arg 启动定时器时传入的参数。
+   */
+  /**
+   * @~English
+   * @brief Stop and release a periodic timer, the handler is no longer called after this returns.
+   * @param[in] arg The argument passed when starting the timer.
+   */
+  virtual void TimerDetach(void* arg) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 获取单调时钟的当前时间，可以在中断处理函数中调用。
+   * @return 当前时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Get the current time of the monotonic clock, may be called from an interrupt handler.
+   * @return The current time in microseconds.
+   */
+  virtual int64_t Micros() = 0;
+
+  /**
+   * @~Chinese
+   * @brief 获取自由运行的周期计数器，用于测量很短的时长，溢出后回绕，可以在中断处理函数中调用。
+   * @return 当前计数值，单位为 1 / @ref CyclesPerMicrosecond 微秒。
+   */
+  /**
+   * @~English
+   * @brief Get a free-running cycle counter for measuring short durations, wraps around, may be called from an interrupt
+   * handler.
+   * @return The current count, in units of 1 / @ref CyclesPerMicrosecond microseconds.
+   */
+  virtual uint32_t CycleCount() = 0;
+
+  /**
+   * @~Chinese
+   * @brief 获取 @ref CycleCount 每微秒的计数值。
+   * @return 每微秒的计数值。
+   */
+  /**
+   * @~English
+   * @brief Get the number of @ref CycleCount counts per microsecond.
+   * @return The counts per microsecond.
+   */
+  virtual uint32_t CyclesPerMicrosecond() = 0;
+};
+
+/**
+ * @~Chinese
+ * @brief 获取当前平台的默认硬件抽象层实例。
+ * @return 在ESP32上返回 @ref EspHal 实例，在主机上返回 @ref HostHal 实例。
+ */
+/**
+ * @~English
+ * @brief Get the default hardware abstraction layer instance of the current platform.
+ * @return The @ref EspHal instance on the ESP32, the @ref HostHal instance on a host.
+ */
+Hal& DefaultHal();
+}  // namespace em
+
+#endif
@@ -0,0 +1,486 @@
+/**
+ * @file host_hal.cpp
+ */
+
+#if !defined(ARDUINO)
+
+#include "host_hal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+namespace em {
+
+namespace {
+int64_t SteadyMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}  // namespace
+
+HostHal::HostHal() : epoch_us_(SteadyMicros()) {
+}
+
+HostHal::~HostHal() {
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  stopping_ = true;
+  const auto thread = std::exchange(timer_thread_, nullptr);
+  lock.unlock();
+  timer_condition_.notify_all();
+  if (thread != nullptr) {
+    thread->join();
+    delete thread;
+  }
+}
+
+bool HostHal::PwmAttach(const uint8_t pin, const uint32_t frequency, const uint8_t resolution) {
+  if (pin >= kMaxPins || frequency == 0 || resolution == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  pins_[pin].pwm_frequency = frequency;
+  pins_[pin].pwm_resolution = resolution;
+  pins_[pin].pwm_duty = 0;
+  return true;
+}
+
+void HostHal::PwmWrite(const uint8_t pin, const uint32_t duty) {
+  if (pin < kMaxPins) {
+    pins_[pin].pwm_duty = duty;
+    if (recording_waveforms_.load(std::memory_order_relaxed)) {
+      RecordPwm(Micros(), pin, duty);
+    }
+  }
+}
+
+bool HostHal::PwmBridgeAttach(const uint8_t pin_positive,
+                              const uint8_t pin_negative,
+                              const uint32_t frequency,
+                              const uint8_t resolution) {
+  if (pin_positive >= kMaxPins || pin_negative >= kMaxPins || frequency == 0 || resolution == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  for (const auto& bridge : pwm_bridges_) {
+    if (bridge.attached && bridge.pin_positive == pin_positive) {
+      return false;
+    }
+  }
+
+  for (auto& bridge : pwm_bridges_) {
+    if (!bridge.attached) {
+      bridge.attached = true;
+      bridge.pin_positive = pin_positive;
+      bridge.pin_negative = pin_negative;
+      bridge.frequency = frequency;
+      for (const uint8_t pin : {pin_positive, pin_negative}) {
+        pins_[pin].pwm_frequency = frequency;
+        pins_[pin].pwm_resolution = resolution;
+        pins_[pin].pwm_duty = 0;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void HostHal::PwmBridgeWrite(const uint8_t pin_positive, const uint32_t duty_positive, const uint32_t duty_negative) {
+  uint8_t pin_negative = kMaxPins;
+  uint32_t frequency = 0;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    for (const auto& bridge : pwm_bridges_) {
+      if (bridge.attached && bridge.pin_positive == pin_positive) {
+        pin_negative = bridge.pin_negative;
+        frequency = bridge.frequency;
+        // Both legs change under the lock, so no reader sees one updated without the other.
+        pins_[pin_positive].pwm_duty = duty_positive;
+        pins_[pin_negative].pwm_duty = duty_negative;
+        break;
+      }
+    }
+  }
+
+  if (pin_negative < kMaxPins && recording_waveforms_.load(std::memory_order_relaxed)) {
+    // Shadow registers: the duties load at the next period boundary of a timer that started with the clock.
+    const int64_t periods = (Micros() * frequency + 999999) / 1000000;
+    const int64_t boundary_us = (periods * 1000000 + frequency - 1) / frequency;
+    RecordPwm(boundary_us, pin_positive, duty_positive);
+    RecordPwm(boundary_us, pin_negative, duty_negative);
+  }
+}
+
+void HostHal::PwmBridgeDetach(const uint8_t pin_positive) {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (auto& bridge : pwm_bridges_) {
+    if (bridge.attached && bridge.pin_positive == pin_positive) {
+      bridge.attached = false;
+    }
+  }
+}
+
+void HostHal::InputPullUp(const uint8_t pin) {
+  if (pin < kMaxPins) {
+    pins_[pin].level = 1;
+  }
+}
+
+uint8_t HostHal::DigitalRead(const uint8_t pin) {
+  return pin < kMaxPins ? pins_[pin].level.load() : 0;
+}
+
+void HostHal::AttachInterrupt(const uint8_t pin, const InterruptHandler handler, void* arg, const InterruptMode mode) {
+  if (pin >= kMaxPins) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  pins_[pin].handler = handler;
+  pins_[pin].arg = arg;
+  pins_[pin].mode = mode;
+}
+
+void HostHal::DetachInterrupt(const uint8_t pin) {
+  if (pin >= kMaxPins) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  pins_[pin].handler = nullptr;
+  pins_[pin].arg = nullptr;
+}
+
+bool HostHal::PulseCounterAttach(const uint8_t pin_a,
+                                 const uint8_t pin_b,
+                                 const QuadratureDecoder::Mode mode,
+                                 const uint32_t glitch_filter_ns) {
+  if (pin_a >= kMaxPins || pin_b >= kMaxPins) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  for (const auto& counter : pulse_counters_) {
+    if (counter.attached && counter.pin_a == pin_a) {
+      return false;
+    }
+  }
+
+  for (auto& counter : pulse_counters_) {
+    if (!counter.attached) {
+      counter.attached = true;
+      counter.pin_a = pin_a;
+      counter.pin_b = pin_b;
+      counter.decoder = QuadratureDecoder(mode);
+      counter.decoder.Reset(pins_[pin_a].level, pins_[pin_b].level);
+      counter.glitch_filter_ns = glitch_filter_ns;
+      counter.count = 0;
+      counter.overflow = 0;
+      counter.has_last_edge = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+void HostHal::PulseCounterDetach(const uint8_t pin_a) {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (auto& counter : pulse_counters_) {
+    if (counter.attached && counter.pin_a == pin_a) {
+      counter.attached = false;
+    }
+  }
+}
+
+int64_t HostHal::PulseCounterRead(const uint8_t pin_a) {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (const auto& counter : pulse_counters_) {
+    if (counter.attached && counter.pin_a == pin_a) {
+      return counter.overflow + counter.count;
+    }
+  }
+  return 0;
+}
+
+bool HostHal::TimerAttach(const uint32_t period_us, const InterruptHandler handler, void* arg) {
+  if (period_us == 0 || handler == nullptr || arg == nullptr) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  Timer* timer = nullptr;
+  for (auto& candidate : timers_) {
+    if (candidate.handler != nullptr && candidate.arg == arg) {
+      timer = &candidate;
+      break;
+    }
+  }
+  for (auto& candidate : timers_) {
+    if (timer == nullptr && candidate.handler == nullptr) {
+      timer = &candidate;
+    }
+  }
+  if (timer == nullptr) {
+    return false;
+  }
+
+  timer->handler = handler;
+  timer->arg = arg;
+  timer->period_us = period_us;
+  timer->next_us = Micros() + period_us;
+  UpdateNextTimer();
+  if (timer_thread_ == nullptr) {
+    timer_thread_ = new std::thread(&HostHal::RunTimers, this);
+  }
+  lock.unlock();
+  timer_condition_.notify_all();
+  return true;
+}
+
+void HostHal::TimerDetach(void* arg) {
+  // Waits for a running handler, and keeps the thread from calling the timer again.
+  std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_);
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  for (auto& timer : timers_) {
+    if (timer.handler != nullptr && timer.arg == arg) {
+      timer = Timer();
+    }
+  }
+  UpdateNextTimer();
+  lock.unlock();
+  timer_condition_.notify_all();
+}
+
+int64_t HostHal::Micros() {
+  if (virtual_clock_.load(std::memory_order_acquire)) {
+    return virtual_time_us_.load(std::memory_order_relaxed);
+  }
+  return SteadyMicros() - epoch_us_;
+}
+
+uint32_t HostHal::CycleCount() {
+  // Always the real clock, also with the virtual clock, so that the measured durations are the host's execution time.
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t HostHal::CyclesPerMicrosecond() {
+  return 1000;
+}
+
+void HostHal::SetMicros(const int64_t time_us) {
+  if (time_us >= next_timer_us_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_);
+    // A handler that advances the clock itself doesn't dispatch timers again, the outer loop catches up.
+    if (!dispatching_virtual_timers_) {
+      dispatching_virtual_timers_ = true;
+      Timer expired;
+      while (true) {
+        {
+          std::lock_guard<std::mutex> l(timer_mutex_);
+          if (!PopExpiredTimer(time_us, &expired)) {
+            break;
+          }
+        }
+        virtual_time_us_.store(expired.next_us, std::memory_order_relaxed);
+        virtual_clock_.store(true, std::memory_order_release);
+        expired.handler(expired.arg);
+      }
+      dispatching_virtual_timers_ = false;
+    }
+  }
+
+  virtual_time_us_.store(time_us, std::memory_order_relaxed);
+  virtual_clock_.store(true, std::memory_order_release);
+}
+
+void HostHal::SetLevel(const uint8_t pin, const uint8_t level, const bool trigger_interrupt) {
+  if (pin >= kMaxPins) {
+    return;
+  }
+
+  const uint8_t new_level = level != 0 ? 1 : 0;
+  const uint8_t old_level = pins_[pin].level.exchange(new_level);
+  if (old_level == new_level) {
+    return;
+  }
+
+  UpdatePulseCounters(pin);
+  if (!trigger_interrupt) {
+    return;
+  }
+
+  InterruptHandler handler = nullptr;
+  void* arg = nullptr;
+  InterruptMode mode = kChange;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    handler = pins_[pin].handler;
+    arg = pins_[pin].arg;
+    mode = pins_[pin].mode;
+  }
+
+  if (handler == nullptr) {
+    return;
+  }
+
+  if (mode == kChange || (mode == kRising && new_level == 1) || (mode == kFalling && new_level == 0)) {
+    handler(arg);
+  }
+}
+
+void HostHal::UpdatePulseCounters(const uint8_t pin) {
+  const int64_t now_us = Micros();
+  std::lock_guard<std::mutex> l(mutex_);
+  for (auto& counter : pulse_counters_) {
+    if (!counter.attached || (counter.pin_a != pin && counter.pin_b != pin)) {
+      continue;
+    }
+
+    // A pulse shorter than the glitch filter never reaches the hardware counter, undo its first edge and drop this one.
+    if (counter.glitch_filter_ns > 0 && counter.has_last_edge && counter.last_edge_pin == pin &&
+        (now_us - counter.last_edge_us) * 1000 < counter.glitch_filter_ns) {
+      counter.decoder = counter.decoder_before_edge;
+      counter.count = counter.count_before_edge;
+      counter.overflow = counter.overflow_before_edge;
+      counter.has_last_edge = false;
+      continue;
+    }
+    counter.has_last_edge = true;
+    counter.last_edge_pin = pin;
+    counter.last_edge_us = now_us;
+    counter.decoder_before_edge = counter.decoder;
+    counter.count_before_edge = counter.count;
+    counter.overflow_before_edge = counter.overflow;
+
+    // Like the hardware channels, x1 and x2 only see the edges of A, and x1 ignores its rising edges.
+    const uint8_t a_level = pins_[counter.pin_a].level;
+    const auto mode = counter.decoder.DecodingMode();
+    if (mode != QuadratureDecoder::kX4 && (pin != counter.pin_a || (mode == QuadratureDecoder::kX1 && a_level != 0))) {
+      continue;
+    }
+
+    counter.count += counter.decoder.Update(a_level, pins_[counter.pin_b].level);
+    if (counter.count >= kPulseCounterLimit || counter.count <= -kPulseCounterLimit) {
+      counter.overflow += counter.count;
+      counter.count = 0;
+    }
+  }
+}
+
+void HostHal::RunTimers() {
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  while (!stopping_) {
+    // On the virtual clock the timers are dispatched by SetMicros.
+    const int64_t next_us = next_timer_us_.load(std::memory_order_relaxed);
+    if (virtual_clock_.load(std::memory_order_acquire) || next_us == std::numeric_limits<int64_t>::max()) {
+      timer_condition_.wait(lock);
+      continue;
+    }
+
+    const std::chrono::steady_clock::time_point deadline{std::chrono::microseconds(epoch_us_ + next_us)};
+    if (timer_condition_.wait_until(lock, deadline) != std::cv_status::timeout) {
+      // Attached, detached or stopping, recompute the deadline.
+      continue;
+    }
+
+    lock.unlock();
+    {
+      std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_);
+      const int64_t now_us = Micros();
+      Timer expired;
+      bool found = false;
+      {
+        std::lock_guard<std::mutex> l(timer_mutex_);
+        found = !virtual_clock_.load(std::memory_order_acquire) && PopExpiredTimer(now_us, &expired);
+        // Like a hardware timer that skips the expiries missed while the handler was blocked.
+        for (auto& timer : timers_) {
+          if (found && timer.handler != nullptr && timer.arg == expired.arg && timer.next_us <= now_us) {
+            timer.next_us += ((now_us - timer.next_us) / timer.period_us + 1) * timer.period_us;
+          }
+        }
+        UpdateNextTimer();
+      }
+      if (found) {
+        expired.handler(expired.arg);
+      }
+    }
+    lock.lock();
+  }
+}
+
+bool HostHal::PopExpiredTimer(const int64_t time_us, Timer* const expired) {
+  Timer* earliest = nullptr;
+  for (auto& timer : timers_) {
+    if (timer.handler != nullptr && timer.next_us <= time_us && (earliest == nullptr || timer.next_us < earliest->next_us)) {
+      earliest = &timer;
+    }
+  }
+  if (earliest == nullptr) {
+    return false;
+  }
+
+  *expired = *earliest;
+  earliest->next_us += earliest->period_us;
+  UpdateNextTimer();
+  return true;
+}
+
+void HostHal::UpdateNextTimer() {
+  int64_t next_us = std::numeric_limits<int64_t>::max();
+  for (const auto& timer : timers_) {
+    if (timer.handler != nullptr) {
+      next_us = std::min(next_us, timer.next_us);
+    }
+  }
+  next_timer_us_.store(next_us, std::memory_order_release);
+}
+
+uint32_t HostHal::PwmDuty(const uint8_t pin) const {
+  return pin < kMaxPins ? pins_[pin].pwm_duty.load() : 0;
+}
+
+uint32_t HostHal::PwmFrequency(const uint8_t pin) const {
+  if (pin >= kMaxPins) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  return pins_[pin].pwm_frequency;
+}
+
+uint8_t HostHal::PwmResolution(const uint8_t pin) const {
+  if (pin >= kMaxPins) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  return pins_[pin].pwm_resolution;
+}
+
+void HostHal::SetWaveformRecording(const bool enabled) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (enabled && !recording_waveforms_) {
+    waveform_events_.clear();
+  }
+  recording_waveforms_ = enabled;
+}
+
+std::vector<HostHal::PwmEvent> HostHal::WaveformEvents() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return waveform_events_;
+}
+
+void HostHal::RecordPwm(const int64_t time_us, const uint8_t pin, const uint32_t duty) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (recording_waveforms_) {
+    waveform_events_.push_back({time_us, pin, duty});
+  }
+}
+
+Hal& DefaultHal() {
+  // Never destroyed, so that motors with static storage duration can still detach their interrupts at exit.
+  static HostHal* const hal = new HostHal();
+  return *hal;
+}
+
+}  // namespace em
+
+#endif
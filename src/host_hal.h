@@ -0,0 +1,365 @@
+#pragma once
+
+#ifndef _EM_HOST_HAL_H_
+#define _EM_HOST_HAL_H_
+
+/**
+ * @file host_hal.h
+ */
+
+#if !defined(ARDUINO)
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hal.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class HostHal
+ * @brief 主机（Linux）上的硬件抽象层实现。
+ * @details PWM输出只记录写入的配置与占空比；编码器信号由测试或仿真代码通过 @ref SetLevel 注入，电平变化满足中断触发
+ * 条件时在调用线程中同步执行中断处理函数；时钟默认基于std::chrono::steady_clock，调用 @ref SetMicros 后切换为由仿真代码
+ * 推进的虚拟时钟。周期计数器始终是以纳秒为单位的真实时钟。周期定时器在真实时钟下由一个后台线程模拟，在虚拟时钟下由
+ * @ref SetMicros 在每个到期时刻同步调用。
+ */
+/**
+ * @~English
+ * @class HostHal
+ * @brief Hardware abstraction layer implementation on a host (Linux).
+ * @details The PWM output only records the written configuration and duty cycles; encoder signals are injected by
+ * test or simulation code through @ref SetLevel, and the interrupt handler runs synchronously on the calling thread
+ * when a level change matches the trigger mode; the clock is based on std::chrono::steady_clock by default and becomes
+ * a virtual clock advanced by simulation code once @ref SetMicros is called. The cycle counter is always the real clock
+ * in nanoseconds. Periodic timers are emulated by a background thread on the real clock, and called synchronously by
+ * @ref SetMicros at each expiry on the virtual clock.
+ */
+class HostHal : public Hal {
+ public:
+  /**
+   * @~Chinese
+   * @brief 支持的最大引脚数量。
+   */
+  /**
+   * @~English
+   * @brief The maximum number of supported pins.
+   */
+  static constexpr uint8_t kMaxPins = 64;
+
+  /**
+   * @~Chinese
+   * @brief 模拟的硬件脉冲计数器数量。
+   */
+  /**
+   * @~English
+   * @brief The number of simulated hardware pulse counters.
+   */
+  static constexpr uint8_t kMaxPulseCounters = 8;
+
+  /**
+   * @~Chinese
+   * @brief 模拟的硬件脉冲计数器的计数上下限，计数达到上下限时清零并累加到溢出值中，与ESP32上的行为一致。
+   */
+  /**
+   * @~English
+   * @brief The limit of the simulated hardware pulse counters, the count is cleared and accumulated into the overflow
+   * when it reaches the limit, the same as on the ESP32.
+   */
+  static constexpr int32_t kPulseCounterLimit = 30000;
+
+  /**
+   * @~Chinese
+   * @brief 模拟的周期定时器数量。
+   */
+  /**
+   * @~English
+   * @brief The number of emulated periodic timers.
+   */
+  static constexpr uint8_t kMaxTimers = 4;
+
+  /**
+   * @~Chinese
+   * @brief 模拟的H桥PWM数量，与ESP32的MCPWM操作器数量相同。
+   */
+  /**
+   * @~English
+   * @brief The number of emulated H-bridge PWMs, the same as the number of MCPWM operators on the ESP32.
+   */
+  static constexpr uint8_t kMaxPwmBridges = 6;
+
+  /**
+   * @~Chinese
+   * @brief 记录的一次PWM占空比变化。
+   */
+  /**
+   * @~English
+   * @brief One recorded PWM duty change.
+   */
+  struct PwmEvent {
+    /**
+     * @~Chinese
+     * @brief 占空比在硬件上生效的时间，单位为微秒。H桥的写入在下一个PWM周期边界生效，两个桥臂的时间相同。
+     */
+    /**
+     * @~English
+     * @brief The time the duty takes effect on the hardware in microseconds. H-bridge writes take effect at the next PWM
+     * period boundary, at the same time for both legs.
+     */
+    int64_t time_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 引脚编号。
+     */
+    /**
+     * @~English
+     * @brief The pin number.
+     */
+    uint8_t pin = 0;
+
+    /**
+     * @~Chinese
+     * @brief 写入的占空比。
+     */
+    /**
+     * @~English
+     * @brief The written duty.
+     */
+    uint32_t duty = 0;
+  };
+
+  HostHal();
+
+  ~HostHal();
+
+  bool PwmAttach(const uint8_t pin, const uint32_t frequency, const uint8_t resolution) override;
+
+  void PwmWrite(const uint8_t pin, const uint32_t duty) override;
+
+  bool PwmBridgeAttach(const uint8_t pin_positive,
+                       const uint8_t pin_negative,
+                       const uint32_t frequency,
+                       const uint8_t resolution) override;
+
+  void PwmBridgeWrite(const uint8_t pin_positive, const uint32_t duty_positive, const uint32_t duty_negative) override;
+
+  void PwmBridgeDetach(const uint8_t pin_positive) override;
+
+  void InputPullUp(const uint8_t pin) override;
+
+  uint8_t DigitalRead(const uint8_t pin) override;
+
+  void AttachInterrupt(const uint8_t pin, const InterruptHandler handler, void* arg, const InterruptMode mode) override;
+
+  void DetachInterrupt(const uint8_t pin) override;
+
+  bool PulseCounterAttach(const uint8_t pin_a,
+                          const uint8_t pin_b,
+                          const QuadratureDecoder::Mode mode,
+                          const uint32_t glitch_filter_ns) override;
+
+  void PulseCounterDetach(const uint8_t pin_a) override;
+
+  int64_t PulseCounterRead(const uint8_t pin_a) override;
+
+  bool TimerAttach(const uint32_t period_us, const InterruptHandler handler, void* arg) override;
+
+  void TimerDetach(void* arg) override;
+
+  int64_t Micros() override;
+
+  uint32_t CycleCount() override;
+
+  uint32_t CyclesPerMicrosecond() override;
+
+  /**
+   * @~Chinese
+   * @brief 设置输入引脚的电平，如果电平变化满足中断触发条件，则在当前线程中执行中断处理函数，如果引脚连接了脉冲计数器，
+   * 则同时更新模拟的计数值。脉冲计数器模拟毛刺滤波：同一引脚上的电平在短于滤波时间内变回原值，且期间计数器没有看到其他
+   * 边沿时，这个脉冲的两个边沿都被撤销，计数恢复到脉冲之前的值。时钟分辨率为微秒，滤波时间按微秒比较。
+   * @param[in] pin 引脚编号。
+   * @param[in] level 电平，0为低电平，非0为高电平。
+   * @param[in] trigger_interrupt 为false时不执行中断处理函数，用于模拟丢失的中断，脉冲计数器仍然计数。
+   */
+  /**
+   * @~English
+   * @brief Set the level of an input pin, the interrupt handler runs on the current thread if the level change matches
+   * the trigger mode, and the simulated count is updated if the pin is connected to a pulse counter. The pulse counters
+   * emulate the glitch filter: when a pin returns to its previous level sooner than the filter time, with no other edge
+   * seen by the counter in between, both edges of that pulse are undone and the count is restored to its value before
+   * the pulse. The clock has a resolution of one microsecond, so the filter time is compared in microseconds.
+   * @param[in] pin The pin number.
+   * @param[in] level The level, 0 for low and non-zero for high.
+   * @param[in] trigger_interrupt When false the interrupt handler doesn't run, to simulate a lost interrupt, the pulse
+   * counters still count.
+   */
+  void SetLevel(const uint8_t pin, const uint8_t level, const bool trigger_interrupt = true);
+
+  /**
+   * @~Chinese
+   * @brief 切换到虚拟时钟并设置当前时间，之后 @ref Micros 返回该值直到再次设置，用于比实时更快且可复现的仿真。在此之前
+   * 到期的周期定时器按顺序被调用，调用时时钟为各自的到期时刻。
+   * @param[in] time_us 当前时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Switch to the virtual clock and set the current time, @ref Micros returns this value until set again, for
+   * simulations that run faster than real time and reproducibly. Periodic timers that expire up to this time are called
+   * in order, with the clock set to each expiry.
+   * @param[in] time_us The current time in microseconds.
+   */
+  void SetMicros(const int64_t time_us);
+
+  /**
+   * @~Chinese
+   * @brief 获取最近一次写入引脚的PWM占空比。
+   * @param[in] pin 引脚编号。
+   * @return PWM占空比。
+   */
+  /**
+   * @~English
+   * @brief Get the PWM duty cycle last written to a pin.
+   * @param[in] pin The pin number.
+   * @return The PWM duty cycle.
+   */
+  uint32_t PwmDuty(const uint8_t pin) const;
+
+  /**
+   * @~Chinese
+   * @brief 获取引脚配置的PWM频率。
+   * @param[in] pin 引脚编号。
+   * @return PWM频率，单位为赫兹，未配置时为0。
+   */
+  /**
+   * @~English
+   * @brief Get the PWM frequency configured on a pin.
+   * @param[in] pin The pin number.
+   * @return The PWM frequency in Hz, 0 if not configured.
+   */
+  uint32_t PwmFrequency(const uint8_t pin) const;
+
+  /**
+   * @~Chinese
+   * @brief 获取引脚配置的PWM分辨率。
+   * @param[in] pin 引脚编号。
+   * @return PWM分辨率，单位为位，未配置时为0。
+   */
+  /**
+   * @~English
+   * @brief Get the PWM resolution configured on a pin.
+   * @param[in] pin The pin number.
+   * @return The PWM resolution in bits, 0 if not configured.
+   */
+  uint8_t PwmResolution(const uint8_t pin) const;
+
+  /**
+   * @~Chinese
+   * @brief 开始或停止记录PWM波形，开始时清除之前的记录。记录每一次实际的写入，包括占空比未变化的写入。
+   * @param[in] enabled 为true时开始记录，为false时停止记录。
+   */
+  /**
+   * @~English
+   * @brief Start or stop recording the PWM waveforms, starting clears the previous recording. Every actual write is
+   * recorded, including writes that don't change the duty.
+   * @param[in] enabled true to start recording, false to stop.
+   */
+  void SetWaveformRecording(const bool enabled);
+
+  /**
+   * @~Chinese
+   * @brief 获取记录的PWM波形，按写入顺序排列。
+   * @return 记录的占空比变化，@ref PwmEvent。
+   */
+  /**
+   * @~English
+   * @brief Get the recorded PWM waveforms, in the order of the writes.
+   * @return The recorded duty changes, @ref PwmEvent.
+   */
+  std::vector<PwmEvent> WaveformEvents() const;
+
+ private:
+  struct Pin {
+    std::atomic<uint8_t> level = 0;
+    std::atomic<uint32_t> pwm_duty = 0;
+    uint32_t pwm_frequency = 0;
+    uint8_t pwm_resolution = 0;
+    InterruptHandler handler = nullptr;
+    void* arg = nullptr;
+    InterruptMode mode = kChange;
+  };
+
+  struct PulseCounter {
+    bool attached = false;
+    uint8_t pin_a = 0;
+    uint8_t pin_b = 0;
+    QuadratureDecoder decoder;
+    uint32_t glitch_filter_ns = 0;
+    int32_t count = 0;
+    int64_t overflow = 0;
+    // The most recent edge and the state before it, restored if the next edge on the same pin comes back within the
+    // glitch filter time.
+    bool has_last_edge = false;
+    uint8_t last_edge_pin = 0;
+    int64_t last_edge_us = 0;
+    QuadratureDecoder decoder_before_edge;
+    int32_t count_before_edge = 0;
+    int64_t overflow_before_edge = 0;
+  };
+
+  struct Timer {
+    InterruptHandler handler = nullptr;
+    void* arg = nullptr;
+    uint32_t period_us = 0;
+    int64_t next_us = 0;
+  };
+
+  struct PwmBridge {
+    bool attached = false;
+    uint8_t pin_positive = 0;
+    uint8_t pin_negative = 0;
+    uint32_t frequency = 0;
+  };
+
+  void UpdatePulseCounters(const uint8_t pin);
+
+  void RecordPwm(const int64_t time_us, const uint8_t pin, const uint32_t duty);
+
+  void RunTimers();
+
+  // Pops the earliest timer that expires at or before time_us and schedules its next expiry, requires timer_mutex_.
+  bool PopExpiredTimer(const int64_t time_us, Timer* const expired);
+
+  // Publishes the earliest expiry for the lock-free check in SetMicros, requires timer_mutex_.
+  void UpdateNextTimer();
+
+  mutable std::mutex mutex_;
+  std::array<Pin, kMaxPins> pins_;
+  std::array<PulseCounter, kMaxPulseCounters> pulse_counters_;
+  std::array<PwmBridge, kMaxPwmBridges> pwm_bridges_;
+  std::atomic<bool> recording_waveforms_ = false;
+  std::vector<PwmEvent> waveform_events_;
+  const int64_t epoch_us_ = 0;
+  std::atomic<bool> virtual_clock_ = false;
+  std::atomic<int64_t> virtual_time_us_ = 0;
+  // Held while a timer handler runs, so that TimerDetach waits for it; recursive, so that a handler may detach itself.
+  std::recursive_mutex dispatch_mutex_;
+  std::mutex timer_mutex_;
+  std::condition_variable timer_condition_;
+  std::array<Timer, kMaxTimers> timers_;
+  std::atomic<int64_t> next_timer_us_ = std::numeric_limits<int64_t>::max();
+  std::thread* timer_thread_ = nullptr;
+  bool stopping_ = false;
+  bool dispatching_virtual_timers_ = false;
+};
+}  // namespace em
+
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file latency_probe.cpp
+ */
+
+#include "latency_probe.h"
+
+#include <algorithm>
+
+namespace em {
+
+void LatencyProbe::Record(const uint32_t cycles, const uint32_t cycles_per_us) {
+  // Same protocol as Seqlock::Write, but only the words that change are stored.
+  const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (reset_requested_.load(std::memory_order_relaxed)) {
+    reset_requested_.store(false, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_cycles_low_.store(0, std::memory_order_relaxed);
+    sum_cycles_high_.store(0, std::memory_order_relaxed);
+    for (auto& bucket : histogram_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  const uint32_t count = count_.load(std::memory_order_relaxed);
+  if (count == 0 || cycles < min_cycles_.load(std::memory_order_relaxed)) {
+    min_cycles_.store(cycles, std::memory_order_relaxed);
+  }
+  if (count == 0 || cycles > max_cycles_.load(std::memory_order_relaxed)) {
+    max_cycles_.store(cycles, std::memory_order_relaxed);
+  }
+  count_.store(count + 1, std::memory_order_relaxed);
+
+  const uint32_t sum_low = sum_cycles_low_.load(std::memory_order_relaxed);
+  sum_cycles_low_.store(sum_low + cycles, std::memory_order_relaxed);
+  if (sum_low + cycles < sum_low) {
+    sum_cycles_high_.store(sum_cycles_high_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  size_t bucket = 0;
+  for (uint32_t us = cycles_per_us == 0 ? 0 : cycles / cycles_per_us; us != 0 && bucket + 1 < histogram_.size(); us >>= 1) {
+    ++bucket;
+  }
+  histogram_[bucket].store(histogram_[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+LatencyStatistics LatencyProbe::Get(const uint32_t cycles_per_us) const {
+  LatencyStatistics statistics;
+  uint32_t min_cycles = 0;
+  uint32_t max_cycles = 0;
+  uint64_t sum_cycles = 0;
+  uint32_t sequence = 0;
+  do {
+    sequence = sequence_.load(std::memory_order_acquire);
+    statistics.count = count_.load(std::memory_order_relaxed);
+    min_cycles = min_cycles_.load(std::memory_order_relaxed);
+    max_cycles = max_cycles_.load(std::memory_order_relaxed);
+    sum_cycles = static_cast<uint64_t>(sum_cycles_high_.load(std::memory_order_relaxed)) << 32 |
+                 sum_cycles_low_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < histogram_.size(); ++i) {
+      statistics.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) != 0 || sequence != sequence_.load(std::memory_order_relaxed));
+
+  if (statistics.count != 0 && cycles_per_us != 0) {
+    statistics.min_us = static_cast<float>(min_cycles) / cycles_per_us;
+    statistics.max_us = static_cast<float>(max_cycles) / cycles_per_us;
+    statistics.mean_us = static_cast<float>(static_cast<double>(sum_cycles) / statistics.count / cycles_per_us);
+  }
+  return statistics;
+}
+
+void LatencyProbe::Reset() {
+  reset_requested_.store(true, std::memory_order_relaxed);
+}
+
+}  // namespace em
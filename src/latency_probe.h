@@ -0,0 +1,202 @@
+#pragma once
+
+#ifndef _EM_LATENCY_PROBE_H_
+#define _EM_LATENCY_PROBE_H_
+
+/**
+ * @file latency_probe.h
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "hal.h"
+
+/**
+ * @~Chinese
+ * @brief 为1时编译控制循环的耗时统计，参见 @ref em::EspEncoderMotor::GetLatencyProfile，默认为0，相关代码完全不参与编译。
+ * 必须作为编译选项对库和程序统一定义（例如 -DEM_ESP_ENCODER_MOTOR_PROFILING=1），不能只在程序中定义。
+ */
+/**
+ * @~English
+ * @brief When 1, the timing statistics of the control loop are compiled in, see
+ * @ref em::EspEncoderMotor::GetLatencyProfile. Defaults to 0, in which case none of that code is compiled. Must be
+ * defined as a compiler flag for the library and the program alike (e.g. -DEM_ESP_ENCODER_MOTOR_PROFILING=1), not just
+ * in the program.
+ */
+#ifndef EM_ESP_ENCODER_MOTOR_PROFILING
+#define EM_ESP_ENCODER_MOTOR_PROFILING 0
+#endif
+
+namespace em {
+/**
+ * @~Chinese
+ * @brief 一段代码执行耗时的统计。
+ */
+/**
+ * @~English
+ * @brief Statistics of the execution time of a piece of code.
+ */
+struct LatencyStatistics {
+  /**
+   * @~Chinese
+   * @brief 直方图的分组数量。
+   */
+  /**
+   * @~English
+   * @brief The number of histogram buckets.
+   */
+  static constexpr size_t kBuckets = 16;
+
+  /**
+   * @~Chinese
+   * @brief 执行次数。
+   */
+  /**
+   * @~English
+   * @brief The number of executions.
+   */
+  uint32_t count = 0;
+
+  /**
+   * @~Chinese
+   * @brief 最短耗时，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The shortest time in microseconds.
+   */
+  float min_us = 0;
+
+  /**
+   * @~Chinese
+   * @brief 最长耗时，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The longest time in microseconds.
+   */
+  float max_us = 0;
+
+  /**
+   * @~Chinese
+   * @brief 平均耗时，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The mean time in microseconds.
+   */
+  float mean_us = 0;
+
+  /**
+   * @~Chinese
+   * @brief 按耗时以2为底对数分组的执行次数：histogram[0]为不足1微秒，histogram[i]为[2^(i-1), 2^i)微秒，最后一组包括更长的
+   * 耗时。
+   */
+  /**
+   * @~English
+   * @brief The number of executions in log2 buckets of the time: histogram[0] is below 1 microsecond, histogram[i] is
+   * [2^(i-1), 2^i) microseconds, and the last bucket includes all longer times.
+   */
+  std::array<uint32_t, kBuckets> histogram = {};
+};
+
+/**
+ * @~Chinese
+ * @class LatencyProbe
+ * @brief 累计一段代码的执行耗时，由 @ref Hal::CycleCount 计时。
+ * @details 只能由唯一的写入端记录（例如同一个中断处理函数，或持有同一把锁的代码），每次记录只更新少数几个字，
+ * 通过序列号发布，读取端不加锁，不会阻塞写入端。
+ */
+/**
+ * @~English
+ * @class LatencyProbe
+ * @brief Accumulates the execution time of a piece of code, timed with @ref Hal::CycleCount.
+ * @details Must be recorded by a single writer (e.g. the same interrupt handler, or code holding the same lock), each
+ * record only updates a few words and publishes them through a sequence number, the reader doesn't lock and never
+ * blocks the writer.
+ */
+class LatencyProbe {
+ public:
+  /**
+   * @~Chinese
+   * @class Scope
+   * @brief 在作用域内计时，析构时记录到探针。
+   */
+  /**
+   * @~English
+   * @class Scope
+   * @brief Times its scope and records into the probe on destruction.
+   */
+  class Scope {
+   public:
+    Scope(LatencyProbe& probe, Hal& hal) : probe_(probe), hal_(hal), start_(hal.CycleCount()) {
+    }
+
+    ~Scope() {
+      probe_.Record(hal_.CycleCount() - start_, hal_.CyclesPerMicrosecond());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    LatencyProbe& probe_;
+    Hal& hal_;
+    const uint32_t start_ = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 记录一次耗时，只能由唯一的写入端调用。
+   * @param[in] cycles 耗时的周期数。
+   * @param[in] cycles_per_us 每微秒的周期数。
+   */
+  /**
+   * @~English
+   * @brief Record one duration, only called by the single writer.
+   * @param[in] cycles The duration in cycles.
+   * @param[in] cycles_per_us The cycles per microsecond.
+   */
+  void Record(const uint32_t cycles, const uint32_t cycles_per_us);
+
+  /**
+   * @~Chinese
+   * @brief 获取统计结果，不加锁。
+   * @param[in] cycles_per_us 每微秒的周期数。
+   * @return 统计结果，@ref LatencyStatistics。
+   */
+  /**
+   * @~English
+   * @brief Get the statistics, without locking.
+   * @param[in] cycles_per_us The cycles per microsecond.
+   * @return The statistics, @ref LatencyStatistics.
+   */
+  LatencyStatistics Get(const uint32_t cycles_per_us) const;
+
+  /**
+   * @~Chinese
+   * @brief 请求清零统计结果，在写入端下一次记录时生效。
+   */
+  /**
+   * @~English
+   * @brief Request clearing the statistics, takes effect at the next record of the writer.
+   */
+  void Reset();
+
+ private:
+  std::atomic<uint32_t> sequence_ = 0;
+  std::atomic<bool> reset_requested_ = false;
+  std::atomic<uint32_t> count_ = 0;
+  std::atomic<uint32_t> min_cycles_ = 0;
+  std::atomic<uint32_t> max_cycles_ = 0;
+  // The 64-bit sum split into words, so that it is updated without 64-bit atomics.
+  std::atomic<uint32_t> sum_cycles_low_ = 0;
+  std::atomic<uint32_t> sum_cycles_high_ = 0;
+  std::array<std::atomic<uint32_t>, LatencyStatistics::kBuckets> histogram_ = {};
+};
+}  // namespace em
+
+#endif
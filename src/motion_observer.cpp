@@ -0,0 +1,111 @@
+/**
+ * @file motion_observer.cpp
+ */
+
+#include "motion_observer.h"
+
+namespace em {
+
+namespace {
+// The initial uncertainty of velocity and acceleration after a reset, large enough for the first samples to dominate.
+constexpr float kInitialVelocityVariance = 1e6;
+constexpr float kInitialAccelerationVariance = 1e10;
+}  // namespace
+
+AlphaBetaObserver::AlphaBetaObserver(const Parameters& parameters) : parameters_(parameters) {
+}
+
+void AlphaBetaObserver::Reset(const int64_t position, const int64_t time_us) {
+  origin_ = position;
+  time_us_ = time_us;
+  position_ = 0;
+  velocity_ = 0;
+  acceleration_ = 0;
+}
+
+MotionObserver::State AlphaBetaObserver::Update(const int64_t position, const int64_t time_us) {
+  if (time_us > time_us_) {
+    const float dt = (time_us - time_us_) / 1000000.0f;
+    time_us_ = time_us;
+
+    // Predict, then rebase the position onto the new count.
+    const float predicted = position_ + (velocity_ + acceleration_ * dt / 2) * dt - (position - origin_);
+    velocity_ += acceleration_ * dt;
+    origin_ = position;
+
+    const float residual = -predicted;
+    position_ = predicted + parameters_.alpha * residual;
+    velocity_ += parameters_.beta * residual / dt;
+    acceleration_ += 2 * parameters_.gamma * residual / (dt * dt);
+  }
+  return {origin_ + static_cast<double>(position_), velocity_, acceleration_};
+}
+
+KalmanObserver::KalmanObserver(const Parameters& parameters) : parameters_(parameters) {
+}
+
+void KalmanObserver::Reset(const int64_t position, const int64_t time_us) {
+  origin_ = position;
+  time_us_ = time_us;
+  state_ = {};
+  covariance_ = {};
+  covariance_[0][0] = parameters_.measurement_noise;
+  covariance_[1][1] = kInitialVelocityVariance;
+  covariance_[2][2] = kInitialAccelerationVariance;
+}
+
+MotionObserver::State KalmanObserver::Update(const int64_t position, const int64_t time_us) {
+  if (time_us > time_us_) {
+    const float dt = (time_us - time_us_) / 1000000.0f;
+    time_us_ = time_us;
+    auto& x = state_;
+    auto& p = covariance_;
+
+    // Predict x = F x with F = [1 dt dt²/2; 0 1 dt; 0 0 1], rebased onto the new count.
+    x[0] += (x[1] + x[2] * dt / 2) * dt - (position - origin_);
+    x[1] += x[2] * dt;
+    origin_ = position;
+
+    // P = F P Fᵀ, first F P row by row, then (F P) Fᵀ column by column.
+    const float half_dt2 = dt * dt / 2;
+    for (int j = 0; j < 3; ++j) {
+      p[0][j] += dt * p[1][j] + half_dt2 * p[2][j];
+      p[1][j] += dt * p[2][j];
+    }
+    for (int i = 0; i < 3; ++i) {
+      p[i][0] += dt * p[i][1] + half_dt2 * p[i][2];
+      p[i][1] += dt * p[i][2];
+    }
+
+    // Plus the discretized white noise jerk Q = q [dt⁵/20 dt⁴/8 dt³/6; dt⁴/8 dt³/3 dt²/2; dt³/6 dt²/2 dt].
+    const float q = parameters_.process_noise;
+    const float dt2 = dt * dt;
+    const float dt3 = dt2 * dt;
+    p[0][0] += q * dt3 * dt2 / 20;
+    p[0][1] += q * dt2 * dt2 / 8;
+    p[1][0] += q * dt2 * dt2 / 8;
+    p[0][2] += q * dt3 / 6;
+    p[2][0] += q * dt3 / 6;
+    p[1][1] += q * dt3 / 3;
+    p[1][2] += q * dt2 / 2;
+    p[2][1] += q * dt2 / 2;
+    p[2][2] += q * dt;
+
+    // Update with the count, which is 0 relative to the new origin: H = [1 0 0].
+    const float innovation = -x[0];
+    const float s = p[0][0] + parameters_.measurement_noise;
+    const std::array<float, 3> gain = {p[0][0] / s, p[1][0] / s, p[2][0] / s};
+    for (int i = 0; i < 3; ++i) {
+      x[i] += gain[i] * innovation;
+    }
+    const std::array<float, 3> first_row = p[0];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        p[i][j] -= gain[i] * first_row[j];
+      }
+    }
+  }
+  return {origin_ + static_cast<double>(state_[0]), state_[1], state_[2]};
+}
+
+}  // namespace em
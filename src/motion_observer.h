@@ -0,0 +1,284 @@
+#pragma once
+
+#ifndef _EM_MOTION_OBSERVER_H_
+#define _EM_MOTION_OBSERVER_H_
+
+/**
+ * @file motion_observer.h
+ */
+
+#include <array>
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class MotionObserver
+ * @brief 运动观测器接口，每个控制周期由编码器计数估计位置、速度和加速度，参见 @ref EspEncoderMotor::SetMotionObserver。
+ * @details 位置的单位为编码器计数，速度和加速度的单位为计数/秒和计数/秒²。实现在控制线程中调用，不加锁，应尽快返回且不分配
+ * 内存。
+ */
+/**
+ * @~English
+ * @class MotionObserver
+ * @brief Motion observer interface, estimates position, velocity and acceleration from the encoder count every control
+ * tick, see @ref EspEncoderMotor::SetMotionObserver.
+ * @details Positions are in encoder counts, velocities and accelerations in counts/s and counts/s². Implementations
+ * are called from the control thread without locking, and should return quickly without allocating memory.
+ */
+class MotionObserver {
+ public:
+  /**
+   * @~Chinese
+   * @brief 估计的运动状态。
+   */
+  /**
+   * @~English
+   * @brief The estimated motion state.
+   */
+  struct State {
+    /**
+     * @~Chinese
+     * @brief 位置，单位为计数。
+     */
+    /**
+     * @~English
+     * @brief Position in counts.
+     */
+    double position = 0;
+
+    /**
+     * @~Chinese
+     * @brief 速度，单位为计数/秒。
+     */
+    /**
+     * @~English
+     * @brief Velocity in counts/s.
+     */
+    float velocity = 0;
+
+    /**
+     * @~Chinese
+     * @brief 加速度，单位为计数/秒²。
+     */
+    /**
+     * @~English
+     * @brief Acceleration in counts/s².
+     */
+    float acceleration = 0;
+  };
+
+  virtual ~MotionObserver() = default;
+
+  /**
+   * @~Chinese
+   * @brief 以静止在给定位置的状态重新开始估计。
+   * @param[in] position 编码器计数。
+   * @param[in] time_us 计数的采样时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Restart the estimation at rest at the given position.
+   * @param[in] position The encoder count.
+   * @param[in] time_us The sampling time of the count in microseconds.
+   */
+  virtual void Reset(const int64_t position, const int64_t time_us) = 0;
+
+  /**
+   * @~Chinese
+   * @brief 输入一次编码器计数的采样，更新估计。
+   * @param[in] position 编码器计数。
+   * @param[in] time_us 计数的采样时间，单位为微秒，不晚于上一次采样时忽略该采样。
+   * @return 估计的运动状态，@ref State。
+   */
+  /**
+   * @~English
+   * @brief Feed one sample of the encoder count and update the estimate.
+   * @param[in] position The encoder count.
+   * @param[in] time_us The sampling time of the count in microseconds, the sample is ignored if it isn't later than the
+   * previous one.
+   * @return The estimated motion state, @ref State.
+   */
+  virtual State Update(const int64_t position, const int64_t time_us) = 0;
+};
+
+/**
+ * @~Chinese
+ * @class AlphaBetaObserver
+ * @brief α-β（-γ）跟踪器，以固定增益将预测的位置向测得的计数修正。
+ * @details 每个周期按常速度（γ大于0时为常加速度）模型预测，再以残差乘以α、β/Δt和2γ/Δt²分别修正位置、速度和加速度。
+ * γ为0时加速度保持为0。增益越大响应越快，量化噪声也放大得越多；一组临界阻尼的增益为β = 2 - α - 2√(1 - α)。以float计算，
+ * 位置相对于最近一次的计数保存，不会随计数增大而丢失精度。
+ */
+/**
+ * @~English
+ * @class AlphaBetaObserver
+ * @brief Alpha-beta(-gamma) tracker, corrects the predicted position towards the measured count with fixed gains.
+ * @details Every period the state is predicted with a constant velocity model (constant acceleration when gamma is
+ * greater than 0), then the residual times alpha, beta/Δt and 2·gamma/Δt² corrects position, velocity and
+ * acceleration. With a gamma of 0 the acceleration stays 0. Higher gains respond faster and amplify the quantization
+ * noise more, a critically damped pair is beta = 2 - alpha - 2·sqrt(1 - alpha). Computed in float, the position is kept
+ * relative to the latest count and doesn't lose precision as the count grows.
+ */
+class AlphaBetaObserver : public MotionObserver {
+ public:
+  /**
+   * @~Chinese
+   * @brief 跟踪器增益。
+   */
+  /**
+   * @~English
+   * @brief The tracker gains.
+   */
+  struct Parameters {
+    /**
+     * @~Chinese
+     * @brief 位置增益，取值范围(0, 1]。
+     */
+    /**
+     * @~English
+     * @brief The position gain, in (0, 1].
+     */
+    float alpha = 0.8;
+
+    /**
+     * @~Chinese
+     * @brief 速度增益，取值范围(0, 2)，默认值与α临界阻尼。
+     */
+    /**
+     * @~English
+     * @brief The velocity gain, in (0, 2), the default is critically damped with alpha.
+     */
+    float beta = 0.3056;
+
+    /**
+     * @~Chinese
+     * @brief 加速度增益，0表示不估计加速度。
+     */
+    /**
+     * @~English
+     * @brief The acceleration gain, 0 to not estimate the acceleration.
+     */
+    float gamma = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 以默认参数构造。
+   */
+  /**
+   * @~English
+   * @brief Construct with the default parameters.
+   */
+  AlphaBetaObserver() = default;
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] parameters 跟踪器增益，@ref Parameters。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] parameters The tracker gains, @ref Parameters.
+   */
+  explicit AlphaBetaObserver(const Parameters& parameters);
+
+  void Reset(const int64_t position, const int64_t time_us) override;
+
+  State Update(const int64_t position, const int64_t time_us) override;
+
+ private:
+  Parameters parameters_;
+  int64_t origin_ = 0;
+  int64_t time_us_ = 0;
+  float position_ = 0;
+  float velocity_ = 0;
+  float acceleration_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @class KalmanObserver
+ * @brief 常加速度模型的卡尔曼滤波器，状态为位置、速度和加速度，按实际采样间隔计算增益。
+ * @details 过程噪声为连续白噪声加加速度的功率谱密度q，单位为计数²/秒⁵；测量噪声为计数的方差r，单位为计数²，量化误差约为1/12，
+ * 编码器边沿有抖动或间隔不均时应增大。q越大越信任测量，响应越快噪声越大。以float计算，位置相对于最近一次的计数保存。
+ */
+/**
+ * @~English
+ * @class KalmanObserver
+ * @brief Kalman filter with a constant acceleration model, its state is position, velocity and acceleration, the gains
+ * follow the actual sampling interval.
+ * @details The process noise is the power spectral density q of a continuous white noise jerk in counts²/s⁵; the
+ * measurement noise is the variance r of the count in counts², about 1/12 for the quantization alone, more if the
+ * encoder edges jitter or are unevenly spaced. A larger q trusts the measurement more, responding faster with more noise.
+ * Computed in float, the position is kept relative to the latest count.
+ */
+class KalmanObserver : public MotionObserver {
+ public:
+  /**
+   * @~Chinese
+   * @brief 噪声参数。
+   */
+  /**
+   * @~English
+   * @brief The noise parameters.
+   */
+  struct Parameters {
+    /**
+     * @~Chinese
+     * @brief 加加速度的功率谱密度q，单位为计数²/秒⁵，必须大于0。
+     */
+    /**
+     * @~English
+     * @brief The power spectral density q of the jerk in counts²/s⁵, must be greater than 0.
+     */
+    float process_noise = 1e8;
+
+    /**
+     * @~Chinese
+     * @brief 计数的方差r，单位为计数²，必须大于0。
+     */
+    /**
+     * @~English
+     * @brief The variance r of the count in counts², must be greater than 0.
+     */
+    float measurement_noise = 1.0f / 12;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 以默认参数构造。
+   */
+  /**
+   * @~English
+   * @brief Construct with the default parameters.
+   */
+  KalmanObserver() = default;
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] parameters 噪声参数，@ref Parameters。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] parameters The noise parameters, @ref Parameters.
+   */
+  explicit KalmanObserver(const Parameters& parameters);
+
+  void Reset(const int64_t position, const int64_t time_us) override;
+
+  State Update(const int64_t position, const int64_t time_us) override;
+
+ private:
+  Parameters parameters_;
+  int64_t origin_ = 0;
+  int64_t time_us_ = 0;
+  std::array<float, 3> state_ = {};
+  std::array<std::array<float, 3>, 3> covariance_ = {};
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file motion_profile.cpp
+ */
+
+#include "motion_profile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+void MotionProfile::Plan(const double start, const double target, const Limits& limits) {
+  segment_count_ = 0;
+  duration_ = 0;
+  starts_[0] = {start, 0, 0};
+
+  const double distance = std::fabs(target - start);
+  const double sign = target < start ? -1 : 1;
+  double velocity = limits.max_velocity;
+  double acceleration = limits.max_acceleration;
+  const double jerk = limits.max_jerk;
+
+  if (distance == 0 || velocity <= 0 || acceleration <= 0) {
+    starts_[0].position = target;
+    return;
+  }
+
+  if (jerk <= 0) {
+    // Trapezoid: accelerate, cruise, decelerate. Triangle if the maximum velocity can't be reached.
+    if (velocity * velocity / acceleration > distance) {
+      velocity = std::sqrt(distance * acceleration);
+    }
+    const double acceleration_time = velocity / acceleration;
+    AddSegment(acceleration_time, 0, sign * acceleration);
+    AddSegment(distance / velocity - acceleration_time, 0, 0);
+    AddSegment(acceleration_time, 0, -sign * acceleration);
+  } else {
+    // S-curve: each of the acceleration and deceleration phases ramps the acceleration up, holds it and ramps it down.
+    if (velocity * jerk < acceleration * acceleration) {
+      acceleration = std::sqrt(velocity * jerk);
+    }
+    if (velocity * (velocity / acceleration + acceleration / jerk) > distance) {
+      // Too short to reach the maximum velocity, solve velocity² / a + velocity * a / j = distance.
+      const double ratio = acceleration / jerk;
+      velocity = acceleration / 2 * (std::sqrt(ratio * ratio + 4 * distance / acceleration) - ratio);
+      if (velocity * jerk < acceleration * acceleration) {
+        // Too short to reach the maximum acceleration either, solve 2 * velocity * sqrt(velocity / j) = distance.
+        velocity = std::cbrt(distance * distance * jerk / 4);
+        acceleration = std::sqrt(velocity * jerk);
+      }
+    }
+    const double jerk_time = acceleration / jerk;
+    const double constant_acceleration_time = velocity / acceleration - jerk_time;
+    const double cruise_time = distance / velocity - velocity / acceleration - jerk_time;
+    AddSegment(jerk_time, sign * jerk, 0);
+    AddSegment(constant_acceleration_time, 0, sign * acceleration);
+    AddSegment(jerk_time, -sign * jerk, sign * acceleration);
+    AddSegment(cruise_time, 0, 0);
+    AddSegment(jerk_time, -sign * jerk, 0);
+    AddSegment(constant_acceleration_time, 0, -sign * acceleration);
+    AddSegment(jerk_time, sign * jerk, -sign * acceleration);
+  }
+
+  // Land exactly on the target regardless of rounding.
+  starts_[segment_count_] = {target, 0, 0};
+}
+
+MotionProfile::State MotionProfile::Sample(const double time_s) const {
+  double t = std::max(time_s, 0.0);
+  for (size_t i = 0; i < segment_count_; ++i) {
+    const Segment& segment = segments_[i];
+    if (t < segment.duration) {
+      const State& start = starts_[i];
+      State state;
+      state.acceleration = segment.acceleration + segment.jerk * t;
+      state.velocity = start.velocity + (segment.acceleration + segment.jerk * t / 2) * t;
+      state.position = start.position + (start.velocity + (segment.acceleration / 2 + segment.jerk * t / 6) * t) * t;
+      return state;
+    }
+    t -= segment.duration;
+  }
+  return starts_[segment_count_];
+}
+
+double MotionProfile::Duration() const {
+  return duration_;
+}
+
+double MotionProfile::Target() const {
+  return starts_[segment_count_].position;
+}
+
+void MotionProfile::AddSegment(const double duration, const double jerk, const double acceleration) {
+  if (duration <= 0) {
+    return;
+  }
+
+  const State& start = starts_[segment_count_];
+  State& end = starts_[segment_count_ + 1];
+  end.acceleration = acceleration + jerk * duration;
+  end.velocity = start.velocity + (acceleration + jerk * duration / 2) * duration;
+  end.position = start.position + (start.velocity + (acceleration / 2 + jerk * duration / 6) * duration) * duration;
+
+  segments_[segment_count_++] = {duration, jerk, acceleration};
+  duration_ += duration;
+}
+
+}  // namespace em
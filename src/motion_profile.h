@@ -0,0 +1,186 @@
+#pragma once
+
+#ifndef _EM_MOTION_PROFILE_H_
+#define _EM_MOTION_PROFILE_H_
+
+/**
+ * @file motion_profile.h
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class MotionProfile
+ * @brief 点到点运动轨迹，在静止的起点和终点之间预先规划梯形速度曲线或加加速度受限的S形速度曲线。
+ * @details 位置、速度、加速度和加加速度的单位由调用者决定，只需保持一致，例如计数、计数/秒、计数/秒²、计数/秒³。
+ * 距离太短而无法达到最大速度（或最大加速度）时，自动降低峰值速度（或峰值加速度）。
+ */
+/**
+ * @~English
+ * @class MotionProfile
+ * @brief Point-to-point motion trajectory, a trapezoidal or jerk-limited S-curve velocity profile planned in advance
+ * between a start and an end position at rest.
+ * @details The units of position, velocity, acceleration and jerk are up to the caller as long as they are consistent,
+ * e.g. counts, counts/s, counts/s², counts/s³. When the distance is too short to reach the maximum velocity (or maximum
+ * acceleration), the peak velocity (or peak acceleration) is lowered automatically.
+ */
+class MotionProfile {
+ public:
+  /**
+   * @~Chinese
+   * @brief 运动限制。
+   */
+  /**
+   * @~English
+   * @brief Motion limits.
+   */
+  struct Limits {
+    /**
+     * @~Chinese
+     * @brief 最大速度，必须大于0。
+     */
+    /**
+     * @~English
+     * @brief The maximum velocity, must be greater than 0.
+     */
+    double max_velocity = 0;
+
+    /**
+     * @~Chinese
+     * @brief 最大加速度，必须大于0。
+     */
+    /**
+     * @~English
+     * @brief The maximum acceleration, must be greater than 0.
+     */
+    double max_acceleration = 0;
+
+    /**
+     * @~Chinese
+     * @brief 最大加加速度，0表示不限制，即梯形速度曲线。
+     */
+    /**
+     * @~English
+     * @brief The maximum jerk, 0 for unlimited, i.e. a trapezoidal velocity profile.
+     */
+    double max_jerk = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 轨迹上某一时刻的状态。
+   */
+  /**
+   * @~English
+   * @brief The state at one instant of the trajectory.
+   */
+  struct State {
+    /**
+     * @~Chinese
+     * @brief 位置。
+     */
+    /**
+     * @~English
+     * @brief Position.
+     */
+    double position = 0;
+
+    /**
+     * @~Chinese
+     * @brief 速度。
+     */
+    /**
+     * @~English
+     * @brief Velocity.
+     */
+    double velocity = 0;
+
+    /**
+     * @~Chinese
+     * @brief 加速度。
+     */
+    /**
+     * @~English
+     * @brief Acceleration.
+     */
+    double acceleration = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 规划从start到target的轨迹，起点和终点速度均为0。
+   * @param[in] start 起点位置。
+   * @param[in] target 终点位置。
+   * @param[in] limits 运动限制，@ref Limits。
+   */
+  /**
+   * @~English
+   * @brief Plan the trajectory from start to target, at rest at both ends.
+   * @param[in] start The start position.
+   * @param[in] target The target position.
+   * @param[in] limits The motion limits, @ref Limits.
+   */
+  void Plan(const double start, const double target, const Limits& limits);
+
+  /**
+   * @~Chinese
+   * @brief 获取轨迹在指定时刻的状态，时刻早于0时为起点，晚于 @ref Duration 时为终点。
+   * @param[in] time_s 从轨迹开始经过的时间，单位为秒。
+   * @return 轨迹状态，@ref State。
+   */
+  /**
+   * @~English
+   * @brief Get the state of the trajectory at a given time, the start before 0 and the target after @ref Duration.
+   * @param[in] time_s The time since the start of the trajectory in seconds.
+   * @return The trajectory state, @ref State.
+   */
+  State Sample(const double time_s) const;
+
+  /**
+   * @~Chinese
+   * @brief 获取轨迹的总时长。
+   * @return 总时长，单位为秒。
+   */
+  /**
+   * @~English
+   * @brief Get the total duration of the trajectory.
+   * @return The total duration in seconds.
+   */
+  double Duration() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取轨迹的终点位置。
+   * @return 终点位置。
+   */
+  /**
+   * @~English
+   * @brief Get the target position of the trajectory.
+   * @return The target position.
+   */
+  double Target() const;
+
+ private:
+  static constexpr size_t kMaxSegments = 7;
+
+  // A segment of constant jerk, starting from the state in starts_ with the same index.
+  struct Segment {
+    double duration = 0;
+    double jerk = 0;
+    double acceleration = 0;
+  };
+
+  void AddSegment(const double duration, const double jerk, const double acceleration);
+
+  std::array<Segment, kMaxSegments> segments_;
+  std::array<State, kMaxSegments + 1> starts_;
+  size_t segment_count_ = 0;
+  double duration_ = 0;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * @file motor_group.cpp
+ */
+
+#include "motor_group.h"
+
+#include <algorithm>
+
+namespace em {
+
+MotorGroup::MotorGroup(std::initializer_list<EspEncoderMotor*> motors) {
+  for (EspEncoderMotor* const motor : motors) {
+    if (motor != nullptr && motor_count_ < kMaxMotors) {
+      motors_[motor_count_++] = motor;
+    }
+  }
+}
+
+MotorGroup::~MotorGroup() {
+  if (scheduler_ != nullptr) {
+    scheduler_->Unregister(this);
+  }
+}
+
+bool MotorGroup::Init(ControlScheduler& scheduler) {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (scheduler_ != nullptr) {
+      return true;
+    }
+    scheduler_ = &scheduler;
+  }
+
+  bool registered = true;
+  for (size_t i = 0; i < motor_count_; ++i) {
+    registered &= motors_[i]->Init(scheduler);
+  }
+  // Registered after the motors, so that the group's control phase runs once all of theirs have computed a duty.
+  if (registered && scheduler.Register(this)) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  scheduler_ = nullptr;
+  return false;
+}
+
+size_t MotorGroup::Size() const {
+  return motor_count_;
+}
+
+void MotorGroup::RunSpeed(const int16_t* const speeds_rpm, const size_t count) {
+  Enqueue(kSpeedCommand, speeds_rpm, count);
+}
+
+void MotorGroup::RunSpeed(std::initializer_list<int16_t> speeds_rpm) {
+  Enqueue(kSpeedCommand, speeds_rpm.begin(), speeds_rpm.size());
+}
+
+void MotorGroup::RunPwmDuty(const int16_t* const pwm_duties, const size_t count) {
+  Enqueue(kPwmDutyCommand, pwm_duties, count);
+}
+
+void MotorGroup::RunPwmDuty(std::initializer_list<int16_t> pwm_duties) {
+  Enqueue(kPwmDutyCommand, pwm_duties.begin(), pwm_duties.size());
+}
+
+void MotorGroup::Stop() {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (size_t i = 0; i < motor_count_; ++i) {
+    pending_commands_[i] = {kStopCommand, 0};
+  }
+}
+
+size_t MotorGroup::GetSnapshots(EspEncoderMotor::Snapshot* const snapshots, const size_t count) const {
+  if (snapshots == nullptr) {
+    return 0;
+  }
+  const auto published = snapshots_.Read();
+  const size_t n = std::min(count, motor_count_);
+  std::copy(published.begin(), published.begin() + n, snapshots);
+  return n;
+}
+
+void MotorGroup::Sample(const int64_t /* now_us */) {
+  std::array<Command, kMaxMotors> commands;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    commands = pending_commands_;
+    pending_commands_.fill(Command());
+  }
+
+  // Deferred before the commands are applied, so that the PWM duties they set are output in the same pass.
+  for (size_t i = 0; i < motor_count_; ++i) {
+    EspEncoderMotor* const motor = motors_[i];
+    motor->DeferOutput(true);
+    switch (commands[i].type) {
+      case kSpeedCommand:
+        motor->RunSpeed(commands[i].value);
+        break;
+      case kPwmDutyCommand:
+        motor->RunPwmDuty(commands[i].value);
+        break;
+      case kStopCommand:
+        motor->Stop();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void MotorGroup::Control(const int64_t /* now_us */) {
+  for (size_t i = 0; i < motor_count_; ++i) {
+    motors_[i]->DeferOutput(false);
+  }
+
+  std::array<EspEncoderMotor::Snapshot, kMaxMotors> snapshots;
+  for (size_t i = 0; i < motor_count_; ++i) {
+    snapshots[i] = motors_[i]->GetSnapshot();
+  }
+  snapshots_.Write(snapshots);
+}
+
+EspEncoderMotor* MotorGroup::Motor(const size_t index) const {
+  return index < motor_count_ ? motors_[index] : nullptr;
+}
+
+void MotorGroup::Enqueue(const CommandType type, const int16_t* const values, const size_t count) {
+  if (values == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  for (size_t i = 0; i < std::min(count, motor_count_); ++i) {
+    pending_commands_[i] = {type, values[i]};
+  }
+}
+
+}  // namespace em
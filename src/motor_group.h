@@ -0,0 +1,213 @@
+#pragma once
+
+#ifndef _EM_MOTOR_GROUP_H_
+#define _EM_MOTOR_GROUP_H_
+
+/**
+ * @file motor_group.h
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+
+#include "control_scheduler.h"
+#include "esp_encoder_motor.h"
+#include "seqlock.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class MotorGroup
+ * @brief 同步控制的多电机组，例如一辆小车的所有车轮。
+ * @details 电机组本身也是一个注册在同一个 @ref ControlScheduler 上的控制任务：
+ * -# 通过电机组下达的一组指令先暂存，在下一个控制周期的采样阶段一次性应用到所有电机，所有电机在同一个周期开始执行新指令。
+ * -# 在该周期内各电机的PWM输出先暂缓，电机组在所有电机完成控制计算后紧接着依次更新所有PWM占空比。
+ * -# 每个周期结束时把所有电机的状态快照作为一个整体发布，@ref GetSnapshots 得到的快照来自同一个采样时刻。
+ */
+/**
+ * @~English
+ * @class MotorGroup
+ * @brief A group of motors controlled in sync, such as all wheels of a rover.
+ * @details The group itself is a control task registered with the same @ref ControlScheduler:
+ * -# A set of commands issued through the group is held and applied to all motors at once in the sampling phase of the
+ * next control tick, so all motors start executing it in the same tick.
+ * -# The PWM output of every motor is deferred during that tick, and the group updates all PWM duties back to back
+ * once all motors have finished their control computation.
+ * -# The snapshots of all motors are published as a whole at the end of each tick, so @ref GetSnapshots returns
+ * snapshots from the same sampling instant.
+ */
+class MotorGroup : public ControlTask {
+ public:
+  /**
+   * @~Chinese
+   * @brief 电机组最多可包含的电机数量，调度器的一个任务位置留给电机组本身。
+   */
+  /**
+   * @~English
+   * @brief The maximum number of motors in a group, one task slot of the scheduler is left for the group itself.
+   */
+  static constexpr size_t kMaxMotors = ControlScheduler::kMaxTasks - 1;
+
+  /**
+   * @~Chinese
+   * @brief 构造函数，用于创建一个 MotorGroup 对象。
+   * @param[in] motors 组内的电机，顺序即指令和快照的顺序，空指针被忽略，超过 @ref kMaxMotors 的部分被忽略。电机的生命周期
+   * 必须长于电机组。
+   */
+  /**
+   * @~English
+   * @brief Constructor for creating a MotorGroup object.
+   * @param[in] motors The motors in the group, their order is the order of commands and snapshots, null pointers and
+   * motors beyond @ref kMaxMotors are ignored. The motors must outlive the group.
+   */
+  explicit MotorGroup(std::initializer_list<EspEncoderMotor*> motors);
+
+  ~MotorGroup();
+
+  /**
+   * @~Chinese
+   * @brief 初始化组内的所有电机并把电机组注册到调度器。
+   * @param[in] scheduler 控制调度器，默认为 @ref ControlScheduler::Default。组内已经初始化的电机必须使用同一个调度器。
+   * @return 所有电机和电机组都注册成功或电机组已经初始化时返回true。调度器的任务数量不足时返回false，此时电机组未初始化，
+   * 已经注册成功的电机保持初始化状态。
+   */
+  /**
+   * @~English
+   * @brief Initialize all motors in the group and register the group with the scheduler.
+   * @param[in] scheduler The control scheduler, defaults to @ref ControlScheduler::Default. Motors of the group that are
+   * already initialized must use the same scheduler.
+   * @return true if all motors and the group were registered, or the group is already initialized. false if the
+   * scheduler has too few free task slots, the group then stays uninitialized while the motors that were registered stay
+   * initialized.
+   */
+  virtual bool Init(ControlScheduler& scheduler = ControlScheduler::Default());
+
+  /**
+   * @~Chinese
+   * @brief 获取组内的电机数量。
+   * @return 电机数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of motors in the group.
+   * @return The number of motors.
+   */
+  size_t Size() const;
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期同时以指定的速度驱动各电机，参见 @ref EspEncoderMotor::RunSpeed。
+   * @param[in] speeds_rpm 各电机的目标速度（RPM），按组内顺序排列。
+   * @param[in] count @p speeds_rpm 的数量，少于电机数量时其余电机保持原指令，多出的部分被忽略。
+   */
+  /**
+   * @~English
+   * @brief Drive the motors at the given speeds together from the next control tick, see @ref EspEncoderMotor::RunSpeed.
+   * @param[in] speeds_rpm The target speed of each motor in RPM, in group order.
+   * @param[in] count The number of @p speeds_rpm, the remaining motors keep their command if fewer than the motors, extra
+   * values are ignored.
+   */
+  void RunSpeed(const int16_t* const speeds_rpm, const size_t count);
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期同时以指定的速度驱动各电机。
+   * @param[in] speeds_rpm 各电机的目标速度（RPM），按组内顺序排列。
+   */
+  /**
+   * @~English
+   * @brief Drive the motors at the given speeds together from the next control tick.
+   * @param[in] speeds_rpm The target speed of each motor in RPM, in group order.
+   */
+  void RunSpeed(std::initializer_list<int16_t> speeds_rpm);
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期同时以指定的PWM占空比驱动各电机，参见 @ref EspEncoderMotor::RunPwmDuty。
+   * @param[in] pwm_duties 各电机的PWM占空比，按组内顺序排列。
+   * @param[in] count @p pwm_duties 的数量，少于电机数量时其余电机保持原指令，多出的部分被忽略。
+   */
+  /**
+   * @~English
+   * @brief Drive the motors at the given PWM duties together from the next control tick, see
+   * @ref EspEncoderMotor::RunPwmDuty.
+   * @param[in] pwm_duties The PWM duty of each motor, in group order.
+   * @param[in] count The number of @p pwm_duties, the remaining motors keep their command if fewer than the motors,
+   * extra values are ignored.
+   */
+  void RunPwmDuty(const int16_t* const pwm_duties, const size_t count);
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期同时以指定的PWM占空比驱动各电机。
+   * @param[in] pwm_duties 各电机的PWM占空比，按组内顺序排列。
+   */
+  /**
+   * @~English
+   * @brief Drive the motors at the given PWM duties together from the next control tick.
+   * @param[in] pwm_duties The PWM duty of each motor, in group order.
+   */
+  void RunPwmDuty(std::initializer_list<int16_t> pwm_duties);
+
+  /**
+   * @~Chinese
+   * @brief 在下一个控制周期同时停止所有电机，参见 @ref EspEncoderMotor::Stop。
+   */
+  /**
+   * @~English
+   * @brief Stop all motors together at the next control tick, see @ref EspEncoderMotor::Stop.
+   */
+  void Stop();
+
+  /**
+   * @~Chinese
+   * @brief 获取所有电机在同一个控制周期结束时的状态快照，不加锁，不会阻塞控制循环。
+   * @param[out] snapshots 用于保存快照的数组，按组内顺序排列。
+   * @param[in] count @p snapshots 的容量。
+   * @return 写入的快照数量，为 @p count 与电机数量中的较小值。
+   */
+  /**
+   * @~English
+   * @brief Get the snapshots of all motors at the end of the same control tick, without locking, so it never blocks the
+   * control loop.
+   * @param[out] snapshots The array receiving the snapshots, in group order.
+   * @param[in] count The capacity of @p snapshots.
+   * @return The number of snapshots written, the smaller of @p count and the number of motors.
+   */
+  size_t GetSnapshots(EspEncoderMotor::Snapshot* const snapshots, const size_t count) const;
+
+ protected:
+  void Sample(const int64_t now_us) override;
+
+  void Control(const int64_t now_us) override;
+
+  EspEncoderMotor* Motor(const size_t index) const;
+
+ private:
+  enum CommandType : uint8_t {
+    kNoCommand,
+    kSpeedCommand,
+    kPwmDutyCommand,
+    kStopCommand,
+  };
+
+  struct Command {
+    CommandType type = kNoCommand;
+    int16_t value = 0;
+  };
+
+  void Enqueue(const CommandType type, const int16_t* const values, const size_t count);
+
+  std::array<EspEncoderMotor*, kMaxMotors> motors_ = {};
+  size_t motor_count_ = 0;
+  mutable std::mutex mutex_;
+  ControlScheduler* scheduler_ = nullptr;
+  std::array<Command, kMaxMotors> pending_commands_ = {};
+  Seqlock<std::array<EspEncoderMotor::Snapshot, kMaxMotors>> snapshots_;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * @file motor_simulator.cpp
+ */
+
+#if !defined(ARDUINO)
+
+#include "motor_simulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+namespace {
+// The quadrature state the encoder starts in, and the A/B levels of each state, A leads B when counting up.
+constexpr int64_t kInitialEncoderState = 2;
+constexpr uint8_t kEncoderLevels[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+constexpr double kTwoPi = 6.283185307179586;
+}  // namespace
+
+MotorSimulator::MotorSimulator(HostHal& hal,
+                               const uint8_t positive_pin,
+                               const uint8_t negative_pin,
+                               const uint8_t a_pin,
+                               const uint8_t b_pin,
+                               const Parameters& parameters)
+    : hal_(hal),
+      positive_pin_(positive_pin),
+      negative_pin_(negative_pin),
+      a_pin_(a_pin),
+      b_pin_(b_pin),
+      parameters_(parameters),
+      edge_angle_(kTwoPi / (4.0 * std::max<uint32_t>(parameters.encoder_ppr, 1))),
+      random_(parameters.seed),
+      time_us_(hal.Micros()),
+      encoder_state_(kInitialEncoderState),
+      last_edge_time_us_(time_us_) {
+  parameters_.step_us = std::max<uint32_t>(parameters_.step_us, 1);
+  hal_.SetMicros(time_us_);
+  hal_.SetLevel(a_pin_, kEncoderLevels[kInitialEncoderState][0], false);
+  hal_.SetLevel(b_pin_, kEncoderLevels[kInitialEncoderState][1], false);
+}
+
+void MotorSimulator::Advance(const uint32_t duration_us) {
+  AdvanceTo(time_us_ + duration_us);
+}
+
+void MotorSimulator::AdvanceTo(const int64_t time_us) {
+  while (time_us_ < time_us) {
+    const int64_t step_us = std::min<int64_t>(parameters_.step_us, time_us - time_us_);
+    Step(step_us / 1000000.0);
+    time_us_ += step_us;
+    // Dispatches the HostHal timers that expire within the step, so that their output applies from the next step.
+    hal_.SetMicros(time_us_);
+  }
+  hal_.SetMicros(time_us_);
+}
+
+void MotorSimulator::SetLoadTorque(const float load_torque) {
+  parameters_.load_torque = load_torque;
+}
+
+int64_t MotorSimulator::Micros() const {
+  return time_us_;
+}
+
+float MotorSimulator::SpeedRpm() const {
+  return velocity_ * 60 / kTwoPi / parameters_.gear_ratio;
+}
+
+double MotorSimulator::Revolutions() const {
+  return angle_ / kTwoPi / parameters_.gear_ratio;
+}
+
+float MotorSimulator::Current() const {
+  return current_;
+}
+
+uint64_t MotorSimulator::Edges() const {
+  return edges_;
+}
+
+uint64_t MotorSimulator::MissedEdges() const {
+  return missed_edges_;
+}
+
+void MotorSimulator::Step(const double step_s) {
+  const Parameters& p = parameters_;
+
+  // Electrical: L·di/dt = V − R·i − ke·ω, solved exactly over the step for a constant V and ω.
+  const uint32_t positive_duty = hal_.PwmDuty(positive_pin_);
+  const uint32_t negative_duty = hal_.PwmDuty(negative_pin_);
+  const uint8_t resolution = hal_.PwmResolution(positive_pin_);
+  if ((positive_duty == 0 && negative_duty == 0) || resolution == 0) {
+    current_ = 0;
+  } else {
+    const double max_duty = (1u << resolution) - 1;
+    const double voltage = p.supply_voltage * (static_cast<double>(positive_duty) - negative_duty) / max_duty;
+    const double steady_current = (voltage - p.torque_constant * velocity_) / p.resistance;
+    const double decay = p.inductance > 0 ? std::exp(-step_s * p.resistance / p.inductance) : 0;
+    current_ = steady_current + (current_ - steady_current) * decay;
+  }
+
+  // Mechanical: J·dω/dt = kt·i − b·ω − load − friction, with the Coulomb friction holding the shaft at standstill.
+  const double inertia = p.rotor_inertia + p.load_inertia / (p.gear_ratio * p.gear_ratio);
+  const double drive = p.torque_constant * current_ - p.viscous_friction * velocity_ - p.load_torque / p.gear_ratio;
+  const double previous_velocity = velocity_;
+  if (velocity_ == 0) {
+    if (std::fabs(drive) > p.coulomb_friction) {
+      velocity_ = (drive - std::copysign(p.coulomb_friction, drive)) / inertia * step_s;
+    }
+  } else {
+    velocity_ += (drive - std::copysign(p.coulomb_friction, velocity_)) / inertia * step_s;
+    if ((velocity_ > 0) != (previous_velocity > 0)) {
+      velocity_ = 0;
+    }
+  }
+  angle_ += (previous_velocity + velocity_) / 2 * step_s;
+
+  // The encoder disc only follows the shaft once the play is taken up.
+  const double previous_encoder_angle = encoder_angle_;
+  const double half_backlash = p.backlash / 2;
+  if (angle_ - encoder_angle_ > half_backlash) {
+    encoder_angle_ = angle_ - half_backlash;
+  } else if (encoder_angle_ - angle_ > half_backlash) {
+    encoder_angle_ = angle_ + half_backlash;
+  }
+  EmitEdges(previous_encoder_angle, step_s);
+}
+
+void MotorSimulator::EmitEdges(const double previous_encoder_angle, const double step_s) {
+  // Encoder position in edges, state n spans [n, n + 1), the start angle sits in the middle of the initial state.
+  const double from = previous_encoder_angle / edge_angle_ + kInitialEncoderState + 0.5;
+  const double to = encoder_angle_ / edge_angle_ + kInitialEncoderState + 0.5;
+  const int64_t target_state = static_cast<int64_t>(std::floor(to));
+  const double step_end_us = time_us_ + step_s * 1000000.0;
+
+  while (encoder_state_ != target_state) {
+    const int64_t direction = target_state > encoder_state_ ? 1 : -1;
+    const double boundary = direction > 0 ? encoder_state_ + 1 : encoder_state_;
+    double edge_time_us = time_us_ + (boundary - from) / (to - from) * step_s * 1000000.0;
+    if (parameters_.edge_jitter_us > 0) {
+      edge_time_us += parameters_.edge_jitter_us * Gaussian();
+    }
+    // Edges stay in order and within the step, the decoder relies on both.
+    edge_time_us = std::clamp(edge_time_us, last_edge_time_us_, step_end_us);
+    last_edge_time_us_ = edge_time_us;
+
+    encoder_state_ += direction;
+    const uint8_t* const levels = kEncoderLevels[encoder_state_ & 3];
+    const bool missed = parameters_.missed_edge_probability > 0 && Uniform() < parameters_.missed_edge_probability;
+    hal_.SetMicros(std::llround(edge_time_us));
+    hal_.SetLevel(a_pin_, levels[0], !missed);
+    hal_.SetLevel(b_pin_, levels[1], !missed);
+    ++edges_;
+    if (missed) {
+      ++missed_edges_;
+    }
+  }
+}
+
+double MotorSimulator::Gaussian() {
+  // Box-Muller on the raw generator output, std::normal_distribution differs between standard libraries.
+  const double u1 = 1 - Uniform();
+  const double u2 = Uniform();
+  return std::sqrt(-2 * std::log(u1)) * std::cos(kTwoPi * u2);
+}
+
+double MotorSimulator::Uniform() {
+  return random_() / 4294967296.0;
+}
+
+}  // namespace em
+
+#endif
@@ -0,0 +1,400 @@
+#pragma once
+
+#ifndef _EM_MOTOR_SIMULATOR_H_
+#define _EM_MOTOR_SIMULATOR_H_
+
+/**
+ * @file motor_simulator.h
+ */
+
+#if !defined(ARDUINO)
+
+#include <cstdint>
+#include <random>
+
+#include "host_hal.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class MotorSimulator
+ * @brief 主机上的直流减速电机及编码器物理仿真，用于在没有硬件的情况下进行闭环测试和基准测试。
+ * @details 仿真读取 @ref HostHal 记录的电机驱动引脚PWM占空比，按平均电压计算电枢电流（R、L、反电动势），再按转矩、
+ * 转动惯量、粘滞摩擦、库仑摩擦（含静摩擦）和负载计算电机轴转速，最后把电机轴上的编码器转角转换为A/B相正交电平，
+ * 通过 @ref HostHal::SetLevel 注入，驱动被测电机的编码器路径。两个引脚均为最大占空比时为刹车（电枢短路），均为0时为
+ * 滑行（电枢开路）。
+ *
+ * 仿真使用 @ref HostHal 的虚拟时钟：每个编码器边沿按线性插值得到的时刻设置时钟后再注入，因此速度测量能看到真实的
+ * 边沿时间，且仿真比实时更快。边沿时间抖动、编码器码盘与电机轴之间的间隙以及丢失的中断均可配置，随机数由固定种子
+ * 生成，相同参数的两次运行结果完全相同。
+ *
+ * 电机轴上的量使用国际单位（V、Ω、H、N·m、kg·m²、rad）；负载转矩和负载转动惯量作用在减速器输出轴上。
+ */
+/**
+ * @~English
+ * @class MotorSimulator
+ * @brief Physics simulation of a geared DC motor with an encoder on the host, for closed-loop tests and benchmarks
+ * without hardware.
+ * @details The simulation reads the PWM duty cycles of the motor driver pins recorded by @ref HostHal, computes the
+ * armature current from the average voltage (R, L, back-EMF), then the motor shaft speed from the torque, inertia,
+ * viscous friction, Coulomb friction (with stiction) and load, and finally turns the encoder angle on the motor shaft
+ * into A/B quadrature levels injected through @ref HostHal::SetLevel into the encoder path of the motor under test. Both
+ * pins at the maximum duty brake (shorted armature), both at 0 coast (open armature).
+ *
+ * The simulation runs on the virtual clock of @ref HostHal: the clock is set to the linearly interpolated time of each
+ * encoder edge before the edge is injected, so the speed measurement sees realistic edge timing and the simulation runs
+ * faster than real time. Edge timing jitter, play between the encoder disc and the motor shaft, and lost interrupts are
+ * configurable, the random numbers come from a fixed seed so two runs with the same parameters are identical.
+ *
+ * Motor shaft quantities use SI units (V, Ω, H, N·m, kg·m², rad); the load torque and load inertia act on the gearbox
+ * output shaft.
+ */
+class MotorSimulator {
+ public:
+  /**
+   * @~Chinese
+   * @brief 仿真参数，默认值近似一个12V、90:1减速、12线编码器的小型减速电机。
+   */
+  /**
+   * @~English
+   * @brief Simulation parameters, the defaults approximate a small 12 V gear motor with a 90:1 gearbox and a 12 PPR
+   * encoder.
+   */
+  struct Parameters {
+    /**
+     * @~Chinese
+     * @brief 电源电压，单位为V。
+     */
+    /**
+     * @~English
+     * @brief The supply voltage in V.
+     */
+    float supply_voltage = 12;
+
+    /**
+     * @~Chinese
+     * @brief 电枢电阻，单位为Ω。
+     */
+    /**
+     * @~English
+     * @brief The armature resistance in Ω.
+     */
+    float resistance = 5;
+
+    /**
+     * @~Chinese
+     * @brief 电枢电感，单位为H。
+     */
+    /**
+     * @~English
+     * @brief The armature inductance in H.
+     */
+    float inductance = 0.001;
+
+    /**
+     * @~Chinese
+     * @brief 转矩常数，单位为N·m/A，同时也是反电动势常数（V·s/rad）。
+     */
+    /**
+     * @~English
+     * @brief The torque constant in N·m/A, which is also the back-EMF constant in V·s/rad.
+     */
+    float torque_constant = 0.0055;
+
+    /**
+     * @~Chinese
+     * @brief 电机转子转动惯量，单位为kg·m²。
+     */
+    /**
+     * @~English
+     * @brief The rotor inertia in kg·m².
+     */
+    float rotor_inertia = 5e-7;
+
+    /**
+     * @~Chinese
+     * @brief 电机轴上的粘滞摩擦系数，单位为N·m·s/rad。
+     */
+    /**
+     * @~English
+     * @brief The viscous friction on the motor shaft in N·m·s/rad.
+     */
+    float viscous_friction = 2e-7;
+
+    /**
+     * @~Chinese
+     * @brief 电机轴上的库仑摩擦转矩，单位为N·m，静止时也作为静摩擦。
+     */
+    /**
+     * @~English
+     * @brief The Coulomb friction torque on the motor shaft in N·m, also the stiction at standstill.
+     */
+    float coulomb_friction = 0.0012;
+
+    /**
+     * @~Chinese
+     * @brief 减速比。
+     */
+    /**
+     * @~English
+     * @brief The gear ratio.
+     */
+    float gear_ratio = 90;
+
+    /**
+     * @~Chinese
+     * @brief 输出轴上的负载转矩，单位为N·m，正值阻碍正转。
+     */
+    /**
+     * @~English
+     * @brief The load torque on the output shaft in N·m, positive values oppose forward rotation.
+     */
+    float load_torque = 0;
+
+    /**
+     * @~Chinese
+     * @brief 输出轴上的负载转动惯量，单位为kg·m²。
+     */
+    /**
+     * @~English
+     * @brief The load inertia on the output shaft in kg·m².
+     */
+    float load_inertia = 0;
+
+    /**
+     * @~Chinese
+     * @brief 编码器每转脉冲数（电机轴），每转产生4倍的正交边沿。
+     */
+    /**
+     * @~English
+     * @brief The encoder pulses per revolution of the motor shaft, each revolution produces 4 times as many quadrature
+     * edges.
+     */
+    uint32_t encoder_ppr = 12;
+
+    /**
+     * @~Chinese
+     * @brief 编码器码盘与电机轴之间的间隙，单位为rad，换向时码盘在间隙内不动。
+     */
+    /**
+     * @~English
+     * @brief The play between the encoder disc and the motor shaft in rad, the disc stands still within it on reversal.
+     */
+    float backlash = 0;
+
+    /**
+     * @~Chinese
+     * @brief 编码器边沿时间抖动的标准差，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The standard deviation of the encoder edge timing jitter in microseconds.
+     */
+    float edge_jitter_us = 0;
+
+    /**
+     * @~Chinese
+     * @brief 每个编码器边沿丢失中断的概率，丢失的边沿仍会改变引脚电平和硬件脉冲计数。
+     */
+    /**
+     * @~English
+     * @brief The probability of each encoder edge losing its interrupt, lost edges still change the pin level and the
+     * hardware pulse count.
+     */
+    float missed_edge_probability = 0;
+
+    /**
+     * @~Chinese
+     * @brief 随机数种子。
+     */
+    /**
+     * @~English
+     * @brief The random number seed.
+     */
+    uint32_t seed = 1;
+
+    /**
+     * @~Chinese
+     * @brief 积分步长，单位为微秒。
+     */
+    /**
+     * @~English
+     * @brief The integration step in microseconds.
+     */
+    uint32_t step_us = 10;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 构造函数，切换 @p hal 到虚拟时钟，电机静止，A/B相均为高电平，与上拉输入的空闲电平一致。
+   * @param[in] hal 被测电机使用的主机硬件抽象层。
+   * @param[in] positive_pin 电机驱动正极引脚。
+   * @param[in] negative_pin 电机驱动负极引脚。
+   * @param[in] a_pin 编码器A相引脚。
+   * @param[in] b_pin 编码器B相引脚。
+   * @param[in] parameters 仿真参数，@ref Parameters。
+   * @details 正向电压使电机正转，正转时A相超前B相。
+   */
+  /**
+   * @~English
+   * @brief Constructor, switches @p hal to the virtual clock, the motor stands still with both A and B high, like the
+   * idle level of pulled-up inputs.
+   * @param[in] hal The host hardware abstraction layer used by the motor under test.
+   * @param[in] positive_pin The positive pin of the motor driver.
+   * @param[in] negative_pin The negative pin of the motor driver.
+   * @param[in] a_pin The encoder A phase pin.
+   * @param[in] b_pin The encoder B phase pin.
+   * @param[in] parameters The simulation parameters, @ref Parameters.
+   * @details A positive voltage turns the motor forward, and A leads B when turning forward.
+   */
+  MotorSimulator(HostHal& hal,
+                 const uint8_t positive_pin,
+                 const uint8_t negative_pin,
+                 const uint8_t a_pin,
+                 const uint8_t b_pin,
+                 const Parameters& parameters);
+
+  /**
+   * @~Chinese
+   * @brief 推进仿真时间，结束时虚拟时钟停在推进后的时刻。
+   * @param[in] duration_us 推进的时长，单位为微秒。
+   * @details 每个积分步开始时读取一次PWM占空比，因此与控制代码交替调用时，控制代码写入的占空比在下一次推进中生效。
+   */
+  /**
+   * @~English
+   * @brief Advance the simulated time, the virtual clock stops at the advanced time.
+   * @param[in] duration_us The time to advance in microseconds.
+   * @details The PWM duty cycles are read at the start of each integration step, so when interleaved with the control
+   * code, the duty it writes takes effect in the next advance.
+   */
+  void Advance(const uint32_t duration_us);
+
+  /**
+   * @~Chinese
+   * @brief 推进仿真时间到指定时刻，早于当前仿真时间时不推进，可直接作为 @ref ControlScheduler::RunUntil 的回调使用。
+   * @param[in] time_us 推进到的时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Advance the simulated time to the given time, nothing happens if it is not later than the current simulated
+   * time, usable directly as the callback of @ref ControlScheduler::RunUntil.
+   * @param[in] time_us The time to advance to in microseconds.
+   */
+  void AdvanceTo(const int64_t time_us);
+
+  /**
+   * @~Chinese
+   * @brief 设置输出轴上的负载转矩。
+   * @param[in] load_torque 负载转矩，单位为N·m，正值阻碍正转。
+   */
+  /**
+   * @~English
+   * @brief Set the load torque on the output shaft.
+   * @param[in] load_torque The load torque in N·m, positive values oppose forward rotation.
+   */
+  void SetLoadTorque(const float load_torque);
+
+  /**
+   * @~Chinese
+   * @brief 获取当前的仿真时间。
+   * @return 仿真时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Get the current simulated time.
+   * @return The simulated time in microseconds.
+   */
+  int64_t Micros() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取输出轴的真实转速。
+   * @return 转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief Get the true speed of the output shaft.
+   * @return The speed in RPM.
+   */
+  float SpeedRpm() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取输出轴的真实转角。
+   * @return 转角，单位为转。
+   */
+  /**
+   * @~English
+   * @brief Get the true angle of the output shaft.
+   * @return The angle in revolutions.
+   */
+  double Revolutions() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取电枢电流。
+   * @return 电流，单位为A。
+   */
+  /**
+   * @~English
+   * @brief Get the armature current.
+   * @return The current in A.
+   */
+  float Current() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取已注入的编码器边沿数量。
+   * @return 边沿数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of injected encoder edges.
+   * @return The number of edges.
+   */
+  uint64_t Edges() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取丢失了中断的编码器边沿数量。
+   * @return 边沿数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of encoder edges that lost their interrupt.
+   * @return The number of edges.
+   */
+  uint64_t MissedEdges() const;
+
+ private:
+  void Step(const double step_s);
+
+  void EmitEdges(const double previous_encoder_angle, const double step_s);
+
+  double Gaussian();
+
+  double Uniform();
+
+  HostHal& hal_;
+  const uint8_t positive_pin_ = 0;
+  const uint8_t negative_pin_ = 0;
+  const uint8_t a_pin_ = 0;
+  const uint8_t b_pin_ = 0;
+  Parameters parameters_;
+  const double edge_angle_ = 0;
+  std::mt19937 random_;
+  int64_t time_us_ = 0;
+  double current_ = 0;
+  double velocity_ = 0;
+  double angle_ = 0;
+  double encoder_angle_ = 0;
+  int64_t encoder_state_ = 0;
+  double last_edge_time_us_ = 0;
+  uint64_t edges_ = 0;
+  uint64_t missed_edges_ = 0;
+};
+}  // namespace em
+
+#endif
+
+#endif
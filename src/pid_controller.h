@@ -0,0 +1,253 @@
+#pragma once
+
+#ifndef _EM_PID_CONTROLLER_H_
+#define _EM_PID_CONTROLLER_H_
+
+/**
+ * @file pid_controller.h
+ */
+
+#include <algorithm>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class PidController
+ * @brief 带设定值加权、微分滤波和反计算抗积分饱和的PID控制器，数值类型可以是浮点数或定点数（例如 @ref Q16）。
+ * @details 输出为
+ * u = kp·(b·r − y) + ki·∫(r − y)dt + D，其中微分项D = kd·d(c·r − y)/dt 经过时间常数为Tf的一阶低通滤波，
+ * 输出被限制在 [output_min, output_max] 之内，限幅前后的差值乘以 tracking_gain 反馈到积分项（反计算法），
+ * 避免执行器饱和时积分项持续累积。c为0时微分只作用于测量值，设定值阶跃不会引起微分冲击。
+ * 每次 @ref Update 传入实际的采样间隔，控制器在不同的控制频率下保持相同的动态特性。时间单位由调用者决定，例如秒，
+ * 只需与ki、kd、Tf和跟踪增益的单位一致。
+ * 积分项以输出单位保存，修改增益不会引起输出跳变。
+ * @tparam T 数值类型，需要支持 +、-、*、/、比较运算以及从double的显式构造。
+ */
+/**
+ * @~English
+ * @class PidController
+ * @brief PID controller with setpoint weighting, a filtered derivative and back-calculation anti-windup, the numeric type
+ * may be floating point or fixed point (e.g. @ref Q16).
+ * @details The output is u = kp·(b·r − y) + ki·∫(r − y)dt + D, where the derivative term D = kd·d(c·r − y)/dt passes a
+ * first-order low-pass filter with time constant Tf. The output is limited to [output_min, output_max] and the
+ * difference before and after limiting, times tracking_gain, is fed back into the integral (back-calculation), so the
+ * integral does not wind up while the actuator saturates. With c = 0 the derivative acts on the measurement only and
+ * setpoint steps cause no derivative kick. Every @ref Update takes the actual sampling interval, so the dynamics stay
+ * the same at any control rate. The time unit is up to the caller, e.g. seconds, as long as ki, kd, Tf and the tracking
+ * gain use the same unit. The integral is kept in output units, so changing the gains causes no output bump.
+ * @tparam T The numeric type, must support +, -, *, /, comparisons and explicit construction from double.
+ */
+template <typename T>
+class PidController {
+ public:
+  /**
+   * @~Chinese
+   * @brief 控制器参数。
+   */
+  /**
+   * @~English
+   * @brief Controller parameters.
+   */
+  struct Parameters {
+    /**
+     * @~Chinese
+     * @brief 比例增益kp。
+     */
+    /**
+     * @~English
+     * @brief The proportional gain kp.
+     */
+    T kp = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 积分增益ki，单位为1/时间单位。
+     */
+    /**
+     * @~English
+     * @brief The integral gain ki, per time unit.
+     */
+    T ki = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 微分增益kd，单位为时间单位。
+     */
+    /**
+     * @~English
+     * @brief The derivative gain kd, in time units.
+     */
+    T kd = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 比例项的设定值权重b。
+     */
+    /**
+     * @~English
+     * @brief The setpoint weight b of the proportional term.
+     */
+    T setpoint_weight = T(1);
+
+    /**
+     * @~Chinese
+     * @brief 微分项的设定值权重c，0表示微分只作用于测量值。
+     */
+    /**
+     * @~English
+     * @brief The setpoint weight c of the derivative term, 0 for a derivative on the measurement only.
+     */
+    T derivative_setpoint_weight = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 微分滤波时间常数Tf，单位为时间单位，0表示不滤波。
+     */
+    /**
+     * @~English
+     * @brief The derivative filter time constant Tf in time units, 0 for no filtering.
+     */
+    T derivative_filter_time = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 反计算抗积分饱和的跟踪增益，单位为1/时间单位，0表示只将积分项限制在输出范围之内。
+     */
+    /**
+     * @~English
+     * @brief The tracking gain of the back-calculation anti-windup, per time unit, 0 to only limit the integral to the
+     * output range.
+     */
+    T tracking_gain = T(0);
+
+    /**
+     * @~Chinese
+     * @brief 输出下限。
+     */
+    /**
+     * @~English
+     * @brief The lower output limit.
+     */
+    T output_min = T(-1);
+
+    /**
+     * @~Chinese
+     * @brief 输出上限。
+     */
+    /**
+     * @~English
+     * @brief The upper output limit.
+     */
+    T output_max = T(1);
+  };
+
+  /**
+   * @~Chinese
+   * @brief 设置控制器参数，保留积分项和微分项的状态。
+   * @param[in] parameters 控制器参数，@ref Parameters。
+   */
+  /**
+   * @~English
+   * @brief Set the controller parameters, keeping the state of the integral and derivative terms.
+   * @param[in] parameters The controller parameters, @ref Parameters.
+   */
+  void SetParameters(const Parameters& parameters) {
+    parameters_ = parameters;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取控制器参数。
+   * @return 控制器参数，@ref Parameters。
+   */
+  /**
+   * @~English
+   * @brief Get the controller parameters.
+   * @return The controller parameters, @ref Parameters.
+   */
+  const Parameters& GetParameters() const {
+    return parameters_;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 清零积分项和微分项，下一次 @ref Update 不计算微分。
+   */
+  /**
+   * @~English
+   * @brief Clear the integral and derivative terms, the next @ref Update computes no derivative.
+   */
+  void Reset() {
+    integral_ = T();
+    derivative_ = T();
+    has_previous_ = false;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 执行一次控制计算。
+   * @param[in] setpoint 设定值r。
+   * @param[in] measurement 测量值y。
+   * @param[in] dt 距上一次更新的时间间隔，单位为时间单位，不大于0时积分项和微分项保持不变。
+   * @param[in] feedforward 叠加在输出上的前馈量，参与限幅和抗积分饱和计算。
+   * @return 限幅后的控制输出。
+   */
+  /**
+   * @~English
+   * @brief Run one control update.
+   * @param[in] setpoint The setpoint r.
+   * @param[in] measurement The measurement y.
+   * @param[in] dt The time since the previous update in time units, the integral and derivative terms are held when it
+   * is not positive.
+   * @param[in] feedforward A feed-forward term added to the output, included in the limiting and the anti-windup.
+   * @return The limited control output.
+   */
+  T Update(const T setpoint, const T measurement, const T dt, const T feedforward = T(0)) {
+    const T zero = T();
+    const T derivative_input = parameters_.derivative_setpoint_weight * setpoint - measurement;
+    if (dt > zero) {
+      integral_ += parameters_.ki * (setpoint - measurement) * dt;
+      if (has_previous_) {
+        // Backward Euler discretization of kd·s / (Tf·s + 1).
+        derivative_ = (parameters_.derivative_filter_time * derivative_ +
+                       parameters_.kd * (derivative_input - previous_derivative_input_)) /
+                      (parameters_.derivative_filter_time + dt);
+      }
+    }
+    previous_derivative_input_ = derivative_input;
+    has_previous_ = true;
+
+    const T unlimited =
+        feedforward + parameters_.kp * (parameters_.setpoint_weight * setpoint - measurement) + integral_ + derivative_;
+    const T output = std::clamp(unlimited, parameters_.output_min, parameters_.output_max);
+    if (dt > zero) {
+      integral_ += parameters_.tracking_gain * (output - unlimited) * dt;
+    }
+    integral_ = std::clamp(integral_, parameters_.output_min, parameters_.output_max);
+    return output;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取积分项，单位与输出相同。
+   * @return 积分项。
+   */
+  /**
+   * @~English
+   * @brief Get the integral term, in output units.
+   * @return The integral term.
+   */
+  T Integral() const {
+    return integral_;
+  }
+
+ private:
+  Parameters parameters_;
+  T integral_ = T(0);
+  T derivative_ = T(0);
+  T previous_derivative_input_ = T(0);
+  bool has_previous_ = false;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,197 @@
+#pragma once
+
+#ifndef _EM_QUADRATURE_DECODER_H_
+#define _EM_QUADRATURE_DECODER_H_
+
+/**
+ * @file quadrature_decoder.h
+ */
+
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class QuadratureDecoder
+ * @brief 基于查找表的正交编码解码器，支持一倍频、二倍频和四倍频解码。
+ * @details 以“上一次AB状态、当前AB状态”为索引查表得到计数增量，解码过程没有分支，可以直接在中断处理函数中调用。
+ * AB状态为 (A相电平 << 1) | B相电平，A相领先B相时状态按 00 -> 10 -> 11 -> 01 的顺序变化，计数增加。
+ * 同时统计非法状态跳变的次数用于诊断：四倍频下为A、B两相同时变化，一倍频和二倍频下为A相中断发生时A相电平没有按预期变化。
+ */
+/**
+ * @~English
+ * @class QuadratureDecoder
+ * @brief Lookup table based quadrature decoder supporting x1, x2 and x4 decoding.
+ * @details The count increment is looked up with the previous and the current AB state as index, so decoding has no
+ * branches and can be called directly from an interrupt handler. The AB state is (A level << 1) | B level, while phase
+ * A leads phase B the state walks 00 -> 10 -> 11 -> 01 and the count increases. Illegal transitions are counted for
+ * diagnostics: both phases changing at once for x4, and phase A not changing as expected on a phase A interrupt for x1
+ * and x2.
+ */
+class QuadratureDecoder {
+ public:
+  /**
+   * @~Chinese
+   * @brief 解码方式，枚举值即每个编码器脉冲对应的计数数量。
+   */
+  /**
+   * @~English
+   * @brief Decoding mode, the value is the number of counts per encoder pulse.
+   */
+  enum Mode : uint8_t {
+    /**
+     * @~Chinese
+     * @brief 一倍频，只在A相下降沿计数，需要A相下降沿中断。
+     */
+    /**
+     * @~English
+     * @brief x1, counts on the falling edge of phase A only, needs a phase A falling edge interrupt.
+     */
+    kX1 = 1,
+
+    /**
+     * @~Chinese
+     * @brief 二倍频，在A相的上升沿和下降沿计数，需要A相双边沿中断。
+     */
+    /**
+     * @~English
+     * @brief x2, counts on both edges of phase A, needs a phase A interrupt on both edges.
+     */
+    kX2 = 2,
+
+    /**
+     * @~Chinese
+     * @brief 四倍频，在A、B两相的所有边沿计数，需要A、B两相双边沿中断。
+     */
+    /**
+     * @~English
+     * @brief x4, counts on every edge of phase A and B, needs interrupts on both edges of both phases.
+     */
+    kX4 = 4,
+  };
+
+  /**
+   * @~Chinese
+   * @brief 构造函数，用于创建一个 QuadratureDecoder 对象。
+   * @param[in] mode 解码方式，@ref Mode。
+   */
+  /**
+   * @~English
+   * @brief Constructor for creating a QuadratureDecoder object.
+   * @param[in] mode The decoding mode, @ref Mode.
+   */
+  explicit QuadratureDecoder(const Mode mode = kX1) : table_(&TableOf(mode)), mode_(mode) {
+  }
+
+  /**
+   * @~Chinese
+   * @brief 设置当前的A、B相电平，并清零非法跳变计数。
+   * @param[in] a_level A相电平。
+   * @param[in] b_level B相电平。
+   */
+  /**
+   * @~English
+   * @brief Set the current levels of phase A and B, and clear the illegal transition count.
+   * @param[in] a_level The level of phase A.
+   * @param[in] b_level The level of phase B.
+   */
+  void Reset(const uint8_t a_level, const uint8_t b_level) {
+    state_ = ((a_level & 1) << 1) | (b_level & 1);
+    illegal_transitions_ = 0;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 输入新的A、B相电平，返回计数增量。
+   * @param[in] a_level A相电平。
+   * @param[in] b_level B相电平。
+   * @return 计数增量，-1、0或1。
+   */
+  /**
+   * @~English
+   * @brief Feed the new levels of phase A and B, returns the count increment.
+   * @param[in] a_level The level of phase A.
+   * @param[in] b_level The level of phase B.
+   * @return The count increment, -1, 0 or 1.
+   */
+  int8_t Update(const uint8_t a_level, const uint8_t b_level) {
+    const uint8_t current = ((a_level & 1) << 1) | (b_level & 1);
+    // x1 and x2 only see phase A edges, phase B may have changed in between, so only the A level of the stored state is
+    // kept (x2) or implied by the falling edge (x1).
+    const uint8_t previous = (state_ & table_->keep_mask) | (current & 1 & ~table_->keep_mask) | table_->force;
+    const uint8_t index = (previous << 2) | current;
+    illegal_transitions_ += table_->illegal[index];
+    state_ = current;
+    return table_->delta[index];
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取解码方式。
+   * @return 解码方式，@ref Mode。
+   */
+  /**
+   * @~English
+   * @brief Get the decoding mode.
+   * @return The decoding mode, @ref Mode.
+   */
+  Mode DecodingMode() const {
+    return mode_;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取自上次 @ref Reset 以来检测到的非法跳变次数。
+   * @return 非法跳变次数。
+   */
+  /**
+   * @~English
+   * @brief Get the number of illegal transitions detected since the last @ref Reset.
+   * @return The number of illegal transitions.
+   */
+  uint32_t IllegalTransitions() const {
+    return illegal_transitions_;
+  }
+
+ private:
+  struct Table {
+    int8_t delta[16];
+    uint8_t illegal[16];
+    uint8_t keep_mask;
+    uint8_t force;
+  };
+
+  // Indexed by (previous state << 2) | current state.
+  static constexpr Table kX1Table = {
+      {0, 0, 0, 0, 0, 0, 0, 0, -1, 0, 0, 0, 0, 1, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1},
+      0b00,
+      0b10,
+  };
+
+  static constexpr Table kX2Table = {
+      {0, 0, 1, 0, 0, 0, 0, -1, -1, 0, 0, 0, 0, 1, 0, 0},
+      {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1},
+      0b10,
+      0b00,
+  };
+
+  static constexpr Table kX4Table = {
+      {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0},
+      {0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 0},
+      0b11,
+      0b00,
+  };
+
+  static constexpr const Table& TableOf(const Mode mode) {
+    return mode == kX4 ? kX4Table : (mode == kX2 ? kX2Table : kX1Table);
+  }
+
+  const Table* table_ = nullptr;
+  Mode mode_ = kX1;
+  uint8_t state_ = 0;
+  uint32_t illegal_transitions_ = 0;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef _EM_SEQLOCK_H_
+#define _EM_SEQLOCK_H_
+
+/**
+ * @file seqlock.h
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class Seqlock
+ * @brief 顺序锁，用于单个写入者向任意多个读取者发布一个数据结构，读取者从不阻塞写入者。
+ * @details 写入者在写入前后各递增一次序号，读取者在读取前后检查序号，序号为奇数或前后不一致时重新读取，因此总是得到一次完整写入的结果。
+ * 数据按32位字以原子操作复制，多个写入者需要由调用者互斥。
+ * @tparam T 被发布的数据类型，必须可平凡复制。
+ */
+/**
+ * @~English
+ * @class Seqlock
+ * @brief Sequence lock publishing a data structure from a single writer to any number of readers, readers never block
+ * the writer.
+ * @details The writer increments a sequence number before and after writing, readers check it before and after reading
+ * and retry while it is odd or has changed, so they always see one complete write. The data is copied as atomic 32-bit
+ * words, multiple writers must be serialized by the caller.
+ * @tparam T The published data type, must be trivially copyable.
+ */
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ public:
+  /**
+   * @~Chinese
+   * @brief 发布新的数据。
+   * @param[in] value 新的数据。
+   */
+  /**
+   * @~English
+   * @brief Publish new data.
+   * @param[in] value The new data.
+   */
+  void Write(const T& value) {
+    std::array<uint32_t, kWords> words = {};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 读取最近一次发布的完整数据。
+   * @return 最近一次发布的数据。
+   */
+  /**
+   * @~English
+   * @brief Read the most recently published complete data.
+   * @return The most recently published data.
+   */
+  T Read() const {
+    std::array<uint32_t, kWords> words = {};
+    uint32_t sequence = 0;
+    do {
+      sequence = sequence_.load(std::memory_order_acquire);
+      for (size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != sequence_.load(std::memory_order_relaxed));
+
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> sequence_ = 0;
+  std::array<std::atomic<uint32_t>, kWords> words_ = {};
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * @file speed_auto_tuner.cpp
+ */
+
+#include "speed_auto_tuner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+void SpeedAutoTuner::Start(const int16_t step_duty, const int64_t now_us) {
+  phase_ = kBaseline;
+  step_duty_ = step_duty;
+  phase_start_us_ = now_us;
+  settle_start_us_ = now_us;
+  settle_reference_rpm_ = 0;
+  baseline_rpm_ = 0;
+  sample_count_ = 0;
+  stride_ = 1;
+  skipped_ = 0;
+  result_ = Result();
+}
+
+int16_t SpeedAutoTuner::Update(const int64_t now_us, const float speed_rpm) {
+  switch (phase_) {
+    case kBaseline: {
+      if (now_us - phase_start_us_ > kPhaseTimeoutUs) {
+        phase_ = kDone;
+        return 0;
+      }
+      if (!Settled(now_us, speed_rpm)) {
+        return step_duty_ / 2;
+      }
+      baseline_rpm_ = speed_rpm;
+      phase_ = kStep;
+      phase_start_us_ = now_us;
+      Record(now_us, speed_rpm);
+      return step_duty_;
+    }
+
+    case kStep: {
+      Record(now_us, speed_rpm);
+      if (now_us - phase_start_us_ > kPhaseTimeoutUs) {
+        phase_ = kDone;
+        return 0;
+      }
+      // Before the response has left the baseline the speed is flat too, don't mistake the dead time for settling.
+      const bool responded = std::fabs(speed_rpm - baseline_rpm_) >= kMinResponseRpm;
+      if (!Settled(now_us, speed_rpm) || !responded) {
+        return step_duty_;
+      }
+      Identify(speed_rpm);
+      phase_ = kDone;
+      return 0;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+bool SpeedAutoTuner::Done() const {
+  return phase_ == kDone;
+}
+
+const SpeedAutoTuner::Result& SpeedAutoTuner::GetResult() const {
+  return result_;
+}
+
+bool SpeedAutoTuner::Settled(const int64_t now_us, const float speed_rpm) {
+  const float band = std::max(kSettleBand * std::fabs(settle_reference_rpm_), kMinSettleBandRpm);
+  if (std::fabs(speed_rpm - settle_reference_rpm_) > band) {
+    settle_reference_rpm_ = speed_rpm;
+    settle_start_us_ = now_us;
+    return false;
+  }
+  return now_us - settle_start_us_ >= kSettleTimeUs;
+}
+
+void SpeedAutoTuner::Record(const int64_t now_us, const float speed_rpm) {
+  if (skipped_ + 1 < stride_) {
+    ++skipped_;
+    return;
+  }
+  skipped_ = 0;
+
+  if (sample_count_ == kMaxSamples) {
+    for (size_t i = 0; i < kMaxSamples / 2; ++i) {
+      samples_[i] = samples_[2 * i];
+    }
+    sample_count_ = kMaxSamples / 2;
+    stride_ *= 2;
+  }
+  samples_[sample_count_++] = {static_cast<int32_t>(now_us - phase_start_us_), speed_rpm};
+}
+
+void SpeedAutoTuner::Identify(const float final_rpm) {
+  const float response_rpm = final_rpm - baseline_rpm_;
+  const float step = step_duty_ - step_duty_ / 2;
+  if (std::fabs(response_rpm) < kMinResponseRpm || step == 0) {
+    return;
+  }
+
+  const float t28 = CrossingTimeS(baseline_rpm_ + 0.283f * response_rpm);
+  const float t63 = CrossingTimeS(baseline_rpm_ + 0.632f * response_rpm);
+  if (t28 < 0 || t63 < 0) {
+    return;
+  }
+
+  Model& model = result_.model;
+  model.gain = response_rpm / step;
+  model.time_constant_s = std::max(1.5f * (t63 - t28), 0.001f);
+  model.dead_time_s = std::max(t63 - model.time_constant_s, 0.0f);
+
+  // SIMC PI rules, the closed-loop time constant is kept at no less than half the open-loop one, since the measured speed
+  // is quantized and the dead time of small motors is often below one sample.
+  const float closed_loop_time_constant_s = std::max(model.dead_time_s, model.time_constant_s / 2);
+  const float horizon_s = closed_loop_time_constant_s + model.dead_time_s;
+  result_.kp = model.time_constant_s / (model.gain * horizon_s);
+  result_.ki = result_.kp / std::min(model.time_constant_s, 4 * horizon_s);
+  result_.kd = 0;
+  result_.success = true;
+}
+
+float SpeedAutoTuner::CrossingTimeS(const float level_rpm) const {
+  const float direction = level_rpm >= baseline_rpm_ ? 1 : -1;
+  for (size_t i = 0; i < sample_count_; ++i) {
+    const Sample& sample = samples_[i];
+    if (direction * (sample.speed_rpm - level_rpm) < 0) {
+      continue;
+    }
+    if (i == 0) {
+      return 0;
+    }
+    const Sample& previous = samples_[i - 1];
+    const float fraction = (level_rpm - previous.speed_rpm) / (sample.speed_rpm - previous.speed_rpm);
+    return (previous.time_us + fraction * (sample.time_us - previous.time_us)) / 1000000.0f;
+  }
+  return -1;
+}
+
+}  // namespace em
@@ -0,0 +1,249 @@
+#pragma once
+
+#ifndef _EM_SPEED_AUTO_TUNER_H_
+#define _EM_SPEED_AUTO_TUNER_H_
+
+/**
+ * @file speed_auto_tuner.h
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class SpeedAutoTuner
+ * @brief 基于阶跃响应的速度环PID自动整定。
+ * @details 整定分为两个阶段，每个控制周期调用一次 @ref Update，按返回的PWM占空比驱动电机：
+ * -# 以一半的阶跃占空比驱动电机，等待转速稳定，避开静摩擦造成的非线性。
+ * -# 将占空比阶跃到完整的阶跃占空比，记录转速响应直到再次稳定。
+ *
+ * 然后用两点法（28.3%和63.2%响应时刻）辨识一阶加纯滞后（FOPDT）模型，并按SIMC规则计算PI参数。
+ * 响应记录使用固定大小的缓冲区，记满时丢弃一半的样本并加倍采样间隔，因此不分配内存，也不限制响应时长。
+ */
+/**
+ * @~English
+ * @class SpeedAutoTuner
+ * @brief Step response based automatic tuning of the speed loop PID.
+ * @details Tuning has two phases, @ref Update is called once per control tick and the motor is driven with the PWM duty
+ * it returns:
+ * -# Drive the motor at half the step duty and wait for the speed to settle, away from the nonlinearity of static
+ * friction.
+ * -# Step the duty to the full step duty and record the speed response until it settles again.
+ *
+ * A first-order-plus-dead-time (FOPDT) model is then identified with the two-point method (28.3% and 63.2% response
+ * times), and PI gains are computed with the SIMC rules. The response is recorded in a fixed size buffer, which drops
+ * every other sample and doubles the sampling stride when full, so there is no allocation and no limit on the response
+ * duration.
+ */
+class SpeedAutoTuner {
+ public:
+  /**
+   * @~Chinese
+   * @brief 一阶加纯滞后模型：转速对PWM占空比的传递函数为 K·e^(−L·s) / (τ·s + 1)。
+   */
+  /**
+   * @~English
+   * @brief First-order-plus-dead-time model: the transfer function from PWM duty to speed is K·e^(−L·s) / (τ·s + 1).
+   */
+  struct Model {
+    /**
+     * @~Chinese
+     * @brief 静态增益K，单位为RPM/PWM占空比。
+     */
+    /**
+     * @~English
+     * @brief The static gain K in RPM per PWM duty.
+     */
+    float gain = 0;
+
+    /**
+     * @~Chinese
+     * @brief 时间常数τ，单位为秒。
+     */
+    /**
+     * @~English
+     * @brief The time constant τ in seconds.
+     */
+    float time_constant_s = 0;
+
+    /**
+     * @~Chinese
+     * @brief 纯滞后时间L，单位为秒，包含转速测量的延迟。
+     */
+    /**
+     * @~English
+     * @brief The dead time L in seconds, including the delay of the speed measurement.
+     */
+    float dead_time_s = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 整定结果。
+   */
+  /**
+   * @~English
+   * @brief Tuning result.
+   */
+  struct Result {
+    /**
+     * @~Chinese
+     * @brief 整定是否成功。转速响应太小或超时未稳定时失败。
+     */
+    /**
+     * @~English
+     * @brief Whether the tuning succeeded. It fails if the speed response is too small or doesn't settle in time.
+     */
+    bool success = false;
+
+    /**
+     * @~Chinese
+     * @brief 辨识得到的模型，@ref Model。
+     */
+    /**
+     * @~English
+     * @brief The identified model, @ref Model.
+     */
+    Model model;
+
+    /**
+     * @~Chinese
+     * @brief 比例增益，单位为PWM占空比/RPM。
+     */
+    /**
+     * @~English
+     * @brief The proportional gain in PWM duty per RPM.
+     */
+    float kp = 0;
+
+    /**
+     * @~Chinese
+     * @brief 积分增益，单位为PWM占空比/(RPM·秒)。
+     */
+    /**
+     * @~English
+     * @brief The integral gain in PWM duty per RPM second.
+     */
+    float ki = 0;
+
+    /**
+     * @~Chinese
+     * @brief 微分增益，单位为PWM占空比·秒/RPM，SIMC的PI规则下为0。
+     */
+    /**
+     * @~English
+     * @brief The derivative gain in PWM duty seconds per RPM, 0 with the SIMC PI rules.
+     */
+    float kd = 0;
+  };
+
+  /**
+   * @~Chinese
+   * @brief 每个阶段等待转速稳定的最长时间，单位为微秒，超时则整定失败。
+   */
+  /**
+   * @~English
+   * @brief The maximum time to wait for the speed to settle in each phase in microseconds, tuning fails on timeout.
+   */
+  static constexpr int64_t kPhaseTimeoutUs = 10000000;
+
+  /**
+   * @~Chinese
+   * @brief 开始整定。
+   * @param[in] step_duty 阶跃的PWM占空比，符号决定转动方向。
+   * @param[in] now_us 当前时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Start tuning.
+   * @param[in] step_duty The PWM duty of the step, its sign selects the direction.
+   * @param[in] now_us The current time in microseconds.
+   */
+  void Start(const int16_t step_duty, const int64_t now_us);
+
+  /**
+   * @~Chinese
+   * @brief 输入一个转速采样，推进整定过程。
+   * @param[in] now_us 采样时间，单位为微秒。
+   * @param[in] speed_rpm 测得的转速（RPM）。
+   * @return 接下来应施加的PWM占空比，整定结束后为0。
+   */
+  /**
+   * @~English
+   * @brief Feed a speed sample and advance the tuning.
+   * @param[in] now_us The sampling time in microseconds.
+   * @param[in] speed_rpm The measured speed in RPM.
+   * @return The PWM duty to apply next, 0 once tuning has finished.
+   */
+  int16_t Update(const int64_t now_us, const float speed_rpm);
+
+  /**
+   * @~Chinese
+   * @brief 查询整定是否已结束。
+   * @return 已结束返回true。
+   */
+  /**
+   * @~English
+   * @brief Query whether tuning has finished.
+   * @return true if finished.
+   */
+  bool Done() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取整定结果，仅在 @ref Done 返回true后有效。
+   * @return 整定结果，@ref Result。
+   */
+  /**
+   * @~English
+   * @brief Get the tuning result, only valid once @ref Done returns true.
+   * @return The tuning result, @ref Result.
+   */
+  const Result& GetResult() const;
+
+ private:
+  static constexpr size_t kMaxSamples = 128;
+  // The speed counts as settled once it stayed within this band for kSettleTimeUs.
+  static constexpr float kSettleBand = 0.02;
+  static constexpr float kMinSettleBandRpm = 2;
+  static constexpr int64_t kSettleTimeUs = 300000;
+  static constexpr float kMinResponseRpm = 5;
+
+  enum Phase : uint8_t {
+    kIdle,
+    kBaseline,
+    kStep,
+    kDone,
+  };
+
+  struct Sample {
+    int32_t time_us = 0;
+    float speed_rpm = 0;
+  };
+
+  bool Settled(const int64_t now_us, const float speed_rpm);
+
+  void Record(const int64_t now_us, const float speed_rpm);
+
+  void Identify(const float final_rpm);
+
+  float CrossingTimeS(const float level_rpm) const;
+
+  Phase phase_ = kIdle;
+  int16_t step_duty_ = 0;
+  int64_t phase_start_us_ = 0;
+  int64_t settle_start_us_ = 0;
+  float settle_reference_rpm_ = 0;
+  float baseline_rpm_ = 0;
+  std::array<Sample, kMaxSamples> samples_;
+  size_t sample_count_ = 0;
+  uint32_t stride_ = 1;
+  uint32_t skipped_ = 0;
+  Result result_;
+};
+}  // namespace em
+
+#endif
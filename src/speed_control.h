@@ -0,0 +1,420 @@
+#pragma once
+
+#ifndef _EM_SPEED_CONTROL_H_
+#define _EM_SPEED_CONTROL_H_
+
+/**
+ * @file speed_control.h
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+#include "edge_timestamp_buffer.h"
+#include "feedforward.h"
+#include "fixed_point.h"
+#include "pid_controller.h"
+#include "quadrature_decoder.h"
+
+/**
+ * @~Chinese
+ * @brief 为1时转速估算和速度PID使用 @ref em::Q16 定点数运算（@ref em::ControlNumber），不使用浮点运算，执行时间确定，
+ * 可以在不能使用FPU的中断中执行；默认为0，使用float。必须作为编译选项对库和程序统一定义（例如
+ * -DEM_ESP_ENCODER_MOTOR_FIXED_POINT=1）。定点数的取值范围为±32767，转速、PWM占空比以及中间结果都在此范围内。
+ */
+/**
+ * @~English
+ * @brief When 1, the speed estimation and the speed PID use @ref em::Q16 fixed-point arithmetic (@ref em::ControlNumber)
+ * without floating point, with a deterministic execution time, so they can run in interrupts that may not use the FPU.
+ * Defaults to 0, using float. Must be defined as a compiler flag for the library and the program alike (e.g.
+ * -DEM_ESP_ENCODER_MOTOR_FIXED_POINT=1). The fixed-point range is ±32767, speeds, PWM duties and intermediate results
+ * stay within it.
+ */
+#ifndef EM_ESP_ENCODER_MOTOR_FIXED_POINT
+#define EM_ESP_ENCODER_MOTOR_FIXED_POINT 0
+#endif
+
+namespace em {
+/**
+ * @~Chinese
+ * @brief 转速估算和速度PID的数值类型，由 @ref EM_ESP_ENCODER_MOTOR_FIXED_POINT 选择 @ref Q16 或float。
+ */
+/**
+ * @~English
+ * @brief The numeric type of the speed estimation and the speed PID, @ref Q16 or float as selected by
+ * @ref EM_ESP_ENCODER_MOTOR_FIXED_POINT.
+ */
+#if EM_ESP_ENCODER_MOTOR_FIXED_POINT
+using ControlNumber = Q16;
+#else
+using ControlNumber = float;
+#endif
+
+/**
+ * @~Chinese
+ * @brief 计算两个整数之商，定点数时只使用整数运算，四舍五入并在溢出时饱和。
+ * @tparam T 数值类型，浮点数或 @ref FixedPoint。
+ * @param[in] numerator 被除数。
+ * @param[in] denominator 除数，不能为0。
+ * @return 商。
+ */
+/**
+ * @~English
+ * @brief The quotient of two integers, computed with integer arithmetic only for fixed point, rounded and saturated on
+ * overflow.
+ * @tparam T The numeric type, floating point or @ref FixedPoint.
+ * @param[in] numerator The numerator.
+ * @param[in] denominator The denominator, must not be 0.
+ * @return The quotient.
+ */
+template <typename T>
+T Quotient(const int64_t numerator, const int64_t denominator) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return static_cast<T>(static_cast<double>(numerator) / denominator);
+  } else {
+    const int64_t scaled = numerator * T::kOne;
+    const int64_t magnitude = (std::abs(scaled) + std::abs(denominator) / 2) / std::abs(denominator);
+    const int64_t raw = (scaled < 0) == (denominator < 0) ? magnitude : -magnitude;
+    return T::FromRaw(static_cast<int32_t>(
+        std::clamp<int64_t>(raw, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max())));
+  }
+}
+
+/**
+ * @~Chinese
+ * @brief 四舍五入为整数，定点数时只使用整数运算。
+ * @tparam T 数值类型，浮点数或 @ref FixedPoint。
+ * @param[in] value 数值。
+ * @return 最接近的整数，恰好在两个整数中间时远离0。
+ */
+/**
+ * @~English
+ * @brief Round to an integer, with integer arithmetic only for fixed point.
+ * @tparam T The numeric type, floating point or @ref FixedPoint.
+ * @param[in] value The value.
+ * @return The nearest integer, halfway cases away from zero.
+ */
+template <typename T>
+int32_t RoundToInt(const T value) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return static_cast<int32_t>(value < 0 ? value - T(0.5) : value + T(0.5));
+  } else {
+    return (value.Raw() + (value.Raw() < 0 ? -T::kOne / 2 : T::kOne / 2)) / T::kOne;
+  }
+}
+
+/**
+ * @~Chinese
+ * @class SpeedEstimator
+ * @brief 由编码器计数估算转速（RPM）。
+ * @details 计数法（M法）用采样周期内的计数增量除以采样周期；有边沿时间戳时改用边沿计时：两次采样之间至少有一个完整的
+ * 编码器周期时，用两次采样各自最后一个边沿之间的计数和精确时间（M/T法），否则用最近一个完整编码器周期的时长（1/T法），
+ * 长时间没有新边沿时以距最后一个边沿的时间作为上限，超过 @ref kStandstillTimeoutUs 认为已停止。
+ * 除最后一步除法外都是整数运算，定点数时完全不使用浮点运算。
+ * @tparam T 数值类型，float或 @ref Q16。
+ */
+/**
+ * @~English
+ * @class SpeedEstimator
+ * @brief Estimates the speed in RPM from encoder counts.
+ * @details Counting (M method) divides the count increment of a sampling period by the period; with edge timestamps,
+ * edge timing is used instead: with at least one full encoder cycle between two samples, the counts and the exact time
+ * between the last edges of the two samples (M/T method), otherwise the duration of the latest full encoder cycle
+ * (1/T method), bounded by the time since the last edge while no new edge arrives, and standstill after
+ * @ref kStandstillTimeoutUs. Everything but the final division is integer arithmetic, fixed point uses no floating
+ * point at all.
+ * @tparam T The numeric type, float or @ref Q16.
+ */
+template <typename T>
+class SpeedEstimator {
+ public:
+  /**
+   * @~Chinese
+   * @brief 超过该时间没有新边沿时认为已停止，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief Standstill is assumed after this long without a new edge, in microseconds.
+   */
+  static constexpr int64_t kStandstillTimeoutUs = 500000;
+
+  /**
+   * @~Chinese
+   * @brief 重置估算器。
+   * @param[in] counts_per_revolution 输出轴每转的计数。
+   * @param[in] time_us 当前时间，单位为微秒。
+   * @param[in] count 当前计数。
+   */
+  /**
+   * @~English
+   * @brief Reset the estimator.
+   * @param[in] counts_per_revolution The counts per output shaft revolution.
+   * @param[in] time_us The current time in microseconds.
+   * @param[in] count The current count.
+   */
+  void Reset(const int64_t counts_per_revolution, const int64_t time_us, const int64_t count) {
+    counts_per_revolution_ = std::max<int64_t>(counts_per_revolution, 1);
+    last_timed_edge_.time_us = time_us;
+    last_timed_edge_.count = count;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 用计数法估算转速。
+   * @param[in] counts 采样周期内的计数增量。
+   * @param[in] duration_us 采样周期，单位为微秒，必须大于0。
+   * @return 转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief Estimate the speed by counting.
+   * @param[in] counts The count increment over the sampling period.
+   * @param[in] duration_us The sampling period in microseconds, must be positive.
+   * @return The speed in RPM.
+   */
+  T CountRate(const int64_t counts, const int64_t duration_us) const {
+    return Quotient<T>(counts * kMicrosecondsPerMinute, duration_us * counts_per_revolution_);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 用边沿计时估算转速，每个采样周期调用一次。
+   * @param[in] now_us 当前时间，单位为微秒。
+   * @param[in] edges 边沿时间戳缓冲区。
+   * @param[in] cycle_edges 一个完整编码器周期的边沿数，即解码倍数。
+   * @param[in] count_based 计数法的结果，边沿记录不足或读取失败时返回该值。
+   * @return 转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief Estimate the speed by edge timing, called once per sampling period.
+   * @param[in] now_us The current time in microseconds.
+   * @param[in] edges The edge timestamp buffer.
+   * @param[in] cycle_edges The edges of one full encoder cycle, i.e. the decoding multiple.
+   * @param[in] count_based The result of counting, returned when there are too few edges or reading them failed.
+   * @return The speed in RPM.
+   */
+  T EdgeTimed(const int64_t now_us, const EdgeTimestampBuffer& edges, const uint32_t cycle_edges, const T count_based) {
+    // The edges of one full encoder cycle, so that uneven duty and phase of the A/B signals cancel out.
+    EdgeTimestampBuffer::Edge latest[QuadratureDecoder::kX4 + 1];
+    if (cycle_edges > QuadratureDecoder::kX4 || !edges.Latest(latest, cycle_edges + 1)) {
+      return count_based;
+    }
+
+    const EdgeTimestampBuffer::Edge& last = latest[cycle_edges];
+    const int64_t counts = last.count - last_timed_edge_.count;
+    T rpm = T();
+    if (std::abs(counts) >= cycle_edges && last.time_us > last_timed_edge_.time_us) {
+      // M/T: the counts since the last edge of the previous sample over the exact time between the two edges.
+      rpm = Quotient<T>(counts * kMicrosecondsPerMinute, (last.time_us - last_timed_edge_.time_us) * counts_per_revolution_);
+    } else {
+      // 1/T: the latest full encoder cycle, bounded by the time since the last edge while no new edge arrives.
+      const int64_t since_last_edge_us = now_us - last.time_us;
+      const int64_t cycle_us = std::max<int64_t>(last.time_us - latest[0].time_us, 1);
+      if (since_last_edge_us < kStandstillTimeoutUs) {
+        rpm = Quotient<T>((last.count - latest[0].count) * kMicrosecondsPerMinute,
+                          std::max<int64_t>(cycle_us, since_last_edge_us * cycle_edges) * counts_per_revolution_);
+      }
+    }
+
+    last_timed_edge_ = last;
+    return rpm;
+  }
+
+ private:
+  static constexpr int64_t kMicrosecondsPerMinute = 60000000;
+
+  int64_t counts_per_revolution_ = 1;
+  EdgeTimestampBuffer::Edge last_timed_edge_;
+};
+
+/**
+ * @~Chinese
+ * @class SpeedController
+ * @brief 速度闭环的一步：前馈加速度PID，输出PWM占空比。
+ * @details 目标转速在死区 ±@ref kDeadZoneRpm 之内时输出0并重置PID。增益以50毫秒（@ref kReferencePeriodUs）为时间单位，
+ * 积分和微分按实际采样周期换算。前馈限制在PID的输出范围之内。参数以float设置，定点数时在设置时转换，@ref Update 中
+ * 不使用浮点运算。
+ * @tparam T 数值类型，float或 @ref Q16。
+ */
+/**
+ * @~English
+ * @class SpeedController
+ * @brief One step of the speed loop: feed-forward plus speed PID, producing the PWM duty.
+ * @details Outputs 0 and resets the PID while the target is within the dead zone ±@ref kDeadZoneRpm. The gains use
+ * 50 ms (@ref kReferencePeriodUs) as time unit, the integral and the derivative are scaled to the actual sampling period.
+ * The feed-forward is limited to the output range of the PID. The parameters are set as float and converted when set
+ * for fixed point, @ref Update uses no floating point.
+ * @tparam T The numeric type, float or @ref Q16.
+ */
+template <typename T>
+class SpeedController {
+ public:
+  /**
+   * @~Chinese
+   * @brief PID增益的时间单位，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The time unit of the PID gains in microseconds.
+   */
+  static constexpr int64_t kReferencePeriodUs = 50000;
+
+  /**
+   * @~Chinese
+   * @brief 目标转速死区（RPM）。
+   */
+  /**
+   * @~English
+   * @brief The target speed dead zone in RPM.
+   */
+  static constexpr int32_t kDeadZoneRpm = 10;
+
+  /**
+   * @~Chinese
+   * @brief 设置PID参数。
+   * @param[in] parameters PID参数，时间单位为 @ref kReferencePeriodUs。
+   */
+  /**
+   * @~English
+   * @brief Set the PID parameters.
+   * @param[in] parameters The PID parameters, with @ref kReferencePeriodUs as time unit.
+   */
+  void SetParameters(const typename PidController<float>::Parameters& parameters) {
+    parameters_ = parameters;
+    typename PidController<T>::Parameters converted;
+    converted.kp = T(parameters.kp);
+    converted.ki = T(parameters.ki);
+    converted.kd = T(parameters.kd);
+    converted.setpoint_weight = T(parameters.setpoint_weight);
+    converted.derivative_setpoint_weight = T(parameters.derivative_setpoint_weight);
+    converted.derivative_filter_time = T(parameters.derivative_filter_time);
+    converted.tracking_gain = T(parameters.tracking_gain);
+    converted.output_min = T(parameters.output_min);
+    converted.output_max = T(parameters.output_max);
+    pid_.SetParameters(converted);
+    output_min_ = converted.output_min;
+    output_max_ = converted.output_max;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取PID参数。
+   * @return 以float表示的PID参数。
+   */
+  /**
+   * @~English
+   * @brief Get the PID parameters.
+   * @return The PID parameters as float.
+   */
+  const typename PidController<float>::Parameters& GetParameters() const {
+    return parameters_;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 设置前馈参数。
+   * @param[in] feedforward 前馈参数，@ref Feedforward。
+   */
+  /**
+   * @~English
+   * @brief Set the feed-forward parameters.
+   * @param[in] feedforward The feed-forward parameters, @ref Feedforward.
+   */
+  void SetFeedforward(const Feedforward& feedforward) {
+    ks_ = T(feedforward.ks);
+    kv_ = T(feedforward.kv);
+    // The acceleration is taken per reference period; the fixed-point conversion saturates gains out of range.
+    ka_ = T(feedforward.ka * 1000000.0 / kReferencePeriodUs);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 重置PID和上一次的目标转速。
+   */
+  /**
+   * @~English
+   * @brief Reset the PID and the previous target speed.
+   */
+  void Reset() {
+    pid_.Reset();
+    previous_target_rpm_ = 0;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 重置PID，保留上一次的目标转速。
+   */
+  /**
+   * @~English
+   * @brief Reset the PID, keeping the previous target speed.
+   */
+  void ResetPid() {
+    pid_.Reset();
+  }
+
+  /**
+   * @~Chinese
+   * @brief 计算一个控制周期的PWM占空比。
+   * @param[in] target_rpm 目标转速（RPM）。
+   * @param[in] speed_rpm 测得的转速（RPM）。
+   * @param[in] period_us 采样周期，单位为微秒。
+   * @return PWM占空比。
+   */
+  /**
+   * @~English
+   * @brief Compute the PWM duty of one control tick.
+   * @param[in] target_rpm The target speed in RPM.
+   * @param[in] speed_rpm The measured speed in RPM.
+   * @param[in] period_us The sampling period in microseconds.
+   * @return The PWM duty.
+   */
+  int16_t Update(const int32_t target_rpm, const T speed_rpm, const int64_t period_us) {
+    const T target_acceleration =
+        period_us > 0 ? Quotient<T>((target_rpm - previous_target_rpm_) * kReferencePeriodUs, period_us) : T();
+    previous_target_rpm_ = target_rpm;
+
+    if (target_rpm < kDeadZoneRpm && target_rpm > -kDeadZoneRpm) {
+      pid_.Reset();
+      return 0;
+    }
+
+    const T target = Quotient<T>(target_rpm, 1);
+    // Short periods turn a target step into a large acceleration, the feed-forward is limited to the output range so
+    // that Q16 saturating at ±32768 and float unwind the integral the same way.
+    const T feedforward = std::clamp((target_rpm > 0 ? ks_ : -ks_) + kv_ * target + ka_ * target_acceleration,
+                                     output_min_,
+                                     output_max_);
+    return RoundToInt(pid_.Update(target, speed_rpm, Quotient<T>(period_us, kReferencePeriodUs), feedforward));
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取PID的积分项。
+   * @return 积分项，以PWM占空比为单位。
+   */
+  /**
+   * @~English
+   * @brief Get the integral term of the PID.
+   * @return The integral term in PWM duty units.
+   */
+  T Integral() const {
+    return pid_.Integral();
+  }
+
+ private:
+  typename PidController<float>::Parameters parameters_;
+  PidController<T> pid_;
+  T ks_ = T();
+  T kv_ = T();
+  T ka_ = T();
+  T output_min_ = T();
+  T output_max_ = T();
+  int32_t previous_target_rpm_ = 0;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file speed_ramp.cpp
+ */
+
+#include "speed_ramp.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace em {
+
+void SpeedRamp::SetLimits(const float max_acceleration, const float max_jerk) {
+  max_acceleration_ = std::max(max_acceleration, 0.0f);
+  max_jerk_ = std::max(max_jerk, 0.0f);
+  if (max_jerk_ <= 0) {
+    acceleration_ = std::clamp(acceleration_, -max_acceleration_, max_acceleration_);
+  }
+}
+
+bool SpeedRamp::Enabled() const {
+  return max_acceleration_ > 0;
+}
+
+void SpeedRamp::Reset(const float speed) {
+  setpoint_ = speed;
+  acceleration_ = 0;
+}
+
+float SpeedRamp::Update(const float target, const int64_t period_us) {
+  if (!Enabled()) {
+    Reset(target);
+    return setpoint_;
+  }
+  if (period_us <= 0) {
+    return setpoint_;
+  }
+
+  const float period_s = period_us / 1000000.0f;
+  const float error = target - setpoint_;
+  // The acceleration that can still be ramped down at the maximum jerk to land on the target, and that doesn't pass
+  // the target within this period.
+  float acceleration = std::min(max_acceleration_, std::fabs(error) / period_s);
+  if (max_jerk_ > 0) {
+    acceleration = std::min(acceleration, std::sqrt(2 * max_jerk_ * std::fabs(error)));
+  }
+  acceleration = std::copysign(acceleration, error);
+
+  if (max_jerk_ > 0) {
+    const float jerk_step = max_jerk_ * period_s;
+    acceleration_ = std::clamp(acceleration, acceleration_ - jerk_step, acceleration_ + jerk_step);
+  } else {
+    acceleration_ = acceleration;
+  }
+  setpoint_ += acceleration_ * period_s;
+
+  // Reaching the target with an acceleration that can be stopped within one period ends the ramp, passing it with more
+  // is an overshoot forced by the jerk limit after a change of the target.
+  if ((target - setpoint_) * error <= 0 && (max_jerk_ <= 0 || std::fabs(acceleration_) <= max_jerk_ * period_s)) {
+    Reset(target);
+  }
+  return setpoint_;
+}
+
+float SpeedRamp::Setpoint() const {
+  return setpoint_;
+}
+
+float SpeedRamp::Acceleration() const {
+  return acceleration_;
+}
+
+}  // namespace em
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef _EM_SPEED_RAMP_H_
+#define _EM_SPEED_RAMP_H_
+
+/**
+ * @file speed_ramp.h
+ */
+
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class SpeedRamp
+ * @brief 在线速度设定值生成器，每个控制周期以受限的加速度和加加速度将设定值推向目标速度。
+ * @details 与 @ref MotionProfile 不同，不预先规划，目标可以在斜坡途中随时改变，设定值从当前的速度和加速度平滑地转向新目标。
+ * 限制加加速度时，加速度按加加速度线性变化，并在恰好到达目标时降为0；加加速度为0时为梯形斜坡，加速度可以突变。
+ * 速度单位由调用者决定，例如RPM、RPM/秒、RPM/秒²。
+ */
+/**
+ * @~English
+ * @class SpeedRamp
+ * @brief Online speed setpoint generator, moves the setpoint towards the target speed with limited acceleration and
+ * jerk every control tick.
+ * @details Unlike @ref MotionProfile nothing is planned in advance, the target may change at any time during the ramp
+ * and the setpoint turns smoothly from its current speed and acceleration towards the new target. With a jerk limit the
+ * acceleration changes linearly at that jerk and returns to 0 exactly when the target is reached, with a jerk of 0 the
+ * ramp is trapezoidal and the acceleration may jump. The speed unit is up to the caller, e.g. RPM, RPM/s, RPM/s².
+ */
+class SpeedRamp {
+ public:
+  /**
+   * @~Chinese
+   * @brief 设置斜坡的限制。
+   * @param[in] max_acceleration 最大加速度，0表示不使用斜坡，设定值直接跳到目标。
+   * @param[in] max_jerk 最大加加速度，0表示不限制。
+   */
+  /**
+   * @~English
+   * @brief Set the limits of the ramp.
+   * @param[in] max_acceleration The maximum acceleration, 0 disables the ramp and the setpoint jumps to the target.
+   * @param[in] max_jerk The maximum jerk, 0 for unlimited.
+   */
+  void SetLimits(const float max_acceleration, const float max_jerk);
+
+  /**
+   * @~Chinese
+   * @brief 查询是否使用斜坡，即最大加速度大于0。
+   * @return 使用斜坡返回true，否则返回false。
+   */
+  /**
+   * @~English
+   * @brief Query whether the ramp is enabled, i.e. the maximum acceleration is greater than 0.
+   * @return true if enabled, false otherwise.
+   */
+  bool Enabled() const;
+
+  /**
+   * @~Chinese
+   * @brief 将设定值设为给定速度，加速度设为0，例如从其它控制模式切换过来时设为电机当前的转速。
+   * @param[in] speed 速度。
+   */
+  /**
+   * @~English
+   * @brief Set the setpoint to the given speed at zero acceleration, e.g. to the current motor speed when switching
+   * from another control mode.
+   * @param[in] speed The speed.
+   */
+  void Reset(const float speed);
+
+  /**
+   * @~Chinese
+   * @brief 将设定值向目标推进一个控制周期。
+   * @param[in] target 目标速度。
+   * @param[in] period_us 控制周期，单位为微秒。
+   * @return 新的设定值。
+   */
+  /**
+   * @~English
+   * @brief Advance the setpoint towards the target by one control period.
+   * @param[in] target The target speed.
+   * @param[in] period_us The control period in microseconds.
+   * @return The new setpoint.
+   */
+  float Update(const float target, const int64_t period_us);
+
+  /**
+   * @~Chinese
+   * @brief 获取当前的设定值。
+   * @return 设定值。
+   */
+  /**
+   * @~English
+   * @brief Get the current setpoint.
+   * @return The setpoint.
+   */
+  float Setpoint() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取设定值当前的加速度。
+   * @return 加速度，单位为速度单位/秒。
+   */
+  /**
+   * @~English
+   * @brief Get the current acceleration of the setpoint.
+   * @return The acceleration in speed units per second.
+   */
+  float Acceleration() const;
+
+ private:
+  float max_acceleration_ = 0;
+  float max_jerk_ = 0;
+  float setpoint_ = 0;
+  float acceleration_ = 0;
+};
+}  // namespace em
+
+#endif
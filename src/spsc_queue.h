@@ -0,0 +1,131 @@
+#pragma once
+
+#ifndef _EM_SPSC_QUEUE_H_
+#define _EM_SPSC_QUEUE_H_
+
+/**
+ * @file spsc_queue.h
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace em {
+/**
+ * @~Chinese
+ * @class SpscQueue
+ * @brief 无锁的定长先进先出队列，单个生产者，单个消费者。
+ * @details 两端都从不阻塞：队列满时写入失败，由生产者决定重试或丢弃；队列空时读取失败。生产者和消费者可以运行在不同的
+ * 核心上，各自只写自己的索引。
+ * @tparam T 元素类型，必须可平凡复制。
+ * @tparam kCapacity 队列容量，必须为2的幂。
+ */
+/**
+ * @~English
+ * @class SpscQueue
+ * @brief Lock-free fixed-size first-in first-out queue with a single producer and a single consumer.
+ * @details Neither side ever blocks: pushing fails when the queue is full, leaving retrying or dropping to the
+ * producer, and reading fails when it is empty. The producer and the consumer may run on different cores, each only
+ * writes its own index.
+ * @tparam T The element type, must be trivially copyable.
+ * @tparam kCapacity The queue capacity, must be a power of two.
+ */
+template <typename T, uint32_t kCapacity>
+class SpscQueue {
+ public:
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0);
+
+  /**
+   * @~Chinese
+   * @brief 写入元素，只能由生产者调用。
+   * @param[in] elements 要写入的元素。
+   * @param[in] count 元素数量。
+   * @return 写入的元素数量，队列剩余空间不足时只写入前面的部分。
+   */
+  /**
+   * @~English
+   * @brief Push elements, only called by the producer.
+   * @param[in] elements The elements to push.
+   * @param[in] count The number of elements.
+   * @return The number of elements pushed, only the leading ones when the remaining space is too small.
+   */
+  size_t Push(const T* const elements, const size_t count) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    const uint32_t space = kCapacity - (tail - head_.load(std::memory_order_acquire));
+    const uint32_t n = count < space ? count : space;
+    for (uint32_t i = 0; i < n; ++i) {
+      elements_[(tail + i) & (kCapacity - 1)] = elements[i];
+    }
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 读取队首元素但不移除，只能由消费者调用。
+   * @param[out] element 用于存放队首元素。
+   * @return 队列不为空返回true，否则返回false。
+   */
+  /**
+   * @~English
+   * @brief Read the front element without removing it, only called by the consumer.
+   * @param[out] element Receives the front element.
+   * @return true if the queue is not empty, false otherwise.
+   */
+  bool Front(T& element) const {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head) {
+      return false;
+    }
+    element = elements_[head & (kCapacity - 1)];
+    return true;
+  }
+
+  /**
+   * @~Chinese
+   * @brief 移除队首元素，只能由消费者在 @ref Front 成功之后调用。
+   */
+  /**
+   * @~English
+   * @brief Remove the front element, only called by the consumer after a successful @ref Front.
+   */
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 移除所有元素，只能由消费者调用。
+   */
+  /**
+   * @~English
+   * @brief Remove all elements, only called by the consumer.
+   */
+  void Clear() {
+    head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  /**
+   * @~Chinese
+   * @brief 获取剩余空间，生产者调用时结果只会偏小。
+   * @return 还能写入的元素数量。
+   */
+  /**
+   * @~English
+   * @brief Get the remaining space, never too large when called by the producer.
+   * @return The number of elements that can still be pushed.
+   */
+  size_t Space() const {
+    return kCapacity - (tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+  }
+
+ private:
+  std::array<T, kCapacity> elements_ = {};
+  std::atomic<uint32_t> head_ = 0;
+  std::atomic<uint32_t> tail_ = 0;
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#ifndef _EM_STATIC_ENCODER_MOTOR_H_
+#define _EM_STATIC_ENCODER_MOTOR_H_
+
+/**
+ * @file static_encoder_motor.h
+ */
+
+#include <cstdint>
+
+#include "esp_encoder_motor.h"
+#include "hal.h"
+
+namespace em {
+/**
+ * @~Chinese
+ * @class StaticEncoderMotor
+ * @brief 引脚、每转计数和相位关系在编译期确定的编码电机，接口与 @ref EspEncoderMotor 相同。
+ * @details 适用于硬件固定的板卡：参数错误（引脚重复、每转脉冲数或减速比为0、每转计数溢出）在编译时报错，编码器中断处理函数
+ * 针对这组引脚和方向生成，不再从对象中读取引脚、也不再乘以方向。电机对象不含任何堆内存，定义为全局对象时与
+ * @ref StaticControlScheduler 一起在链接时确定全部内存占用，初始化之后的控制循环不分配堆内存。
+ * 定义示例：
+ * @code
+ * em::StaticControlScheduler<10000> g_scheduler;
+ * em::StaticEncoderMotor<GPIO_NUM_27, GPIO_NUM_13, GPIO_NUM_18, GPIO_NUM_19, 12, 90> g_motor;
+ * @endcode
+ * @tparam kPinPositive 电机正极引脚编号。
+ * @tparam kPinNegative 电机负极引脚编号。
+ * @tparam kPinA 编码器A相引脚编号。
+ * @tparam kPinB 编码器B相引脚编号。
+ * @tparam kPpr 每转脉冲数。
+ * @tparam kReductionRatio 减速比。
+ * @tparam kPhaseRelation 相位关系，@ref EspEncoderMotor::PhaseRelation，默认为A相领先。
+ */
+/**
+ * @~English
+ * @class StaticEncoderMotor
+ * @brief Encoder motor whose pins, counts per revolution and phase relation are fixed at compile time, with the same
+ * interface as @ref EspEncoderMotor.
+ * @details Meant for boards with fixed wiring: wrong parameters (duplicate pins, zero pulses per revolution or reduction
+ * ratio, overflowing counts per revolution) fail to compile, and the encoder interrupt handler is generated for this set
+ * of pins and direction, so it no longer loads the pins from the object nor multiplies by the direction. The motor owns
+ * no heap memory; defined as a global next to a @ref StaticControlScheduler its whole footprint is fixed at link time,
+ * and the control loop allocates no heap memory after initialization.
+ * Example definition:
+ * @code
+ * em::StaticControlScheduler<10000> g_scheduler;
+ * em::StaticEncoderMotor<GPIO_NUM_27, GPIO_NUM_13, GPIO_NUM_18, GPIO_NUM_19, 12, 90> g_motor;
+ * @endcode
+ * @tparam kPinPositive The pin number of the motor's positive pole.
+ * @tparam kPinNegative The pin number of the motor's negative pole.
+ * @tparam kPinA The pin number of the encoder's A phase.
+ * @tparam kPinB The pin number of the encoder's B phase.
+ * @tparam kPpr Pulses per revolution.
+ * @tparam kReductionRatio Reduction ratio.
+ * @tparam kPhaseRelation The phase relation, @ref EspEncoderMotor::PhaseRelation, defaults to phase A leading.
+ */
+template <uint8_t kPinPositive,
+          uint8_t kPinNegative,
+          uint8_t kPinA,
+          uint8_t kPinB,
+          uint32_t kPpr,
+          uint32_t kReductionRatio,
+          EspEncoderMotor::PhaseRelation kPhaseRelation = EspEncoderMotor::kAPhaseLeads>
+class StaticEncoderMotor : public EspEncoderMotor {
+ public:
+  static_assert(kPpr > 0 && kReductionRatio > 0, "pulses per revolution and reduction ratio must be positive");
+  static_assert(kPpr <= UINT32_MAX / 4 / kReductionRatio, "counts per revolution overflow with x4 decoding");
+  static_assert(kPinPositive != kPinNegative && kPinA != kPinB && kPinA != kPinPositive && kPinA != kPinNegative &&
+                    kPinB != kPinPositive && kPinB != kPinNegative,
+                "the motor and encoder pins must be distinct");
+
+  /**
+   * @~Chinese
+   * @brief 输出轴每转的编码器脉冲数（一倍频）。
+   */
+  /**
+   * @~English
+   * @brief The encoder pulses per output shaft revolution (x1 decoding).
+   */
+  static constexpr uint32_t kPulsesPerRevolution = kPpr * kReductionRatio;
+
+  /**
+   * @~Chinese
+   * @brief 计数方向，A相领先为1，B相领先为-1。
+   */
+  /**
+   * @~English
+   * @brief The counting direction, 1 if phase A leads, -1 if phase B leads.
+   */
+  static constexpr int8_t kDirection = kPhaseRelation == EspEncoderMotor::kAPhaseLeads ? 1 : -1;
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] hal 用于PWM输出、编码器中断和计时的硬件抽象层，默认为当前平台的 @ref DefaultHal。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] hal The hardware abstraction layer used for PWM output, encoder interrupts and timing, defaults to
+   * @ref DefaultHal of the current platform.
+   */
+  explicit StaticEncoderMotor(Hal& hal = DefaultHal())
+      : EspEncoderMotor(kPinPositive,
+                        kPinNegative,
+                        kPinA,
+                        kPinB,
+                        kPpr,
+                        kReductionRatio,
+                        kPhaseRelation,
+                        hal,
+                        StaticEncoderMotor::OnEncoderEdge) {
+  }
+
+ private:
+  static void OnEncoderEdge(void* self) {
+    static_cast<StaticEncoderMotor*>(reinterpret_cast<EspEncoderMotor*>(self))
+        ->template DecodeEncoderEdge<kPinA, kPinB, kDirection>();
+  }
+};
+}  // namespace em
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * @file telemetry_recorder.cpp
+ */
+
+#include "telemetry_recorder.h"
+
+#include <cstring>
+
+namespace em {
+
+namespace {
+constexpr uint8_t kSync0 = 0xA5;
+constexpr uint8_t kSync1 = 0x5A;
+constexpr uint8_t kPayloadSize = TelemetryRecorder::kFrameSize - 5;
+// The CRC covers the length byte and the payload.
+constexpr size_t kCrcBegin = 2;
+constexpr size_t kCrcEnd = TelemetryRecorder::kFrameSize - 2;
+
+uint16_t Crc16(const uint8_t* const data, const size_t size) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void PutLittleEndian(uint8_t* const data, const uint64_t value, const size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint64_t GetLittleEndian(const uint8_t* const data, const size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint32_t FloatBits(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float BitsFloat(const uint32_t bits) {
+  float value = 0;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+size_t FloorPowerOfTwo(const size_t value) {
+  size_t power = 1;
+  while (power <= value / 2) {
+    power *= 2;
+  }
+  return value == 0 ? 0 : power;
+}
+}  // namespace
+
+TelemetryRecorder::TelemetryRecorder(const uint8_t id, TelemetryRecord* const buffer, const size_t capacity)
+    : id_(id), buffer_(buffer), capacity_(buffer == nullptr ? 0 : FloorPowerOfTwo(capacity)) {
+}
+
+uint8_t TelemetryRecorder::Id() const {
+  return id_;
+}
+
+bool TelemetryRecorder::Record(const TelemetryRecord& record) {
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) >= capacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  buffer_[head & (capacity_ - 1)] = record;
+  // Releases the slot contents to the reader.
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool TelemetryRecorder::Pop(TelemetryRecord* const record) {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail == head_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  if (record != nullptr) {
+    *record = buffer_[tail & (capacity_ - 1)];
+  }
+  // Hands the slot back to the writer only after it has been copied out.
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+size_t TelemetryRecorder::Size() const {
+  return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+uint32_t TelemetryRecorder::Dropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+size_t TelemetryRecorder::Stream(const ByteSink& sink, const size_t max_records) {
+  if (!sink) {
+    return 0;
+  }
+
+  size_t count = 0;
+  TelemetryRecord record;
+  uint8_t frame[kFrameSize];
+  while (count < max_records && Pop(&record)) {
+    EncodeFrame(id_, record, frame);
+    if (sink(frame, kFrameSize) != kFrameSize) {
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+void TelemetryRecorder::EncodeFrame(const uint8_t id, const TelemetryRecord& record, uint8_t* const frame) {
+  frame[0] = kSync0;
+  frame[1] = kSync1;
+  frame[2] = kPayloadSize;
+  frame[3] = id;
+  PutLittleEndian(frame + 4, static_cast<uint64_t>(record.time_us), 8);
+  PutLittleEndian(frame + 12, static_cast<uint64_t>(record.pulse_count), 8);
+  PutLittleEndian(frame + 20, FloatBits(record.target_rpm), 4);
+  PutLittleEndian(frame + 24, FloatBits(record.speed_rpm), 4);
+  PutLittleEndian(frame + 28, static_cast<uint16_t>(record.pwm_duty), 2);
+  PutLittleEndian(frame + kCrcEnd, Crc16(frame + kCrcBegin, kCrcEnd - kCrcBegin), 2);
+}
+
+bool TelemetryDecoder::Push(const uint8_t byte, uint8_t* const id, TelemetryRecord* const record) {
+  if ((size_ == 0 && byte != kSync0) || (size_ == 1 && byte != kSync1) || (size_ == 2 && byte != kPayloadSize)) {
+    // Restart the search, the byte itself may be the first sync byte.
+    size_ = 0;
+    if (byte == kSync0) {
+      frame_[size_++] = byte;
+    }
+    return false;
+  }
+
+  frame_[size_++] = byte;
+  if (size_ < frame_.size()) {
+    return false;
+  }
+  size_ = 0;
+
+  if (GetLittleEndian(frame_.data() + kCrcEnd, 2) != Crc16(frame_.data() + kCrcBegin, kCrcEnd - kCrcBegin)) {
+    ++crc_errors_;
+    // Rescan the bytes after the false sync word, a real frame may start among them.
+    const auto rejected = frame_;
+    for (size_t i = 1; i < rejected.size(); ++i) {
+      Push(rejected[i], nullptr, nullptr);
+    }
+    return false;
+  }
+
+  if (id != nullptr) {
+    *id = frame_[3];
+  }
+  if (record != nullptr) {
+    record->time_us = static_cast<int64_t>(GetLittleEndian(frame_.data() + 4, 8));
+    record->pulse_count = static_cast<int64_t>(GetLittleEndian(frame_.data() + 12, 8));
+    record->target_rpm = BitsFloat(GetLittleEndian(frame_.data() + 20, 4));
+    record->speed_rpm = BitsFloat(GetLittleEndian(frame_.data() + 24, 4));
+    record->pwm_duty = static_cast<int16_t>(GetLittleEndian(frame_.data() + 28, 2));
+  }
+  return true;
+}
+
+uint32_t TelemetryDecoder::CrcErrors() const {
+  return crc_errors_;
+}
+
+}  // namespace em
@@ -0,0 +1,359 @@
+#pragma once
+
+#ifndef _EM_TELEMETRY_RECORDER_H_
+#define _EM_TELEMETRY_RECORDER_H_
+
+/**
+ * @file telemetry_recorder.h
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace em {
+/**
+ * @~Chinese
+ * @brief 一个控制周期的遥测记录。
+ */
+/**
+ * @~English
+ * @brief The telemetry record of one control tick.
+ */
+struct TelemetryRecord {
+  /**
+   * @~Chinese
+   * @brief 采样时间，单位为微秒。
+   */
+  /**
+   * @~English
+   * @brief The sampling time in microseconds.
+   */
+  int64_t time_us = 0;
+
+  /**
+   * @~Chinese
+   * @brief 编码器脉冲计数。
+   */
+  /**
+   * @~English
+   * @brief The encoder pulse count.
+   */
+  int64_t pulse_count = 0;
+
+  /**
+   * @~Chinese
+   * @brief 目标转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief The target speed in RPM.
+   */
+  float target_rpm = 0;
+
+  /**
+   * @~Chinese
+   * @brief 测得的转速（RPM）。
+   */
+  /**
+   * @~English
+   * @brief The measured speed in RPM.
+   */
+  float speed_rpm = 0;
+
+  /**
+   * @~Chinese
+   * @brief PWM占空比。
+   */
+  /**
+   * @~English
+   * @brief The PWM duty.
+   */
+  int16_t pwm_duty = 0;
+};
+
+/**
+ * @~Chinese
+ * @class TelemetryRecorder
+ * @brief 单生产者单消费者的遥测环形缓冲区，由控制周期写入，由 @c loop() 或其他任务读出并以二进制帧流式输出。
+ * @details 缓冲区由调用者预先分配（或使用 @ref StaticTelemetryRecorder），写入端只有原子的下标读写，不加锁、不分配内存；
+ * 缓冲区满时丢弃新记录并计数。
+ *
+ * 每条记录编码为 @ref kFrameSize 字节的帧（小端序）：
+ * | 偏移 | 长度 | 内容 |
+ * | ---- | ---- | ---- |
+ * | 0 | 2 | 同步字 0xA5 0x5A |
+ * | 2 | 1 | 负载长度，27 |
+ * | 3 | 1 | 记录器编号 |
+ * | 4 | 8 | 采样时间（微秒），int64 |
+ * | 12 | 8 | 编码器脉冲计数，int64 |
+ * | 20 | 4 | 目标转速（RPM），float32 |
+ * | 24 | 4 | 测得的转速（RPM），float32 |
+ * | 28 | 2 | PWM占空比，int16 |
+ * | 30 | 2 | 对偏移2到29计算的CRC-16/CCITT-FALSE |
+ *
+ * 接收端用 @ref TelemetryDecoder 解码，同步字和CRC使其可以在丢字节后重新同步。
+ */
+/**
+ * @~English
+ * @class TelemetryRecorder
+ * @brief Single-producer single-consumer telemetry ring buffer, written by the control tick and read out by @c loop()
+ * or another task, which streams it as binary frames.
+ * @details The buffer is preallocated by the caller (or use @ref StaticTelemetryRecorder), the writer side only does
+ * atomic index loads and stores, without locks or allocation; new records are dropped and counted when the buffer is
+ * full.
+ *
+ * Each record is encoded as a frame of @ref kFrameSize bytes (little endian):
+ * | Offset | Size | Content |
+ * | ------ | ---- | ------- |
+ * | 0 | 2 | Sync word 0xA5 0x5A |
+ * | 2 | 1 | Payload length, 27 |
+ * | 3 | 1 | Recorder id |
+ * | 4 | 8 | Sampling time in microseconds, int64 |
+ * | 12 | 8 | Encoder pulse count, int64 |
+ * | 20 | 4 | Target speed in RPM, float32 |
+ * | 24 | 4 | Measured speed in RPM, float32 |
+ * | 28 | 2 | PWM duty, int16 |
+ * | 30 | 2 | CRC-16/CCITT-FALSE over offsets 2 to 29 |
+ *
+ * The receiver decodes it with @ref TelemetryDecoder, the sync word and the CRC let it resynchronize after lost bytes.
+ */
+class TelemetryRecorder {
+ public:
+  /**
+   * @~Chinese
+   * @brief 字节输出函数类型，例如写串口或文件。
+   * @param[in] data 要输出的数据。
+   * @param[in] size 数据长度。
+   * @return 实际输出的字节数。
+   */
+  /**
+   * @~English
+   * @brief Byte sink function type, e.g. writing to a serial port or a file.
+   * @param[in] data The data to output.
+   * @param[in] size The data size.
+   * @return The number of bytes actually output.
+   */
+  using ByteSink = std::function<size_t(const uint8_t* data, size_t size)>;
+
+  /**
+   * @~Chinese
+   * @brief 每帧的字节数。
+   */
+  /**
+   * @~English
+   * @brief The size of each frame in bytes.
+   */
+  static constexpr size_t kFrameSize = 32;
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] id 记录器编号，写入每一帧，用于区分共用一个输出的多个电机。
+   * @param[in] buffer 预先分配的记录缓冲区，生命周期必须长于记录器。
+   * @param[in] capacity 缓冲区可容纳的记录数量，应为2的幂，否则只使用不大于它的最大的2的幂个记录。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] id The recorder id, written into each frame to tell apart motors sharing one sink.
+   * @param[in] buffer The preallocated record buffer, which must outlive the recorder.
+   * @param[in] capacity The number of records the buffer holds, should be a power of two, otherwise only the largest power
+   * of two not above it is used.
+   */
+  TelemetryRecorder(const uint8_t id, TelemetryRecord* const buffer, const size_t capacity);
+
+  /**
+   * @~Chinese
+   * @brief 获取记录器编号。
+   * @return 记录器编号。
+   */
+  /**
+   * @~English
+   * @brief Get the recorder id.
+   * @return The recorder id.
+   */
+  uint8_t Id() const;
+
+  /**
+   * @~Chinese
+   * @brief 写入一条记录，只能由唯一的写入端（控制周期）调用，不加锁。
+   * @param[in] record 记录，@ref TelemetryRecord。
+   * @return 写入成功返回true，缓冲区已满时丢弃该记录并返回false。
+   */
+  /**
+   * @~English
+   * @brief Write a record, only called by the single writer (the control tick), without locking.
+   * @param[in] record The record, @ref TelemetryRecord.
+   * @return true on success, false if the buffer is full and the record was dropped.
+   */
+  bool Record(const TelemetryRecord& record);
+
+  /**
+   * @~Chinese
+   * @brief 读出最早的一条记录，只能由唯一的读取端调用。
+   * @param[out] record 读出的记录。
+   * @return 读出成功返回true，缓冲区为空时返回false。
+   */
+  /**
+   * @~English
+   * @brief Read out the oldest record, only called by the single reader.
+   * @param[out] record The record read out.
+   * @return true on success, false if the buffer is empty.
+   */
+  bool Pop(TelemetryRecord* const record);
+
+  /**
+   * @~Chinese
+   * @brief 获取缓冲区中的记录数量。
+   * @return 记录数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of records in the buffer.
+   * @return The number of records.
+   */
+  size_t Size() const;
+
+  /**
+   * @~Chinese
+   * @brief 获取因缓冲区已满而丢弃的记录数量。
+   * @return 丢弃的记录数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of records dropped because the buffer was full.
+   * @return The number of dropped records.
+   */
+  uint32_t Dropped() const;
+
+  /**
+   * @~Chinese
+   * @brief 读出记录并编码为帧写入字节输出，只能由唯一的读取端调用。
+   * @param[in] sink 字节输出函数，@ref ByteSink。
+   * @param[in] max_records 本次最多输出的记录数量。
+   * @return 输出的记录数量，输出函数写入的字节数不足一帧时停止。
+   */
+  /**
+   * @~English
+   * @brief Read out records, encode them as frames and write them to a byte sink, only called by the single reader.
+   * @param[in] sink The byte sink function, @ref ByteSink.
+   * @param[in] max_records The maximum number of records to output in this call.
+   * @return The number of records output, stops when the sink accepts less than a whole frame.
+   */
+  size_t Stream(const ByteSink& sink, const size_t max_records = SIZE_MAX);
+
+  /**
+   * @~Chinese
+   * @brief 把一条记录编码为帧。
+   * @param[in] id 记录器编号。
+   * @param[in] record 记录，@ref TelemetryRecord。
+   * @param[out] frame 输出缓冲区，长度至少为 @ref kFrameSize。
+   */
+  /**
+   * @~English
+   * @brief Encode a record as a frame.
+   * @param[in] id The recorder id.
+   * @param[in] record The record, @ref TelemetryRecord.
+   * @param[out] frame The output buffer, at least @ref kFrameSize long.
+   */
+  static void EncodeFrame(const uint8_t id, const TelemetryRecord& record, uint8_t* const frame);
+
+ private:
+  const uint8_t id_ = 0;
+  TelemetryRecord* const buffer_ = nullptr;
+  // A power of two, so that the slot stays continuous when the free-running counters wrap around.
+  const size_t capacity_ = 0;
+  // Free-running counters, the slot is the counter masked by the capacity.
+  std::atomic<size_t> head_ = 0;
+  std::atomic<size_t> tail_ = 0;
+  std::atomic<uint32_t> dropped_ = 0;
+};
+
+/**
+ * @~Chinese
+ * @class StaticTelemetryRecorder
+ * @brief 自带定长缓冲区的 @ref TelemetryRecorder。
+ * @tparam kCapacity 缓冲区可容纳的记录数量，必须为2的幂。
+ */
+/**
+ * @~English
+ * @class StaticTelemetryRecorder
+ * @brief A @ref TelemetryRecorder with its own fixed-size buffer.
+ * @tparam kCapacity The number of records the buffer holds, must be a power of two.
+ */
+template <size_t kCapacity>
+class StaticTelemetryRecorder : public TelemetryRecorder {
+ public:
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0);
+
+  /**
+   * @~Chinese
+   * @brief 构造函数。
+   * @param[in] id 记录器编号。
+   */
+  /**
+   * @~English
+   * @brief Constructor.
+   * @param[in] id The recorder id.
+   */
+  explicit StaticTelemetryRecorder(const uint8_t id) : TelemetryRecorder(id, storage_.data(), kCapacity) {
+  }
+
+ private:
+  std::array<TelemetryRecord, kCapacity> storage_;
+};
+
+/**
+ * @~Chinese
+ * @class TelemetryDecoder
+ * @brief 遥测帧的流式解码器，逐字节输入，丢失或损坏的字节会被跳过并在下一个同步字处重新同步。
+ */
+/**
+ * @~English
+ * @class TelemetryDecoder
+ * @brief Streaming decoder of telemetry frames, fed byte by byte, lost or corrupted bytes are skipped and decoding
+ * resynchronizes at the next sync word.
+ */
+class TelemetryDecoder {
+ public:
+  /**
+   * @~Chinese
+   * @brief 输入一个字节。
+   * @param[in] byte 输入的字节。
+   * @param[out] id 解码出一帧时为该帧的记录器编号。
+   * @param[out] record 解码出一帧时为该帧的记录。
+   * @return 解码出一个完整且校验正确的帧时返回true。
+   */
+  /**
+   * @~English
+   * @brief Feed one byte.
+   * @param[in] byte The input byte.
+   * @param[out] id The recorder id of the frame when one is decoded.
+   * @param[out] record The record of the frame when one is decoded.
+   * @return true when a complete frame with a valid checksum was decoded.
+   */
+  bool Push(const uint8_t byte, uint8_t* const id, TelemetryRecord* const record);
+
+  /**
+   * @~Chinese
+   * @brief 获取校验失败的帧数量。
+   * @return 校验失败的帧数量。
+   */
+  /**
+   * @~English
+   * @brief Get the number of frames that failed the checksum.
+   * @return The number of frames that failed the checksum.
+   */
+  uint32_t CrcErrors() const;
+
+ private:
+  std::array<uint8_t, TelemetryRecorder::kFrameSize> frame_ = {};
+  size_t size_ = 0;
+  uint32_t crc_errors_ = 0;
+};
+}  // namespace em
+
+#endif